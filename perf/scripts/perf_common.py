@@ -0,0 +1,70 @@
+#
+# Shared harness of the test_*_perf.py scripts: location of the synfig
+# binary, parsing of the `--benchmarks` output and best-of-N timing.
+#
+# The scripts import it from their own directory, so copy it together with
+# them into the root of the build directory.
+
+import os
+import re
+import time
+import subprocess
+
+SIF_EXE = 'output/bin/synfig'
+NUM_PASSES = 3
+
+RENDERED_RE = re.compile(r': Rendered in ([0-9.eE+-]+)')
+SAVED_RE = re.compile(r': Saved in ([0-9.eE+-]+)')
+
+
+def write_file(path, text):
+    with open(path, 'w') as f:
+        f.write(text)
+
+
+def best_of(func, passes=NUM_PASSES):
+    """Returns the minimum of `passes` calls of `func`."""
+    return min(func() for i in range(0, passes))
+
+
+def benchmark(args, regex=RENDERED_RE, env=None):
+    """Runs synfig with `--benchmarks` and returns the time it reports."""
+    if env is not None:
+        env = dict(os.environ, **env)
+    result = subprocess.run(
+        [SIF_EXE] + args + ['--benchmarks', '--quiet'],
+        stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, universal_newlines=True, env=env
+    )
+    match = regex.search(result.stdout)
+    if not match:
+        raise RuntimeError('no time reported for %s' % ' '.join(args))
+    return float(match.group(1))
+
+
+def render_time(sif_path, out_path, args=(), env=None):
+    """Renders `sif_path` to `out_path` and returns the reported render time."""
+    return benchmark([sif_path, '-o', out_path] + list(args), RENDERED_RE, env)
+
+
+def best_render_time(sif_path, out_path, args=(), env=None, passes=NUM_PASSES):
+    return best_of(lambda: render_time(sif_path, out_path, args, env), passes)
+
+
+def wall_time(args, env=None):
+    """Runs synfig and returns its wall clock time, fails if synfig fails."""
+    if env is not None:
+        env = dict(os.environ, **env)
+    start = time.perf_counter()
+    subprocess.run(
+        [SIF_EXE] + args + ['--quiet'],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, env=env, check=True
+    )
+    return time.perf_counter() - start
+
+
+def sif_files(sif_dir, argv):
+    """Returns files given in the command line, or all documents of `sif_dir`."""
+    if len(argv) > 1:
+        return argv[1:]
+    return [os.path.join(sif_dir, x) for x in sorted(os.listdir(sif_dir))
+            if x.endswith('.sif') or x.endswith('.sifz')]
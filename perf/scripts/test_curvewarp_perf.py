@@ -0,0 +1,93 @@
+#!/usr/bin/python3
+#
+# This script measures how long it takes synfig to render a Curve Warp layer
+# with splines of different complexity (10, 100 and 1000 vertices).  The test
+# files are generated into a temporary directory: a checkerboard warped along a
+# wavy spline, so the render time is dominated by the closest point search of
+# the Curve Warp layer.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_curvewarp_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed times.
+
+import math
+import os
+import tempfile
+
+from perf_common import best_render_time
+
+NUM_PASSES = 5
+VERTEX_COUNTS = (10, 100, 1000)
+SIZE = 480
+
+SIF_HEADER = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%d" height="%d" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="0f" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="checker_board" active="true" version="0.1">
+    <param name="color"><color><r>1.0</r><g>1.0</g><b>1.0</b><a>1.0</a></color></param>
+    <param name="origin"><vector><x>0.0</x><y>0.0</y></vector></param>
+    <param name="size"><vector><x>0.25</x><y>0.25</y></vector></param>
+  </layer>
+  <layer type="curve_warp" active="true" version="0.0">
+    <param name="origin"><vector><x>0.0</x><y>0.0</y></vector></param>
+    <param name="perp_width"><real value="1.0"/></param>
+    <param name="start_point"><vector><x>-3.5</x><y>0.0</y></vector></param>
+    <param name="end_point"><vector><x>3.5</x><y>0.0</y></vector></param>
+    <param name="fast"><bool value="%s"/></param>
+    <param name="bline">
+      <bline type="bline_point" loop="false">
+'''
+
+SIF_ENTRY = '''        <entry>
+          <composite type="bline_point">
+            <point><vector><x>%.10f</x><y>%.10f</y></vector></point>
+            <width><real value="1.0"/></width>
+            <origin><real value="0.5"/></origin>
+            <split><bool value="false"/></split>
+            <t1><vector><x>%.10f</x><y>%.10f</y></vector></t1>
+            <t2><vector><x>%.10f</x><y>%.10f</y></vector></t2>
+          </composite>
+        </entry>
+'''
+
+SIF_FOOTER = '''      </bline>
+    </param>
+  </layer>
+</canvas>
+'''
+
+
+def write_sif(path, vertex_count, fast):
+    with open(path, 'w') as f:
+        f.write(SIF_HEADER % (SIZE, SIZE * 9 // 16, 'true' if fast else 'false'))
+        step = 7.0 / (vertex_count - 1)
+        for i in range(0, vertex_count):
+            x = -3.5 + i * step
+            y = 1.5 * math.sin(x * 2.0)
+            # tangent of the sine, scaled to the segment length
+            dy = 3.0 * math.cos(x * 2.0)
+            f.write(SIF_ENTRY % (x, y, step, dy * step, step, dy * step))
+        f.write(SIF_FOOTER)
+
+
+def main():
+    total = 0.0
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        print('%-10s %8s %12s' % ('vertices', 'fast', 'time (s)'))
+        for vertex_count in VERTEX_COUNTS:
+            for fast in (True, False):
+                sif_path = os.path.join(tmp_dir, 'curvewarp_%d.sif' % vertex_count)
+                out_path = os.path.join(tmp_dir, 'out.png')
+                write_sif(sif_path, vertex_count, fast)
+                best = best_render_time(sif_path, out_path, passes=NUM_PASSES)
+                total += best
+                print('%-10d %8s %12.4f' % (vertex_count, 'yes' if fast else 'no', best))
+
+    print('Total render time: %.4f sec' % total)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/python3
+#
+# This script measures how long it takes synfig to render an animation that
+# imports a video clip through the ffmpeg importer.  A 1000 frames test clip is
+# generated into a temporary directory with ffmpeg, so ffmpeg must be available
+# in PATH.  Every frame of the document shows the next frame of the clip, so
+# the render time is dominated by video decoding.  This is repeated for
+# documents of 24, 25 and 30 fps.
+#
+# Before timing, each frame rate is checked for the correctness: the document
+# imports a short lossless clip where every frame has its own gray level, and
+# the rendered frames must show the frames of the clip with the same numbers.
+# Pillow is required for the check.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_ffmpeg_import_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed times.
+
+import os
+import glob
+import tempfile
+import subprocess
+
+from PIL import Image
+
+from perf_common import best_render_time, render_time
+
+FFMPEG_EXE = 'ffmpeg'
+NUM_PASSES = 3
+FRAME_COUNT = 1000
+RATES = (24, 25, 30)
+SIZE = 320
+
+CHECK_FRAME_COUNT = 24
+CHECK_STEP = 10
+CHECK_TOLERANCE = 4
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%d" height="%d" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="%d.000" begin-time="0f" end-time="%df" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="import" active="true" version="0.1">
+    <param name="tl"><vector><x>-4.0</x><y>2.25</y></vector></param>
+    <param name="br"><vector><x>4.0</x><y>-2.25</y></vector></param>
+    <param name="filename"><string>%s</string></param>
+  </layer>
+</canvas>
+'''
+
+
+def write_clip(path, fps):
+    subprocess.run(
+        [FFMPEG_EXE, '-y', '-f', 'lavfi',
+         '-i', 'testsrc=size=%dx%d:rate=%d' % (SIZE, SIZE * 9 // 16, fps),
+         '-frames:v', str(FRAME_COUNT), path],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, check=True
+    )
+
+
+def write_check_clip(path, fps):
+    # lossless, the gray level of the frame N is N*CHECK_STEP
+    subprocess.run(
+        [FFMPEG_EXE, '-y', '-f', 'lavfi',
+         '-i', 'color=c=black:size=64x36:rate=%d,format=gray,geq=lum=N*%d' % (fps, CHECK_STEP),
+         '-frames:v', str(CHECK_FRAME_COUNT), '-c:v', 'ffv1', path],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, check=True
+    )
+
+
+def write_sif(path, width, height, fps, frame_count, clip_path):
+    with open(path, 'w') as f:
+        f.write(SIF_TEMPLATE % (width, height, fps, frame_count - 1, clip_path))
+
+
+def check_rate(tmp_dir, fps):
+    clip_path = os.path.join(tmp_dir, 'check_%d.avi' % fps)
+    sif_path = os.path.join(tmp_dir, 'check_%d.sif' % fps)
+    out_dir = os.path.join(tmp_dir, 'check_%d' % fps)
+    os.mkdir(out_dir)
+    write_check_clip(clip_path, fps)
+    write_sif(sif_path, 64, 36, fps, CHECK_FRAME_COUNT, clip_path)
+    render_time(sif_path, os.path.join(out_dir, 'out.png'))
+
+    frames = sorted(glob.glob(os.path.join(out_dir, 'out*.png')))
+    if len(frames) != CHECK_FRAME_COUNT:
+        raise RuntimeError('%d fps: %d frames rendered instead of %d' % (fps, len(frames), CHECK_FRAME_COUNT))
+    for index, frame_path in enumerate(frames):
+        level = Image.open(frame_path).convert('RGB').getpixel((32, 18))[0]
+        if abs(level - index * CHECK_STEP) > CHECK_TOLERANCE:
+            raise RuntimeError('%d fps: frame %d shows gray level %d instead of %d'
+                               % (fps, index, level, index * CHECK_STEP))
+
+
+def main():
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        print('%-10s %10s %12s %12s' % ('fps', 'frames', 'time (s)', 's/frame'))
+        for fps in RATES:
+            check_rate(tmp_dir, fps)
+            clip_path = os.path.join(tmp_dir, 'clip_%d.mp4' % fps)
+            sif_path = os.path.join(tmp_dir, 'import_%d.sif' % fps)
+            out_path = os.path.join(tmp_dir, 'out.png')
+            write_clip(clip_path, fps)
+            write_sif(sif_path, SIZE, SIZE * 9 // 16, fps, FRAME_COUNT, clip_path)
+            best = best_render_time(sif_path, out_path, passes=NUM_PASSES)
+            print('%-10d %10d %12.4f %12.4f' % (fps, FRAME_COUNT, best, best / FRAME_COUNT))
+
+
+if __name__ == '__main__':
+    main()
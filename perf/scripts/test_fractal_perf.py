@@ -0,0 +1,76 @@
+#!/usr/bin/python3
+#
+# This script measures the rendering speed of the Mandelbrot Set and Julia Set
+# layers in megapixels per second for several iteration counts.  The test files
+# are generated into a temporary directory: each one contains a single fractal
+# layer over a solid background, with distortion of the context enabled, so
+# both the fractal evaluation and the context sampling are measured.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_fractal_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed speeds.
+
+import os
+import tempfile
+
+from perf_common import best_render_time
+
+NUM_PASSES = 3
+ITERATION_COUNTS = (32, 256, 2048)
+WIDTH = 640
+HEIGHT = 360
+
+SIF_HEADER = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%d" height="%d" xres="2834.645669" yres="2834.645669" view-box="-2.5 1.125 1.5 -1.125" antialias="1" fps="24.000" begin-time="0f" end-time="0f" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="checker_board" active="true" version="0.1">
+    <param name="color"><color><r>1.0</r><g>1.0</g><b>1.0</b><a>1.0</a></color></param>
+    <param name="origin"><vector><x>0.0</x><y>0.0</y></vector></param>
+    <param name="size"><vector><x>0.25</x><y>0.25</y></vector></param>
+  </layer>
+'''
+
+SIF_MANDELBROT = '''  <layer type="mandelbrot" active="true" version="0.2">
+    <param name="iterations"><integer value="%d"/></param>
+    <param name="bailout"><real value="2.0"/></param>
+  </layer>
+'''
+
+SIF_JULIA = '''  <layer type="julia" active="true" version="0.1">
+    <param name="iterations"><integer value="%d"/></param>
+    <param name="seed"><vector><x>-0.8</x><y>0.156</y></vector></param>
+    <param name="color_outside"><bool value="false"/></param>
+  </layer>
+'''
+
+SIF_FOOTER = '''</canvas>
+'''
+
+LAYERS = (('mandelbrot', SIF_MANDELBROT), ('julia', SIF_JULIA))
+
+
+def write_sif(path, layer, iterations):
+    with open(path, 'w') as f:
+        f.write(SIF_HEADER % (WIDTH, HEIGHT))
+        f.write(layer % iterations)
+        f.write(SIF_FOOTER)
+
+
+def main():
+    megapixels = WIDTH * HEIGHT / 1000000.0
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        print('%-12s %10s %12s %12s' % ('layer', 'iterations', 'time (s)', 'MP/s'))
+        for name, layer in LAYERS:
+            for iterations in ITERATION_COUNTS:
+                sif_path = os.path.join(tmp_dir, '%s_%d.sif' % (name, iterations))
+                out_path = os.path.join(tmp_dir, 'out.png')
+                write_sif(sif_path, layer, iterations)
+                best = best_render_time(sif_path, out_path, passes=NUM_PASSES)
+                print('%-12s %10d %12.4f %12.2f' % (name, iterations, best, megapixels / best if best > 0 else 0.0))
+
+
+if __name__ == '__main__':
+    main()
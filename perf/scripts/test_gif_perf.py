@@ -0,0 +1,76 @@
+#!/usr/bin/python3
+#
+# This script measures how long it takes synfig to export a 100 frames 720p
+# animation into GIF.  The test document is an animated gradient with a moving
+# circle, so there are many distinct colors in each frame and the time is
+# dominated by palette generation and color mapping of the GIF target.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_gif_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed times.
+
+import os
+import tempfile
+
+from perf_common import best_render_time
+
+NUM_PASSES = 3
+FRAME_COUNT = 100
+WIDTH = 1280
+HEIGHT = 720
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%d" height="%d" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="%df" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="linear_gradient" active="true" version="0.0">
+    <param name="p1"><vector><x>-4.0</x><y>0.0</y></vector></param>
+    <param name="p2">
+      <animated type="vector">
+        <waypoint time="0f" before="linear" after="linear"><vector><x>4.0</x><y>2.0</y></vector></waypoint>
+        <waypoint time="%df" before="linear" after="linear"><vector><x>4.0</x><y>-2.0</y></vector></waypoint>
+      </animated>
+    </param>
+    <param name="gradient">
+      <gradient>
+        <color pos="0.0"><r>1.0</r><g>0.2</g><b>0.1</b><a>1.0</a></color>
+        <color pos="1.0"><r>0.1</r><g>0.3</g><b>1.0</b><a>1.0</a></color>
+      </gradient>
+    </param>
+  </layer>
+  <layer type="circle" active="true" version="0.2">
+    <param name="color"><color><r>1.0</r><g>1.0</g><b>1.0</b><a>1.0</a></color></param>
+    <param name="radius"><real value="1.0"/></param>
+    <param name="origin">
+      <animated type="vector">
+        <waypoint time="0f" before="linear" after="linear"><vector><x>-3.0</x><y>0.0</y></vector></waypoint>
+        <waypoint time="%df" before="linear" after="linear"><vector><x>3.0</x><y>0.0</y></vector></waypoint>
+      </animated>
+    </param>
+  </layer>
+</canvas>
+'''
+
+
+
+def write_sif(path):
+    last = FRAME_COUNT - 1
+    with open(path, 'w') as f:
+        f.write(SIF_TEMPLATE % (WIDTH, HEIGHT, last, last, last))
+
+
+def main():
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        sif_path = os.path.join(tmp_dir, 'gif.sif')
+        out_path = os.path.join(tmp_dir, 'out.gif')
+        write_sif(sif_path)
+        best = best_render_time(sif_path, out_path, ['-t', 'gif'], passes=NUM_PASSES)
+        print('%-12s %10s %12s %12s' % ('size', 'frames', 'time (s)', 'frames/s'))
+        print('%-12s %10d %12.4f %12.2f' % (
+            '%dx%d' % (WIDTH, HEIGHT), FRAME_COUNT, best, FRAME_COUNT / best))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,132 @@
+#!/usr/bin/python3
+#
+# This script measures how fast synfig renders a batch of short files when
+# several of them are processed simultaneously (the --jobs option).  Each
+# test document is a small animation, so a single job does not load all the
+# cores.  The script prints the wall time of the whole batch for each count
+# of simultaneous jobs.
+#
+# Before timing, two documents which import the same image and the same
+# video are rendered with `--jobs 2`, because the jobs share the importers of
+# these files.  Their frames must equal the frames rendered with `--jobs 1`.
+# ffmpeg (for the test clip) and Pillow are required for the check.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_job_list_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed numbers.
+
+import os
+import glob
+import tempfile
+import subprocess
+
+from PIL import Image, ImageChops
+
+from perf_common import best_of, wall_time
+
+NUM_PASSES = 3
+FILE_COUNT = 8
+FRAME_COUNT = 24
+JOBS = (1, 2, 4, os.cpu_count() or 1)
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="320" height="180" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="%df" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="circle" active="true" version="0.2">
+    <param name="color"><color><r>%f</r><g>0.5</g><b>0.2</b><a>1.0</a></color></param>
+    <param name="radius"><real value="1.0"/></param>
+    <param name="origin">
+      <animated type="vector">
+        <waypoint time="0f" before="linear" after="linear"><vector><x>-3.0</x><y>0.0</y></vector></waypoint>
+        <waypoint time="%df" before="linear" after="linear"><vector><x>3.0</x><y>0.0</y></vector></waypoint>
+      </animated>
+    </param>
+  </layer>
+</canvas>
+'''
+
+SHARED_PASSES = 5
+
+SHARED_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="320" height="180" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="%df" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="import" active="true" version="0.1">
+    <param name="tl"><vector><x>-4.0</x><y>2.25</y></vector></param>
+    <param name="br"><vector><x>0.0</x><y>-2.25</y></vector></param>
+    <param name="filename"><string>%s</string></param>
+  </layer>
+  <layer type="import" active="true" version="0.1">
+    <param name="tl"><vector><x>0.0</x><y>2.25</y></vector></param>
+    <param name="br"><vector><x>4.0</x><y>-2.25</y></vector></param>
+    <param name="filename"><string>%s</string></param>
+  </layer>
+</canvas>
+'''
+
+
+def write_shared_files(tmp_dir):
+    image_path = os.path.join(tmp_dir, 'shared.png')
+    clip_path = os.path.join(tmp_dir, 'shared.avi')
+    Image.radial_gradient('L').convert('RGB').save(image_path)
+    subprocess.run(
+        ['ffmpeg', '-y', '-f', 'lavfi', '-i', 'testsrc=size=160x180:rate=24',
+         '-frames:v', str(FRAME_COUNT), '-c:v', 'ffv1', clip_path],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, check=True
+    )
+    paths = []
+    for i in range(0, 2):
+        path = os.path.join(tmp_dir, 'shared_%d.sif' % i)
+        with open(path, 'w') as f:
+            f.write(SHARED_TEMPLATE % (FRAME_COUNT - 1, image_path, clip_path))
+        paths.append(path)
+    return paths
+
+
+def check_shared(tmp_dir):
+    paths = write_shared_files(tmp_dir)
+    wall_time(paths + ['-t', 'png', '--jobs', '1'])
+    frames = sorted(glob.glob(os.path.join(tmp_dir, 'shared_*.*.png')))
+    if len(frames) != 2 * FRAME_COUNT:
+        raise RuntimeError('%d frames rendered instead of %d' % (len(frames), 2 * FRAME_COUNT))
+    reference = [Image.open(path).convert('RGBA') for path in frames]
+
+    for i in range(0, SHARED_PASSES):
+        for path in frames:
+            os.remove(path)
+        wall_time(paths + ['-t', 'png', '--jobs', '2'])
+        for path, expected in zip(frames, reference):
+            if not os.path.exists(path):
+                raise RuntimeError('--jobs 2: frame %s is not rendered' % os.path.basename(path))
+            if ImageChops.difference(Image.open(path).convert('RGBA'), expected).getbbox():
+                raise RuntimeError('--jobs 2: frame %s differs from --jobs 1' % os.path.basename(path))
+
+
+def write_files(tmp_dir):
+    last = FRAME_COUNT - 1
+    paths = []
+    for i in range(0, FILE_COUNT):
+        path = os.path.join(tmp_dir, 'job_%d.sif' % i)
+        with open(path, 'w') as f:
+            f.write(SIF_TEMPLATE % (last, float(i) / FILE_COUNT, last))
+        paths.append(path)
+    return paths
+
+
+def render_time(paths, jobs):
+    return wall_time(paths + ['-t', 'png', '--jobs', str(jobs)])
+
+
+def main():
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        check_shared(tmp_dir)
+        paths = write_files(tmp_dir)
+        print('%-8s %12s %12s' % ('jobs', 'time (s)', 'frames/s'))
+        for jobs in JOBS:
+            best = best_of(lambda: render_time(paths, jobs), NUM_PASSES)
+            print('%-8d %12.4f %12.2f' % (jobs, best, FILE_COUNT * FRAME_COUNT / best))
+
+
+if __name__ == '__main__':
+    main()
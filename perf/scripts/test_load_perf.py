@@ -0,0 +1,99 @@
+#!/usr/bin/python3
+#
+# This script measures how long it takes synfig to load .sif/.sifz files, and
+# how much memory the loader needs, comparing the streaming loader (default)
+# against the old DOM based one (enabled with SYNFIG_LOADER_USE_DOM=1) and
+# against the binary document cache (enabled with --canvas-cache).  The
+# cache holds the element tree only, so the `cached` mode still builds layers
+# and value nodes from text; it saves decompression and XML lexing.  The
+# `cached` mode reports the best pass, so it measures a warm cache; the `miss`
+# mode clears the cache before every pass, so it measures parsing of the file
+# together with writing of the cache.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there.  Files are passed
+# as arguments, or taken from the `synfig-tests` repo when no argument is
+# given:
+#
+#   ./test_load_perf.py big_scene.sifz other_scene.sif
+#
+# Only the loading is measured: synfig is asked for `--canvas-info` and no frame
+# is rendered.  The peak RSS of the child process is reported in megabytes.
+
+import os
+import sys
+import time
+import tempfile
+import resource
+import subprocess
+
+from perf_common import SIF_EXE, sif_files
+
+SIF_DIR = 'synfig-tests/export/lottie/'
+NUM_PASSES = 5
+
+MODES = [
+    ('stream', {}, []),
+    ('dom', {'SYNFIG_LOADER_USE_DOM': '1'}, []),
+    ('cached', {}, ['--canvas-cache']),
+    ('miss', {}, ['--canvas-cache']),
+]
+
+
+def run_once(sif_path, extra_env, extra_args):
+    env = dict(os.environ)
+    env.update(extra_env)
+
+    # getrusage(RUSAGE_CHILDREN) only reports the maximum over all waited
+    # children, so every measurement runs in its own forked process
+    read_fd, write_fd = os.pipe()
+    pid = os.fork()
+    if pid == 0:
+        os.close(read_fd)
+        st = time.time()
+        subprocess.run(
+            [SIF_EXE, sif_path, '--canvas-info', 'name', '--quiet'] + extra_args,
+            env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL
+        )
+        et = time.time()
+        rss_kb = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+        os.write(write_fd, ('%f %d' % (et - st, rss_kb)).encode())
+        os._exit(0)
+
+    os.close(write_fd)
+    data = os.read(read_fd, 64).decode()
+    os.close(read_fd)
+    os.waitpid(pid, 0)
+    elapsed, rss_kb = data.split()
+    return float(elapsed), int(rss_kb) / 1024.0
+
+
+def main():
+    all_sif = sif_files(SIF_DIR, sys.argv)
+
+    # keep cache files out of the test data
+    cache_dirs = {}
+    for mode, env, args in MODES:
+        if '--canvas-cache' in args:
+            cache_dirs[mode] = tempfile.TemporaryDirectory()
+            env['SYNFIG_CANVAS_CACHE_DIR'] = cache_dirs[mode].name
+
+    print('%-40s %8s %12s %12s' % ('file', 'mode', 'time (s)', 'peak RSS (MB)'))
+    for sif in all_sif:
+        for mode, env, args in MODES:
+            times = []
+            peak = 0.0
+            for i in range(0, NUM_PASSES):
+                if mode == 'miss':
+                    for name in os.listdir(cache_dirs[mode].name):
+                        os.remove(os.path.join(cache_dirs[mode].name, name))
+                elapsed, rss = run_once(sif, env, args)
+                times.append(elapsed)
+                peak = max(peak, rss)
+            print('%-40s %8s %12.4f %12.1f' % (os.path.basename(sif), mode, min(times), peak))
+    for cache_dir in cache_dirs.values():
+        cache_dir.cleanup()
+
+
+if __name__ == '__main__':
+    main()
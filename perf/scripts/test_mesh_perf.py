@@ -0,0 +1,67 @@
+#!/usr/bin/python3
+#
+# This script measures how long it takes synfig to render a mesh deformation:
+# a checkerboard under a Skeleton Deformation layer with a dense grid
+# (200x200 subdivisions, with a 50x50 grid for comparison).  The test files are
+# generated into a temporary directory.  The default bone keeps the grid
+# undeformed, so the render time is dominated by the triangle rasterizer
+# (software::Mesh) rather than by the skeleton math.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_mesh_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed times.
+
+import os
+import tempfile
+
+from perf_common import best_render_time
+
+NUM_PASSES = 5
+SUBDIVISIONS = (50, 200)
+WIDTH = 1280
+HEIGHT = 720
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%d" height="%d" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="0f" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="checker_board" active="true" version="0.1">
+    <param name="color"><color><r>1.0</r><g>1.0</g><b>1.0</b><a>1.0</a></color></param>
+    <param name="origin"><vector><x>0.0</x><y>0.0</y></vector></param>
+    <param name="size"><vector><x>0.25</x><y>0.25</y></vector></param>
+  </layer>
+  <layer type="skeleton_deformation" active="true" version="0.2">
+    <param name="point1"><vector><x>-4.0</x><y>2.25</y></vector></param>
+    <param name="point2"><vector><x>4.0</x><y>-2.25</y></vector></param>
+    <param name="x_subdivisions"><integer value="%d"/></param>
+    <param name="y_subdivisions"><integer value="%d"/></param>
+  </layer>
+</canvas>
+'''
+
+
+def write_sif(path, subdivisions):
+    with open(path, 'w') as f:
+        f.write(SIF_TEMPLATE % (WIDTH, HEIGHT, subdivisions, subdivisions))
+
+
+def main():
+    total = 0.0
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        print('%-14s %12s %12s' % ('grid', 'triangles', 'time (s)'))
+        for subdivisions in SUBDIVISIONS:
+            sif_path = os.path.join(tmp_dir, 'mesh_%d.sif' % subdivisions)
+            out_path = os.path.join(tmp_dir, 'out.png')
+            write_sif(sif_path, subdivisions)
+            best = best_render_time(sif_path, out_path, passes=NUM_PASSES)
+            total += best
+            grid = '%dx%d' % (subdivisions, subdivisions)
+            print('%-14s %12d %12.4f' % (grid, 2 * subdivisions * subdivisions, best))
+
+    print('Total render time: %.4f sec' % total)
+
+
+if __name__ == '__main__':
+    main()
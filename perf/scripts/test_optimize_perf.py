@@ -0,0 +1,88 @@
+#!/usr/bin/python3
+#
+# This script measures how long the renderer takes to optimize the task tree
+# of a task-heavy scene.  Each test document is a flat list of small circles,
+# so its rendering task is a chain of nested blend tasks as deep as the count
+# of layers.  Below the circles lies a rotated rectangle, so the only
+# transformation task is at the bottom of the chain, and the transformation
+# pass has to reach it through every blend.  The image is tiny, so the frame
+# time is dominated by building and optimizing the tasks rather than by
+# drawing.  The test files are generated into a temporary directory.
+#
+# The optimization time is taken from the profile summary that synfig writes
+# with `--profile <file> --profile-format json` (the `optimize` phase).  If the
+# time grows much faster than the count of layers, some optimizer pass walks
+# the chain again for each of its levels.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_optimize_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed times.
+
+import os
+import json
+import tempfile
+
+from perf_common import best_of, wall_time
+
+NUM_PASSES = 3
+LAYER_COUNTS = (250, 500, 1000, 2000)
+
+SIF_HEADER = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="64" height="36" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="0f" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="rectangle" active="true" version="0.2">
+    <param name="color"><color><r>0.2</r><g>0.2</g><b>0.8</b><a>1.0</a></color></param>
+    <param name="point1"><vector><x>-1.0</x><y>-1.0</y></vector></param>
+    <param name="point2"><vector><x>1.0</x><y>1.0</y></vector></param>
+  </layer>
+  <layer type="rotate" active="true" version="0.1">
+    <param name="origin"><vector><x>0.0</x><y>0.0</y></vector></param>
+    <param name="amount"><angle value="30.0"/></param>
+  </layer>
+'''
+
+SIF_LAYER = '''  <layer type="circle" active="true" version="0.2">
+    <param name="color"><color><r>%f</r><g>0.5</g><b>0.2</b><a>0.5</a></color></param>
+    <param name="radius"><real value="0.5"/></param>
+    <param name="origin"><vector><x>%f</x><y>%f</y></vector></param>
+  </layer>
+'''
+
+SIF_FOOTER = '''</canvas>
+'''
+
+
+def write_sif(path, count):
+    with open(path, 'w') as f:
+        f.write(SIF_HEADER)
+        for i in range(0, count):
+            f.write(SIF_LAYER % (i / float(count), (i % 16) * 0.5 - 4.0, (i % 9) * 0.5 - 2.0))
+        f.write(SIF_FOOTER)
+
+
+def optimize_time(sif_path, out_path, profile_path):
+    """Renders the document and returns (optimize seconds, wall seconds)."""
+    wall = wall_time([sif_path, '-o', out_path, '--profile', profile_path, '--profile-format', 'json'])
+    with open(profile_path) as f:
+        phases = json.load(f)['phases']
+    stat = phases.get('optimize')
+    return (stat['time'] if stat else 0.0, wall)
+
+
+def main():
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        out_path = os.path.join(tmp_dir, 'out.png')
+        profile_path = os.path.join(tmp_dir, 'profile.json')
+        print('%-10s %14s %14s %14s' % ('layers', 'optimize (s)', 'per layer (ms)', 'wall (s)'))
+        for count in LAYER_COUNTS:
+            sif_path = os.path.join(tmp_dir, 'chain_%d.sif' % count)
+            write_sif(sif_path, count)
+            optimize, wall = best_of(lambda: optimize_time(sif_path, out_path, profile_path), NUM_PASSES)
+            print('%-10d %14.4f %14.4f %14.4f' % (count, optimize, 1000.0 * optimize / count, wall))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,125 @@
+#!/usr/bin/python3
+#
+# This script measures how long it takes synfig to render dense Plant layers.
+# The test files are generated into a temporary directory: a plant with many
+# sprouts and splits and a small step (tens of thousands of particles), rendered
+# as a still frame and as an animation where only the origin is animated.  In
+# the animation the particles don't depend on time, so they should be
+# generated once and only drawn on each frame.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_plant_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed times.
+
+import os
+import tempfile
+
+from perf_common import best_render_time
+
+NUM_PASSES = 3
+WIDTH = 1280
+HEIGHT = 720
+ANIMATION_FRAMES = 24
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%(width)d" height="%(height)d" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="%(end)df" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="plant" active="true" version="0.2">
+    <param name="origin">%(origin)s</param>
+    <param name="gradient">
+      <gradient>
+        <color pos="0.0"><r>0.1</r><g>0.4</g><b>0.05</b><a>1.0</a></color>
+        <color pos="1.0"><r>0.6</r><g>1.0</g><b>0.3</b><a>0.5</a></color>
+      </gradient>
+    </param>
+    <param name="split_angle"><angle value="15.0"/></param>
+    <param name="gravity"><vector><x>0.0</x><y>-0.1</y></vector></param>
+    <param name="velocity"><real value="0.5"/></param>
+    <param name="perp_velocity"><real value="0.0"/></param>
+    <param name="size"><real value="%(size)f"/></param>
+    <param name="size_as_alpha"><bool value="false"/></param>
+    <param name="reverse"><bool value="true"/></param>
+    <param name="step"><real value="%(step)f"/></param>
+    <param name="seed"><integer value="1234"/></param>
+    <param name="splits"><integer value="%(splits)d"/></param>
+    <param name="sprouts"><integer value="%(sprouts)d"/></param>
+    <param name="random_factor"><real value="0.2"/></param>
+    <param name="drag"><real value="0.1"/></param>
+    <param name="use_width"><bool value="true"/></param>
+    <param name="bline">
+      <bline type="bline_point" loop="false">
+        <entry>
+          <composite type="bline_point">
+            <point><vector><x>-3.0</x><y>-1.5</y></vector></point>
+            <width><real value="1.0"/></width>
+            <origin><real value="0.5"/></origin>
+            <split><bool value="false"/></split>
+            <t1><vector><x>3.0</x><y>3.0</y></vector></t1>
+            <t2><vector><x>3.0</x><y>3.0</y></vector></t2>
+          </composite>
+        </entry>
+        <entry>
+          <composite type="bline_point">
+            <point><vector><x>3.0</x><y>-1.5</y></vector></point>
+            <width><real value="1.0"/></width>
+            <origin><real value="0.5"/></origin>
+            <split><bool value="false"/></split>
+            <t1><vector><x>3.0</x><y>-3.0</y></vector></t1>
+            <t2><vector><x>3.0</x><y>-3.0</y></vector></t2>
+          </composite>
+        </entry>
+      </bline>
+    </param>
+  </layer>
+</canvas>
+'''
+
+STATIC_ORIGIN = '<vector><x>0.0</x><y>0.0</y></vector>'
+
+ANIMATED_ORIGIN = '''<animated type="vector">
+        <waypoint time="0f" before="linear" after="linear"><vector><x>-0.5</x><y>0.0</y></vector></waypoint>
+        <waypoint time="%df" before="linear" after="linear"><vector><x>0.5</x><y>0.0</y></vector></waypoint>
+      </animated>''' % (ANIMATION_FRAMES - 1)
+
+# (name, step, splits, sprouts, size, animated)
+TESTS = (
+    ('still',     0.005,  6, 40, 0.015, False),
+    ('dense',     0.001,  8, 60, 0.010, False),
+    ('animated',  0.005,  6, 40, 0.015, True),
+)
+
+
+def write_sif(path, step, splits, sprouts, size, animated):
+    with open(path, 'w') as f:
+        f.write(SIF_TEMPLATE % {
+            'width': WIDTH,
+            'height': HEIGHT,
+            'end': ANIMATION_FRAMES - 1 if animated else 0,
+            'origin': ANIMATED_ORIGIN if animated else STATIC_ORIGIN,
+            'step': step,
+            'splits': splits,
+            'sprouts': sprouts,
+            'size': size,
+        })
+
+
+def main():
+    total = 0.0
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        print('%-10s %8s %12s' % ('test', 'frames', 'time (s)'))
+        for name, step, splits, sprouts, size, animated in TESTS:
+            sif_path = os.path.join(tmp_dir, 'plant_%s.sif' % name)
+            out_path = os.path.join(tmp_dir, 'out.png')
+            write_sif(sif_path, step, splits, sprouts, size, animated)
+            best = best_render_time(sif_path, out_path, passes=NUM_PASSES)
+            total += best
+            print('%-10s %8d %12.4f' % (name, ANIMATION_FRAMES if animated else 1, best))
+
+    print('Total render time: %.4f sec' % total)
+
+
+if __name__ == '__main__':
+    main()
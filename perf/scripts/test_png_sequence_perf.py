@@ -0,0 +1,85 @@
+#!/usr/bin/python3
+#
+# This script measures how fast synfig writes PNG sequences at 1080p and 4K.
+# The test document is a simple animated gradient with a moving circle, so
+# rendering is cheap and the time is dominated by PNG compression.  The
+# script prints frames per second for each resolution, with the default
+# compression and with the fast one (SYNFIG_PNG_COMPRESSION_LEVEL=1).
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_png_sequence_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed numbers.
+
+import os
+import tempfile
+
+from perf_common import best_render_time
+
+NUM_PASSES = 3
+FRAME_COUNT = 48
+SIZES = ((1920, 1080), (3840, 2160))
+LEVELS = (None, 1)
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%d" height="%d" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="%df" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="linear_gradient" active="true" version="0.0">
+    <param name="p1"><vector><x>-4.0</x><y>0.0</y></vector></param>
+    <param name="p2">
+      <animated type="vector">
+        <waypoint time="0f" before="linear" after="linear"><vector><x>4.0</x><y>2.0</y></vector></waypoint>
+        <waypoint time="%df" before="linear" after="linear"><vector><x>4.0</x><y>-2.0</y></vector></waypoint>
+      </animated>
+    </param>
+    <param name="gradient">
+      <gradient>
+        <color pos="0.0"><r>1.0</r><g>0.2</g><b>0.1</b><a>1.0</a></color>
+        <color pos="1.0"><r>0.1</r><g>0.3</g><b>1.0</b><a>1.0</a></color>
+      </gradient>
+    </param>
+  </layer>
+  <layer type="circle" active="true" version="0.2">
+    <param name="color"><color><r>1.0</r><g>1.0</g><b>1.0</b><a>1.0</a></color></param>
+    <param name="radius"><real value="1.0"/></param>
+    <param name="origin">
+      <animated type="vector">
+        <waypoint time="0f" before="linear" after="linear"><vector><x>-3.0</x><y>0.0</y></vector></waypoint>
+        <waypoint time="%df" before="linear" after="linear"><vector><x>3.0</x><y>0.0</y></vector></waypoint>
+      </animated>
+    </param>
+  </layer>
+</canvas>
+'''
+
+
+def write_sif(path, width, height):
+    last = FRAME_COUNT - 1
+    with open(path, 'w') as f:
+        f.write(SIF_TEMPLATE % (width, height, last, last, last))
+
+
+def render_time(sif_path, out_path, level):
+    env = {} if level is None else {'SYNFIG_PNG_COMPRESSION_LEVEL': str(level)}
+    return best_render_time(sif_path, out_path, ['-t', 'png'], env, NUM_PASSES)
+
+
+def main():
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        print('%-12s %10s %12s %12s' % ('size', 'level', 'time (s)', 'frames/s'))
+        for width, height in SIZES:
+            sif_path = os.path.join(tmp_dir, 'sequence_%dx%d.sif' % (width, height))
+            out_path = os.path.join(tmp_dir, 'out.png')
+            write_sif(sif_path, width, height)
+            for level in LEVELS:
+                best = render_time(sif_path, out_path, level)
+                print('%-12s %10s %12.4f %12.2f' % (
+                    '%dx%d' % (width, height),
+                    'default' if level is None else str(level),
+                    best, FRAME_COUNT / best))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,67 @@
+#!/usr/bin/python3
+#
+# This script measures how long it takes synfig to render a Radial Blur layer
+# of different sizes (0.05, 0.2 and 0.8), with and without fade out.  The test
+# files are generated into a temporary directory: a checkerboard blurred
+# towards the center of the image, so the render time is dominated by the
+# radial blur.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there:
+#
+#   ./test_radialblur_perf.py
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed times.
+
+import os
+import tempfile
+
+from perf_common import best_render_time
+
+NUM_PASSES = 5
+SIZES = (0.05, 0.2, 0.8)
+WIDTH = 1920
+HEIGHT = 1080
+
+SIF_TEMPLATE = '''<?xml version="1.0" encoding="UTF-8"?>
+<canvas version="1.2" width="%d" height="%d" xres="2834.645669" yres="2834.645669" view-box="-4.0 2.25 4.0 -2.25" antialias="1" fps="24.000" begin-time="0f" end-time="0f" bgcolor="0.5 0.5 0.5 1.0">
+  <layer type="checker_board" active="true" version="0.1">
+    <param name="color"><color><r>1.0</r><g>1.0</g><b>1.0</b><a>1.0</a></color></param>
+    <param name="origin"><vector><x>0.0</x><y>0.0</y></vector></param>
+    <param name="size"><vector><x>0.25</x><y>0.25</y></vector></param>
+  </layer>
+  <layer type="radial_blur" active="true" version="0.1">
+    <param name="amount"><real value="1.0"/></param>
+    <param name="blend_method"><integer value="1"/></param>
+    <param name="origin"><vector><x>0.5</x><y>0.25</y></vector></param>
+    <param name="size"><real value="%f"/></param>
+    <param name="fade_out"><bool value="%s"/></param>
+  </layer>
+</canvas>
+'''
+
+
+def write_sif(path, size, fade_out):
+    with open(path, 'w') as f:
+        f.write(SIF_TEMPLATE % (WIDTH, HEIGHT, size, 'true' if fade_out else 'false'))
+
+
+def main():
+    total = 0.0
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        print('%-10s %8s %12s' % ('size', 'fade', 'time (s)'))
+        for size in SIZES:
+            for fade_out in (False, True):
+                sif_path = os.path.join(tmp_dir, 'radialblur.sif')
+                out_path = os.path.join(tmp_dir, 'out.png')
+                write_sif(sif_path, size, fade_out)
+                best = best_render_time(sif_path, out_path, passes=NUM_PASSES)
+                total += best
+                print('%-10.2f %8s %12.4f' % (size, 'yes' if fade_out else 'no', best))
+
+    print('Total render time: %.4f sec' % total)
+
+
+if __name__ == '__main__':
+    main()
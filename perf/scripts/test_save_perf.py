@@ -0,0 +1,48 @@
+#!/usr/bin/python3
+#
+# This script measures how long it takes synfig to save (re-encode) .sif/.sifz
+# files.  Every file is loaded and written back to a temporary .sif and .sifz
+# file, and the save time reported by `--benchmarks` is collected.
+#
+# As with `test_render_all_perf.py`, place it together with `perf_common.py`
+# in the root of the build directory and run it from there.  Files are passed as arguments, or taken from
+# the `synfig-tests` repo when no argument is given:
+#
+#   ./test_save_perf.py big_scene.sifz other_scene.sif
+#
+# To compare against another revision, run the script with both builds and
+# compare the printed times.
+
+import os
+import sys
+import tempfile
+
+from perf_common import SAVED_RE, benchmark, best_of, sif_files
+
+SIF_DIR = 'synfig-tests/export/lottie/'
+NUM_PASSES = 5
+
+
+def save_time(sif_path, out_path):
+    return benchmark([sif_path, '-t', 'sif', '-o', out_path], SAVED_RE)
+
+
+def main():
+    all_sif = sif_files(SIF_DIR, sys.argv)
+
+    total = {'.sif': 0.0, '.sifz': 0.0}
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        print('%-40s %8s %12s %12s' % ('file', 'format', 'time (s)', 'size (KB)'))
+        for sif in all_sif:
+            for ext in ('.sif', '.sifz'):
+                out_path = os.path.join(tmp_dir, 'out' + ext)
+                best = best_of(lambda: save_time(sif, out_path), NUM_PASSES)
+                total[ext] += best
+                print('%-40s %8s %12.4f %12.1f' % (
+                    os.path.basename(sif), ext, best, os.path.getsize(out_path) / 1024.0))
+
+    print('Total save time: %.4f sec (.sif), %.4f sec (.sifz)' % (total['.sif'], total['.sifz']))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,83 @@
+#!/usr/bin/python3
+#
+# This script prints the hotspots of a render from the profile summary that
+# synfig writes with `--profile <file> --profile-format json`:
+#
+#   output/bin/synfig scene.sifz -o out.png --profile profile.json --profile-format json
+#   ./view_profile_summary.py profile.json
+#
+# It prints the total time of each rendering phase and task type, the
+# distribution of durations of each task type, the utilization of each
+# thread, and the slowest frames of all jobs.  Two summaries can be
+# given; then the second one is compared against the first (reference) one.
+
+import sys
+import json
+
+NUM_TOP = 10
+
+
+def load(filename):
+    with open(filename) as f:
+        return json.load(f)
+
+
+def print_stats(title, stats, ref_stats=None):
+    print(title)
+    rows = sorted(stats.items(), key=lambda item: item[1]['time'], reverse=True)
+    for name, stat in rows[:NUM_TOP]:
+        line = '  %-32s %8d %12.4f' % (name, stat['count'], stat['time'])
+        if ref_stats is not None and name in ref_stats and ref_stats[name]['time'] > 0:
+            line += ' %+8.1f%%' % (100.0 * (stat['time'] / ref_stats[name]['time'] - 1.0))
+        print(line)
+    print()
+
+
+def frame_time(frame):
+    stat = frame['phases'].get('frame')
+    return stat['time'] if stat else 0.0
+
+
+def main():
+    if len(sys.argv) < 2:
+        print('Please supply a profile summary, and optionally a second one to compare')
+        sys.exit(0)
+
+    profile = load(sys.argv[-1])
+    ref = load(sys.argv[1]) if len(sys.argv) > 2 else None
+
+    print('duration: %.4f s' % profile['duration'])
+    print()
+    print_stats('phases (count, seconds):', profile['phases'], ref and ref['phases'])
+    print_stats('tasks (count, seconds):', profile['tasks'], ref and ref['tasks'])
+
+    histograms = profile.get('histograms', {})
+    if histograms:
+        print('task durations (count, mean, p50, p90, p99, max milliseconds):')
+        rows = sorted(histograms.items(), key=lambda item: item[1]['count'] * item[1]['mean'], reverse=True)
+        for name, h in rows[:NUM_TOP]:
+            print('  %-32s %8d %8.3f %8.3f %8.3f %8.3f %8.3f' % (
+                name, h['count'], 1000.0 * h['mean'], 1000.0 * h['p50'],
+                1000.0 * h['p90'], 1000.0 * h['p99'], 1000.0 * h['max']))
+        print()
+
+    print('threads (busy seconds, utilization, dropped events):')
+    for thread in profile['threads']:
+        print('  %-32s %12.4f %8.1f%% %8d' % (
+            thread['name'], thread['busy'], 100.0 * thread['utilization'], thread.get('dropped', 0)))
+    print()
+
+    # frames of different jobs (files, alpha outputs) may have the same numbers
+    frames = []
+    for job in profile['jobs']:
+        name = job.get('name', 'job %d' % job['job'])
+        for frame in job['frames']:
+            frames.append(('%s: %d' % (name, frame['frame']), frame))
+
+    print('slowest frames (seconds):')
+    for label, frame in sorted(frames, key=lambda item: frame_time(item[1]), reverse=True)[:NUM_TOP]:
+        print('  %-32s %12.4f' % (label, frame_time(frame)))
+
+
+if __name__ == '__main__':
+    main()
@@ -48,9 +48,15 @@
 #include <synfig/valuenode.h>
 #include <synfig/segment.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <vector>
 #include <ETL/misc>
 
+#include <synfig/rendering/common/task/taskblur.h>
+#include <synfig/rendering/software/task/tasksw.h>
+
 #endif
 
 using namespace etl;
@@ -77,6 +83,210 @@ SYNFIG_LAYER_SET_VERSION(Layer_Bevel,"0.2");
 
 /* -- F U N C T I O N S ----------------------------------------------------- */
 
+namespace {
+
+//! Lights the blurred sub task from the direction of the \a offset.
+//! The sub task is expected to be already blurred, see TaskBlur.
+class TaskBevel: public rendering::Task, public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskBevel> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	// parameters are evaluated once by layer, see Layer_Bevel::build_composite_fork_task_vfunc()
+	Vector offset;
+	Vector offset45;
+	Color color1;
+	Color color2;
+	bool use_luma;
+	bool solid;
+
+	TaskBevel(): use_luma(), solid() { }
+
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	//! Returns the maximal distance of the samples from the pixel
+	Real get_max_offset() const
+		{ return std::max(std::fabs(offset[0]), std::fabs(offset[1])) + offset45.mag(); }
+
+	virtual Rect calc_bounds() const {
+		if (!sub_task())
+			return Rect::zero();
+		// flat area of the solid bevel still gets the mix of both colors
+		if (solid)
+			return Rect::infinite();
+		Rect bounds = sub_task()->get_bounds();
+		if (!bounds.is_valid())
+			return bounds;
+		Real d = get_max_offset();
+		return bounds.expand_x(d).expand_y(d);
+	}
+
+	virtual void set_coords_sub_tasks() {
+		if (!sub_task())
+			{ trunc_to_zero(); return; }
+		if (!is_valid_coords())
+			{ sub_task()->set_coords_zero(); return; }
+
+		Vector upp = get_units_per_pixel();
+		Real d = get_max_offset();
+		Rect rect = source_rect;
+		rect.expand_x(d).expand_y(d);
+		rect &= sub_task()->get_bounds();
+		if (!rect.is_valid() || rect.is_nan_or_inf())
+			{ sub_task()->set_coords_zero(); return; }
+
+		// align the source to the pixels of this task,
+		// so offsets of the samples are the same for every pixel,
+		// and add two pixels for interpolation
+		const int margin = 2;
+		const int max_size = 10000;
+		RectInt pixels(
+			(int)approximate_floor((rect.minx - source_rect.minx)/upp[0]) - margin,
+			(int)approximate_floor((rect.miny - source_rect.miny)/upp[1]) - margin,
+			(int)approximate_ceil ((rect.maxx - source_rect.minx)/upp[0]) + margin,
+			(int)approximate_ceil ((rect.maxy - source_rect.miny)/upp[1]) + margin );
+		Rect sub_source_rect(
+			source_rect.minx + pixels.minx*upp[0],
+			source_rect.miny + pixels.miny*upp[1],
+			source_rect.minx + pixels.maxx*upp[0],
+			source_rect.miny + pixels.maxy*upp[1] );
+		VectorInt sub_target_size(
+			std::min(pixels.get_width(), max_size),
+			std::min(pixels.get_height(), max_size) );
+
+		sub_task()->set_coords(sub_source_rect, sub_target_size);
+	}
+};
+
+
+class TaskBevelSW: public TaskBevel, public rendering::TaskSW
+{
+public:
+	typedef etl::handle<TaskBevelSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+private:
+	//! Bilinear sample with the constant offset for the all pixels of the row
+	struct Sample {
+		int dx, dy;
+		float w00, w01, w10, w11;
+
+		Sample(const Vector &pixels = Vector()) {
+			Real fx = std::floor(pixels[0]), fy = std::floor(pixels[1]);
+			dx = (int)fx; dy = (int)fy;
+			float kx = (float)(pixels[0] - fx), ky = (float)(pixels[1] - fy);
+			w00 = (1.f - kx)*(1.f - ky); w01 = kx*(1.f - ky);
+			w10 = (1.f - kx)*ky;         w11 = kx*ky;
+		}
+
+		//! \a row points to the pixel of the plane with the given \a pitch
+		float operator() (const float *row, int pitch) const {
+			const float *p = row + dy*pitch + dx;
+			return w00*p[0] + w01*p[1] + w10*p[pitch] + w11*p[pitch + 1];
+		}
+	};
+
+public:
+	virtual bool run(RunParams&) const {
+		if (!is_valid())
+			return true;
+
+		LockWrite la(this);
+		if (!la)
+			return false;
+
+		synfig::Surface &dst = la->get_surface();
+		const RectInt &rd = target_rect;
+		const Vector upp = get_units_per_pixel();
+
+		// sample offsets in pixels of this task,
+		// rotated offsets are the same as in the legacy renderer for the square pixels
+		Sample samples[6] = {
+			Sample(Vector( offset[0]/upp[0],    offset[1]/upp[1])),
+			Sample(Vector(-offset[0]/upp[0],   -offset[1]/upp[1])),
+			Sample(Vector( offset45[0]/upp[0],  offset45[1]/upp[1])),
+			Sample(Vector(-offset45[1]/upp[0],  offset45[0]/upp[1])),
+			Sample(Vector(-offset45[0]/upp[0], -offset45[1]/upp[1])),
+			Sample(Vector( offset45[1]/upp[0], -offset45[0]/upp[1])) };
+
+		int pad = 1;
+		for(int i = 0; i < 6; ++i)
+			pad = std::max(pad, std::max(std::abs(samples[i].dx), std::abs(samples[i].dy)) + 1);
+
+		// copy alpha (or luma) of the blurred surface into the padded plane,
+		// pixels outside of the sub task are transparent
+		const int pitch = rd.get_width() + 2*pad;
+		const int rows = rd.get_height() + 2*pad;
+		std::vector<float> plane(pitch*rows, 0.f);
+
+		if (sub_task() && sub_task()->is_valid()) {
+			LockRead lb(sub_task());
+			if (!lb)
+				return false;
+			const synfig::Surface &src = lb->get_surface();
+			const RectInt &src_target_rect = sub_task()->target_rect;
+			Vector src_offset = (source_rect.get_min() - sub_task()->source_rect.get_min())
+			                    .multiply_coords(sub_task()->get_pixels_per_unit());
+			// source pixel of the top-left pixel of the plane
+			int sx0 = (int)round(src_offset[0]) + src_target_rect.minx - pad;
+			int sy0 = (int)round(src_offset[1]) + src_target_rect.miny - pad;
+
+			RectInt r(
+				std::max(0, src_target_rect.minx - sx0),
+				std::max(0, src_target_rect.miny - sy0),
+				std::min(pitch, src_target_rect.maxx - sx0),
+				std::min(rows, src_target_rect.maxy - sy0) );
+			for(int y = r.miny; y < r.maxy; ++y) {
+				float *p = &plane[y*pitch];
+				const Color *c = &src[sy0 + y][sx0];
+				if (use_luma)
+					for(int x = r.minx; x < r.maxx; ++x)
+						p[x] = c[x].get_a()*c[x].get_y();
+				else
+					for(int x = r.minx; x < r.maxx; ++x)
+						p[x] = c[x].get_a();
+			}
+		}
+
+		std::vector<float> alpha(rd.get_width());
+		for(int y = rd.miny; y < rd.maxy; ++y) {
+			const float *row = &plane[(y - rd.miny + pad)*pitch + pad];
+			for(int x = 0; x < (int)alpha.size(); ++x) {
+				const float *p = row + x;
+				alpha[x] = samples[1](p, pitch) - samples[0](p, pitch)
+				         + 0.5f*( samples[4](p, pitch) + samples[5](p, pitch)
+				                - samples[2](p, pitch) - samples[3](p, pitch) );
+			}
+
+			Color *d = &dst[y][rd.minx];
+			if (solid) {
+				for(int x = 0; x < (int)alpha.size(); ++x)
+					d[x] = Color::blend(color1, color2, alpha[x]/4.f + 0.5f, Color::BLEND_STRAIGHT);
+			} else {
+				for(int x = 0; x < (int)alpha.size(); ++x) {
+					float a = alpha[x]/2.f;
+					d[x] = a > 0.f ? color1 : color2;
+					d[x].set_a(d[x].get_a()*std::fabs(a));
+				}
+			}
+		}
+
+		return true;
+	}
+};
+
+
+rendering::Task::Token TaskBevel::token(
+	DescAbstract<TaskBevel>("Bevel") );
+rendering::Task::Token TaskBevelSW::token(
+	DescReal<TaskBevelSW, TaskBevel>("BevelSW") );
+
+} // namespace
+
 inline void clamp(Vector &v)
 {
 	if(v[0]<0.0)v[0]=0.0;
@@ -180,243 +390,6 @@ Layer_Bevel::get_color(Context context, const Point &pos)const
 	return Color::blend(shade,context.get_color(pos),get_amount(),get_blend_method());
 }
 
-RendDesc
-Layer_Bevel::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
-{
-	Real softness=param_softness.get(Real());
-	int type=param_type.get(int());
-
-	const int	w = renddesc.get_w(),
-				h = renddesc.get_h();
-	const Real	pw = renddesc.get_pw(),
-				ph = renddesc.get_ph();
-	const Vector size(softness,softness);
-
-	RendDesc workdesc(renddesc);
-
-	//expand the working surface to accommodate the blur
-
-	//the expanded size = 1/2 the size in each direction rounded up
-	int	halfsizex = (int) (std::fabs(size[0]*.5/pw) + 3),
-		halfsizey = (int) (std::fabs(size[1]*.5/ph) + 3);
-
-	int offset_u(round_to_int(offset[0]/pw)),offset_v(round_to_int(offset[1]/ph));
-	int offset_w(w+std::abs(offset_u)*2),offset_h(h+std::abs(offset_v)*2);
-
-	workdesc.set_subwindow(
-		-std::abs(offset_u),
-		-std::abs(offset_v),
-		w+std::abs(offset_u),
-		h+std::abs(offset_v)
-	);
-
-	//expand by 1/2 size in each direction on either side
-	switch(type)
-	{
-		case Blur::DISC:
-		case Blur::BOX:
-		case Blur::CROSS:
-		{
-			workdesc.set_subwindow(-std::max(1,halfsizex),-std::max(1,halfsizey),offset_w+2*std::max(1,halfsizex),offset_h+2*std::max(1,halfsizey));
-			break;
-		}
-		case Blur::FASTGAUSSIAN:
-		{
-			workdesc.set_subwindow(-std::max(1,halfsizex),-std::max(1,halfsizey),offset_w+2*std::max(1,halfsizex),offset_h+2*std::max(1,halfsizey));
-			break;
-		}
-		case Blur::GAUSSIAN:
-		{
-		#define GAUSSIAN_ADJUSTMENT		(0.05)
-			Real	pw = (Real)workdesc.get_w()/(workdesc.get_br()[0]-workdesc.get_tl()[0]);
-			Real 	ph = (Real)workdesc.get_h()/(workdesc.get_br()[1]-workdesc.get_tl()[1]);
-
-			pw=pw*pw;
-			ph=ph*ph;
-
-			halfsizex = (int)(std::fabs(pw)*size[0]*GAUSSIAN_ADJUSTMENT+0.5);
-			halfsizey = (int)(std::fabs(ph)*size[1]*GAUSSIAN_ADJUSTMENT+0.5);
-
-			halfsizex = (halfsizex + 1)/2;
-			halfsizey = (halfsizey + 1)/2;
-			workdesc.set_subwindow( -halfsizex, -halfsizey, offset_w+2*halfsizex, offset_h+2*halfsizey );
-
-			break;
-		}
-	}
-
-	return workdesc;
-}
-
-bool
-Layer_Bevel::accelerated_render(Context context,Surface *surface,int quality, const RendDesc &renddesc, ProgressCallback *cb)const
-{
-	RENDER_TRANSFORMED_IF_NEED(__FILE__, __LINE__)
-
-	Real softness=param_softness.get(Real());
-	int type=param_type.get(int());
-	Color color1=param_color1.get(Color());
-	Color color2=param_color2.get(Color());
-	bool use_luma=param_use_luma.get(bool());
-	bool solid=param_solid.get(bool());
-
-	int x,y;
-	SuperCallback stageone(cb,0,5000,10000);
-	SuperCallback stagetwo(cb,5000,10000,10000);
-
-	RendDesc	workdesc = get_sub_renddesc(renddesc);
-	Surface		worksurface;
-	etl::surface<float> blurred;
-
-	const Real	pw = renddesc.get_pw(),
-				ph = renddesc.get_ph();
-	const Vector size(softness,softness);
-
-	int	halfsizex = (int) (std::fabs(size[0]*.5/pw) + 3),
-		halfsizey = (int) (std::fabs(size[1]*.5/ph) + 3);
-
-	int offset_u(round_to_int(offset[0]/pw)),offset_v(round_to_int(offset[1]/ph));
-
-	//callbacks depend on how long the blur takes
-	if(size[0] || size[1])
-	{
-		if(type == Blur::DISC)
-		{
-			stageone = SuperCallback(cb,0,5000,10000);
-			stagetwo = SuperCallback(cb,5000,10000,10000);
-		}
-		else
-		{
-			stageone = SuperCallback(cb,0,9000,10000);
-			stagetwo = SuperCallback(cb,9000,10000,10000);
-		}
-	}
-	else
-	{
-		stageone = SuperCallback(cb,0,9999,10000);
-		stagetwo = SuperCallback(cb,9999,10000,10000);
-	}
-
-	switch(type)
-	{
-		case Blur::GAUSSIAN:
-		{
-			Real pw = (Real)workdesc.get_w()/(workdesc.get_br()[0]-workdesc.get_tl()[0]);
-			Real ph = (Real)workdesc.get_h()/(workdesc.get_br()[1]-workdesc.get_tl()[1]);
-
-			pw=pw*pw;
-			ph=ph*ph;
-
-			halfsizex = (int)(std::fabs(pw)*size[0]*GAUSSIAN_ADJUSTMENT+0.5);
-			halfsizey = (int)(std::fabs(ph)*size[1]*GAUSSIAN_ADJUSTMENT+0.5);
-
-			halfsizex = (halfsizex + 1)/2;
-			halfsizey = (halfsizey + 1)/2;
-
-			break;
-		}
-	}
-
-	//render the background onto the expanded surface
-	if(!context.accelerated_render(&worksurface,quality,workdesc,&stageone))
-		return false;
-
-	// Copy over the alpha
-	blurred.set_wh(worksurface.get_w(),worksurface.get_h());
-	if(!use_luma)
-	{
-		for(int j=0;j<worksurface.get_h();j++)
-			for(int i=0;i<worksurface.get_w();i++)
-			{
-				blurred[j][i]=worksurface[j][i].get_a();
-			}
-	}
-	else
-	{
-		for(int j=0;j<worksurface.get_h();j++)
-			for(int i=0;i<worksurface.get_w();i++)
-			{
-				blurred[j][i]=worksurface[j][i].get_a()*worksurface[j][i].get_y();
-			}
-	}
-
-	//blur the image
-	Blur(size,type,&stagetwo)(blurred,workdesc.get_br()-workdesc.get_tl(),blurred);
-
-	//be sure the surface is of the correct size
-	surface->set_wh(renddesc.get_w(),renddesc.get_h());
-
-	int v = halfsizey+std::abs(offset_v);
-	for(y=0;y<renddesc.get_h();y++,v++)
-	{
-		int u = halfsizex+std::abs(offset_u);
-		for(x=0;x<renddesc.get_w();x++,u++)
-		{
-			Real alpha(0);
-			Color shade;
-
-			{
-				const float u2(offset[0]/pw),v2(offset[1]/ph);
-				alpha+=1.0f-blurred.linear_sample(u2+u,v2+v);
-			}
-			{
-				const float u2(-offset[0]/pw),v2(-offset[1]/ph);
-				alpha-=1.0f-blurred.linear_sample(u2+u,v2+v);
-			}
-			{
-				const float u2(offset45[0]/pw),v2(offset45[1]/ph);
-				alpha+=1.0f-blurred.linear_sample(u2+u,v2+v)*0.5f;
-			}
-			{
-				const float u2(offset45[1]/ph),v2(-offset45[0]/pw);
-				alpha+=1.0f-blurred.linear_sample(u2+u,v2+v)*0.5f;
-			}
-			{
-				const float u2(-offset45[0]/pw),v2(-offset45[1]/ph);
-				alpha-=1.0f-blurred.linear_sample(u2+u,v2+v)*0.5f;
-			}
-			{
-				const float u2(-offset45[1]/ph),v2(offset45[0]/pw);
-				alpha-=1.0f-blurred.linear_sample(u2+u,v2+v)*0.5f;
-			}
-
-			if(solid)
-			{
-				alpha/=4.0f;
-				alpha+=0.5f;
-				shade=Color::blend(color1,color2,alpha,Color::BLEND_STRAIGHT);
-			}
-			else
-			{
-				alpha/=2;
-				if(alpha>0)
-					shade=color1,shade.set_a(shade.get_a()*alpha);
-				else
-					shade=color2,shade.set_a(shade.get_a()*-alpha);
-			}
-
-
-
-			if(shade.get_a())
-			{
-				(*surface)[y][x]=Color::blend(shade,worksurface[v][u],get_amount(),get_blend_method());
-			}
-			else (*surface)[y][x] = worksurface[v][u];
-		}
-	}
-
-	if(cb && !cb->amount_complete(10000,10000))
-	{
-		//if(cb)cb->error(strprintf(__FILE__"%d: Accelerated Renderer Failure",__LINE__));
-		return false;
-	}
-
-	return true;
-}
-
-
-////
-
 Layer::Vocab
 Layer_Bevel::get_param_vocab(void)const
 {
@@ -483,5 +456,27 @@ Layer_Bevel::get_full_bounding_rect(Context context)const
 }
 
 rendering::Task::Handle
-Layer_Bevel::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+Layer_Bevel::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	Real softness = param_softness.get(Real());
+	rendering::Blur::Type type = (rendering::Blur::Type)param_type.get(int());
+
+	if (!sub_task)
+		return sub_task;
+
+	rendering::TaskBlur::Handle task_blur(new rendering::TaskBlur());
+	task_blur->blur.size = Vector(softness, softness);
+	task_blur->blur.type = type;
+	task_blur->sub_task() = sub_task->clone_recursive();
+
+	TaskBevel::Handle task_bevel(new TaskBevel());
+	task_bevel->offset = offset;
+	task_bevel->offset45 = offset45;
+	task_bevel->color1 = param_color1.get(Color());
+	task_bevel->color2 = param_color2.get(Color());
+	task_bevel->use_luma = param_use_luma.get(bool());
+	task_bevel->solid = param_solid.get(bool());
+	task_bevel->sub_task() = task_blur;
+
+	return task_bevel;
+}
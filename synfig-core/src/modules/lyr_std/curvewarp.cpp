@@ -38,12 +38,16 @@
 
 #include <synfig/localization.h>
 
+#include <algorithm>
+
 #include <synfig/context.h>
 #include <synfig/paramdesc.h>
 #include <synfig/surface.h>
 #include <synfig/valuenode.h>
 #include <ETL/calculus>
 
+#include <synfig/rendering/common/task/taskdistort.h>
+
 #endif
 
 using namespace etl;
@@ -66,102 +70,210 @@ SYNFIG_LAYER_SET_VERSION(CurveWarp,"0.0");
 
 /* === P R O C E D U R E S ================================================= */
 
-inline float calculate_distance(const std::vector<BLinePoint>& bline)
+namespace {
+
+//! Samples of the segment checked in fast mode
+const Real fast_samples[] = { 0.0001, 1.0/6, 2.0/6, 3.0/6, 4.0/6, 5.0/6, 0.9999 };
+const int fast_samples_count = sizeof(fast_samples)/sizeof(fast_samples[0]);
+
+//! The lower bound of the squared distance from point to any point inside the rect
+inline Real
+distance_squared(const Rect &r, const Point &p)
 {
-	std::vector<BLinePoint>::const_iterator iter,next/*,ret*/;
-	std::vector<BLinePoint>::const_iterator end(bline.end());
+	Real dx = std::max(Real(0), std::max(r.minx - p[0], p[0] - r.maxx));
+	Real dy = std::max(Real(0), std::max(r.miny - p[1], p[1] - r.maxy));
+	return dx*dx + dy*dy;
+}
 
-	float dist(0);
+class CurveWarpDistortion: public rendering::TaskDistort::Distortion
+{
+public:
+	//! Immutable copy of the layer, see Layer::get_rendering_snapshot()
+	etl::handle<CurveWarp> layer;
+
+	explicit CurveWarpDistortion(const etl::handle<CurveWarp> &layer): layer(layer) { }
+
+	virtual void transform(Vector *points, int count) const {
+		for(Vector *p = points, *end = points + count; p < end; ++p)
+			*p = layer->transform(*p);
+	}
+
+	virtual Rect calc_source_rect(const Rect &rect, const Vector &units_per_pixel) const {
+		RendDesc desc;
+		desc.set_tl(rect.get_min());
+		desc.set_br(rect.get_max());
+		desc.set_wh(
+			std::max(1, (int)approximate_ceil(rect.get_width()/std::fabs(units_per_pixel[0]))),
+			std::max(1, (int)approximate_ceil(rect.get_height()/std::fabs(units_per_pixel[1]))) );
+		RendDesc src_desc = layer->get_source_renddesc(desc);
+		return Rect(src_desc.get_tl(), src_desc.get_br());
+	}
+};
 
-	if (bline.empty()) return dist;
+} // namespace
 
-	next=bline.begin();
-	iter=next++;
+/* === M E T H O D S ======================================================= */
 
-	for(;next!=end;iter=next++)
+inline void
+CurveWarp::sync()
+{
+	bline_ = param_bline.get_list_of(BLinePoint());
+	Point start_point=param_start_point.get(Point());
+	Point end_point=param_end_point.get(Point());
+
+	segments_.clear();
+	segment_bounds_.clear();
+	segment_offsets_.clear();
+	tree_segments_.clear();
+	tree_.clear();
+
+	// accumulate lengths in float, exactly as the closest segment search did before
+	float dist(0);
+	for(int i = 1; i < (int)bline_.size(); ++i)
 	{
-		// Setup the curve
-		etl::hermite<Vector> curve(iter->get_vertex(), next->get_vertex(), iter->get_tangent2(), next->get_tangent1());
-		dist+=curve.length();
+		const BLinePoint &a = bline_[i-1], &b = bline_[i];
+		segments_.push_back(Segment(a.get_vertex(), b.get_vertex(), a.get_tangent2(), b.get_tangent1()));
+		const Segment &curve = segments_.back();
+
+		// segment lies inside the convex hull of its bezier control points,
+		// expand a bit against rounding errors of evaluation
+		Rect bounds(curve[0]);
+		for(int j = 1; j < 4; ++j)
+			bounds.expand(curve[j]);
+		bounds.expand(1e-7);
+		segment_bounds_.push_back(bounds);
+
+		segment_offsets_.push_back(dist);
+		dist += curve.length();
+		tree_segments_.push_back(i - 1);
 	}
+	curve_length_ = dist;
+	perp_ = (end_point - start_point).perp().norm();
 
-	return dist;
+	if (!segments_.empty())
+	{
+		tree_.resize(1);
+		build_tree(0, 0, (int)segments_.size());
+	}
 }
 
-std::vector<BLinePoint>::const_iterator
-find_closest_to_bline(bool fast, const std::vector<BLinePoint>& bline,const Point& p,float& t, float& len, bool& extreme)
+void
+CurveWarp::build_tree(int node, int first, int count)
 {
-	std::vector<BLinePoint>::const_iterator iter,next,ret;
-	std::vector<BLinePoint>::const_iterator end(bline.end());
+	Rect bounds = segment_bounds_[tree_segments_[first]];
+	for(int i = first + 1; i < first + count; ++i)
+		rect_set_union(bounds, bounds, segment_bounds_[tree_segments_[i]]);
+	tree_[node].bounds = bounds;
+
+	if (count <= 4)
+	{
+		tree_[node].first = first;
+		tree_[node].count = count;
+		return;
+	}
 
-	ret=bline.end();
+	// split by median of segment centers along the longest side
+	int axis = bounds.get_width() >= bounds.get_height() ? 0 : 1;
+	const std::vector<Rect> &segment_bounds = segment_bounds_;
+	std::nth_element(
+		tree_segments_.begin() + first,
+		tree_segments_.begin() + first + count/2,
+		tree_segments_.begin() + first + count,
+		[&segment_bounds, axis](int a, int b) {
+			return segment_bounds[a].get_min()[axis] + segment_bounds[a].get_max()[axis]
+			     < segment_bounds[b].get_min()[axis] + segment_bounds[b].get_max()[axis];
+		} );
+
+	int children = (int)tree_.size();
+	tree_.resize(children + 2);
+	tree_[node].first = children;
+	tree_[node].count = 0;
+	build_tree(children, first, count/2);
+	build_tree(children + 1, first + count/2, count - count/2);
+}
+
+int
+CurveWarp::find_closest_segment(bool fast, const Point &p, float &t, float &len, bool &extreme)const
+{
+	// results are the same as of the linear search through all the segments:
+	// the closest segment wins, or the first one of equally close segments
+	int best = -1;
 	float dist(100000000000.0);
-	next=bline.begin();
-	float best_pos(0), best_len(0);
-	etl::hermite<Vector> best_curve;
-	iter=next++;
-	Point bp;
-	float total_len(0);
-	bool first = true, last = false;
-	extreme = false;
-
-	for(;next!=end;iter=next++)
+	float best_pos(0);
+
+	int stack[64];
+	int stack_size = 0;
+	if (!tree_.empty())
+		stack[stack_size++] = 0;
+
+	while(stack_size)
 	{
-		// Setup the curve
-		etl::hermite<Vector> curve(iter->get_vertex(), next->get_vertex(), iter->get_tangent2(), next->get_tangent1());
-		float thisdist(0);
-		last = false;
+		const TreeNode &node = tree_[stack[--stack_size]];
+		if ((float)distance_squared(node.bounds, p) > dist)
+			continue;
 
-		if (fast)
+		if (!node.count)
 		{
-#define POINT_CHECK(x) bp=curve(x);	thisdist=(bp-p).mag_squared(); if(thisdist<dist) { extreme = (first&&x<0.01); ret=iter; best_len = total_len; dist=thisdist; best_curve=curve; last=true; best_pos=x;}
-			POINT_CHECK(0.0001);  POINT_CHECK((1.0/6)); POINT_CHECK((2.0/6)); POINT_CHECK((3.0/6));
-			POINT_CHECK((4.0/6)); POINT_CHECK((5.0/6)); POINT_CHECK(0.9999);
+			// visit the closest child first
+			int a = node.first, b = node.first + 1;
+			if (distance_squared(tree_[a].bounds, p) > distance_squared(tree_[b].bounds, p))
+				std::swap(a, b);
+			stack[stack_size++] = b;
+			stack[stack_size++] = a;
+			continue;
 		}
-		else
+
+		for(int i = node.first; i < node.first + node.count; ++i)
 		{
-			float pos = curve.find_closest(fast, p);
-			thisdist=(curve(pos)-p).mag_squared();
-			if(thisdist<dist)
+			int index = tree_segments_[i];
+			if ((float)distance_squared(segment_bounds_[index], p) > dist)
+				continue;
+
+			const Segment &curve = segments_[index];
+			float thisdist(100000000000.0);
+			float pos(0);
+			if (fast)
+			{
+				for(int j = 0; j < fast_samples_count; ++j)
+				{
+					float d = (curve(fast_samples[j]) - p).mag_squared();
+					if (d < thisdist) { thisdist = d; pos = fast_samples[j]; }
+				}
+			}
+			else
+			{
+				pos = curve.find_closest(fast, p);
+				thisdist = (curve(pos) - p).mag_squared();
+			}
+
+			if (thisdist < dist || (thisdist == dist && index < best))
 			{
-				extreme = (first && pos == 0);
-				ret=iter;
-				dist=thisdist;
+				best = index;
+				dist = thisdist;
 				best_pos = pos;
-				best_curve = curve;
-				best_len = total_len;
-				last = true;
 			}
 		}
-		total_len += curve.length();
-		first = false;
 	}
 
+	if (best < 0)
+		best = 0;
+
+	const Segment &best_curve = segments_[best];
+	bool last = best == (int)segments_.size() - 1;
 	t = best_pos;
 	if (fast)
 	{
-		len = best_len + best_curve.find_distance(0,best_curve.find_closest(fast, p));
+		extreme = best == 0 && best_pos < 0.01;
+		len = segment_offsets_[best] + best_curve.find_distance(0,best_curve.find_closest(fast, p));
 		if (last && t > .99) extreme = true;
 	}
 	else
 	{
-		len = best_len + best_curve.find_distance(0,best_pos);
+		extreme = best == 0 && best_pos == 0;
+		len = segment_offsets_[best] + best_curve.find_distance(0,best_pos);
 		if (last && t == 1) extreme = true;
 	}
-	return ret;
-}
-
-/* === M E T H O D S ======================================================= */
-
-inline void
-CurveWarp::sync()
-{
-	std::vector<BLinePoint> bline(param_bline.get_list_of(BLinePoint()));
-	Point start_point=param_start_point.get(Point());
-	Point end_point=param_end_point.get(Point());
-	
-	curve_length_=calculate_distance(bline);
-	perp_ = (end_point - start_point).perp().norm();
+	return best;
 }
 
 CurveWarp::CurveWarp():
@@ -191,7 +303,7 @@ CurveWarp::CurveWarp():
 inline Point
 CurveWarp::transform(const Point &point_, Real *dist, Real *along, int quality)const
 {
-	std::vector<BLinePoint> bline(param_bline.get_list_of(BLinePoint()));
+	const std::vector<BLinePoint> &bline = bline_;
 	Point start_point=param_start_point.get(Point());
 	Point end_point=param_end_point.get(Point());
 	Point origin=param_origin.get(Point());
@@ -224,13 +336,14 @@ CurveWarp::transform(const Point &point_, Real *dist, Real *along, int quality)c
 		std::vector<BLinePoint>::const_iterator iter,next;
 
 		// Figure out the BLinePoint we will be using,
-		next=find_closest_to_bline(fast,bline,point,t,len,extreme);
+		int segment = find_closest_segment(fast,point,t,len,extreme);
+		next = bline.begin() + segment;
 
 		iter=next++;
 		if(next==bline.end()) next=bline.begin();
 
 		// Setup the curve
-		etl::hermite<Vector> curve(iter->get_vertex(), next->get_vertex(), iter->get_tangent2(), next->get_tangent1());
+		const etl::hermite<Vector> &curve = segments_[segment];
 
 		// Setup the derivative function
 		etl::derivative<etl::hermite<Vector> > deriv(curve);
@@ -454,17 +567,12 @@ CurveWarp::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
 	return desc;
 }
 
-bool
-CurveWarp::accelerated_render(Context context,Surface *surface,int quality, const RendDesc &renddesc, ProgressCallback *cb)const
+RendDesc
+CurveWarp::get_source_renddesc(const RendDesc &renddesc)const
 {
-	RENDER_TRANSFORMED_IF_NEED(__FILE__, __LINE__)
-
 	Point start_point=param_start_point.get(Point());
 	Point end_point=param_end_point.get(Point());
 
-	SuperCallback stageone(cb,0,9000,10000);
-	SuperCallback stagetwo(cb,9000,10000,10000);
-
 	int x,y;
 
 	const Real pw(renddesc.get_pw()),ph(renddesc.get_ph());
@@ -563,12 +671,46 @@ CurveWarp::accelerated_render(Context context,Surface *surface,int quality, cons
 	src_pw = (src_br[0] - src_tl[0]) / src_w;
 	src_ph = (src_br[1] - src_tl[1]) / src_h;
 
-	// set up a renddesc for the context to render
 	RendDesc src_desc(renddesc);
 	src_desc.clear_flags();
 	src_desc.set_tl(src_tl);
 	src_desc.set_br(src_br);
 	src_desc.set_wh(src_w, src_h);
+	return src_desc;
+}
+
+rendering::Task::Handle
+CurveWarp::build_rendering_task_vfunc(Context context) const
+{
+	rendering::TaskDistort::Handle task(new rendering::TaskDistort());
+	task->distortion = new CurveWarpDistortion(
+		etl::handle<CurveWarp>::cast_dynamic(get_rendering_snapshot()) );
+	task->sub_task() = context.build_rendering_task();
+	return task;
+}
+
+bool
+CurveWarp::accelerated_render(Context context,Surface *surface,int quality, const RendDesc &renddesc, ProgressCallback *cb)const
+{
+	RENDER_TRANSFORMED_IF_NEED(__FILE__, __LINE__)
+
+	SuperCallback stageone(cb,0,9000,10000);
+	SuperCallback stagetwo(cb,9000,10000,10000);
+
+	int x,y;
+
+	const Real pw(renddesc.get_pw()),ph(renddesc.get_ph());
+	Point tl(renddesc.get_tl());
+	const int w(renddesc.get_w());
+	const int h(renddesc.get_h());
+
+	// set up a renddesc for the context to render
+	RendDesc src_desc = get_source_renddesc(renddesc);
+	const Point src_tl(src_desc.get_tl());
+	const int src_w(src_desc.get_w());
+	const int src_h(src_desc.get_h());
+	const Real src_pw(src_desc.get_pw());
+	const Real src_ph(src_desc.get_ph());
 
 	// render the context onto a new surface
 	Surface source;
@@ -33,9 +33,11 @@
 /* === H E A D E R S ======================================================= */
 
 #include <vector>
+#include <ETL/hermite>
 #include <synfig/vector.h>
 #include <synfig/layer.h>
 #include <synfig/blinepoint.h>
+#include <synfig/rect.h>
 
 /* === M A C R O S ========================================================= */
 
@@ -68,10 +70,31 @@ private:
 	//!Parameter: (bool)
 	ValueBase param_fast;
 
+	typedef etl::hermite<Vector> Segment;
+
+	//! Node of the bounding volume hierarchy of the spline segments
+	struct TreeNode
+	{
+		Rect bounds;
+		int first; //!< first index in tree_segments_ for leaf, or index of the first child node
+		int count; //!< count of segments in leaf, zero for inner node
+	};
+
 	Vector perp_;
 	Real curve_length_;
 
+	// spline is preprocessed by sync(), so transform() doesn't walk
+	// through the whole spline for each pixel
+	std::vector<BLinePoint> bline_;
+	std::vector<Segment> segments_;
+	std::vector<Rect> segment_bounds_;
+	std::vector<float> segment_offsets_; //!< arc length of the spline before each segment
+	std::vector<int> tree_segments_;
+	std::vector<TreeNode> tree_;
+
 	void sync();
+	void build_tree(int node, int first, int count);
+	int find_closest_segment(bool fast, const Point &p, float &t, float &len, bool &extreme)const;
 
 public:
 	CurveWarp();
@@ -85,8 +108,12 @@ public:
 
 	virtual Vocab get_param_vocab()const;
 
+	//! Returns area and resolution of the context required to render \a renddesc
+	RendDesc get_source_renddesc(const RendDesc &renddesc)const;
+
 protected:
 	virtual RendDesc get_sub_renddesc_vfunc(const RendDesc &renddesc) const;
+	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
 };
 
 }; // END of namespace lyr_std
@@ -0,0 +1,176 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file fractal.h
+**	\brief Rendering tasks shared by the "Mandelbrot" and "Julia" layers
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_LYR_STD_FRACTAL_H
+#define __SYNFIG_LYR_STD_FRACTAL_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <algorithm>
+#include <cmath>
+
+#include <synfig/real.h>
+#include <synfig/surface.h>
+
+#include <synfig/rendering/task.h>
+#include <synfig/rendering/software/task/tasksw.h>
+#include <synfig/rendering/software/function/resample.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace modules
+{
+namespace lyr_std
+{
+
+//! Task of the escape-time fractal layer.
+//! \a Params are the parameters evaluated once by the layer, they provide
+//! batch_size, iterate_batch(), get_context_point(), shade()
+//! and is_context_distorted(), see Mandelbrot::Params and Julia::Params
+template<typename Params>
+class TaskFractal: public rendering::Task
+{
+public:
+	Params params;
+
+	//! Context, optional, it's not needed when both inside and outside are solid
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	virtual void set_coords_sub_tasks() {
+		if (!sub_task())
+			return;
+		if (!is_valid_coords())
+			{ sub_task()->set_coords_zero(); return; }
+
+		// distorted points are sampled from the same area
+		// as in get_sub_renddesc_vfunc() of layers
+		Rect rect = source_rect;
+		if (params.is_context_distorted())
+			rect_set_union(rect, rect, Rect(-5.0, -5.0, 5.0, 5.0));
+
+		const int max_size = 4096;
+		const Vector upp = get_units_per_pixel();
+		VectorInt size(
+			std::max(1, std::min(max_size, (int)approximate_ceil(rect.get_width()/std::fabs(upp[0])))),
+			std::max(1, std::min(max_size, (int)approximate_ceil(rect.get_height()/std::fabs(upp[1])))) );
+		sub_task()->set_coords(rect, size);
+	}
+
+protected:
+	//! Renders the target surface by batches of pixels,
+	//! to be called by run() of the software task
+	bool run_sw() const {
+		if (!is_valid())
+			return true;
+
+		rendering::TaskSW::LockWrite la(this);
+		if (!la)
+			return false;
+		rendering::TaskSW::LockRead lb(sub_task());
+		if (sub_task() && sub_task()->is_valid() && !lb)
+			return false;
+		const synfig::Surface *src = lb ? &lb->get_surface() : nullptr;
+
+		// units to pixels of context surface
+		Vector src_k, src_offset;
+		if (src) {
+			RectInt src_target_rect = sub_task()->target_rect;
+			Vector src_lt = sub_task()->source_rect.get_min();
+			Vector src_rb = sub_task()->source_rect.get_max();
+			src_k = Vector(
+				(src_target_rect.maxx - src_target_rect.minx)/(src_rb[0] - src_lt[0]),
+				(src_target_rect.maxy - src_target_rect.miny)/(src_rb[1] - src_lt[1]) );
+			src_offset = Vector(
+				src_target_rect.minx - src_lt[0]*src_k[0],
+				src_target_rect.miny - src_lt[1]*src_k[1] );
+		}
+
+		// points are taken at the centers of pixels, as by the Layer::get_color() path
+		const Vector upp = get_units_per_pixel();
+		const Vector lt = source_rect.get_min() + upp*0.5;
+
+		// single precision is enough while pixels are much larger than its resolution
+		const Real max_coord = std::max( std::max(1.0,
+			std::max(std::fabs(source_rect.minx), std::fabs(source_rect.maxx)) ),
+			std::max(std::fabs(source_rect.miny), std::fabs(source_rect.maxy)) );
+		const bool use_float = std::min(std::fabs(upp[0]), std::fabs(upp[1])) > 1e-4*max_coord;
+
+		const int n = Params::batch_size;
+		Real x[n], y[n], zr[n], zi[n];
+		ColorReal mag[n];
+		int escape[n];
+		Vector points[n];
+		Color colors[n];
+
+		synfig::Surface &dst = la->get_surface();
+		for(int iy = target_rect.miny; iy < target_rect.maxy; ++iy) {
+			const Real yy = lt[1] + (iy - target_rect.miny)*upp[1];
+			for(int ix = target_rect.minx; ix < target_rect.maxx; ix += n) {
+				const int count = std::min(n, target_rect.maxx - ix);
+				for(int i = 0; i < n; ++i) {
+					x[i] = lt[0] + (ix - target_rect.minx + i)*upp[0];
+					y[i] = yy;
+				}
+
+				if (use_float)
+					params.template iterate_batch<float>(x, y, escape, zr, zi, mag);
+				else
+					params.template iterate_batch<Real>(x, y, escape, zr, zi, mag);
+
+				if (src) {
+					for(int i = 0; i < count; ++i) {
+						Point p = params.get_context_point(Point(x[i], y[i]), escape[i], zr[i], zi[i]);
+						points[i] = Vector(p[0]*src_k[0] + src_offset[0], p[1]*src_k[1] + src_offset[1]);
+					}
+					rendering::software::Resample::resample_points(
+						colors, *src, points, count, Color::INTERPOLATION_LINEAR );
+				} else {
+					for(int i = 0; i < count; ++i)
+						colors[i] = Color::alpha();
+				}
+
+				for(int i = 0; i < count; ++i)
+					dst[iy][ix + i] = params.shade(escape[i], zr[i], zi[i], mag[i], colors[i]);
+			}
+		}
+
+		return true;
+	}
+};
+
+}; // END of namespace lyr_std
+}; // END of namespace modules
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
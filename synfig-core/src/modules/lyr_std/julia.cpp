@@ -33,7 +33,11 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+
 #include "julia.h"
+#include "fractal.h"
 
 #include <synfig/localization.h>
 
@@ -44,6 +48,7 @@
 #include <synfig/renddesc.h>
 #include <synfig/value.h>
 
+
 #endif
 
 using namespace etl;
@@ -97,6 +102,212 @@ color_neg_flip(Color &color)
 	}
 }
 
+struct Julia::Params
+{
+	//! Count of points evaluated at once by iterate_batch()
+	static const int batch_size = 8;
+
+	Color icolor;
+	Color ocolor;
+	Angle color_shift;
+	int iterations;
+	Point seed;
+	bool distort_inside;
+	bool shade_inside;
+	bool solid_inside;
+	bool invert_inside;
+	bool color_inside;
+	bool distort_outside;
+	bool shade_outside;
+	bool solid_outside;
+	bool invert_outside;
+	bool color_outside;
+	bool color_cycle;
+	bool smooth_outside;
+	bool broken;
+
+	Params():
+		iterations(),
+		distort_inside(), shade_inside(), solid_inside(), invert_inside(), color_inside(),
+		distort_outside(), shade_outside(), solid_outside(), invert_outside(), color_outside(),
+		color_cycle(), smooth_outside(), broken() { }
+
+	bool is_solid(int escape) const
+		{ return escape < 0 ? solid_inside : solid_outside; }
+	bool is_context_needed() const
+		{ return !solid_inside || !solid_outside; }
+	bool is_context_distorted() const
+		{ return (!solid_inside && distort_inside) || (!solid_outside && distort_outside); }
+
+	//! Iterates the point \a pos, returns the iteration where the point escapes, or -1
+	int iterate(const Point &pos, Real &zr, Real &zi, ColorReal &mag) const
+	{
+		Real cr = seed[0], ci = seed[1], zr_hold;
+		zr = pos[0];
+		zi = pos[1];
+		mag = 0;
+
+		for(int i=0;i<iterations;i++)
+		{
+			// Perform complex multiplication
+			zr_hold=zr;
+			zr=zr*zr-zi*zi + cr;
+			zi=zr_hold*zi*2 + ci;
+
+			// Use "broken" algorithm, if requested (looks weird)
+			if(broken)zr+=zi;
+
+			// Calculate Magnitude
+			mag=zr*zr+zi*zi;
+
+			if(mag>4)
+				return i;
+		}
+		return -1;
+	}
+
+	//! Batch version of iterate() for batch_size points.
+	//! Escaped points keep their values while the others continue,
+	//! so loops have no branches and may be vectorized by compiler.
+	//! Iterations stop when all points are escaped.
+	//! With T = Real the arithmetic is the same as in iterate().
+	template<typename T>
+	void iterate_batch(const Real *x, const Real *y, int *escape, Real *out_zr, Real *out_zi, ColorReal *out_mag) const
+	{
+		const int n = batch_size;
+		const T cr = (T)seed[0], ci = (T)seed[1];
+		T zr[n], zi[n];
+		ColorReal mag[n];
+		for(int j = 0; j < n; ++j) {
+			zr[j] = (T)x[j];
+			zi[j] = (T)y[j];
+			mag[j] = 0;
+			escape[j] = -1;
+		}
+
+		for(int i = 0; i < iterations; ++i) {
+			int active = 0;
+			for(int j = 0; j < n; ++j) {
+				T nzr = zr[j]*zr[j] - zi[j]*zi[j] + cr;
+				T nzi = zr[j]*zi[j]*2 + ci;
+				if (broken) nzr += nzi;
+				ColorReal nmag = (ColorReal)(nzr*nzr + nzi*nzi);
+
+				bool a = escape[j] < 0;
+				bool e = a && nmag > 4;
+				zr[j] = a ? nzr : zr[j];
+				zi[j] = a ? nzi : zi[j];
+				mag[j] = a ? nmag : mag[j];
+				escape[j] = e ? i : escape[j];
+				active += a && !e;
+			}
+			if (!active) break;
+		}
+
+		for(int j = 0; j < n; ++j) {
+			out_zr[j] = (Real)zr[j];
+			out_zi[j] = (Real)zi[j];
+			out_mag[j] = mag[j];
+		}
+	}
+
+	//! Returns the point of context where the color comes from
+	Point get_context_point(const Point &pos, int escape, Real zr, Real zi) const
+	{
+		bool distort = escape < 0 ? distort_inside : distort_outside;
+		return distort ? Point(zr, zi) : pos;
+	}
+
+	//! Returns the color for result of iterate(),
+	//! \a color is the color of context at get_context_point()
+	Color shade(int escape, Real zr, Real zi, ColorReal mag, const Color &color) const
+	{
+		Color ret;
+
+		if (escape >= 0)
+		{
+			ColorReal depth;
+			if(smooth_outside)
+			{
+				// Darco's original mandelbrot smoothing algo
+				// depth=((Point::value_type)i+(2.0-sqrt(mag))/PI);
+
+				// Linas Vepstas algo (Better than darco's)
+				// See (http://linas.org/art-gallery/escape/smooth.html)
+				depth= (ColorReal)escape - log(log(sqrt(mag))) / LOG_OF_2;
+
+				// Clamp
+				if(depth<0) depth=0;
+			}
+			else
+				depth=static_cast<ColorReal>(escape);
+
+			ret=solid_outside ? ocolor : color;
+
+			if(invert_outside)
+				ret=~ret;
+
+			if(color_outside)
+				ret=ret.set_uv(zr,zi).clamped_negative();
+
+			if(color_cycle)
+				ret=ret.rotate_uv(color_shift.operator*(depth)).clamped_negative();
+
+			if(shade_outside)
+			{
+				ColorReal alpha=depth/static_cast<ColorReal>(iterations);
+				ret=(ocolor-ret)*alpha+ret;
+			}
+			return ret;
+		}
+
+		ret=solid_inside ? icolor : color;
+
+		if(invert_inside)
+			ret=~ret;
+
+		if(color_inside)
+			ret=ret.set_uv(zr,zi).clamped_negative();
+
+		if(shade_inside)
+			ret=(icolor-ret)*mag+ret;
+
+		return ret;
+	}
+};
+
+
+namespace {
+
+class TaskJulia: public TaskFractal<Julia::Params>
+{
+public:
+	typedef etl::handle<TaskJulia> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+};
+
+
+class TaskJuliaSW: public TaskJulia, public rendering::TaskSW,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskJuliaSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_sw(); }
+};
+
+
+rendering::Task::Token TaskJulia::token(
+	DescAbstract<TaskJulia>("Julia") );
+rendering::Task::Token TaskJuliaSW::token(
+	DescReal<TaskJuliaSW, TaskJulia>("JuliaSW") );
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
 Julia::Julia():
@@ -226,119 +437,54 @@ Julia::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
 	return desc;
 }
 
+void
+Julia::fill_params(Params &params)const
+{
+	params.icolor=param_icolor.get(Color());
+	params.ocolor=param_ocolor.get(Color());
+	params.color_shift=param_color_shift.get(Angle());
+	params.iterations=param_iterations.get(int());
+	params.seed=param_seed.get(Point());
+	params.distort_inside=param_distort_inside.get(bool());
+	params.shade_inside=param_shade_inside.get(bool());
+	params.solid_inside=param_solid_inside.get(bool());
+	params.invert_inside=param_invert_inside.get(bool());
+	params.color_inside=param_color_inside.get(bool());
+	params.distort_outside=param_distort_outside.get(bool());
+	params.shade_outside=param_shade_outside.get(bool());
+	params.solid_outside=param_solid_outside.get(bool());
+	params.invert_outside=param_invert_outside.get(bool());
+	params.color_outside=param_color_outside.get(bool());
+
+	params.color_cycle=param_color_cycle.get(bool());
+	params.smooth_outside=param_smooth_outside.get(bool());
+	params.broken=param_broken.get(bool());
+}
+
 Color
 Julia::get_color(Context context, const Point &pos)const
 {
-	Color icolor=param_icolor.get(Color());
-	Color ocolor=param_ocolor.get(Color());
-	Angle color_shift=param_color_shift.get(Angle());
-	int iterations=param_iterations.get(int());
-	Point seed=param_seed.get(Point());
-	bool distort_inside=param_distort_inside.get(bool());
-	bool shade_inside=param_shade_inside.get(bool());
-	bool solid_inside=param_solid_inside.get(bool());
-	bool invert_inside=param_invert_inside.get(bool());
-	bool color_inside=param_color_inside.get(bool());
-	bool distort_outside=param_distort_outside.get(bool());
-	bool shade_outside=param_shade_outside.get(bool());
-	bool solid_outside=param_solid_outside.get(bool());
-	bool invert_outside=param_invert_outside.get(bool());
-	bool color_outside=param_color_outside.get(bool());
-
-	bool color_cycle=param_color_cycle.get(bool());
-	bool smooth_outside=param_smooth_outside.get(bool());
-	bool broken=param_broken.get(bool());
-
-	Real
-		cr, ci,
-		zr, zi,
-		zr_hold;
-
-	ColorReal
-		depth, mag(0);
-
-	Color
-		ret;
-
-	cr=seed[0];
-	ci=seed[1];
-	zr=pos[0];
-	zi=pos[1];
-
-	for(int i=0;i<iterations;i++)
-	{
-		// Perform complex multiplication
-		zr_hold=zr;
-		zr=zr*zr-zi*zi + cr;
-		zi=zr_hold*zi*2 + ci;
-
-		// Use "broken" algorithm, if requested (looks weird)
-		if(broken)zr+=zi;
-
-		// Calculate Magnitude
-		mag=zr*zr+zi*zi;
-
-		if(mag>4)
-		{
-			if(smooth_outside)
-			{
-				// Darco's original mandelbrot smoothing algo
-				// depth=((Point::value_type)i+(2.0-sqrt(mag))/PI);
-
-				// Linas Vepstas algo (Better than darco's)
-				// See (http://linas.org/art-gallery/escape/smooth.html)
-				depth= (ColorReal)i - log(log(sqrt(mag))) / LOG_OF_2;
+	Params params;
+	fill_params(params);
 
-				// Clamp
-				if(depth<0) depth=0;
-			}
-			else
-				depth=static_cast<ColorReal>(i);
-
-			if(solid_outside)
-				ret=ocolor;
-			else
-				if(distort_outside)
-					ret=context.get_color(Point(zr,zi));
-				else
-					ret=context.get_color(pos);
-
-			if(invert_outside)
-				ret=~ret;
-
-			if(color_outside)
-				ret=ret.set_uv(zr,zi).clamped_negative();
-
-			if(color_cycle)
-				ret=ret.rotate_uv(color_shift.operator*(depth)).clamped_negative();
+	Real zr, zi;
+	ColorReal mag;
+	int escape = params.iterate(pos, zr, zi, mag);
 
-			if(shade_outside)
-			{
-				ColorReal alpha=depth/static_cast<ColorReal>(iterations);
-				ret=(ocolor-ret)*alpha+ret;
-			}
-			return ret;
-		}
-	}
-
-	if(solid_inside)
-		ret=icolor;
-	else
-		if(distort_inside)
-			ret=context.get_color(Point(zr,zi));
-		else
-			ret=context.get_color(pos);
-
-	if(invert_inside)
-		ret=~ret;
-
-	if(color_inside)
-		ret=ret.set_uv(zr,zi).clamped_negative();
-
-	if(shade_inside)
-		ret=(icolor-ret)*mag+ret;
+	Color color;
+	if (!params.is_solid(escape))
+		color = context.get_color(params.get_context_point(pos, escape, zr, zi));
+	return params.shade(escape, zr, zi, mag, color);
+}
 
-	return ret;
+rendering::Task::Handle
+Julia::build_rendering_task_vfunc(Context context) const
+{
+	TaskJulia::Handle task(new TaskJulia());
+	fill_params(task->params);
+	if (task->params.is_context_needed())
+		task->sub_task() = context.build_rendering_task();
+	return task;
 }
 
 Layer::Vocab
@@ -52,6 +52,10 @@ class Julia : public Layer
 {
 	SYNFIG_LAYER_MODULE_EXT
 
+public:
+	//! Values of parameters evaluated once for rendering, see julia.cpp
+	struct Params;
+
 private:
 	//!Parameter: (Color)
 	ValueBase param_icolor;
@@ -93,7 +97,7 @@ private:
 	ValueBase param_broken;
 	Real lp;
 
-
+	void fill_params(Params &params)const;
 
 public:
 	Julia();
@@ -105,6 +109,7 @@ public:
 
 protected:
 	virtual RendDesc get_sub_renddesc_vfunc(const RendDesc &renddesc) const;
+	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
 };
 
 }; // END of namespace lyr_std
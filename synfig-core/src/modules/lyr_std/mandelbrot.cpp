@@ -33,7 +33,11 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+
 #include "mandelbrot.h"
+#include "fractal.h"
 
 #include <synfig/localization.h>
 
@@ -43,6 +47,7 @@
 #include <synfig/renddesc.h>
 #include <synfig/value.h>
 
+
 #endif
 
 using namespace etl;
@@ -96,6 +101,221 @@ color_neg_flip(Color &color)
 	}
 }
 
+struct Mandelbrot::Params
+{
+	//! Count of points evaluated at once by iterate_batch()
+	static const int batch_size = 8;
+
+	int iterations;
+	Real bailout;
+	Real lp;
+	bool broken;
+
+	bool distort_inside;
+	bool shade_inside;
+	bool solid_inside;
+	bool invert_inside;
+	Gradient gradient_inside;
+	Real gradient_offset_inside;
+	bool gradient_loop_inside;
+
+	bool distort_outside;
+	bool shade_outside;
+	bool solid_outside;
+	bool invert_outside;
+	Gradient gradient_outside;
+	bool smooth_outside;
+	Real gradient_offset_outside;
+	Real gradient_scale_outside;
+
+	Params():
+		iterations(), bailout(), lp(), broken(),
+		distort_inside(), shade_inside(), solid_inside(), invert_inside(),
+		gradient_offset_inside(), gradient_loop_inside(),
+		distort_outside(), shade_outside(), solid_outside(), invert_outside(),
+		smooth_outside(), gradient_offset_outside(), gradient_scale_outside() { }
+
+	bool is_solid(int escape) const
+		{ return escape < 0 ? solid_inside : solid_outside; }
+	bool is_context_needed() const
+		{ return !solid_inside || !solid_outside; }
+	bool is_context_distorted() const
+		{ return (!solid_inside && distort_inside) || (!solid_outside && distort_outside); }
+
+	//! Iterates the point \a pos, returns the iteration where the point escapes, or -1
+	int iterate(const Point &pos, Real &zr, Real &zi, ColorReal &mag) const
+	{
+		Real cr = pos[0], ci = pos[1], zr_hold;
+		zr = zi = 0;
+		mag = 0;
+
+		for(int i=0;i<iterations;i++)
+		{
+			// Perform complex multiplication
+			zr_hold=zr;
+			zr=zr*zr-zi*zi + cr;
+			if(broken)zr+=zi; // Use "broken" algorithm, if requested (looks weird)
+			zi=zr_hold*zi*2 + ci;
+
+			// Calculate Magnitude
+			mag=zr*zr+zi*zi;
+
+			if(mag>bailout)
+				return i;
+		}
+		return -1;
+	}
+
+	//! Batch version of iterate() for batch_size points.
+	//! Escaped points keep their values while the others continue,
+	//! so loops have no branches and may be vectorized by compiler.
+	//! Iterations stop when all points are escaped.
+	//! With T = Real the arithmetic is the same as in iterate().
+	template<typename T>
+	void iterate_batch(const Real *x, const Real *y, int *escape, Real *out_zr, Real *out_zi, ColorReal *out_mag) const
+	{
+		const int n = batch_size;
+		T cr[n], ci[n], zr[n], zi[n];
+		ColorReal mag[n];
+		for(int j = 0; j < n; ++j) {
+			cr[j] = (T)x[j];
+			ci[j] = (T)y[j];
+			zr[j] = zi[j] = T();
+			mag[j] = 0;
+			escape[j] = -1;
+		}
+
+		for(int i = 0; i < iterations; ++i) {
+			int active = 0;
+			for(int j = 0; j < n; ++j) {
+				T nzr = zr[j]*zr[j] - zi[j]*zi[j] + cr[j];
+				if (broken) nzr += zi[j];
+				T nzi = zr[j]*zi[j]*2 + ci[j];
+				ColorReal nmag = (ColorReal)(nzr*nzr + nzi*nzi);
+
+				bool a = escape[j] < 0;
+				bool e = a && nmag > bailout;
+				zr[j] = a ? nzr : zr[j];
+				zi[j] = a ? nzi : zi[j];
+				mag[j] = a ? nmag : mag[j];
+				escape[j] = e ? i : escape[j];
+				active += a && !e;
+			}
+			if (!active) break;
+		}
+
+		for(int j = 0; j < n; ++j) {
+			out_zr[j] = (Real)zr[j];
+			out_zi[j] = (Real)zi[j];
+			out_mag[j] = mag[j];
+		}
+	}
+
+	//! Returns the point of context where the color comes from
+	Point get_context_point(const Point &pos, int escape, Real zr, Real zi) const
+	{
+		bool distort = escape < 0 ? distort_inside : distort_outside;
+		return distort ? Point(pos[0]+zr, pos[1]+zi) : pos;
+	}
+
+	//! Returns the color for result of iterate(),
+	//! \a color is the color of context at get_context_point(),
+	//! \a zr and \a zi are not used, but the signature is shared with Julia::Params
+	Color shade(int escape, Real /* zr */, Real /* zi */, ColorReal mag, const Color &color) const
+	{
+		Color ret;
+
+		if (escape >= 0)
+		{
+			ColorReal depth;
+			if(smooth_outside)
+			{
+				// Darco's original mandelbrot smoothing algo
+				// depth=((Point::value_type)i+(2.0-sqrt(mag))/PI);
+
+				// Linas Vepstas algo (Better than darco's)
+				// See (http://linas.org/art-gallery/escape/smooth.html)
+				depth= (ColorReal)escape + LOG_OF_2*lp - log(log(sqrt(mag))) / LOG_OF_2;
+
+				// Clamp
+				if(depth<0) depth=0;
+			}
+			else
+				depth=static_cast<ColorReal>(escape);
+
+			ColorReal amount(depth/static_cast<ColorReal>(iterations));
+			amount=amount*gradient_scale_outside+gradient_offset_outside;
+			amount-=floor(amount);
+
+			if(solid_outside)
+				ret=gradient_outside(amount);
+			else
+			{
+				ret=color;
+
+				if(invert_outside)
+					ret=~ret;
+
+				if(shade_outside)
+					ret=Color::blend(gradient_outside(amount), ret, 1.0);
+			}
+
+			return ret;
+		}
+
+		ColorReal amount(std::fabs(mag+gradient_offset_inside));
+		if(gradient_loop_inside)
+			amount-=floor(amount);
+
+		if(solid_inside)
+			ret=gradient_inside(amount);
+		else
+		{
+			ret=color;
+
+			if(invert_inside)
+				ret=~ret;
+
+			if(shade_inside)
+				ret=Color::blend(gradient_inside(amount), ret, 1.0);
+		}
+
+		return ret;
+	}
+};
+
+
+namespace {
+
+class TaskMandelbrot: public TaskFractal<Mandelbrot::Params>
+{
+public:
+	typedef etl::handle<TaskMandelbrot> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+};
+
+
+class TaskMandelbrotSW: public TaskMandelbrot, public rendering::TaskSW,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskMandelbrotSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const
+		{ return run_sw(); }
+};
+
+
+rendering::Task::Token TaskMandelbrot::token(
+	DescAbstract<TaskMandelbrot>("Mandelbrot") );
+rendering::Task::Token TaskMandelbrotSW::token(
+	DescReal<TaskMandelbrotSW, TaskMandelbrot>("MandelbrotSW") );
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
 Mandelbrot::Mandelbrot():
@@ -308,119 +528,54 @@ Mandelbrot::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
 	return desc;
 }
 
+void
+Mandelbrot::fill_params(Params &params)const
+{
+	params.iterations=param_iterations.get(int());
+	params.bailout=param_bailout.get(Real());
+	params.lp=lp;
+	params.broken=param_broken.get(bool());
+
+	params.distort_inside=param_distort_inside.get(bool());
+	params.shade_inside=param_shade_inside.get(bool());
+	params.solid_inside=param_solid_inside.get(bool());
+	params.invert_inside=param_invert_inside.get(bool());
+	params.gradient_inside=param_gradient_inside.get(Gradient());
+	params.gradient_offset_inside=param_gradient_offset_inside.get(Real());
+	params.gradient_loop_inside=param_gradient_loop_inside.get(bool());
+
+	params.distort_outside=param_distort_outside.get(bool());
+	params.shade_outside=param_shade_outside.get(bool());
+	params.solid_outside=param_solid_outside.get(bool());
+	params.invert_outside=param_invert_outside.get(bool());
+	params.gradient_outside=param_gradient_outside.get(Gradient());
+	params.smooth_outside=param_smooth_outside.get(bool());
+	params.gradient_offset_outside=param_gradient_offset_outside.get(Real());
+	params.gradient_scale_outside=param_gradient_scale_outside.get(Real());
+}
+
 Color
 Mandelbrot::get_color(Context context, const Point &pos)const
 {
-	int iterations=param_iterations.get(int());
-	Real bailout=param_bailout.get(Real());
-	bool broken=param_broken.get(bool());
-
-	bool distort_inside=param_distort_inside.get(bool());
-	bool shade_inside=param_shade_inside.get(bool());
-	bool solid_inside=param_solid_inside.get(bool());
-	bool invert_inside=param_invert_inside.get(bool());
-	Gradient gradient_inside=param_gradient_inside.get(Gradient());
-	Real gradient_offset_inside=param_gradient_offset_inside.get(Real());
-	bool gradient_loop_inside=param_gradient_loop_inside.get(bool());
-
-	bool distort_outside=param_distort_outside.get(bool());
-	bool shade_outside=param_shade_outside.get(bool());
-	bool solid_outside=param_solid_outside.get(bool());
-	bool invert_outside=param_invert_outside.get(bool());
-	Gradient gradient_outside=param_gradient_outside.get(Gradient());
-	bool smooth_outside=param_smooth_outside.get(bool());
-	Real gradient_offset_outside=param_gradient_offset_outside.get(Real());
-	Real gradient_scale_outside=param_gradient_scale_outside.get(Real());
-	
-	Real
-		cr, ci,
-		zr, zi,
-		zr_hold;
-
-	ColorReal
-		depth, mag(0);
-
-	Color
-		ret;
-
-
-	zr=zi=0;
-	cr=pos[0];
-	ci=pos[1];
-
-	for(int i=0;i<iterations;i++)
-	{
-		// Perform complex multiplication
-		zr_hold=zr;
-		zr=zr*zr-zi*zi + cr;
-		if(broken)zr+=zi; // Use "broken" algorithm, if requested (looks weird)
-		zi=zr_hold*zi*2 + ci;
-
-
-		// Calculate Magnitude
-		mag=zr*zr+zi*zi;
-
-		if(mag>bailout)
-		{
-			if(smooth_outside)
-			{
-				// Darco's original mandelbrot smoothing algo
-				// depth=((Point::value_type)i+(2.0-sqrt(mag))/PI);
-
-				// Linas Vepstas algo (Better than darco's)
-				// See (http://linas.org/art-gallery/escape/smooth.html)
-				depth= (ColorReal)i + LOG_OF_2*lp - log(log(sqrt(mag))) / LOG_OF_2;
-
-				// Clamp
-				if(depth<0) depth=0;
-			}
-			else
-				depth=static_cast<ColorReal>(i);
-
-			ColorReal amount(depth/static_cast<ColorReal>(iterations));
-			amount=amount*gradient_scale_outside+gradient_offset_outside;
-			amount-=floor(amount);
-
-			if(solid_outside)
-				ret=gradient_outside(amount);
-			else
-			{
-				if(distort_outside)
-					ret=context.get_color(Point(pos[0]+zr,pos[1]+zi));
-				else
-					ret=context.get_color(pos);
-
-				if(invert_outside)
-					ret=~ret;
-
-				if(shade_outside)
-					ret=Color::blend(gradient_outside(amount), ret, 1.0);
-			}
-
-
-			return ret;
-		}
-	}
+	Params params;
+	fill_params(params);
 
-	ColorReal amount(std::fabs(mag+gradient_offset_inside));
-	if(gradient_loop_inside)
-		amount-=floor(amount);
+	Real zr, zi;
+	ColorReal mag;
+	int escape = params.iterate(pos, zr, zi, mag);
 
-	if(solid_inside)
-		ret=gradient_inside(amount);
-	else
-	{
-		if(distort_inside)
-			ret=context.get_color(Point(pos[0]+zr,pos[1]+zi));
-		else
-			ret=context.get_color(pos);
-
-		if(invert_inside)
-			ret=~ret;
-
-		if(shade_inside)
-			ret=Color::blend(gradient_inside(amount), ret, 1.0);
-	}
+	Color color;
+	if (!params.is_solid(escape))
+		color = context.get_color(params.get_context_point(pos, escape, zr, zi));
+	return params.shade(escape, zr, zi, mag, color);
+}
 
-	return ret;
+rendering::Task::Handle
+Mandelbrot::build_rendering_task_vfunc(Context context) const
+{
+	TaskMandelbrot::Handle task(new TaskMandelbrot());
+	fill_params(task->params);
+	if (task->params.is_context_needed())
+		task->sub_task() = context.build_rendering_task();
+	return task;
 }
@@ -52,6 +52,10 @@ class Mandelbrot : public Layer
 {
 	SYNFIG_LAYER_MODULE_EXT
 
+public:
+	//! Values of parameters evaluated once for rendering, see mandelbrot.cpp
+	struct Params;
+
 private:
 	//!Parameter: (int)
 	ValueBase param_iterations;
@@ -92,6 +96,8 @@ private:
 	//!Parameter: (Real)
 	ValueBase param_gradient_scale_outside;
 
+	void fill_params(Params &params)const;
+
 public:
 	Mandelbrot();
 
@@ -102,6 +108,7 @@ public:
 
 protected:
 	virtual RendDesc get_sub_renddesc_vfunc(const RendDesc &renddesc) const;
+	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
 };
 
 }; // END of namespace lyr_std
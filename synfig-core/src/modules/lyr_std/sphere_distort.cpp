@@ -49,6 +49,8 @@
 
 #include <synfig/curve_helper.h>
 
+#include <synfig/rendering/common/task/taskdistort.h>
+
 #endif
 
 /* === U S I N G =========================================================== */
@@ -304,6 +306,52 @@ inline Point sphtrans(const Point &p, const Point &center, const Real &radius,
 	return sphtrans(p, center, radius, percent, type, tmp);
 }
 
+namespace {
+
+class SphereDistortion: public rendering::TaskDistort::Distortion
+{
+public:
+	Point center;
+	Real radius;
+	Real percent;
+	int type;
+	bool clip;
+
+	SphereDistortion(): radius(), percent(), type(TYPE_NORMAL), clip() { }
+
+	virtual void transform(Vector *points, int count) const {
+		bool clipped;
+		for(Vector *p = points, *end = points + count; p < end; ++p) {
+			*p = sphtrans(*p, center, radius, percent, type, clipped);
+			if (clip && clipped)
+				*p = Vector(NAN, NAN);
+		}
+	}
+
+	virtual Rect calc_bounds(const Rect &source_bounds) const {
+		// points are moved only inside of the sphere (or strip)
+		Real r = std::fabs(radius);
+		Rect area;
+		switch(type) {
+		case TYPE_NORMAL:
+			area = Rect(center[0] - r, center[1] - r, center[0] + r, center[1] + r); break;
+		case TYPE_DISTH:
+			area = Rect(center[0] - r, source_bounds.miny, center[0] + r, source_bounds.maxy); break;
+		case TYPE_DISTV:
+			area = Rect(source_bounds.minx, center[1] - r, source_bounds.maxx, center[1] + r); break;
+		default:
+			return rendering::TaskDistort::Distortion::calc_bounds(source_bounds);
+		}
+		if (clip)
+			return area;
+		Rect bounds = source_bounds;
+		rect_set_union(bounds, bounds, area);
+		return bounds;
+	}
+};
+
+} // namespace
+
 Layer::Handle
 Layer_SphereDistort::hit_check(Context context, const Point &pos)const
 {
@@ -573,6 +621,22 @@ Layer_SphereDistort::accelerated_render(Context context,Surface *surface,int qua
 
 #endif
 
+rendering::Task::Handle
+Layer_SphereDistort::build_rendering_task_vfunc(Context context) const
+{
+	etl::handle<SphereDistortion> distortion(new SphereDistortion());
+	distortion->center = param_center.get(Vector());
+	distortion->radius = param_radius.get(double());
+	distortion->percent = param_amount.get(double());
+	distortion->type = param_type.get(int());
+	distortion->clip = param_clip.get(bool());
+
+	rendering::TaskDistort::Handle task(new rendering::TaskDistort());
+	task->distortion = distortion;
+	task->sub_task() = context.build_rendering_task();
+	return task;
+}
+
 class lyr_std::Spherize_Trans : public Transform
 {
 	etl::handle<const Layer_SphereDistort> layer;
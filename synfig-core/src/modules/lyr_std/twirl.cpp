@@ -42,6 +42,7 @@
 #include <synfig/renddesc.h>
 #include <synfig/value.h>
 #include <synfig/transform.h>
+#include <synfig/rendering/common/task/taskdistort.h>
 #include "twirl.h"
 
 #endif
@@ -63,6 +64,74 @@ SYNFIG_LAYER_SET_VERSION(Twirl,"0.1");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+inline Point
+twirl(const Point &pos, const Point &center, Real radius, const Angle &rotations,
+	bool distort_inside, bool distort_outside, bool reverse)
+{
+	Point centered(pos-center);
+	Real mag(centered.mag());
+
+	Angle a;
+
+	if((distort_inside || mag>radius) && (distort_outside || mag<radius))
+		a=rotations*((mag-radius)/radius);
+	else
+		return pos;
+
+	if(reverse)	a=-a;
+
+	const Real sin(Angle::sin(a).get());
+	const Real cos(Angle::cos(a).get());
+
+	Point twirled;
+	twirled[0]=cos*centered[0]-sin*centered[1];
+	twirled[1]=sin*centered[0]+cos*centered[1];
+
+	return twirled+center;
+}
+
+class TwirlDistortion: public rendering::TaskDistort::Distortion
+{
+public:
+	Point center;
+	Real radius;
+	Angle rotations;
+	bool distort_inside;
+	bool distort_outside;
+
+	TwirlDistortion(): radius(), distort_inside(), distort_outside() { }
+
+	virtual void transform(Vector *points, int count) const {
+		for(Vector *p = points, *end = points + count; p < end; ++p)
+			*p = twirl(*p, center, radius, rotations, distort_inside, distort_outside, false);
+	}
+
+	virtual Rect calc_source_rect(const Rect &rect, const Vector&) const {
+		// twirl keeps the distance to center, so points of the rect
+		// may come from the circle of the farthest distance
+		Real dx = std::max(std::fabs(rect.minx - center[0]), std::fabs(rect.maxx - center[0]));
+		Real dy = std::max(std::fabs(rect.miny - center[1]), std::fabs(rect.maxy - center[1]));
+		Real max_dist = std::sqrt(dx*dx + dy*dy);
+		if (!distort_outside)
+			max_dist = std::min(max_dist, std::fabs(radius));
+		Rect source_rect = rect;
+		rect_set_union(source_rect, source_rect, Rect(center).expand(max_dist));
+		return source_rect;
+	}
+
+	virtual Rect calc_bounds(const Rect &source_bounds) const {
+		if (distort_outside)
+			return rendering::TaskDistort::Distortion::calc_bounds(source_bounds);
+		Rect bounds = source_bounds;
+		rect_set_union(bounds, bounds, Rect(center).expand(std::fabs(radius)));
+		return bounds;
+	}
+};
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
 /* === E N T R Y P O I N T ================================================= */
@@ -151,27 +220,8 @@ Twirl::distort(const Point &pos,bool reverse)const
 	Angle rotations=param_rotations.get(Angle());
 	bool distort_inside=param_distort_inside.get(bool());
 	bool distort_outside=param_distort_outside.get(bool());
-	
-	Point centered(pos-center);
-	Real mag(centered.mag());
-
-	Angle a;
 
-	if((distort_inside || mag>radius) && (distort_outside || mag<radius))
-		a=rotations*((centered.mag()-radius)/radius);
-	else
-		return pos;
-
-	if(reverse)	a=-a;
-
-	const Real sin(Angle::sin(a).get());
-	const Real cos(Angle::cos(a).get());
-
-	Point twirled;
-	twirled[0]=cos*centered[0]-sin*centered[1];
-	twirled[1]=sin*centered[0]+cos*centered[1];
-
-	return twirled+center;
+	return twirl(pos, center, radius, rotations, distort_inside, distort_outside, reverse);
 }
 
 Layer::Handle
@@ -280,5 +330,20 @@ Twirl::get_sub_renddesc_vfunc(const RendDesc &renddesc) const
 }
 
 rendering::Task::Handle
-Twirl::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+Twirl::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	if (!sub_task)
+		return sub_task;
+
+	etl::handle<TwirlDistortion> distortion(new TwirlDistortion());
+	distortion->center = param_center.get(Point());
+	distortion->radius = param_radius.get(Real());
+	distortion->rotations = param_rotations.get(Angle());
+	distortion->distort_inside = param_distort_inside.get(bool());
+	distortion->distort_outside = param_distort_outside.get(bool());
+
+	rendering::TaskDistort::Handle task(new rendering::TaskDistort());
+	task->distortion = distortion;
+	task->sub_task() = sub_task->clone_recursive();
+	return task;
+}
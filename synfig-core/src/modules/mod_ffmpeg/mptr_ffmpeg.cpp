@@ -50,6 +50,7 @@
  #include <fcntl.h>
 #endif
 #include <iostream>
+#include <vector>
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -81,113 +82,128 @@ bool ffmpeg_mptr::is_animated()
 }
 
 bool
-ffmpeg_mptr::seek_to(const Time& time)
+ffmpeg_mptr::open_stream(const Time& time)
 {
-	//if(frame<cur_frame || !file)
-	//{
-		if(file)
-		{
-#if defined(WIN32_PIPE_TO_PROCESSES)
-			_pclose(file);
-#elif defined(UNIX_PIPE_TO_PROCESSES)
-			fclose(file);
-			int status;
-			waitpid(pid,&status,0);
-#endif
-		}
-		
-		// FIXME: 24 fps is hardcoded now, but in fact we have to get it from canvas
-		//float position = (frame+1)/24; // ffmpeg didn't work with 0 frame
-		//float position = 1000/24; // ffmpeg didn't work with 0 frame
-		const std::string position = time.get_string(Time::FORMAT_NORMAL);
+	close_stream();
+
+	const std::string position = time.get_string(Time::FORMAT_NORMAL);
+	const std::string rate = strprintf("%f", fps);
 
 #if defined(WIN32_PIPE_TO_PROCESSES)
 
-		string command;
-		
-		String binary_path = synfig::get_binary_path("");
-		if (binary_path != "")
-			binary_path = etl::dirname(binary_path)+ETL_DIRECTORY_SEPARATOR;
-		binary_path += "ffmpeg.exe";
+	string command;
+
+	String binary_path = synfig::get_binary_path("");
+	if (binary_path != "")
+		binary_path = etl::dirname(binary_path)+ETL_DIRECTORY_SEPARATOR;
+	binary_path += "ffmpeg.exe";
+
+	command=strprintf("\"%s\" -ss %s -i \"%s\" -an -r %s -f image2pipe -vcodec ppm -\n", binary_path.c_str(), position.c_str(), identifier.filename.c_str(), rate.c_str());
 
-		command=strprintf("\"%s\" -ss %s -i \"%s\" -vframes 1 -an -f image2pipe -vcodec ppm -\n", binary_path.c_str(), position.c_str(), identifier.filename.c_str());
-		
-		// This covers the dumb cmd.exe behavior.
-		// See: http://eli.thegreenplace.net/2011/01/28/on-spaces-in-the-paths-of-programs-and-files-on-windows/
-		command = "\"" + command + "\"";
+	// This covers the dumb cmd.exe behavior.
+	// See: http://eli.thegreenplace.net/2011/01/28/on-spaces-in-the-paths-of-programs-and-files-on-windows/
+	command = "\"" + command + "\"";
 
-		file=_popen(command.c_str(),POPEN_BINARY_READ_TYPE);
+	file=_popen(command.c_str(),POPEN_BINARY_READ_TYPE);
 
 #elif defined(UNIX_PIPE_TO_PROCESSES)
 
-		int p[2];
+	int p[2];
 
-		if (pipe(p)) {
-			cerr<<"Unable to open pipe to ffmpeg (no pipe)"<<endl;
-			return false;
-		};
+	// the process is forked from the multithreaded program,
+	// so descriptors must not leak to processes forked by other threads
+#ifdef HAVE_PIPE2
+	if (pipe2(p, O_CLOEXEC)) {
+#else
+	if (pipe(p) || fcntl(p[0], F_SETFD, FD_CLOEXEC) || fcntl(p[1], F_SETFD, FD_CLOEXEC)) {
+#endif
+		cerr<<"Unable to open pipe to ffmpeg (no pipe)"<<endl;
+		return false;
+	};
 
-		pid = fork();
+	pid = fork();
 
-		if (pid == -1) {
-			cerr<<"Unable to open pipe to ffmpeg (pid == -1)"<<endl;
-			return false;
-		}
+	if (pid == -1) {
+		cerr<<"Unable to open pipe to ffmpeg (pid == -1)"<<endl;
+		close(p[0]);
+		close(p[1]);
+		return false;
+	}
 
-		if (pid == 0){
-			// Child process
-			// Close pipein, not needed
-			close(p[0]);
-			// Dup pipein to stdout
-			if( dup2( p[1], STDOUT_FILENO ) == -1 ){
-				cerr<<"Unable to open pipe to ffmpeg (dup2( p[1], STDOUT_FILENO ) == -1)"<<endl;
-				return false;
-			}
-			// Close the unneeded pipein
-			close(p[1]);
-			/*std::string command = strprintf("\"%s\" -ss '%s' -i \"%s\" -vframes 1 -an -f image2pipe -vcodec ppm -\n", "ffmpeg", position2, identifier.filename.c_str());
-			synfig::warning("ffmpeg command: '%s'", command.c_str());*/
-			execlp("ffmpeg", "ffmpeg", "-ss", position.c_str(), "-i", identifier.filename.c_str(), "-vframes", "1","-an", "-f", "image2pipe", "-vcodec", "ppm", "-", (const char *)NULL);
-			// We should never reach here unless the exec failed
-			cerr<<"Unable to open pipe to ffmpeg (exec failed)"<<endl;
+	if (pid == 0){
+		// Child process
+		// Close pipein, not needed
+		close(p[0]);
+		// Dup pipein to stdout
+		if( dup2( p[1], STDOUT_FILENO ) == -1 ){
+			cerr<<"Unable to open pipe to ffmpeg (dup2( p[1], STDOUT_FILENO ) == -1)"<<endl;
 			_exit(1);
-		} else {
-			// Parent process
-			// Close pipeout, not needed
-			close(p[1]);
-			// Save pipein to file handle, will read from it later
-			file = fdopen(p[0], "rb");
 		}
+		// Close the unneeded pipein
+		close(p[1]);
+		// output frame rate is fixed, so n-th frame of stream is at time position + n/fps
+		execlp("ffmpeg", "ffmpeg", "-ss", position.c_str(), "-i", identifier.filename.c_str(), "-an", "-r", rate.c_str(), "-f", "image2pipe", "-vcodec", "ppm", "-", (const char *)NULL);
+		// We should never reach here unless the exec failed
+		cerr<<"Unable to open pipe to ffmpeg (exec failed)"<<endl;
+		_exit(1);
+	} else {
+		// Parent process
+		// Close pipeout, not needed
+		close(p[1]);
+		// Save pipein to file handle, will read from it later
+		file = fdopen(p[0], "rb");
+	}
 
 #else
 	#error There are no known APIs for creating child processes
 #endif
 
-		if(!file)
-		{
-			cerr<<"Unable to open pipe to ffmpeg"<<endl;
-			return false;
-		}
-		cur_frame=-1;
-	//}
-
-	//while(cur_frame<frame-1)
-	//{
-	//	cerr<<"Seeking to..."<<frame<<'('<<cur_frame<<')'<<endl;
-	//	if(!grab_frame())
-	//		return false;
-	//}
+	if(!file)
+	{
+		cerr<<"Unable to open pipe to ffmpeg"<<endl;
+		return false;
+	}
+
+	stream_time = time;
+	next_index = 0;
+	wanted_index = 0;
+	stop = false;
+	eof = false;
+	reader = std::thread(&ffmpeg_mptr::read_frames, this);
 	return true;
 }
 
-bool
-ffmpeg_mptr::grab_frame(void)
+void
+ffmpeg_mptr::close_stream()
 {
-	if(!file)
+	if (reader.joinable())
 	{
-		cerr<<"unable to open "<<identifier.filename.c_str()<<endl;
-		return false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cond.notify_all();
+		reader.join();
+	}
+
+	if(file)
+	{
+#if defined(WIN32_PIPE_TO_PROCESSES)
+		_pclose(file);
+#elif defined(UNIX_PIPE_TO_PROCESSES)
+		fclose(file);
+		int status;
+		waitpid(pid,&status,0);
+#endif
+		file = NULL;
 	}
+
+	frames.clear();
+}
+
+bool
+ffmpeg_mptr::grab_frame(Surface &surface)
+{
 	int w,h;
 	float divisor;
 	char cookie[2];
@@ -205,27 +221,57 @@ ffmpeg_mptr::grab_frame(void)
 	}
 
 	fgetc(file);
-	fscanf(file,"%d %d\n",&w,&h);
-	fscanf(file,"%f",&divisor);
+	if (fscanf(file,"%d %d\n",&w,&h) != 2 || fscanf(file,"%f",&divisor) != 1)
+		return false;
 	fgetc(file);
 
-	if(feof(file))
+	if(feof(file) || w <= 0 || h <= 0)
 		return false;
 
-	frame.set_wh(w, h);
+	surface.set_wh(w, h);
+	std::vector<unsigned char> row(3*w);
 	const ColorReal k = 1/255.0;
-	for(int y = 0; y < frame.get_h(); ++y)
-		for(int x = 0; x < frame.get_w(); ++x)
+	for(int y = 0; y < h; ++y)
+	{
+		if (fread(&row.front(), 1, row.size(), file) != row.size())
+			return false;
+		const unsigned char *c = &row.front();
+		for(int x = 0; x < w; ++x, c += 3)
+			surface[y][x] = Color(k*c[0], k*c[1], k*c[2]);
+	}
+	return true;
+}
+
+void
+ffmpeg_mptr::read_frames()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true)
+	{
+		while(!stop && next_index - wanted_index >= lookahead)
+			cond.wait(lock);
+		if (stop)
+			break;
+
+		// decode without lock, so already decoded frames are available meanwhile
+		lock.unlock();
+		Frame frame;
+		bool success = grab_frame(frame.surface);
+		lock.lock();
+
+		if (!success)
 		{
-			if(feof(file))
-				return false;
-			ColorReal r = k*(unsigned char)fgetc(file);
-			ColorReal g = k*(unsigned char)fgetc(file);
-			ColorReal b = k*(unsigned char)fgetc(file);
-			frame[y][x] = Color(r, g, b);
+			eof = true;
+			cond.notify_all();
+			break;
 		}
-	cur_frame++;
-	return true;
+
+		frame.index = next_index++;
+		frames.push_back(frame);
+		while((int)frames.size() > lookahead + lookbehind)
+			frames.pop_front();
+		cond.notify_all();
+	}
 }
 
 ffmpeg_mptr::ffmpeg_mptr(const synfig::FileSystem::Identifier &identifier):
@@ -235,36 +281,53 @@ ffmpeg_mptr::ffmpeg_mptr(const synfig::FileSystem::Identifier &identifier):
 	tcgetattr (0, &oldtty);
 #endif
 	file=NULL;
-	fps=23.98;
-	cur_frame=-1;
+	fps=24;
+	next_index=0;
+	wanted_index=0;
+	stop=false;
+	eof=false;
 }
 
 ffmpeg_mptr::~ffmpeg_mptr()
 {
-	if(file)
-	{
-#if defined(WIN32_PIPE_TO_PROCESSES)
-		_pclose(file);
-#elif defined(UNIX_PIPE_TO_PROCESSES)
-		fclose(file);
-		int status;
-		waitpid(pid,&status,0);
-#endif
-	}
+	close_stream();
 #ifdef HAVE_TERMIOS_H
 	tcsetattr(0,TCSANOW,&oldtty);
 #endif
 }
 
 bool
-ffmpeg_mptr::get_frame(synfig::Surface &surface, const synfig::RendDesc &/*renddesc*/, Time time, synfig::ProgressCallback *)
+ffmpeg_mptr::get_frame(synfig::Surface &surface, const synfig::RendDesc &renddesc, Time time, synfig::ProgressCallback *)
 {
-	synfig::warning("time: %f", (float)time);
-	if(!seek_to(time))
-		return false;
-	if(!grab_frame())
-		return false;
+	float rate = renddesc.get_frame_rate() > 0 ? renddesc.get_frame_rate() : 24;
+
+	// the importer is shared between all Import layers of the file
+	std::lock_guard<std::mutex> access_lock(access_mutex);
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// seek only on discontinuous access, sequential frames are already decoded or coming soon
+	int index = round_to_int((time - stream_time)*rate);
+	bool seek = !file
+	         || rate != fps
+	         || index < (frames.empty() ? next_index : frames.front().index)
+	         || index > next_index + max_skip;
+	if (seek)
+	{
+		lock.unlock();
+		fps = rate;
+		if (!open_stream(time))
+			return false;
+		lock.lock();
+		index = 0;
+	}
 
-	surface=frame;
-	return true;
+	wanted_index = index;
+	cond.notify_all();
+	while(!eof && next_index <= index)
+		cond.wait(lock);
+
+	for(std::deque<Frame>::const_iterator i = frames.begin(); i != frames.end(); ++i)
+		if (i->index == index)
+			{ surface = i->surface; return true; }
+	return false;
 }
@@ -33,6 +33,10 @@
 #include <synfig/importer.h>
 #include <sys/types.h>
 #include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #ifdef HAVE_TERMIOS_H
 #include <termios.h>
 #endif
@@ -44,24 +48,53 @@
 
 /* === C L A S S E S & S T R U C T S ======================================= */
 
+//! Imports video through the long-lived ffmpeg process.
+//! Frames are decoded sequentially by the reader thread into the small ring buffer,
+//! the process is restarted with the new position only on discontinuous access.
 class ffmpeg_mptr : public synfig::Importer
 {
 	SYNFIG_IMPORTER_MODULE_EXT
 public:
+	//! Count of frames decoded ahead of the requested one
+	static const int lookahead = 8;
+	//! Count of already requested frames kept in buffer
+	static const int lookbehind = 4;
+	//! Max count of frames to decode sequentially instead of seeking
+	static const int max_skip = 48;
+
 private:
+	struct Frame {
+		int index;
+		synfig::Surface surface;
+		Frame(): index() { }
+	};
+
 #ifdef HAVE_FORK
 	pid_t pid = -1;
 #endif
 	FILE *file;
-	int cur_frame;
-	synfig::Surface frame;
 	float fps;
+	synfig::Time stream_time; //!< time of the first frame of stream
 #ifdef HAVE_TERMIOS_H
 	struct termios oldtty;
 #endif
 
-	bool seek_to(const synfig::Time& time);
-	bool grab_frame(void);
+	//! Serializes callers of get_frame(), because the seek
+	//! restarts the process and the reader thread
+	std::mutex access_mutex;
+	std::thread reader;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<Frame> frames; //!< ring buffer of decoded frames
+	int next_index;           //!< index of the next frame in stream
+	int wanted_index;         //!< index of the last requested frame
+	bool stop;
+	bool eof;
+
+	bool open_stream(const synfig::Time &time);
+	void close_stream();
+	bool grab_frame(synfig::Surface &surface);
+	void read_frames();
 
 public:
 	ffmpeg_mptr(const synfig::FileSystem::Identifier &identifier);
@@ -33,8 +33,12 @@
 #	include <config.h>
 #endif
 
+#include <cmath>
+
 #include "halftone.h"
 
+#include <synfig/rendering/software/task/tasksw.h>
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -51,6 +55,68 @@ using namespace etl;
 
 /* === M E T H O D S ======================================================= */
 
+namespace {
+
+class TaskHalftoneSW: public TaskHalftone, public rendering::TaskSW
+{
+public:
+	typedef etl::handle<TaskHalftoneSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid() || !func || !sub_task() || !sub_task()->is_valid())
+			return true;
+
+		RectInt rd = target_rect;
+		Vector offset_units = (sub_task()->source_rect.get_min() - source_rect.get_min()).multiply_coords(get_pixels_per_unit());
+		VectorInt offset = VectorInt((int)round(offset_units[0]), (int)round(offset_units[1])) - sub_task()->target_rect.get_min();
+		RectInt rs = sub_task()->target_rect + rd.get_min() + offset;
+		rect_set_intersect(rs, rs, rd);
+		if (!rs.is_valid())
+			return true;
+
+		LockWrite ldst(this);
+		LockRead lsrc(sub_task());
+		if (!ldst || !lsrc)
+			return false;
+
+		synfig::Surface &dst = ldst->get_surface();
+		const synfig::Surface &src = lsrc->get_surface();
+
+		// positions of the pixel corners, as in accelerated_render()
+		const Vector upp = get_units_per_pixel();
+		const Point lt = source_rect.get_min();
+		const float supersample = func->calc_supersample(upp);
+
+		Point point;
+		for(int y = rs.miny; y < rs.maxy; ++y)
+		{
+			point[1] = lt[1] + (y - rd.miny)*upp[1];
+			const Color *s = &src[y - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]];
+			Color *d = &dst[y][rs.minx];
+			for(int x = rs.minx; x < rs.maxx; ++x, ++d, ++s)
+			{
+				point[0] = lt[0] + (x - rd.minx)*upp[0];
+				*d = func->color(point, supersample, *s);
+			}
+		}
+
+		return true;
+	}
+};
+
+
+rendering::Task::Token TaskHalftoneSW::token(
+	DescReal<TaskHalftoneSW, TaskHalftone>("HalftoneSW") );
+
+} // namespace
+
+
+rendering::Task::Token TaskHalftone::token(
+	DescAbstract<TaskHalftone>("Halftone") );
+
+
 float
 Halftone::operator()(const Point &point, const float& luma, float supersample)const
 {
@@ -33,7 +33,9 @@
 
 #include <synfig/vector.h>
 #include <synfig/angle.h>
+#include <synfig/color.h>
 #include <synfig/value.h>
+#include <synfig/rendering/task.h>
 
 /* === M A C R O S ========================================================= */
 
@@ -66,6 +68,41 @@ public:
 	float operator()(const synfig::Point &point, const float& intensity, float supersample=0)const;
 };
 
+//! Replaces colors of the sub task by the halftone pattern,
+//! the color of each pixel depends on its position, so the task can't pass transformations
+class TaskHalftone: public rendering::Task, public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskHalftone> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	//! Color function of the halftone layer.
+	//! It must be immutable, because it shared between clones of the task.
+	class Func: public etl::shared_object
+	{
+	public:
+		typedef etl::handle<Func> Handle;
+
+		virtual ~Func() { }
+
+		//! Returns the color at the \a point for the color of the sub task \a under_color
+		virtual Color color(const Point &point, float supersample, const Color &under_color) const = 0;
+
+		//! Returns width of the transition between dark and light colors
+		//! for the resolution \a units_per_pixel
+		virtual float calc_supersample(const Vector &units_per_pixel) const = 0;
+	};
+
+	Func::Handle func;
+
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	virtual Rect calc_bounds() const
+		{ return func && sub_task() ? sub_task()->get_bounds() : Rect::zero(); }
+};
+
 /* === E N D =============================================================== */
 
 #endif
@@ -63,6 +63,24 @@ SYNFIG_LAYER_SET_VERSION(Halftone2,"0.0");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+class Halftone2Func: public TaskHalftone::Func
+{
+public:
+	//! Immutable copy of the layer, see Layer::get_rendering_snapshot()
+	etl::handle<Halftone2> layer;
+
+	explicit Halftone2Func(const etl::handle<Halftone2> &layer): layer(layer) { }
+
+	virtual Color color(const Point &point, float supersample, const Color &under_color) const
+		{ return layer->color_func(point, supersample, under_color); }
+	virtual float calc_supersample(const Vector &units_per_pixel) const
+		{ return layer->calc_supersample(Point(), units_per_pixel[0], units_per_pixel[1]); }
+};
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
 Halftone2::Halftone2():
@@ -79,7 +97,7 @@ Halftone2::Halftone2():
 	SET_STATIC_DEFAULTS();
 }
 
-inline Color
+Color
 Halftone2::color_func(const Point &point, float supersample,const Color& color)const
 {
 	Color color_dark=param_color_dark.get(Color());
@@ -100,7 +118,7 @@ Halftone2::color_func(const Point &point, float supersample,const Color& color)c
 	return halfcolor;
 }
 
-inline float
+float
 Halftone2::calc_supersample(const synfig::Point &/*x*/, float pw,float /*ph*/)const
 {
 	return std::fabs(pw/(halftone.param_size.get(Vector())).mag());
@@ -258,7 +276,16 @@ Halftone2::accelerated_render(Context context,Surface *surface,int quality, cons
 ///
 
 rendering::Task::Handle
-Halftone2::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+Halftone2::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	if (!sub_task)
+		return rendering::Task::Handle();
+
+	TaskHalftone::Handle task(new TaskHalftone());
+	task->func = new Halftone2Func(
+		etl::handle<Halftone2>::cast_dynamic(get_rendering_snapshot()) );
+	task->sub_task() = sub_task->clone_recursive();
+	return task;
+}
 
 ///
@@ -71,15 +71,15 @@ private:
 	//! Parameter: (Color)
 	ValueBase param_color_light;
 
-	Color color_func(const Point &x, float supersample,const Color &under_color)const;
-
-	float calc_supersample(const Point &x, float pw,float ph)const;
-
 	//float halftone_func(Point x)const;
 
 public:
 	Halftone2();
 
+	Color color_func(const Point &x, float supersample,const Color &under_color)const;
+
+	float calc_supersample(const Point &x, float pw,float ph)const;
+
 	virtual bool set_param(const String &param, const ValueBase &value);
 	virtual ValueBase get_param(const String &param)const;
 	virtual Color get_color(Context context, const Point &pos)const;
@@ -89,7 +89,7 @@ public:
 	virtual bool reads_context()const { return true; }
 
 protected:
-	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
+	virtual rendering::Task::Handle build_composite_fork_task_vfunc(ContextParams context_params, rendering::Task::Handle sub_task)const;
 }; // END of class Halftone2
 
 /* === E N D =============================================================== */
@@ -64,6 +64,24 @@ SYNFIG_LAYER_SET_VERSION(Halftone3,"0.0");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+class Halftone3Func: public TaskHalftone::Func
+{
+public:
+	//! Immutable copy of the layer, see Layer::get_rendering_snapshot()
+	etl::handle<Halftone3> layer;
+
+	explicit Halftone3Func(const etl::handle<Halftone3> &layer): layer(layer) { }
+
+	virtual Color color(const Point &point, float supersample, const Color &under_color) const
+		{ return layer->color_func(point, supersample, under_color); }
+	virtual float calc_supersample(const Vector &units_per_pixel) const
+		{ return layer->calc_supersample(Point(), units_per_pixel[0], units_per_pixel[1]); }
+};
+
+} // namespace
+
 #define HALFSQRT2	(0.7)
 #define SQRT2	(1.414213562f)
 
@@ -203,7 +221,7 @@ Halftone3::sync()
 #endif
 }
 
-inline Color
+Color
 Halftone3::color_func(const Point &point, float supersample,const Color& in_color)const
 {
 	bool subtractive=param_subtractive.get(bool());
@@ -246,7 +264,7 @@ Halftone3::color_func(const Point &point, float supersample,const Color& in_colo
 	return halfcolor;
 }
 
-inline float
+float
 Halftone3::calc_supersample(const synfig::Point &/*x*/, float pw,float /*ph*/)const
 {
 	return std::fabs(pw/(tone[0].param_size.get(Vector())).mag());
@@ -439,7 +457,16 @@ Halftone3::accelerated_render(Context context,Surface *surface,int quality, cons
 
 
 rendering::Task::Handle
-Halftone3::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+Halftone3::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	if (!sub_task)
+		return rendering::Task::Handle();
+
+	TaskHalftone::Handle task(new TaskHalftone());
+	task->func = new Halftone3Func(
+		etl::handle<Halftone3>::cast_dynamic(get_rendering_snapshot()) );
+	task->sub_task() = sub_task->clone_recursive();
+	return task;
+}
 
 ////
@@ -71,10 +71,6 @@ private:
 
 	float inverse_matrix[3][3];
 
-	Color color_func(const Point &x, float supersample,const Color &under_color)const;
-
-	float calc_supersample(const Point &x, float pw,float ph)const;
-
 	//float halftone_func(Point x)const;
 
 	void sync();
@@ -82,6 +78,10 @@ private:
 public:
 	Halftone3();
 
+	Color color_func(const Point &x, float supersample,const Color &under_color)const;
+
+	float calc_supersample(const Point &x, float pw,float ph)const;
+
 	virtual bool set_param(const String &param, const ValueBase &value);
 	virtual ValueBase get_param(const String &param)const;
 	virtual Color get_color(Context context, const Point &pos)const;
@@ -91,7 +91,7 @@ public:
 	virtual bool reads_context()const { return true; }
 
 protected:
-	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context) const;
+	virtual rendering::Task::Handle build_composite_fork_task_vfunc(ContextParams context_params, rendering::Task::Handle sub_task)const;
 }; // END of class Halftone3
 
 /* === E N D =============================================================== */
@@ -47,6 +47,9 @@
 #include <synfig/value.h>
 #include <synfig/segment.h>
 
+#include <synfig/rendering/common/task/taskpixelprocessor.h>
+#include <synfig/rendering/software/task/tasksw.h>
+
 #endif
 
 using namespace synfig;
@@ -66,6 +69,69 @@ SYNFIG_LAYER_SET_VERSION(LumaKey,"0.1");
 
 /* === M E T H O D S ======================================================= */
 
+namespace {
+
+//! Converts luminance to alpha: a' = Y*a, Y' = 1
+class TaskLumaKey: public rendering::TaskPixelProcessor
+{
+public:
+	typedef etl::handle<TaskLumaKey> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+};
+
+
+class TaskLumaKeySW: public TaskLumaKey, public rendering::TaskSW
+{
+public:
+	typedef etl::handle<TaskLumaKeySW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
+			return true;
+
+		RectInt rd = target_rect;
+		VectorInt offset = get_offset();
+		RectInt rs = sub_task()->target_rect + rd.get_min() + offset;
+		rect_set_intersect(rs, rs, rd);
+		if (!rs.is_valid())
+			return true;
+
+		LockWrite ldst(this);
+		LockRead lsrc(sub_task());
+		if (!ldst || !lsrc)
+			return false;
+
+		synfig::Surface &dst = ldst->get_surface();
+		const synfig::Surface &src = lsrc->get_surface();
+
+		for(int y = rs.miny; y < rs.maxy; ++y)
+		{
+			const Color *s = &src[y - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]];
+			for(Color *d = &dst[y][rs.minx], *end = d + rs.get_width(); d != end; ++d, ++s)
+			{
+				Color c = *s;
+				c.set_a(c.get_y()*c.get_a());
+				c.set_y(1);
+				*d = c;
+			}
+		}
+
+		return true;
+	}
+};
+
+
+rendering::Task::Token TaskLumaKey::token(
+	DescAbstract<TaskLumaKey, rendering::TaskPixelProcessor>("LumaKey") );
+rendering::Task::Token TaskLumaKeySW::token(
+	DescReal<TaskLumaKeySW, TaskLumaKey>("LumaKeySW") );
+
+} // namespace
+
+
 LumaKey::LumaKey():
 	Layer_CompositeFork(1.0,Color::BLEND_STRAIGHT)
 {
@@ -179,5 +245,12 @@ LumaKey::get_bounding_rect(Context context)const
 }
 
 rendering::Task::Handle
-LumaKey::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+LumaKey::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	if (!sub_task)
+		return rendering::Task::Handle();
+
+	TaskLumaKey::Handle task_lumakey(new TaskLumaKey());
+	task_lumakey->sub_task() = sub_task->clone_recursive();
+	return task_lumakey;
+}
@@ -46,6 +46,12 @@
 #include <synfig/transform.h>
 #include <ETL/misc>
 
+#include <algorithm>
+#include <cmath>
+
+#include <synfig/rendering/software/task/tasksw.h>
+#include <synfig/rendering/software/function/radialblur.h>
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -60,6 +66,128 @@ SYNFIG_LAYER_SET_VERSION(RadialBlur,"0.1");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+class TaskRadialBlur: public rendering::Task, public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskRadialBlur> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	// parameters are evaluated once by layer, see RadialBlur::build_composite_fork_task_vfunc()
+	Vector origin;
+	Real size;
+	bool fade_out;
+
+	TaskRadialBlur(): size(), fade_out() { }
+
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	//! Returns \a rect scaled by \a scale relative to the origin
+	Rect scale_rect(const Rect &rect, Real scale) const {
+		return Rect(
+			(rect.get_min() - origin)*scale + origin,
+			(rect.get_max() - origin)*scale + origin );
+	}
+
+	virtual Rect calc_bounds() const {
+		if (!sub_task())
+			return Rect::zero();
+		Rect bounds = sub_task()->get_bounds();
+		if (!bounds.is_valid() || size <= 0)
+			return bounds;
+		if (size >= 1)
+			return Rect::infinite();
+		// pixel gets color from the source which is closer to the origin
+		return bounds | scale_rect(bounds, 1/(1 - size));
+	}
+
+	virtual void set_coords_sub_tasks() {
+		if (!sub_task())
+			{ trunc_to_zero(); return; }
+		if (!is_valid_coords())
+			{ sub_task()->set_coords_zero(); return; }
+
+		Vector upp = get_units_per_pixel();
+		Rect rect = source_rect | scale_rect(source_rect, std::max(Real(0), 1 - size));
+		rect &= sub_task()->get_bounds();
+		if (!rect.is_valid() || rect.is_nan_or_inf())
+			{ sub_task()->set_coords_zero(); return; }
+
+		// align the source to the pixels of this task,
+		// and add two pixels for interpolation
+		const int margin = 2;
+		const int max_size = 10000;
+		RectInt pixels(
+			(int)approximate_floor((rect.minx - source_rect.minx)/upp[0]) - margin,
+			(int)approximate_floor((rect.miny - source_rect.miny)/upp[1]) - margin,
+			(int)approximate_ceil ((rect.maxx - source_rect.minx)/upp[0]) + margin,
+			(int)approximate_ceil ((rect.maxy - source_rect.miny)/upp[1]) + margin );
+		Rect sub_source_rect(
+			source_rect.minx + pixels.minx*upp[0],
+			source_rect.miny + pixels.miny*upp[1],
+			source_rect.minx + pixels.maxx*upp[0],
+			source_rect.miny + pixels.maxy*upp[1] );
+		VectorInt sub_target_size(
+			std::min(pixels.get_width(), max_size),
+			std::min(pixels.get_height(), max_size) );
+
+		sub_task()->set_coords(sub_source_rect, sub_target_size);
+	}
+};
+
+
+class TaskRadialBlurSW: public TaskRadialBlur, public rendering::TaskSW
+{
+public:
+	typedef etl::handle<TaskRadialBlurSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
+			return true;
+
+		LockWrite la(this);
+		LockRead lb(sub_task());
+		if (!la || !lb)
+			return false;
+
+		const RectInt &src_target_rect = sub_task()->target_rect;
+		const Rect &src_source_rect = sub_task()->source_rect;
+		const Vector src_ppu = sub_task()->get_pixels_per_unit();
+
+		// position of the pixel of this task in the sub task
+		Vector offset = (source_rect.get_min() - src_source_rect.get_min()).multiply_coords(src_ppu);
+		VectorInt src_offset(
+			(int)round(offset[0]) + src_target_rect.minx - target_rect.minx,
+			(int)round(offset[1]) + src_target_rect.miny - target_rect.miny );
+		Vector src_origin = (origin - src_source_rect.get_min()).multiply_coords(src_ppu)
+		                  + Vector(src_target_rect.minx, src_target_rect.miny);
+
+		rendering::software::RadialBlur::blur(
+			la->get_surface(),
+			target_rect,
+			lb->get_surface(),
+			src_offset,
+			src_origin,
+			size,
+			fade_out );
+
+		return true;
+	}
+};
+
+
+rendering::Task::Token TaskRadialBlur::token(
+	DescAbstract<TaskRadialBlur>("RadialBlur") );
+rendering::Task::Token TaskRadialBlurSW::token(
+	DescReal<TaskRadialBlurSW, TaskRadialBlur>("RadialBlurSW") );
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
 /* === E N T R Y P O I N T ================================================= */
@@ -339,5 +467,15 @@ RadialBlur::accelerated_render(Context context,Surface *surface,int quality, con
 
 
 rendering::Task::Handle
-RadialBlur::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+RadialBlur::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	if (!sub_task)
+		return rendering::Task::Handle();
+
+	TaskRadialBlur::Handle task(new TaskRadialBlur());
+	task->origin = param_origin.get(Vector());
+	task->size = param_size.get(Real());
+	task->fade_out = param_fade_out.get(bool());
+	task->sub_task() = sub_task->clone_recursive();
+	return task;
+}
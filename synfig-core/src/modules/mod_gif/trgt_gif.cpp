@@ -239,7 +239,10 @@ gif::end_frame()
 		synfig::info("curr_palette.size()=%d",curr_palette.size());
 	}
 
-	int transparent_index = curr_palette.find_closest(Color(1,0,1,0), Gamma()) - curr_palette.begin();
+	const PaletteIndex palette_index(curr_palette, Gamma());
+	PaletteIndex::Cache palette_cache;
+
+	int transparent_index = palette_index.find(Color(1,0,1,0));
 	bool has_transparency = curr_palette[transparent_index].color.get_a()<=0.00001;
 
 	if(has_transparency)
@@ -321,7 +324,7 @@ gif::end_frame()
 		for(int i=0; i < w; ++i)
 		{
 			Color color(curr_surface[cur_scanline][i].clamped());
-			Palette::iterator iter(curr_palette.find_closest(color, Gamma()));
+			Palette::iterator iter(curr_palette.begin() + palette_index.find(color, palette_cache));
 
 			if(dithering)
 			{
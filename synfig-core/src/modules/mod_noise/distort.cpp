@@ -34,6 +34,8 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+
 #include "distort.h"
 
 #include <synfig/localization.h>
@@ -46,6 +48,8 @@
 #include <synfig/value.h>
 #include <time.h>
 
+#include <synfig/rendering/common/task/taskdistort.h>
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -63,6 +67,98 @@ SYNFIG_LAYER_SET_VERSION(NoiseDistort,"0.0");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+class NoiseDistortion: public rendering::TaskDistort::Distortion
+{
+public:
+	// parameters are evaluated once by layer, see NoiseDistort::build_composite_fork_task_vfunc()
+	RandomNoise random;
+	RandomNoise::SmoothType smooth;
+	Vector displacement;
+	Vector size;
+	int detail;
+	float time;
+	bool turbulent;
+
+	NoiseDistortion():
+		smooth(RandomNoise::SMOOTH_COSINE),
+		detail(4),
+		time(),
+		turbulent() { }
+
+	//! Moves RandomNoise::BATCH_SIZE points,
+	//! it's the batch version of NoiseDistort::point_func()
+	void point_batch(Vector *points) const {
+		const int n = RandomNoise::BATCH_SIZE;
+		const float k = (float)(1 << detail);
+
+		float x[n], y[n], value[n];
+		Real vx[n], vy[n];
+		for(int i = 0; i < n; ++i) {
+			x[i] = points[i][0]/size[0]*k;
+			y[i] = points[i][1]/size[1]*k;
+			vx[i] = vy[i] = 0.0;
+		}
+
+		for(int j = 0; j < detail; ++j) {
+			const int subseed = (detail-j)*5;
+
+			random(smooth, subseed, x, y, time, value);
+			for(int i = 0; i < n; ++i)
+				vx[i] = std::max(-1.0, std::min(1.0, value[i] + vx[i]*0.5));
+			random(smooth, subseed + 1, x, y, time, value);
+			for(int i = 0; i < n; ++i)
+				vy[i] = std::max(-1.0, std::min(1.0, value[i] + vy[i]*0.5));
+
+			if (turbulent)
+				for(int i = 0; i < n; ++i)
+					{ vx[i] = std::fabs(vx[i]); vy[i] = std::fabs(vy[i]); }
+
+			for(int i = 0; i < n; ++i)
+				{ x[i] /= 2.0f; y[i] /= 2.0f; }
+		}
+
+		for(int i = 0; i < n; ++i) {
+			if (!turbulent) {
+				vx[i] = vx[i]/2.0f + 0.5f;
+				vy[i] = vy[i]/2.0f + 0.5f;
+			}
+			points[i][0] += (vx[i] - 0.5f)*displacement[0];
+			points[i][1] += (vy[i] - 0.5f)*displacement[1];
+		}
+	}
+
+	virtual void transform(Vector *points, int count) const {
+		const int n = RandomNoise::BATCH_SIZE;
+		for(; count >= n; count -= n, points += n)
+			point_batch(points);
+		if (count > 0) {
+			Vector tail[n];
+			std::copy(points, points + count, tail);
+			point_batch(tail);
+			std::copy(tail, tail + count, points);
+		}
+	}
+
+	virtual Rect calc_source_rect(const Rect &rect, const Vector&) const {
+		// noise moves points by half of displacement in both directions
+		Rect source_rect = rect;
+		source_rect.expand_x(std::fabs(displacement[0])*0.5);
+		source_rect.expand_y(std::fabs(displacement[1])*0.5);
+		return source_rect;
+	}
+
+	virtual Rect calc_bounds(const Rect &source_bounds) const {
+		Rect bounds = source_bounds;
+		bounds.expand_x(std::fabs(displacement[0]));
+		bounds.expand_y(std::fabs(displacement[1]));
+		return bounds;
+	}
+};
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
 NoiseDistort::NoiseDistort():
@@ -345,5 +441,29 @@ NoiseDistort::accelerated_render(Context context,Surface *surface,int quality, c
 */
 
 rendering::Task::Handle
-NoiseDistort::build_rendering_task_vfunc(Context context) const
-	{ return Layer::build_rendering_task_vfunc(context); }
+NoiseDistort::build_composite_fork_task_vfunc(ContextParams /* context_params */, rendering::Task::Handle sub_task)const
+{
+	if (!sub_task)
+		return sub_task;
+
+	Real speed = param_speed.get(Real());
+	int smooth = param_smooth.get(int());
+	if (!speed && smooth == (int)RandomNoise::SMOOTH_SPLINE)
+		smooth = (int)RandomNoise::SMOOTH_FAST_SPLINE;
+	Time time = speed*get_time_mark();
+
+	etl::handle<NoiseDistortion> distortion(new NoiseDistortion());
+	distortion->random.set_seed(param_random.get(int()));
+	distortion->smooth = RandomNoise::SmoothType(smooth);
+	distortion->displacement = param_displacement.get(Vector());
+	distortion->size = param_size.get(Vector());
+	distortion->detail = param_detail.get(int());
+	distortion->time = (float)time;
+	distortion->turbulent = param_turbulent.get(bool());
+
+	rendering::TaskDistort::Handle task(new rendering::TaskDistort());
+	task->distortion = distortion;
+	task->interpolation = Color::INTERPOLATION_LINEAR;
+	task->sub_task() = sub_task->clone_recursive();
+	return task;
+}
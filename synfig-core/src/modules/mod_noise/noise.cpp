@@ -34,6 +34,8 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+
 #include "noise.h"
 
 #include <synfig/localization.h>
@@ -47,6 +49,10 @@
 #include <synfig/value.h>
 #include <time.h>
 
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/task/tasksw.h>
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -64,6 +70,193 @@ SYNFIG_LAYER_SET_VERSION(Noise,"0.0");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+class TaskNoise: public rendering::Task, public rendering::TaskInterfaceTransformation
+{
+public:
+	typedef etl::handle<TaskNoise> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	// parameters are evaluated once by layer, see Noise::build_composite_task_vfunc()
+	CompiledGradient gradient;
+	RandomNoise random;
+	RandomNoise::SmoothType smooth;
+	Vector size;
+	int detail;
+	float time;
+	bool turbulent;
+	bool do_alpha;
+	bool super_sample;
+	rendering::Holder<rendering::TransformationAffine> transformation;
+
+	TaskNoise():
+		smooth(RandomNoise::SMOOTH_COSINE),
+		detail(4),
+		time(),
+		turbulent(),
+		do_alpha(),
+		super_sample() { }
+
+	virtual rendering::Transformation::Handle get_transformation() const
+		{ return transformation.handle(); }
+};
+
+
+class TaskNoiseSW: public TaskNoise, public rendering::TaskSW,
+	public rendering::TaskInterfaceBlendToTarget,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskNoiseSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual void on_target_set_as_source() {
+		Task::Handle &subtask = sub_task(0);
+		if ( subtask
+		  && subtask->target_surface == target_surface
+		  && !Color::is_straight(blend_method) )
+		{
+			trunc_by_bounds();
+			subtask->source_rect = source_rect;
+			subtask->target_rect = target_rect;
+		}
+	}
+
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+	//! Evaluates colors of RandomNoise::BATCH_SIZE points,
+	//! it's the batch version of Noise::color_func()
+	void color_batch(const Vector *points, float pixel_size, Color *out) const {
+		const int n = RandomNoise::BATCH_SIZE;
+		const bool ss = super_sample && pixel_size;
+		const float k = (float)(1 << detail);
+
+		float x[n], y[n], x2[n], y2[n], value[n];
+		float amount[n], amount2[n], amount3[n], alpha[n];
+		for(int i = 0; i < n; ++i) {
+			x[i] = points[i][0]/size[0]*k;
+			y[i] = points[i][1]/size[1]*k;
+			x2[i] = ss ? (points[i][0]+pixel_size)/size[0]*k : 0.f;
+			y2[i] = ss ? (points[i][1]+pixel_size)/size[1]*k : 0.f;
+			amount[i] = amount2[i] = amount3[i] = alpha[i] = 0.f;
+		}
+
+		for(int j = 0; j < detail; ++j) {
+			const int subseed = (detail-j)*5;
+
+			random(smooth, subseed, x, y, time, value);
+			for(int i = 0; i < n; ++i)
+				amount[i] = std::max(-1.f, std::min(1.f, (float)(value[i] + amount[i]*0.5)));
+
+			if (ss) {
+				random(smooth, subseed, x2, y, time, value);
+				for(int i = 0; i < n; ++i)
+					amount2[i] = std::max(-1.f, std::min(1.f, (float)(value[i] + amount2[i]*0.5)));
+				random(smooth, subseed, x, y2, time, value);
+				for(int i = 0; i < n; ++i)
+					amount3[i] = std::max(-1.f, std::min(1.f, (float)(value[i] + amount3[i]*0.5)));
+				if (turbulent)
+					for(int i = 0; i < n; ++i)
+						{ amount2[i] = std::fabs(amount2[i]); amount3[i] = std::fabs(amount3[i]); }
+				for(int i = 0; i < n; ++i)
+					{ x2[i] *= 0.5f; y2[i] *= 0.5f; }
+			}
+
+			if (do_alpha) {
+				random(smooth, subseed + 3, x, y, time, value);
+				for(int i = 0; i < n; ++i)
+					alpha[i] = std::max(-1.f, std::min(1.f, (float)(value[i] + alpha[i]*0.5)));
+			}
+
+			if (turbulent)
+				for(int i = 0; i < n; ++i)
+					{ amount[i] = std::fabs(amount[i]); alpha[i] = std::fabs(alpha[i]); }
+
+			for(int i = 0; i < n; ++i)
+				{ x[i] *= 0.5f; y[i] *= 0.5f; }
+		}
+
+		for(int i = 0; i < n; ++i) {
+			if (!turbulent) {
+				amount[i] = amount[i]/2.0f + 0.5f;
+				alpha[i] = alpha[i]/2.0f + 0.5f;
+				amount2[i] = amount2[i]/2.0f + 0.5f;
+				amount3[i] = amount3[i]/2.0f + 0.5f;
+			}
+
+			if (ss) {
+				Real da = std::max(amount3[i], std::max(amount[i], amount2[i]))
+						- std::min(amount3[i], std::min(amount[i], amount2[i]));
+				out[i] = gradient.average(amount[i] - da, amount[i] + da);
+			} else {
+				out[i] = gradient.color(amount[i]);
+			}
+
+			if (do_alpha)
+				out[i].set_a(out[i].get_a()*alpha[i]);
+		}
+	}
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid())
+			return true;
+
+		Vector ppu = get_pixels_per_unit();
+
+		Matrix bounds_transfromation;
+		bounds_transfromation.m00 = ppu[0];
+		bounds_transfromation.m11 = ppu[1];
+		bounds_transfromation.m20 = target_rect.minx - ppu[0]*source_rect.minx;
+		bounds_transfromation.m21 = target_rect.miny - ppu[1]*source_rect.miny;
+
+		Matrix matrix = bounds_transfromation * transformation->matrix;
+		Matrix inv_matrix = matrix.get_inverted();
+
+		const int n = RandomNoise::BATCH_SIZE;
+		const int tw = target_rect.get_width();
+		const Vector dx = inv_matrix.axis_x();
+		const Vector dy = inv_matrix.axis_y();
+		const float pixel_size = (float)((dx.mag() + dy.mag())*0.5);
+		// points are taken at the centers of pixels, as by the Layer::get_color() path
+		Vector p = inv_matrix.get_transformed( Vector(target_rect.minx + 0.5, target_rect.miny + 0.5) );
+
+		LockWrite la(this);
+		if (!la)
+			return false;
+
+		Surface::alpha_pen apen(la->get_surface().get_pen(target_rect.minx, target_rect.miny));
+		ColorReal amount = blend ? this->amount : ColorReal(1.0);
+		apen.set_blend_method(blend ? blend_method : Color::BLEND_COMPOSITE);
+
+		Vector points[n];
+		Color colors[n];
+		for(int iy = target_rect.miny; iy < target_rect.maxy; ++iy, p += dy, apen.inc_y(), apen.dec_x(tw)) {
+			Vector pp = p;
+			for(int ix = 0; ix < tw; ix += n) {
+				int count = std::min(n, tw - ix);
+				for(int i = 0; i < n; ++i, pp += dx)
+					points[i] = pp;
+				color_batch(points, pixel_size, colors);
+				for(int i = 0; i < count; ++i, apen.inc_x())
+					apen.put_value(colors[i], amount);
+			}
+		}
+
+		return true;
+	}
+};
+
+rendering::Task::Token TaskNoise::token(
+	DescAbstract<TaskNoise>("Noise") );
+rendering::Task::Token TaskNoiseSW::token(
+	DescReal<TaskNoiseSW, TaskNoise>("NoiseSW") );
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
 Noise::Noise():
@@ -321,6 +514,28 @@ Noise::get_color(Context context, const Point &point)const
 }
 
 
+rendering::Task::Handle
+Noise::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	Real speed = param_speed.get(Real());
+	int smooth = param_smooth.get(int());
+	if (!speed && smooth == (int)RandomNoise::SMOOTH_SPLINE)
+		smooth = (int)RandomNoise::SMOOTH_FAST_SPLINE;
+	Time time = speed*get_time_mark();
+
+	TaskNoise::Handle task(new TaskNoise());
+	task->gradient = compiled_gradient;
+	task->random.set_seed(param_random.get(int()));
+	task->smooth = RandomNoise::SmoothType(smooth);
+	task->size = param_size.get(Vector());
+	task->detail = param_detail.get(int());
+	task->time = (float)time;
+	task->turbulent = param_turbulent.get(bool());
+	task->do_alpha = param_do_alpha.get(bool());
+	task->super_sample = param_super_sample.get(bool());
+	return task;
+}
+
 bool
 Noise::accelerated_render(Context context,Surface *surface,int quality, const RendDesc &renddesc, ProgressCallback *cb)const
 {
@@ -47,16 +47,11 @@
 
 /* === P R O C E D U R E S ================================================= */
 
-/* === M E T H O D S ======================================================= */
+namespace {
 
-void
-RandomNoise::set_seed(int x)
-{
-	seed_=x;
-}
-
-float
-RandomNoise::operator()(const int salt,const int x,const int y,const int t)const
+//! The same as quick_rng(hash).f()*2-1, inlined to be used in loops
+inline float
+noise_value(int seed, int salt, int x, int y, int t)
 {
 	static const unsigned int a(21870);
 	static const unsigned int b(11213);
@@ -64,15 +59,29 @@ RandomNoise::operator()(const int salt,const int x,const int y,const int t)const
 	static const unsigned int d(31337);
 
 	quick_rng rng(
-		( static_cast<unsigned int>(x+y)        * a ) ^
-		( static_cast<unsigned int>(y+t)        * b ) ^
-		( static_cast<unsigned int>(t+x)        * c ) ^
-		( static_cast<unsigned int>(seed_+salt) * d )
+		( static_cast<unsigned int>(x+y)       * a ) ^
+		( static_cast<unsigned int>(y+t)       * b ) ^
+		( static_cast<unsigned int>(t+x)       * c ) ^
+		( static_cast<unsigned int>(seed+salt) * d )
 	);
 
 	return rng.f() * 2.0f - 1.0f;
 }
 
+} // END of anonymous namespace
+
+/* === M E T H O D S ======================================================= */
+
+void
+RandomNoise::set_seed(int x)
+{
+	seed_=x;
+}
+
+float
+RandomNoise::operator()(const int salt,const int x,const int y,const int t)const
+	{ return noise_value(seed_, salt, x, y, t); }
+
 float
 RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf,int loop)const
 {
@@ -323,3 +332,86 @@ RandomNoise::operator()(SmoothType smooth,int subseed,float xf,float yf,float tf
 		return (*this)(subseed,x,y,t0);
 	}
 }
+
+void
+RandomNoise::operator()(SmoothType smooth,int subseed,const float *xf,const float *yf,float tf,float *out)const
+{
+	const int n = BATCH_SIZE;
+	const int seed = seed_ + subseed;
+	const int t((int)floor(tf));
+	const int t0 = t, t1 = t + 1;
+
+	if (smooth != SMOOTH_DEFAULT && smooth != SMOOTH_LINEAR && smooth != SMOOTH_COSINE)
+	{
+		for(int k = 0; k < n; ++k)
+			out[k] = (*this)(smooth, subseed, xf[k], yf[k], tf);
+		return;
+	}
+
+	int x[n], y[n];
+	float a[n], b[n];
+	for(int k = 0; k < n; ++k)
+	{
+		x[k] = (int)floor(xf[k]);
+		y[k] = (int)floor(yf[k]);
+	}
+
+	if (smooth == SMOOTH_DEFAULT)
+	{
+		for(int k = 0; k < n; ++k)
+			out[k] = noise_value(seed, 0, x[k], y[k], t0);
+		return;
+	}
+
+	for(int k = 0; k < n; ++k)
+	{
+		a[k] = xf[k] - x[k];
+		b[k] = yf[k] - y[k];
+	}
+
+	if (smooth == SMOOTH_COSINE)
+	{
+		for(int k = 0; k < n; ++k)
+		{
+			a[k] = (1.0f-cos(a[k]*PI))*0.5f;
+			b[k] = (1.0f-cos(b[k]*PI))*0.5f;
+		}
+	}
+
+	// keep the same order of operations as in the single point version,
+	// so results are bit-exact
+	if ((float)t == tf)
+	{
+		for(int k = 0; k < n; ++k)
+		{
+			float c = 1.0-a[k];
+			float d = 1.0-b[k];
+			int x2 = x[k]+1, y2 = y[k]+1;
+			out[k] =
+				noise_value(seed, 0, x[k], y[k], t0)*(c*d)+
+				noise_value(seed, 0, x2,   y[k], t0)*(a[k]*d)+
+				noise_value(seed, 0, x[k], y2,   t0)*(c*b[k])+
+				noise_value(seed, 0, x2,   y2,   t0)*(a[k]*b[k]);
+		}
+	}
+	else
+	{
+		float c = tf-t;
+		float f = 1.0-c;
+		for(int k = 0; k < n; ++k)
+		{
+			float d = 1.0-a[k];
+			float e = 1.0-b[k];
+			int x2 = x[k]+1, y2 = y[k]+1;
+			out[k] =
+				noise_value(seed, 0, x[k], y[k], t0)*(d*e*f)+
+				noise_value(seed, 0, x2,   y[k], t0)*(a[k]*e*f)+
+				noise_value(seed, 0, x[k], y2,   t0)*(d*b[k]*f)+
+				noise_value(seed, 0, x2,   y2,   t0)*(a[k]*b[k]*f)+
+				noise_value(seed, 0, x[k], y[k], t1)*(d*e*c)+
+				noise_value(seed, 0, x2,   y[k], t1)*(a[k]*e*c)+
+				noise_value(seed, 0, x[k], y2,   t1)*(d*b[k]*c)+
+				noise_value(seed, 0, x2,   y2,   t1)*(a[k]*b[k]*c);
+		}
+	}
+}
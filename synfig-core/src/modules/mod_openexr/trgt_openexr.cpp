@@ -34,7 +34,18 @@
 #endif
 
 #include "trgt_openexr.h"
+#include <synfig/general.h>
+#include <OpenEXR/ImfChannelList.h>
+#include <OpenEXR/ImfOutputFile.h>
+#include <OpenEXR/ImfThreading.h>
+#include <OpenEXR/ImfTiledOutputFile.h>
+#include <algorithm>
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <thread>
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -49,12 +60,75 @@ SYNFIG_TARGET_SET_NAME(exr_trgt,"openexr");
 SYNFIG_TARGET_SET_EXT(exr_trgt,"exr");
 SYNFIG_TARGET_SET_VERSION(exr_trgt,"1.0.4");
 
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+Imf::Compression
+get_compression()
+{
+	const char *s = getenv("SYNFIG_EXR_COMPRESSION");
+	if (!s) return Imf::ZIP_COMPRESSION;
+	String name(s);
+	if (name == "none")  return Imf::NO_COMPRESSION;
+	if (name == "rle")   return Imf::RLE_COMPRESSION;
+	if (name == "zips")  return Imf::ZIPS_COMPRESSION;
+	if (name == "zip")   return Imf::ZIP_COMPRESSION;
+	if (name == "piz")   return Imf::PIZ_COMPRESSION;
+	if (name == "pxr24") return Imf::PXR24_COMPRESSION;
+	if (name == "b44")   return Imf::B44_COMPRESSION;
+	if (name == "b44a")  return Imf::B44A_COMPRESSION;
+	if (name == "dwaa")  return Imf::DWAA_COMPRESSION;
+	if (name == "dwab")  return Imf::DWAB_COMPRESSION;
+	synfig::warning("exr_trgt: unknown compression \"%s\", zip is used", s);
+	return Imf::ZIP_COMPRESSION;
+}
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
+// branches are replaced by selects, so the loop can be vectorized by compiler
+void
+exr_trgt::convert_to_half(const float *src, Imf::Rgba *dst, int count)
+{
+	unsigned short *out = reinterpret_cast<unsigned short*>(dst);
+	const unsigned int f32infty = 255u << 23;
+	const unsigned int f16max = (127u + 16u) << 23;
+	const unsigned int denorm_magic_bits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+	float denorm_magic;
+	memcpy(&denorm_magic, &denorm_magic_bits, sizeof(denorm_magic));
+
+	for(int i = 0; i < 4*count; ++i)
+	{
+		unsigned int f;
+		memcpy(&f, &src[i], sizeof(f));
+		unsigned int sign = f & 0x80000000u;
+		f ^= sign;
+
+		// subnormal or zero
+		float ff;
+		memcpy(&ff, &f, sizeof(ff));
+		ff += denorm_magic;
+		unsigned int fd;
+		memcpy(&fd, &ff, sizeof(fd));
+		unsigned int denorm = fd - denorm_magic_bits;
+
+		// normal
+		unsigned int norm = (f + ((unsigned int)(15 - 127) << 23) + 0xfff + ((f >> 13) & 1)) >> 13;
+
+		// infinity or nan
+		unsigned int inf = f > f32infty ? 0x7e00u : 0x7c00u;
+
+		unsigned int h = f >= f16max ? inf : f < (113u << 23) ? denorm : norm;
+		out[i] = (unsigned short)(h | (sign >> 16));
+	}
+}
+
 bool
 exr_trgt::ready()
 {
-	return (bool)exr_file;
+	return out_surface.is_valid();
 }
 
 exr_trgt::exr_trgt(const char *Filename, const synfig::TargetParam &params):
@@ -62,18 +136,23 @@ exr_trgt::exr_trgt(const char *Filename, const synfig::TargetParam &params):
 	imagecount(0),
 	scanline(),
 	filename(Filename),
-	exr_file(NULL),
-	buffer(NULL),
+	compression(get_compression()),
+	tile_size(),
 	buffer_color(NULL)
 {
 	// OpenEXR uses linear gamma
 	sequence_separator = params.sequence_separator;
+
+	if (const char *s = getenv("SYNFIG_EXR_TILE_SIZE"))
+		tile_size = std::max(0, atoi(s));
+
+	// compress and write lines or tiles by all cores
+	if (!Imf::globalThreadCount())
+		Imf::setGlobalThreadCount(std::max(1u, std::thread::hardware_concurrency()));
 }
 
 exr_trgt::~exr_trgt()
 {
-	if(exr_file) delete exr_file;
-	if(buffer) delete [] buffer;
 	if(buffer_color) delete [] buffer_color;
 }
 
@@ -90,33 +169,87 @@ exr_trgt::set_rend_desc(RendDesc *given_desc)
 	return true;
 }
 
+String
+exr_trgt::get_frame_name() const
+{
+	if(multi_image)
+		return filename_sans_extension(filename) +
+			   sequence_separator +
+			   etl::strprintf("%04d",imagecount) +
+			   filename_extension(filename);
+	return filename;
+}
+
 bool
-exr_trgt::start_frame(synfig::ProgressCallback *cb)
+exr_trgt::write_frame(const Imf::FrameBuffer &frame_buffer)
 {
 	int w=desc.get_w(),h=desc.get_h();
 
-	String frame_name;
+	Imf::Header header(w, h, desc.get_pixel_aspect(), Imath::V2f(0, 0), 1, Imf::INCREASING_Y, compression);
+	header.channels().insert("R", Imf::Channel(Imf::HALF));
+	header.channels().insert("G", Imf::Channel(Imf::HALF));
+	header.channels().insert("B", Imf::Channel(Imf::HALF));
+	header.channels().insert("A", Imf::Channel(Imf::HALF));
 
-	if(exr_file)
-		delete exr_file;
-	if(multi_image)
+	try
 	{
-		frame_name = (filename_sans_extension(filename) +
-					  sequence_separator +
-					  etl::strprintf("%04d",imagecount) +
-					  filename_extension(filename));
-		if(cb)cb->task(frame_name);
+		if (tile_size > 0)
+		{
+			header.setTileDescription(Imf::TileDescription(tile_size, tile_size, Imf::ONE_LEVEL));
+			Imf::TiledOutputFile file(frame_name.c_str(), header);
+			file.setFrameBuffer(frame_buffer);
+			file.writeTiles(0, file.numXTiles() - 1, 0, file.numYTiles() - 1);
+		}
+		else
+		{
+			Imf::OutputFile file(frame_name.c_str(), header);
+			file.setFrameBuffer(frame_buffer);
+			file.writePixels(h);
+		}
 	}
-	else
+	catch(const std::exception &e)
 	{
-		frame_name=filename;
-		if(cb)cb->task(filename);
+		synfig::error("exr_trgt: unable to write %s: %s", frame_name.c_str(), e.what());
+		return false;
 	}
-	exr_file=new Imf::RgbaOutputFile(frame_name.c_str(),w,h,Imf::WRITE_RGBA,desc.get_pixel_aspect());
+	return true;
+}
+
+bool
+exr_trgt::add_frame(const synfig::Surface *surface, synfig::ProgressCallback *cb)
+{
+	if (get_alpha_mode() != TARGET_ALPHA_MODE_KEEP)
+		return Target_Scanline::add_frame(surface, cb);
+
+	// write rendered surface directly, OpenEXR converts floats to halfs by its threads
+	frame_name = get_frame_name();
+	if(cb)cb->task(frame_name);
+
+	const size_t x_stride = sizeof(Color);
+	const size_t y_stride = surface->get_pitch();
+	char *base = (char*)(*surface)[0];
+
+	Imf::FrameBuffer frame_buffer;
+	frame_buffer.insert("R", Imf::Slice(Imf::FLOAT, base + 0*sizeof(ColorReal), x_stride, y_stride));
+	frame_buffer.insert("G", Imf::Slice(Imf::FLOAT, base + 1*sizeof(ColorReal), x_stride, y_stride));
+	frame_buffer.insert("B", Imf::Slice(Imf::FLOAT, base + 2*sizeof(ColorReal), x_stride, y_stride));
+	frame_buffer.insert("A", Imf::Slice(Imf::FLOAT, base + 3*sizeof(ColorReal), x_stride, y_stride));
+
+	bool success = write_frame(frame_buffer);
+	imagecount++;
+	return success;
+}
+
+bool
+exr_trgt::start_frame(synfig::ProgressCallback *cb)
+{
+	int w=desc.get_w(),h=desc.get_h();
+
+	frame_name = get_frame_name();
+	if(cb)cb->task(frame_name);
+
 	if(buffer_color) delete [] buffer_color;
 	buffer_color=new Color[w];
-	//if(buffer) delete [] buffer;
-	//buffer=new Imf::Rgba[w];
 	out_surface.set_wh(w,h);
 
 	return true;
@@ -125,16 +258,20 @@ exr_trgt::start_frame(synfig::ProgressCallback *cb)
 void
 exr_trgt::end_frame()
 {
-	if(exr_file)
+	if(ready())
 	{
-		exr_file->setFrameBuffer(out_surface[0],1,desc.get_w());
-		exr_file->writePixels(desc.get_h());
+		const size_t x_stride = sizeof(Imf::Rgba);
+		const size_t y_stride = x_stride*desc.get_w();
+		char *base = (char*)out_surface[0];
 
-		delete exr_file;
+		Imf::FrameBuffer frame_buffer;
+		frame_buffer.insert("R", Imf::Slice(Imf::HALF, base + offsetof(Imf::Rgba, r), x_stride, y_stride));
+		frame_buffer.insert("G", Imf::Slice(Imf::HALF, base + offsetof(Imf::Rgba, g), x_stride, y_stride));
+		frame_buffer.insert("B", Imf::Slice(Imf::HALF, base + offsetof(Imf::Rgba, b), x_stride, y_stride));
+		frame_buffer.insert("A", Imf::Slice(Imf::HALF, base + offsetof(Imf::Rgba, a), x_stride, y_stride));
+		write_frame(frame_buffer);
 	}
 
-	exr_file=0;
-
 	imagecount++;
 }
 
@@ -151,20 +288,6 @@ exr_trgt::end_scanline()
 	if(!ready())
 		return false;
 
-	int i;
-	for(i=0;i<desc.get_w();i++)
-	{
-//		Imf::Rgba &rgba=buffer[i];
-		Imf::Rgba &rgba=out_surface[scanline][i];
-		Color &color=buffer_color[i];
-		rgba.r=color.get_r();
-		rgba.g=color.get_g();
-		rgba.b=color.get_b();
-		rgba.a=color.get_a();
-	}
-
-    //exr_file->setFrameBuffer(buffer,1,desc.get_w());
-	//exr_file->writePixels(1);
-
+	convert_to_half(reinterpret_cast<const float*>(buffer_color), out_surface[scanline], desc.get_w());
 	return true;
 }
@@ -34,8 +34,10 @@
 #include <synfig/string.h>
 #include <synfig/surface.h>
 #include <synfig/targetparam.h>
-#include <OpenEXR/ImfArray.h>
-#include <OpenEXR/ImfRgbaFile.h>
+#include <OpenEXR/ImfCompression.h>
+#include <OpenEXR/ImfFrameBuffer.h>
+#include <OpenEXR/ImfHeader.h>
+#include <OpenEXR/ImfRgba.h>
 
 /* === M A C R O S ========================================================= */
 
@@ -43,6 +45,10 @@
 
 /* === C L A S S E S & S T R U C T S ======================================= */
 
+//! Writes half-float RGBA OpenEXR images by the OpenEXR global thread pool.
+//! Compression and tiles are set by environment variables
+//! SYNFIG_EXR_COMPRESSION (none, rle, zips, zip, piz, pxr24, b44, b44a, dwaa, dwab)
+//! and SYNFIG_EXR_TILE_SIZE (0 means scanline image).
 class exr_trgt : public synfig::Target_Scanline
 {
 public:
@@ -50,13 +56,17 @@ private:
 	bool multi_image;
 	int imagecount,scanline;
 	synfig::String filename;
-	Imf::RgbaOutputFile *exr_file;
-	Imf::Rgba *buffer;
+	synfig::String frame_name;
+	Imf::Compression compression;
+	int tile_size;
 	etl::surface<Imf::Rgba> out_surface;
 	synfig::Color *buffer_color;
 
 	bool ready();
 	synfig::String sequence_separator;
+
+	synfig::String get_frame_name() const;
+	bool write_frame(const Imf::FrameBuffer &frame_buffer);
 public:
 	exr_trgt(const char *filename, const synfig::TargetParam& /* params */);
 	virtual ~exr_trgt();
@@ -68,6 +78,12 @@ public:
 	virtual synfig::Color * start_scanline(int scanline);
 	virtual bool end_scanline(void);
 
+	virtual bool add_frame(const synfig::Surface *surface, synfig::ProgressCallback *cb);
+
+	//! Converts \a count colors of floats to halfs with rounding to nearest even,
+	//! the same as half(float) does, except that any NaN becomes the quiet NaN
+	static void convert_to_half(const float *src, Imf::Rgba *dst, int count);
+
 
 	SYNFIG_TARGET_MODULE_EXT
 };
@@ -49,10 +49,14 @@
 
 #include <ETL/calculus>
 #include <ETL/hermite>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include <synfig/valuenodes/valuenode_bline.h>
 
+#include <synfig/rendering/software/task/tasksw.h>
+
 #endif
 
 using namespace etl;
@@ -76,6 +80,190 @@ SYNFIG_LAYER_SET_VERSION(Plant,"0.2");
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+//! Blends \a src with alpha \a a_src onto \a dst, see blendfunc_COMPOSITE()
+inline void
+composite(Color &dst, const Color &src, ColorReal a_src)
+{
+	const ColorReal a_dst = dst.get_a()*(ColorReal(1.0) - a_src);
+	const ColorReal a = a_src + a_dst;
+	if (a > ColorReal(0.000001)) {
+		const ColorReal k = ColorReal(1.0)/a;
+		dst = Color(
+			(src.get_r()*a_src + dst.get_r()*a_dst)*k,
+			(src.get_g()*a_src + dst.get_g()*a_dst)*k,
+			(src.get_b()*a_src + dst.get_b()*a_dst)*k,
+			a );
+	} else {
+		dst = Color::alpha();
+	}
+}
+
+//! Draws one particle as a square [x0, x1]x[y0, y1] (in pixels) clipped by \a rect,
+//! pixels at the edges are partially covered
+void
+splat_particle(
+	synfig::Surface &surface,
+	const RectInt &rect,
+	const Color &color,
+	Real x0,
+	Real y0,
+	Real x1,
+	Real y1 )
+{
+	const int left   = std::max(rect.minx, (int)std::floor(x0));
+	const int right  = std::min(rect.maxx, (int)std::ceil (x1));
+	const int top    = std::max(rect.miny, (int)std::floor(y0));
+	const int bottom = std::min(rect.maxy, (int)std::ceil (y1));
+	if (left >= right || top >= bottom)
+		return;
+
+	const ColorReal alpha = color.get_a();
+	const ColorReal cx_left  = (ColorReal)(std::min(left + 1.0, x1) - std::max((Real)left, x0));
+	const ColorReal cx_right = (ColorReal)(std::min((Real)right, x1) - std::max(right - 1.0, x0));
+
+	for(int y = top; y < bottom; ++y) {
+		const ColorReal a = alpha*(ColorReal)(std::min(y + 1.0, y1) - std::max((Real)y, y0));
+		Color *row = &surface[y][0];
+		if (right - left == 1) {
+			composite(row[left], color, a*cx_left);
+			continue;
+		}
+		composite(row[left], color, a*cx_left);
+		for(Color *c = row + left + 1, *end = row + right - 1; c < end; ++c)
+			composite(*c, color, a);
+		composite(row[right - 1], color, a*cx_right);
+	}
+}
+
+//! Draws particles into \a rect of the \a surface,
+//! particle at point p has center at pixel p*k + offset and width \a size in pixels.
+//! Particles are distributed by bins of rows first, so each bin is drawn
+//! while its rows are in cache, and particles outside of the \a rect are skipped.
+void
+draw_particles_to_rect(
+	synfig::Surface &surface,
+	const RectInt &rect,
+	const std::vector<Plant::Particle> &particles,
+	const Vector &k,
+	const Vector &offset,
+	Real size,
+	bool reverse,
+	bool size_as_alpha )
+{
+	if (!rect.is_valid() || particles.empty())
+		return;
+
+	const int bin_rows = 32;
+	const int bins_count = (rect.get_height() + bin_rows - 1)/bin_rows;
+	std::vector< std::vector<int> > bins(bins_count);
+
+	const int count = (int)particles.size();
+	for(int j = 0; j < count; ++j) {
+		const int i = reverse ? count - 1 - j : j;
+		const Plant::Particle &particle = particles[i];
+		const Real radius = 0.5*size*(size_as_alpha ? particle.color.get_a() : 1.f);
+		const Real y = particle.point[1]*k[1] + offset[1];
+		const Real x = particle.point[0]*k[0] + offset[0];
+		if ( x + radius <= rect.minx || x - radius >= rect.maxx
+		  || y + radius <= rect.miny || y - radius >= rect.maxy
+		  || std::isnan(x) || std::isnan(y) )
+			continue;
+		const int first = std::max(0, ((int)std::floor(y - radius) - rect.miny)/bin_rows);
+		const int last = std::min(bins_count - 1, ((int)std::ceil(y + radius) - 1 - rect.miny)/bin_rows);
+		for(int b = first; b <= last; ++b)
+			bins[b].push_back(i);
+	}
+
+	for(int b = 0; b < bins_count; ++b) {
+		const RectInt bin_rect(
+			rect.minx,
+			rect.miny + b*bin_rows,
+			rect.maxx,
+			std::min(rect.maxy, rect.miny + (b + 1)*bin_rows) );
+		for(std::vector<int>::const_iterator i = bins[b].begin(); i != bins[b].end(); ++i) {
+			const Plant::Particle &particle = particles[*i];
+			Color color = particle.color;
+			Real radius = 0.5*size;
+			if (size_as_alpha) {
+				radius *= color.get_a();
+				color.set_a(1);
+			}
+			const Real x = particle.point[0]*k[0] + offset[0];
+			const Real y = particle.point[1]*k[1] + offset[1];
+			splat_particle(surface, bin_rect, color, x - radius, y - radius, x + radius, y + radius);
+		}
+	}
+}
+
+
+class TaskPlant: public rendering::Task
+{
+public:
+	typedef etl::handle<TaskPlant> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	// parameters are evaluated once by layer, see Plant::build_composite_task_vfunc()
+	Plant::ParticleList::Handle particle_list;
+	Rect bounds;
+	Point origin;
+	Real size;
+	bool reverse;
+	bool size_as_alpha;
+
+	TaskPlant(): size(), reverse(), size_as_alpha() { }
+
+	virtual Rect calc_bounds() const
+		{ return particle_list ? bounds : Rect::zero(); }
+};
+
+
+class TaskPlantSW: public TaskPlant, public rendering::TaskSW,
+	public rendering::TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskPlantSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid() || !particle_list)
+			return true;
+
+		const Vector ppu = get_pixels_per_unit();
+		const Vector upp = get_units_per_pixel();
+		const Point lt = source_rect.get_min();
+
+		LockWrite la(this);
+		if (!la)
+			return false;
+
+		draw_particles_to_rect(
+			la->get_surface(),
+			target_rect,
+			particle_list->particles,
+			ppu,
+			Vector(
+				target_rect.minx + (origin[0] - lt[0])*ppu[0],
+				target_rect.miny + (origin[1] - lt[1])*ppu[1] ),
+			size/std::sqrt(std::fabs(upp[0]*upp[1])),
+			reverse,
+			size_as_alpha );
+
+		return true;
+	}
+};
+
+
+rendering::Task::Token TaskPlant::token(
+	DescAbstract<TaskPlant>("Plant") );
+rendering::Task::Token TaskPlantSW::token(
+	DescReal<TaskPlantSW, TaskPlant>("PlantSW") );
+
+} // namespace
+
 /* === M E T H O D S ======================================================= */
 
 
@@ -128,7 +316,7 @@ Plant::Plant():
 }
 
 void
-Plant::branch(int n,int depth,float t, float stunt_growth, synfig::Point position,synfig::Vector vel)const
+Plant::branch(std::vector<Particle> &particles, int n,int depth,float t, float stunt_growth, synfig::Point position,synfig::Vector vel)const
 {
 	int splits=param_splits.get(int());
 	Real step=param_step.get(Real());
@@ -149,9 +337,9 @@ Plant::branch(int n,int depth,float t, float stunt_growth, synfig::Point positio
 		position[0]+=vel[0]*step;
 		position[1]+=vel[1]*step;
 
-		particle_list.push_back(Particle(position, gradient(t)));
-		if (particle_list.size() % 1000000 == 0)
-			synfig::info("constructed %d million particles...", particle_list.size()/1000000);
+		particles.push_back(Particle(position, gradient(t)));
+		if (particles.size() % 1000000 == 0)
+			synfig::info("constructed %d million particles...", particles.size()/1000000);
 
 		bounding_rect.expand(position);
 	}
@@ -166,8 +354,8 @@ Plant::branch(int n,int depth,float t, float stunt_growth, synfig::Point positio
 	synfig::Vector velocity2(vel[0]*sin_v + vel[1]*cos_v + random_factor*random(Random::SMOOTH_COSINE, 31+n+depth, t*splits, 0.0f, 0.0f),
 							-vel[0]*cos_v + vel[1]*sin_v + random_factor*random(Random::SMOOTH_COSINE, 33+n+depth, t*splits, 0.0f, 0.0f));
 
-	Plant::branch(n,depth+1,t,stunt_growth,position,velocity1);
-	Plant::branch(n,depth+1,t,stunt_growth,position,velocity2);
+	Plant::branch(particles,n,depth+1,t,stunt_growth,position,velocity1);
+	Plant::branch(particles,n,depth+1,t,stunt_growth,position,velocity2);
 }
 
 void
@@ -207,6 +395,27 @@ Plant::calc_bounding_rect()const
 	bounding_rect.expand_y(size);
 }
 
+std::vector<ValueBase>
+Plant::get_particle_list_params()const
+{
+	std::vector<ValueBase> params;
+	params.push_back(param_bline);
+	params.push_back(ValueBase(bline_loop));
+	params.push_back(param_random);
+	params.push_back(param_split_angle);
+	params.push_back(param_gravity);
+	params.push_back(param_gradient);
+	params.push_back(param_velocity);
+	params.push_back(param_perp_velocity);
+	params.push_back(param_step);
+	params.push_back(param_splits);
+	params.push_back(param_sprouts);
+	params.push_back(param_random_factor);
+	params.push_back(param_drag);
+	params.push_back(param_use_width);
+	return params;
+}
+
 void
 Plant::sync()const
 {
@@ -221,11 +430,24 @@ Plant::sync()const
 	Real perp_velocity=param_perp_velocity.get(Real());
 	int splits=param_splits.get(int());
 	bool use_width=param_use_width.get(bool());
+	std::vector<ValueBase> params=get_particle_list_params();
 	
 	std::lock_guard<std::mutex> lock(mutex);
 	if (!needs_sync_) return;
+
+	// parameters are set on each frame even if they are not animated,
+	// so generate particles again only if values are really changed
+	if (particle_list && particle_list_params == params)
+	{
+		needs_sync_=false;
+		return;
+	}
+
 	time_t start_time; time(&start_time);
-	particle_list.clear();
+	ParticleList::Handle list(new ParticleList());
+	std::vector<Particle> &particles = list->particles;
+	particle_list = list;
+	particle_list_params = params;
 
 	bounding_rect=Rect::zero();
 
@@ -270,9 +492,9 @@ Plant::sync()const
 		{
 			Point point(curve(f));
 
-			particle_list.push_back(Particle(point, gradient(0)));
-			if (particle_list.size() % 1000000 == 0)
-				synfig::info("constructed %d million particles...", particle_list.size()/1000000);
+			particles.push_back(Particle(point, gradient(0)));
+			if (particles.size() % 1000000 == 0)
+				synfig::info("constructed %d million particles...", particles.size()/1000000);
 
 			bounding_rect.expand(point);
 
@@ -297,7 +519,7 @@ Plant::sync()const
 				}
 
 				branch_count++;
-				branch(i, 0, 0,		 // time
+				branch(particles, i, 0, 0,		 // time
 					   stunt_growth, // stunt growth
 					   point, branch_velocity);
 			}
@@ -307,7 +529,7 @@ Plant::sync()const
 	time_t end_time; time(&end_time);
 	if (end_time-start_time > 4)
 		synfig::info("Plant::sync() constructed %d particles in %d seconds\n",
-					 particle_list.size(), int(end_time-start_time));
+					 particles.size(), int(end_time-start_time));
 	needs_sync_=false;
 }
 
@@ -351,7 +573,7 @@ Plant::set_param(const String & param, const ValueBase &value)
 	IMPORT_VALUE(param_size);
 	IMPORT_VALUE(param_size_as_alpha);
 	IMPORT_VALUE(param_reverse);
-	IMPORT_VALUE(param_use_width);
+	IMPORT_VALUE_PLUS(param_use_width,needs_sync_=true);
 
 	if(param=="offset")
 		return set_param("origin", value);
@@ -544,222 +766,30 @@ Plant::draw_particles(Surface *dest_surface, const RendDesc &renddesc)const
 	const int	w(renddesc.get_w());
 	const int	h(renddesc.get_h());
 	
-	const int	surface_width(dest_surface->get_w());
-	const int	surface_height(dest_surface->get_h());
-	
 	// Width and Height of a pixel
 	const Real pw = (br[0] - tl[0]) / w;
 	const Real ph = (br[1] - tl[1]) / h;
 	
 	if (std::isinf(pw) || std::isinf(ph))
 		return;
-	
-	if (particle_list.begin() != particle_list.end())
+
+	ParticleList::Handle list;
 	{
-		std::vector<Particle>::iterator iter;
-		Particle *particle;
-		
-		float radius(size*sqrt(1.0f/(std::fabs(pw)*std::fabs(ph))));
-		
-		int x1,y1,x2,y2;
-		
-		if (reverse)	iter = particle_list.end();
-		else			iter = particle_list.begin();
-		
-		while (true)
-		{
-			if (reverse)	particle = &(*(iter-1));
-			else			particle = &(*iter);
-			
-			float scaled_radius(radius);
-			Color color(particle->color);
-			if(size_as_alpha)
-			{
-				scaled_radius*=color.get_a();
-				color.set_a(1);
-			}
-			
-			// previously, radius was multiplied by sqrt(step)*12 only if
-			// the radius came out at less than 1 (pixel):
-			//   if (radius<=1.0f) radius*=sqrt(step)*12.0f;
-			// seems a little arbitrary - does it help?
-			
-			// calculate the box that this particle will be drawn as
-			float x1f=(particle->point[0]-tl[0])/pw-(scaled_radius*0.5);
-			float x2f=(particle->point[0]-tl[0])/pw+(scaled_radius*0.5);
-			float y1f=(particle->point[1]-tl[1])/ph-(scaled_radius*0.5);
-			float y2f=(particle->point[1]-tl[1])/ph+(scaled_radius*0.5);
-			x1=ceil_to_int(x1f);
-			x2=ceil_to_int(x2f)-1;
-			y1=ceil_to_int(y1f);
-			y2=ceil_to_int(y2f)-1;
-			
-			// if the box isn't entirely off the canvas, draw it
-			if(x1<=surface_width && y1<=surface_height && x2>=0 && y2>=0)
-			{
-				float x1e=x1-x1f, x2e=x2f-x2, y1e=y1-y1f, y2e=y2f-y2;
-				// printf("x1e %.4f x2e %.4f y1e %.4f y2e %.4f\n", x1e, x2e, y1e, y2e);
-				
-				// adjust the box so it's entirely on the canvas
-				if(x1<=0) { x1=0; x1e=0; }
-				if(y1<=0) { y1=0; y1e=0; }
-				if(x2>=surface_width)  { x2=surface_width;  x2e=0; }
-				if(y2>=surface_height) { y2=surface_height; y2e=0; }
-				
-				int w(x2-x1), h(y2-y1);
-				
-				Surface::alpha_pen surface_pen(dest_surface->get_pen(x1,y1),1.0f);
-				if(w>0 && h>0)
-					dest_surface->fill(color,surface_pen,w,h);
-				
-				/* the rectangle doesn't cross any vertical pixel boundaries so we don't
-				 * need to draw any top or bottom edges
-				 */
-				if(x2<x1)
-				{
-					// case 1 - a single pixel
-					if(y2<y1)
-					{
-						surface_pen.move_to(x2,y2);
-						surface_pen.set_alpha((x2f-x1f)*(y2f-y1f));
-						surface_pen.put_value(color);
-					}
-					// case 2 - a single vertical column of pixels
-					else
-					{
-						surface_pen.move_to(x2,y1-1);
-						if (y1e!=0)	// maybe draw top pixel
-						{
-							surface_pen.set_alpha(y1e*(x2f-x1f));
-							surface_pen.put_value(color);
-						}
-						surface_pen.inc_y();
-						surface_pen.set_alpha(x2f-x1f);
-						for(int i=y1; i<y2; i++) // maybe draw pixels between
-						{
-							surface_pen.put_value(color);
-							surface_pen.inc_y();
-						}
-						if (y2e!=0)	// maybe draw bottom pixel
-						{
-							surface_pen.set_alpha(y2e*(x2f-x1f));
-							surface_pen.put_value(color);
-						}
-					}
-				}
-				else
-				{
-					// case 3 - a single horizontal row of pixels
-					if(y2<y1)
-					{
-						surface_pen.move_to(x1-1,y2);
-						if (x1e!=0)	// maybe draw left pixel
-						{
-							surface_pen.set_alpha(x1e*(y2f-y1f));
-							surface_pen.put_value(color);
-						}
-						surface_pen.inc_x();
-						surface_pen.set_alpha(y2f-y1f);
-						for(int i=x1; i<x2; i++) // maybe draw pixels between
-						{
-							surface_pen.put_value(color);
-							surface_pen.inc_x();
-						}
-						if (x2e!=0)	// maybe draw right pixel
-						{
-							surface_pen.set_alpha(x2e*(y2f-y1f));
-							surface_pen.put_value(color);
-						}
-					}
-					// case 4 - a proper block of pixels
-					else
-					{
-						if (x1e!=0)	// maybe draw left edge
-						{
-							surface_pen.move_to(x1-1,y1-1);
-							if (y1e!=0)	// maybe draw top left pixel
-							{
-								surface_pen.set_alpha(x1e*y1e);
-								surface_pen.put_value(color);
-							}
-							surface_pen.inc_y();
-							surface_pen.set_alpha(x1e);
-							for(int i=y1; i<y2; i++) // maybe draw pixels along the left edge
-							{
-								surface_pen.put_value(color);
-								surface_pen.inc_y();
-							}
-							if (y2e!=0)	// maybe draw bottom left pixel
-							{
-								surface_pen.set_alpha(x1e*y2e);
-								surface_pen.put_value(color);
-							}
-							surface_pen.inc_x();
-						}
-						else
-							surface_pen.move_to(x1,y2);
-						
-						if (y2e!=0)	// maybe draw bottom edge
-						{
-							surface_pen.set_alpha(y2e);
-							for(int i=x1; i<x2; i++) // maybe draw pixels along the bottom edge
-							{
-								surface_pen.put_value(color);
-								surface_pen.inc_x();
-							}
-							if (x2e!=0)	// maybe draw bottom right pixel
-							{
-								surface_pen.set_alpha(x2e*y2e);
-								surface_pen.put_value(color);
-							}
-							surface_pen.dec_y();
-						}
-						else
-							surface_pen.move_to(x2,y2-1);
-						
-						if (x2e!=0)	// maybe draw right edge
-						{
-							surface_pen.set_alpha(x2e);
-							for(int i=y1; i<y2; i++) // maybe draw pixels along the right edge
-							{
-								surface_pen.put_value(color);
-								surface_pen.dec_y();
-							}
-							if (y1e!=0)	// maybe draw top right pixel
-							{
-								surface_pen.set_alpha(x2e*y1e);
-								surface_pen.put_value(color);
-							}
-							surface_pen.dec_x();
-						}
-						else
-							surface_pen.move_to(x2-1,y1-1);
-						
-						if (y1e!=0)	// maybe draw top edge
-						{
-							surface_pen.set_alpha(y1e);
-							for(int i=x1; i<x2; i++) // maybe draw pixels along the top edge
-							{
-								surface_pen.put_value(color);
-								surface_pen.dec_x();
-							}
-						}
-					}
-				}
-			}
-			
-			if (reverse)
-			{
-				if (--iter == particle_list.begin())
-					break;
-			}
-			else
-			{
-				if (++iter == particle_list.end())
-					break;
-			}
-		}
+		std::lock_guard<std::mutex> lock(mutex);
+		list = particle_list;
 	}
+	if (!list)
+		return;
+
+	draw_particles_to_rect(
+		*dest_surface,
+		RectInt(0, 0, dest_surface->get_w(), dest_surface->get_h()),
+		list->particles,
+		Vector(1.0/pw, 1.0/ph),
+		Vector(-tl[0]/pw, -tl[1]/ph),
+		size*std::sqrt(1.0/(std::fabs(pw)*std::fabs(ph))),
+		reverse,
+		size_as_alpha );
 }
 
 
@@ -780,3 +810,25 @@ Plant::get_bounding_rect(Context context)const
 	//	return context.get_full_bounding_rect() | bounding_rect;
 	return bounding_rect;
 }
+
+rendering::Task::Handle
+Plant::build_composite_task_vfunc(ContextParams /*context_params*/)const
+{
+	sync();
+
+	Point origin=param_origin.get(Vector());
+	Real size=param_size.get(Real());
+
+	TaskPlant::Handle task(new TaskPlant());
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task->particle_list = particle_list;
+		task->bounds = Rect(bounding_rect.get_min() + origin, bounding_rect.get_max() + origin)
+		               .expand(0.5*std::fabs(size));
+	}
+	task->origin = origin;
+	task->size = size;
+	task->reverse = param_reverse.get(bool());
+	task->size_as_alpha = param_size_as_alpha.get(bool());
+	return task;
+}
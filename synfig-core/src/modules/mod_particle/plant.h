@@ -92,6 +92,7 @@ private:
 
 	bool bline_loop;
 
+public:
 	struct Particle
 	{
 		Point point;
@@ -101,14 +102,27 @@ private:
 			point(point),color(color) { }
 	};
 
-	mutable std::vector<Particle> particle_list;
+	//! Generated particles, they are shared between the layer and rendering tasks,
+	//! so the list is never modified after generation, sync() creates a new one
+	class ParticleList: public etl::shared_object
+	{
+	public:
+		typedef etl::handle<ParticleList> Handle;
+		std::vector<Particle> particles;
+	};
+
+private:
+	mutable ParticleList::Handle particle_list;
+	//! Values of parameters used to generate the particle_list
+	mutable std::vector<ValueBase> particle_list_params;
 	mutable Rect	bounding_rect;
 	Real mass;
 
 	mutable bool needs_sync_;
 	mutable std::mutex mutex;
 
-	void branch(int n, int depth,float t, float stunt_growth, Point position,Vector velocity)const;
+	std::vector<ValueBase> get_particle_list_params()const;
+	void branch(std::vector<Particle> &particles, int n, int depth,float t, float stunt_growth, Point position,Vector velocity)const;
 	void sync()const;
 	String version;
 	void draw_particles(Surface *surface, const RendDesc &renddesc)const;
@@ -130,6 +144,9 @@ public:
 	virtual bool accelerated_render(Context context,Surface *surface,int quality, const RendDesc &renddesc, ProgressCallback *cb)const;
 	using Layer::get_bounding_rect;
 	virtual Rect get_bounding_rect(Context context)const;
+
+protected:
+	virtual rendering::Task::Handle build_composite_task_vfunc(ContextParams context_params)const;
 };
 
 /* === E N D =============================================================== */
@@ -33,11 +33,17 @@
 #	include <config.h>
 #endif
 
+#include <cstdlib>
+
+#include <sigc++/bind.h>
+
 #include <synfig/general.h>
+#include <synfig/threadpool.h>
 
 #include <glib/gstdio.h>
 #include "trgt_png.h"
 #include <png.h>
+#include <zlib.h>
 #include <cstdio>
 #include <ETL/misc>
 #include <string.h>
@@ -61,41 +67,157 @@ SYNFIG_TARGET_SET_VERSION(png_trgt,"0.1");
 void
 png_trgt::png_out_error(png_struct *png_data,const char *msg)
 {
-	png_trgt *me=(png_trgt*)png_get_error_ptr(png_data);
-	synfig::error(strprintf("png_trgt: error: %s",msg));
-	me->ready=false;
+	const Frame *frame=(const Frame*)png_get_error_ptr(png_data);
+	synfig::error(strprintf("png_trgt: error: %s: %s",frame->filename.c_str(),msg));
 }
 
 void
 png_trgt::png_out_warning(png_struct *png_data,const char *msg)
 {
-	png_trgt *me=(png_trgt*)png_get_error_ptr(png_data);
-	synfig::warning(strprintf("png_trgt: warning: %s",msg));
-	me->ready=false;
+	const Frame *frame=(const Frame*)png_get_error_ptr(png_data);
+	synfig::warning(strprintf("png_trgt: warning: %s: %s",frame->filename.c_str(),msg));
+}
+
+bool
+png_trgt::write_frame(const Frame &frame)
+{
+	png_structp png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING, (png_voidp)&frame, png_out_error, png_out_warning);
+	if (!png_ptr)
+	{
+		synfig::error("Unable to setup PNG struct");
+		return false;
+	}
+
+	png_infop info_ptr=png_create_info_struct(png_ptr);
+	if (!info_ptr)
+	{
+		synfig::error("Unable to setup PNG info struct");
+		png_destroy_write_struct(&png_ptr,(png_infopp)NULL);
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(png_ptr)))
+	{
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		return false;
+	}
+
+	png_init_io(png_ptr,frame.file);
+
+	// fast levels use cheap filters and run-length strategy,
+	// otherwise libpng chooses the best filter for each row
+	if (frame.compression_level >= 0 && frame.compression_level <= 3)
+	{
+		png_set_filter(png_ptr,0,PNG_FILTER_SUB|PNG_FILTER_UP);
+		png_set_compression_strategy(png_ptr,Z_RLE);
+	}
+	else
+	{
+		png_set_filter(png_ptr,0,PNG_ALL_FILTERS);
+	}
+	if (frame.compression_level >= 0)
+		png_set_compression_level(png_ptr,frame.compression_level);
+
+	png_set_IHDR(png_ptr,info_ptr,frame.w,frame.h,8,frame.alpha ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
+
+	// Write the physical size
+	png_set_pHYs(png_ptr,info_ptr,frame.x_res,frame.y_res,PNG_RESOLUTION_METER);
+
+	// Explicit set gamma value to 2.2 (it's a default value)
+	png_set_gAMA(png_ptr,info_ptr,1/2.2);
+
+	char title      [] = "Title";
+	char description[] = "Description";
+	char software   [] = "Software";
+	char synfig     [] = "SYNFIG";
+
+	// Output any text info along with the file
+	png_text comments[3];
+	memset(comments, 0, sizeof(comments));
+
+	comments[0].compression = PNG_TEXT_COMPRESSION_NONE;
+	comments[0].key         = title;
+	comments[0].text        = const_cast<char *>(frame.title.c_str());
+	comments[0].text_length = strlen(comments[0].text);
+
+	comments[1].compression = PNG_TEXT_COMPRESSION_NONE;
+	comments[1].key         = description;
+	comments[1].text        = const_cast<char *>(frame.description.c_str());
+	comments[1].text_length = strlen(comments[1].text);
+
+	comments[2].compression = PNG_TEXT_COMPRESSION_NONE;
+	comments[2].key         = software;
+	comments[2].text        = synfig;
+	comments[2].text_length = strlen(comments[2].text);
+
+	png_set_text(png_ptr, info_ptr, comments, sizeof(comments)/sizeof(png_text));
+
+	png_write_info_before_PLTE(png_ptr, info_ptr);
+	png_write_info(png_ptr, info_ptr);
+
+	for(int y = 0; y < frame.h; ++y)
+		png_write_row(png_ptr,(png_bytep)&frame.pixels[y*frame.row_size()]);
+
+	png_write_end(png_ptr,info_ptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	return true;
+}
+
+void
+png_trgt::write_frame_job(Frame *frame)
+{
+	bool success = write_frame(*frame);
+	fclose(frame->file);
+	size_t size = frame->pixels.size();
+	delete frame;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!success) pending_failed = true;
+	pending_size -= size;
+	--pending_count;
+	cond.notify_all();
 }
 
+void
+png_trgt::wait_pending(size_t size)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(pending_count && pending_size + size > max_pending_size)
+		ThreadPool::instance().wait(cond, lock);
+}
+
+bool
+png_trgt::wait_all()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(pending_count)
+		ThreadPool::instance().wait(cond, lock);
+	return !pending_failed;
+}
 
 //Target *png_trgt::New(const char *filename){	return new png_trgt(filename);}
 
 png_trgt::png_trgt(const char *Filename, const synfig::TargetParam &params):
 	file(NULL),
-	png_ptr(NULL),
-	info_ptr(NULL),
+	frame(NULL),
+	scanline(),
 	multi_image(),
-	ready(false),
 	imagecount(),
 	filename(Filename),
-	buffer(NULL),
 	color_buffer(NULL),
-	sequence_separator(params.sequence_separator)
+	sequence_separator(params.sequence_separator),
+	pending_size(),
+	pending_count(),
+	pending_failed()
 { }
 
 png_trgt::~png_trgt()
 {
-	if(file)
+	wait_all();
+	if(file && file!=stdout)
 		fclose(file);
 	file=NULL;
-	delete [] buffer;
+	delete frame;
 	delete [] color_buffer;
 }
 
@@ -112,20 +234,48 @@ png_trgt::set_rend_desc(RendDesc *given_desc)
 	return true;
 }
 
+bool
+png_trgt::render(synfig::ProgressCallback *cb)
+{
+	// render is complete when all frames are written
+	bool success = Target_Scanline::render(cb);
+	return wait_all() && success;
+}
+
 void
 png_trgt::end_frame()
 {
-	if(ready && file)
+	if (frame && file)
 	{
-		png_write_end(png_ptr,info_ptr);
-		png_destroy_write_struct(&png_ptr, &info_ptr);
+		frame->file = file;
+		if (multi_image && file != stdout)
+		{
+			// compress in background, file will be closed by job
+			wait_pending(frame->pixels.size());
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pending_size += frame->pixels.size();
+				++pending_count;
+			}
+			ThreadPool::instance().enqueue( sigc::bind(
+				sigc::mem_fun(this, &png_trgt::write_frame_job), frame ));
+			frame = NULL;
+			file = NULL;
+		}
+		else
+		if (!write_frame(*frame))
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending_failed = true;
+		}
 	}
 
+	delete frame;
+	frame=NULL;
 	if(file && file!=stdout)
 		fclose(file);
 	file=NULL;
 	imagecount++;
-	ready=false;
 }
 
 bool
@@ -133,8 +283,15 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 {
 	int w=desc.get_w(),h=desc.get_h();
 
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (pending_failed)
+			return false;
+	}
+
 	if(file && file!=stdout)
 		fclose(file);
+	String frame_filename = filename;
 	if(filename=="-")
 	{
 		if(callback)callback->task(strprintf("(stdout) %d",imagecount).c_str());
@@ -142,12 +299,12 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 	}
 	else if(multi_image)
 	{
-		String newfilename(filename_sans_extension(filename) +
-						   sequence_separator +
-						   etl::strprintf("%04d",imagecount) +
-						   filename_extension(filename));
-		file=g_fopen(newfilename.c_str(),POPEN_BINARY_WRITE_TYPE);
-		if(callback)callback->task(newfilename);
+		frame_filename = filename_sans_extension(filename) +
+						 sequence_separator +
+						 etl::strprintf("%04d",imagecount) +
+						 filename_extension(filename);
+		file=g_fopen(frame_filename.c_str(),POPEN_BINARY_WRITE_TYPE);
+		if(callback)callback->task(frame_filename);
 	}
 	else
 	{
@@ -158,100 +315,42 @@ png_trgt::start_frame(synfig::ProgressCallback *callback)
 	if(!file)
 		return false;
 
-	delete [] buffer;
-	buffer=new unsigned char[4*w];
-
 	delete [] color_buffer;
 	color_buffer=new Color[w];
 
-	png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING, (png_voidp)this,png_out_error, png_out_warning);
-	if (!png_ptr)
-	{
-		synfig::error("Unable to setup PNG struct");
-		fclose(file);
-		return false;
-	}
-
-	info_ptr= png_create_info_struct(png_ptr);
-	if (!info_ptr)
-	{
-		synfig::error("Unable to setup PNG info struct");
-		fclose(file);
-		png_destroy_write_struct(&png_ptr,(png_infopp)NULL);
-		return false;
-	}
+	delete frame;
+	frame = new Frame();
+	frame->filename = frame_filename;
+	frame->w = w;
+	frame->h = h;
+	frame->alpha = get_alpha_mode()==TARGET_ALPHA_MODE_KEEP;
+	frame->x_res = round_to_int(desc.get_x_res());
+	frame->y_res = round_to_int(desc.get_y_res());
+	frame->title = get_canvas()->get_name();
+	frame->description = get_canvas()->get_description();
+	if (const char *s = getenv("SYNFIG_PNG_COMPRESSION_LEVEL"))
+		frame->compression_level = std::max(0, std::min(9, atoi(s)));
+	frame->pixels.resize(frame->row_size()*h);
+	scanline = 0;
 
-	if (setjmp(png_jmpbuf(png_ptr)))
-	{
-		synfig::error("Unable to setup longjump");
-		png_destroy_write_struct(&png_ptr, &info_ptr);
-		fclose(file);
-		return false;
-	}
-	png_init_io(png_ptr,file);
-	png_set_filter(png_ptr,0,PNG_FILTER_NONE);
-
-	setjmp(png_jmpbuf(png_ptr));
-	if (get_alpha_mode()==TARGET_ALPHA_MODE_KEEP)
-		png_set_IHDR(png_ptr,info_ptr,w,h,8,PNG_COLOR_TYPE_RGBA,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
-	else
-		png_set_IHDR(png_ptr,info_ptr,w,h,8,PNG_COLOR_TYPE_RGB,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
-
-	// Write the physical size
-	png_set_pHYs(png_ptr,info_ptr,round_to_int(desc.get_x_res()),round_to_int(desc.get_y_res()),PNG_RESOLUTION_METER);
-	
-	// Explicit set gamma value to 2.2 (it's a default value)
-	png_set_gAMA(png_ptr,info_ptr,1/2.2);
-
-	char title      [] = "Title";
-	char description[] = "Description";
-	char software   [] = "Software";
-	char synfig     [] = "SYNFIG";
-
-	// Output any text info along with the file
-	png_text comments[3];
-	memset(comments, 0, sizeof(comments));
-
-	comments[0].compression = PNG_TEXT_COMPRESSION_NONE;
-	comments[0].key         = title;
-	comments[0].text        = const_cast<char *>(get_canvas()->get_name().c_str());
-	comments[0].text_length = strlen(comments[0].text);
-
-	comments[1].compression = PNG_TEXT_COMPRESSION_NONE;
-	comments[1].key         = description;
-	comments[1].text        = const_cast<char *>(get_canvas()->get_description().c_str());
-	comments[1].text_length = strlen(comments[1].text);
-
-	comments[2].compression = PNG_TEXT_COMPRESSION_NONE;
-	comments[2].key         = software;
-	comments[2].text        = synfig;
-	comments[2].text_length = strlen(comments[2].text);
-
-	png_set_text(png_ptr, info_ptr, comments, sizeof(comments)/sizeof(png_text));
-
-	png_write_info_before_PLTE(png_ptr, info_ptr);
-	png_write_info(png_ptr, info_ptr);
-	ready=true;
 	return true;
 }
 
 Color *
-png_trgt::start_scanline(int /*scanline*/)
+png_trgt::start_scanline(int scanline)
 {
+	this->scanline = scanline;
 	return color_buffer;
 }
 
 bool
 png_trgt::end_scanline()
 {
-	if(!file || !ready)
+	if(!file || !frame || scanline < 0 || scanline >= frame->h)
 		return false;
 
-	PixelFormat pf = get_alpha_mode()==TARGET_ALPHA_MODE_KEEP ? PF_RGB|PF_A : PF_RGB;
-	color_to_pixelformat(buffer, color_buffer, pf, 0, desc.get_w());
-
-	setjmp(png_jmpbuf(png_ptr));
-	png_write_row(png_ptr,buffer);
+	PixelFormat pf = frame->alpha ? PF_RGB|PF_A : PF_RGB;
+	color_to_pixelformat(&frame->pixels[scanline*frame->row_size()], color_buffer, pf, 0, frame->w);
 
 	return true;
 }
@@ -33,7 +33,10 @@
 #include <png.h>
 #include <synfig/target_scanline.h>
 #include <synfig/targetparam.h>
+#include <condition_variable>
 #include <cstdio>
+#include <mutex>
+#include <vector>
 
 /* === M A C R O S ========================================================= */
 
@@ -41,28 +44,64 @@
 
 /* === C L A S S E S & S T R U C T S ======================================= */
 
+//! Writes PNG image or sequence of images.
+//! Frames of sequence are compressed in background by the ThreadPool,
+//! while the next frames are rendered.
 class png_trgt : public synfig::Target_Scanline
 {
 	SYNFIG_TARGET_MODULE_EXT
+public:
+	//! Memory limit for frames which are waiting for compression, in bytes
+	static const size_t max_pending_size = 512*1024*1024;
+
 private:
+	//! Converted pixels of the frame with everything needed to write it
+	struct Frame
+	{
+		FILE *file;
+		synfig::String filename;
+		int w, h;
+		bool alpha;
+		int x_res, y_res;
+		synfig::String title;
+		synfig::String description;
+		int compression_level;
+		std::vector<unsigned char> pixels;
+
+		Frame(): file(), w(), h(), alpha(), x_res(), y_res(), compression_level(-1) { }
+		size_t row_size() const { return (alpha ? 4 : 3)*w; }
+	};
+
 	FILE *file;
-	//int w,h;
-	png_structp png_ptr;
-	png_infop info_ptr;
+	Frame *frame;
+	int scanline;
 
 	static void png_out_error(png_struct *png,const char *msg);
 	static void png_out_warning(png_struct *png,const char *msg);
-	bool multi_image,ready;
+	static bool write_frame(const Frame &frame);
+	void write_frame_job(Frame *frame);
+
+	bool multi_image;
 	int imagecount;
 	synfig::String filename;
-	unsigned char *buffer;
 	synfig::Color *color_buffer;
 	synfig::String sequence_separator;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	size_t pending_size;
+	int pending_count;
+	bool pending_failed;
+
+	void wait_pending(size_t size);
+	bool wait_all();
+
 public:
 	png_trgt(const char *filename, const synfig::TargetParam& /* params */);
 	virtual ~png_trgt();
 
 	virtual bool set_rend_desc(synfig::RendDesc *desc);
+	virtual bool render(synfig::ProgressCallback *cb=NULL);
 	virtual bool start_frame(synfig::ProgressCallback *cb);
 	virtual void end_frame();
 
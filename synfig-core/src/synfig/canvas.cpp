@@ -52,7 +52,6 @@
 #include "loadcanvas.h"
 #include "valuenode_registry.h"
 
-#include "debug/measure.h"
 #include "layers/layer_pastecanvas.h"
 #include "valuenodes/valuenode_const.h"
 #include "valuenodes/valuenode_scale.h"
@@ -68,8 +67,6 @@ namespace synfig { extern Canvas::Handle open_canvas_as(const FileSystem::Identi
 
 /* === M A C R O S ========================================================= */
 
-//#define DEBUG_SET_TIME_MEASURE
-
 #define ALLOW_CLONE_NON_INLINE_CANVASES
 
 struct _CanvasCounter
@@ -479,10 +476,6 @@ Canvas::set_time(Time t)const
 {
 	if(is_dirty_ || !get_time().is_equal(t))
 	{
-		#ifdef DEBUG_SET_TIME_MEASURE
-		debug::Measure measure("Canvas::set_time", true);
-		#endif
-
 #if 0
 		if(is_root())
 		{
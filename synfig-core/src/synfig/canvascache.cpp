@@ -0,0 +1,482 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file canvascache.cpp
+**	\brief Binary cache of the document trees of canvas files
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libxml++/libxml++.h>
+
+#include <ETL/stringf>
+
+#include "canvascache.h"
+
+#include "filesystemnative.h"
+#include "general.h"
+#include "guid.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+namespace {
+
+//! Layout of the cache file:
+//!   Header
+//!   uint32_t string_offsets[string_count]
+//!   Node nodes[node_count]            (pre-order)
+//!   Attribute attributes[attribute_count] (in order of nodes)
+//!   char string_data[string_data_size]   (NUL-terminated strings)
+struct Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t source_size;
+	int64_t source_mtime;
+	char source_hash[64];
+	uint32_t string_count;
+	uint32_t node_count;
+	uint32_t attribute_count;
+	uint32_t reserved;
+	uint64_t string_data_size;
+};
+
+struct Node
+{
+	uint32_t type;
+	uint32_t name;    //!< name of element or content of text/comment
+	uint32_t line;
+	uint32_t attribute_count;
+	uint32_t child_count;
+};
+
+struct Attribute
+{
+	uint32_t name;
+	uint32_t value;
+};
+
+const char magic[8] = { 'S', 'I', 'F', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t byte_order = 0x01020304;
+
+enum NodeType
+{
+	NODE_ELEMENT = XML_ELEMENT_NODE,
+	NODE_TEXT    = XML_TEXT_NODE,
+	NODE_COMMENT = XML_COMMENT_NODE
+};
+
+class Reader
+{
+public:
+	const char *data;
+	size_t size;
+	const Header *header;
+	const uint32_t *string_offsets;
+	const Node *nodes;
+	const Attribute *attributes;
+	const char *string_data;
+	size_t next_node;
+	size_t next_attribute;
+
+	Reader(const char *data, size_t size):
+		data(data), size(size), header(), string_offsets(), nodes(),
+		attributes(), string_data(), next_node(), next_attribute() { }
+
+	bool open()
+	{
+		if (size < sizeof(Header)) return false;
+		header = (const Header*)data;
+		if ( memcmp(header->magic, magic, sizeof(magic))
+		  || header->version != CanvasCache::format_version
+		  || header->byte_order != byte_order )
+			return false;
+
+		uint64_t offset = sizeof(Header);
+		uint64_t end = offset
+		             + (uint64_t)header->string_count*sizeof(uint32_t)
+		             + (uint64_t)header->node_count*sizeof(Node)
+		             + (uint64_t)header->attribute_count*sizeof(Attribute)
+		             + header->string_data_size;
+		if (end != size || !header->node_count || !header->string_data_size)
+			return false;
+
+		string_offsets = (const uint32_t*)(data + offset);
+		offset += (uint64_t)header->string_count*sizeof(uint32_t);
+		nodes = (const Node*)(data + offset);
+		offset += (uint64_t)header->node_count*sizeof(Node);
+		attributes = (const Attribute*)(data + offset);
+		offset += (uint64_t)header->attribute_count*sizeof(Attribute);
+		string_data = data + offset;
+
+		// strings must be terminated, so the last byte is always zero
+		if (string_data[header->string_data_size - 1]) return false;
+		for(uint32_t i = 0; i < header->string_count; ++i)
+			if (string_offsets[i] >= header->string_data_size) return false;
+		return true;
+	}
+
+	bool match_stamp(const CanvasCache::Stamp &stamp) const
+		{ return header->source_size == stamp.size && header->source_mtime == stamp.mtime; }
+
+	bool match_source_hash(const String &source_hash) const
+	{
+		return !source_hash.empty()
+		    && source_hash.size() < sizeof(header->source_hash)
+		    && !strncmp(header->source_hash, source_hash.c_str(), sizeof(header->source_hash));
+	}
+
+	const xmlChar* get_string(uint32_t index) const
+	{
+		if (index >= header->string_count) return nullptr;
+		return (const xmlChar*)(string_data + string_offsets[index]);
+	}
+
+	bool read_node(xmlNode *node, const Node &n)
+	{
+		node->line = (unsigned short)std::min(n.line, (uint32_t)65535);
+		if (n.type != NODE_ELEMENT)
+			return !n.attribute_count && !n.child_count;
+
+		if (n.attribute_count > header->attribute_count - next_attribute)
+			return false;
+		for(uint32_t i = 0; i < n.attribute_count; ++i)
+		{
+			const Attribute &a = attributes[next_attribute++];
+			const xmlChar *name = get_string(a.name);
+			const xmlChar *value = get_string(a.value);
+			if (!name || !value) return false;
+			xmlNewProp(node, name, value);
+		}
+
+		for(uint32_t i = 0; i < n.child_count; ++i)
+		{
+			if (next_node >= header->node_count) return false;
+			const Node &c = nodes[next_node++];
+			const xmlChar *name = get_string(c.name);
+			if (!name) return false;
+
+			xmlNode *child;
+			switch(c.type)
+			{
+			case NODE_ELEMENT: child = xmlNewDocNode(node->doc, nullptr, name, nullptr); break;
+			case NODE_TEXT:    child = xmlNewDocText(node->doc, name); break;
+			case NODE_COMMENT: child = xmlNewDocComment(node->doc, name); break;
+			default: return false;
+			}
+			if (!child) return false;
+			xmlAddChild(node, child);
+			if (!read_node(child, c)) return false;
+		}
+		return true;
+	}
+};
+
+} // END of anonymous namespace
+
+//! Collects the element tree into the arrays of the cache file
+class CanvasCache::Writer
+{
+public:
+	Header header;
+	std::vector<uint32_t> string_offsets;
+	std::vector<Node> nodes;
+	std::vector<Attribute> attributes;
+	std::vector<char> string_data;
+	std::unordered_map<std::string, uint32_t> strings;
+
+	Writer() { memset(&header, 0, sizeof(header)); }
+
+	uint32_t add_string(const char *x)
+	{
+		if (!x) x = "";
+		std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> r =
+			strings.insert(std::make_pair(std::string(x), (uint32_t)string_offsets.size()));
+		if (r.second)
+		{
+			string_offsets.push_back((uint32_t)string_data.size());
+			string_data.insert(string_data.end(), x, x + strlen(x) + 1);
+		}
+		return r.first->second;
+	}
+
+	void add_node(xmlNode *node, bool add_children = true)
+	{
+		size_t index = nodes.size();
+		nodes.push_back(Node());
+		Node &n = nodes.back();
+		n.type = node->type;
+		n.name = add_string(node->type == XML_ELEMENT_NODE ? (const char*)node->name : (const char*)node->content);
+		n.line = (uint32_t)std::max(0, (int)xmlGetLineNo(node));
+		n.attribute_count = 0;
+		n.child_count = 0;
+
+		if (node->type != XML_ELEMENT_NODE)
+			return;
+
+		for(xmlAttr *attr = node->properties; attr; attr = attr->next)
+		{
+			xmlChar *value = xmlNodeGetContent((xmlNode*)attr);
+			Attribute a;
+			a.name = add_string((const char*)attr->name);
+			a.value = add_string((const char*)value);
+			xmlFree(value);
+			attributes.push_back(a);
+			++nodes[index].attribute_count;
+		}
+
+		if (add_children)
+			for(xmlNode *child = node->children; child; child = child->next)
+				add_child(index, child);
+	}
+
+	void add_child(size_t parent_index, xmlNode *child)
+	{
+		if (child->type != XML_ELEMENT_NODE && child->type != XML_TEXT_NODE && child->type != XML_COMMENT_NODE)
+			return;
+		++nodes[parent_index].child_count;
+		add_node(child);
+	}
+
+	bool write(const String &cache_filename, const CanvasCache::Stamp &stamp, const String &source_hash)
+	{
+		memcpy(header.magic, magic, sizeof(magic));
+		header.version = CanvasCache::format_version;
+		header.byte_order = byte_order;
+		// modification time has a resolution of one second, so the source written
+		// just now may change again without changing its stamp, then only its key is kept
+		if (stamp.mtime < (int64_t)time(nullptr) - 1)
+		{
+			header.source_size = stamp.size;
+			header.source_mtime = stamp.mtime;
+		}
+		strncpy(header.source_hash, source_hash.c_str(), sizeof(header.source_hash) - 1);
+		header.string_count = (uint32_t)string_offsets.size();
+		header.node_count = (uint32_t)nodes.size();
+		header.attribute_count = (uint32_t)attributes.size();
+		header.string_data_size = string_data.size();
+
+		// write into temporary file and rename it, so readers never see a partial cache
+		FileSystem::Handle file_system = FileSystemNative::instance();
+		String tmp_filename = cache_filename + "." + GUID().get_string() + ".tmp";
+		{
+			FileSystem::WriteStream::Handle stream = file_system->get_write_stream(tmp_filename);
+			if (!stream)
+				return false;
+			bool success = stream->write_variable(header)
+			            && stream->write_block(string_offsets.data(), string_offsets.size()*sizeof(uint32_t))
+			            && stream->write_block(nodes.data(), nodes.size()*sizeof(Node))
+			            && stream->write_block(attributes.data(), attributes.size()*sizeof(Attribute))
+			            && stream->write_block(string_data.data(), string_data.size());
+			if (!success)
+			{
+				stream.reset();
+				file_system->file_remove(tmp_filename);
+				synfig::warning("CanvasCache: cannot write cache file: %s", cache_filename.c_str());
+				return false;
+			}
+		}
+
+		if (!file_system->file_rename(tmp_filename, cache_filename))
+		{
+			file_system->file_remove(tmp_filename);
+			return false;
+		}
+		return true;
+	}
+};
+
+
+CanvasCache::Builder::Builder():
+	writer(new Writer()), finished() { }
+
+CanvasCache::Builder::~Builder()
+	{ delete writer; }
+
+void
+CanvasCache::Builder::set_root(const xmlpp::Element &root)
+{
+	assert(writer->nodes.empty());
+	writer->add_node(const_cast<xmlNode*>(root.cobj()), false);
+}
+
+void
+CanvasCache::Builder::add_child(const xmlpp::Element &child)
+{
+	assert(!writer->nodes.empty());
+	writer->add_child(0, const_cast<xmlNode*>(child.cobj()));
+}
+
+bool
+CanvasCache::Builder::save(const String &cache_filename, const Stamp &stamp, const String &source_hash) const
+{
+	if (!finished || writer->nodes.empty())
+		return false;
+	return writer->write(cache_filename, stamp, source_hash);
+}
+
+
+CanvasCache::HashReadStream::HashReadStream(FileSystem::ReadStream::Handle stream):
+	FileSystem::ReadStream(stream->file_system()),
+	stream_(stream),
+	checksum_(g_checksum_new(G_CHECKSUM_SHA1))
+{ }
+
+CanvasCache::HashReadStream::~HashReadStream()
+	{ g_checksum_free(checksum_); }
+
+size_t
+CanvasCache::HashReadStream::internal_read(void *buffer, size_t size)
+{
+	size = stream_->read_block(buffer, size);
+	g_checksum_update(checksum_, (const guchar*)buffer, size);
+	return size;
+}
+
+String
+CanvasCache::HashReadStream::finish()
+{
+	char buffer[65536];
+	while(read_block(buffer, sizeof(buffer))) { }
+	return String(g_checksum_get_string(checksum_));
+}
+
+
+String
+CanvasCache::get_cache_filename(const String &filename)
+{
+	const char *dir = getenv("SYNFIG_CANVAS_CACHE_DIR");
+	if (!dir || !*dir)
+		return filename + ".sifcache";
+
+	String path = etl::absolute_path(filename);
+	gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, path.c_str(), path.size());
+	String name = String(dir) + ETL_DIRECTORY_SEPARATOR + checksum + ".sifcache";
+	g_free(checksum);
+	return name;
+}
+
+bool
+CanvasCache::get_stamp(const FileSystem::Identifier &identifier, Stamp &stamp)
+{
+	stamp = Stamp();
+	if (!identifier.file_system)
+		return false;
+	String uri = identifier.file_system->get_real_uri(identifier.filename);
+	if (uri.empty())
+		return false;
+
+	gchar *path = g_filename_from_uri(uri.c_str(), nullptr, nullptr);
+	if (!path)
+		return false;
+	GStatBuf buf;
+	bool success = g_stat(path, &buf) == 0;
+	g_free(path);
+	if (!success)
+		return false;
+
+	stamp.size = (uint64_t)buf.st_size;
+	stamp.mtime = (int64_t)buf.st_mtime;
+	return true;
+}
+
+String
+CanvasCache::get_source_hash(FileSystem::ReadStream::Handle stream)
+{
+	HashReadStream::Handle hash_stream(new HashReadStream(stream));
+	return hash_stream->finish();
+}
+
+bool
+CanvasCache::load(
+	const String &cache_filename,
+	const Stamp &stamp,
+	const std::function<String()> &get_source_hash,
+	xmlpp::Document &document,
+	bool &stamp_changed )
+{
+	stamp_changed = false;
+
+	GMappedFile *file = g_mapped_file_new(cache_filename.c_str(), FALSE, nullptr);
+	if (!file)
+		return false;
+
+	bool success = false;
+	Reader reader(g_mapped_file_get_contents(file), g_mapped_file_get_length(file));
+	if (reader.open())
+	{
+		// the source is read only when its size or modification time are changed
+		bool valid = (stamp.size || stamp.mtime) && reader.match_stamp(stamp);
+		if (!valid)
+			valid = stamp_changed = reader.match_source_hash(get_source_hash());
+
+		const Node &n = reader.nodes[reader.next_node++];
+		const xmlChar *name = reader.get_string(n.name);
+		if (valid && n.type == NODE_ELEMENT && name)
+		{
+			xmlpp::Element *root = document.create_root_node((const char*)name);
+			success = reader.read_node(root->cobj(), n)
+			       && reader.next_node == reader.header->node_count
+			       && reader.next_attribute == reader.header->attribute_count;
+		}
+	}
+	g_mapped_file_unref(file);
+
+	if (!success)
+	{
+		stamp_changed = false;
+		synfig::info("CanvasCache: ignoring stale or broken cache file: %s", cache_filename.c_str());
+	}
+	return success;
+}
+
+bool
+CanvasCache::save(const String &cache_filename, const Stamp &stamp, const String &source_hash, const xmlpp::Element &root)
+{
+	Writer writer;
+	writer.add_node(const_cast<xmlNode*>(root.cobj()));
+	return writer.write(cache_filename, stamp, source_hash);
+}
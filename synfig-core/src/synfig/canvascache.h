@@ -0,0 +1,161 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file canvascache.h
+**	\brief Binary cache of the document trees of canvas files
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_CANVASCACHE_H
+#define __SYNFIG_CANVASCACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "filesystem.h"
+#include "string.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace xmlpp { class Document; class Element; };
+typedef struct _GChecksum GChecksum;
+
+namespace synfig {
+
+//! Binary cache of the document trees of .sif/.sifz files
+/*! The cache stores the element tree of the document with all names and
+ *  values interned in a string table, so reopening the same file skips
+ *  decompression and XML lexing. It is not a serialized Canvas: layers,
+ *  value nodes and their links are still built by CanvasParser from the
+ *  restored elements on every load. The cache is a flat, versioned file
+ *  which is memory-mapped on load.
+ *
+ *  The cache is valid while the size and the modification time of the
+ *  source file are the same as when the cache was written. Only when they
+ *  differ is the source read and its SHA1 compared with the one stored
+ *  in the cache, so a touched or copied file still hits the cache.
+ *
+ *  Caches are written next to the source file (<filename>.sifcache), or
+ *  into the directory given by SYNFIG_CANVAS_CACHE_DIR environment variable. */
+class CanvasCache
+{
+private:
+	class Writer;
+
+public:
+	enum { format_version = 2 };
+
+	//! Size and modification time of the source file
+	struct Stamp
+	{
+		uint64_t size;
+		int64_t mtime;
+
+		Stamp(): size(), mtime() { }
+
+		bool operator==(const Stamp &other) const
+			{ return size == other.size && mtime == other.mtime; }
+		bool operator!=(const Stamp &other) const
+			{ return !(*this == other); }
+	};
+
+	//! Collects the element tree while the document is streamed by CanvasParser
+	class Builder
+	{
+	private:
+		Writer *writer;
+		bool finished;
+
+		Builder(const Builder&);
+		Builder& operator=(const Builder&);
+
+	public:
+		Builder();
+		~Builder();
+
+		//! Starts the tree with the attributes of the root element, its children are not added
+		void set_root(const xmlpp::Element &root);
+		//! Appends the whole subtree of the child of the root element
+		void add_child(const xmlpp::Element &child);
+		//! Marks that all children of the root element are added
+		void finish() { finished = true; }
+
+		//! Writes the collected tree into the cache file, if it's finished
+		bool save(const String &cache_filename, const Stamp &stamp, const String &source_hash) const;
+	};
+
+	//! Passes the source stream through and computes the key of its content on the way
+	class HashReadStream: public FileSystem::ReadStream
+	{
+	public:
+		typedef etl::handle<HashReadStream> Handle;
+
+	private:
+		FileSystem::ReadStream::Handle stream_;
+		GChecksum *checksum_;
+
+	protected:
+		virtual size_t internal_read(void *buffer, size_t size);
+
+	public:
+		explicit HashReadStream(FileSystem::ReadStream::Handle stream);
+		virtual ~HashReadStream();
+
+		//! Reads the rest of the source and returns the key of the whole content
+		String finish();
+	};
+
+	//! Returns the name of the cache file for the canvas file
+	static String get_cache_filename(const String &filename);
+
+	//! Reads size and modification time of the file
+	/*! \return false if the file isn't stored in the native file system */
+	static bool get_stamp(const FileSystem::Identifier &identifier, Stamp &stamp);
+
+	//! Returns the key of the source file content, reads the stream till the end
+	static String get_source_hash(FileSystem::ReadStream::Handle stream);
+
+	//! Loads the element tree into empty \a document
+	/*! \a get_source_hash is called only if \a stamp doesn't match the cache,
+	 *  then \a stamp_changed is set when the cache is still valid.
+	 *  \return false if cache file is missing, broken or stale */
+	static bool load(
+		const String &cache_filename,
+		const Stamp &stamp,
+		const std::function<String()> &get_source_hash,
+		xmlpp::Document &document,
+		bool &stamp_changed );
+
+	//! Writes the element tree of \a root into the cache file
+	static bool save(const String &cache_filename, const Stamp &stamp, const String &source_hash, const xmlpp::Element &root);
+}; // END of class CanvasCache
+
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
@@ -0,0 +1,524 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file debug/profile.cpp
+**	\brief Recording of the rendering timings for the profiling output
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <ETL/stringf>
+
+#include "profile.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace etl;
+using namespace synfig;
+using namespace debug;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+
+//! Events of the one thread.
+//! Only the owner thread writes events, it publishes them by the counter,
+//! and readers skip events which may be overwritten while they are copied.
+struct ThreadBuffer
+{
+	enum { SIZE = 1 << 15 };
+
+	std::vector<Profile::Event> events;
+	std::atomic<unsigned long long> written; //!< count of events ever written
+	std::atomic<unsigned long long> cleared; //!< events before it are dropped by Profile::enable()
+
+	std::mutex name_mutex;
+	String name;
+
+	ThreadBuffer(): events(SIZE), written(0), cleared(0) { }
+};
+
+struct ThreadEvents
+{
+	String name;
+	std::vector<Profile::Event> events;
+	unsigned long long dropped;
+	ThreadEvents(): dropped() { }
+};
+
+struct Stat
+{
+	int count;
+	long long time;
+	Stat(): count(), time() { }
+	void add(const Profile::Event &event)
+		{ ++count; time += event.end - event.begin; }
+};
+
+typedef std::map<String, Stat> StatMap;
+
+struct FrameStats
+{
+	StatMap phases;
+	StatMap tasks;
+};
+
+std::mutex buffers_mutex;
+std::vector< std::shared_ptr<ThreadBuffer> > buffers;
+
+std::atomic<long long> start_time(0);
+
+std::mutex job_names_mutex;
+std::map<int, String> job_names;
+
+#ifndef SYNFIG_DISABLE_PROFILE
+//! buffer is created by the first event recorded while profiling is enabled
+thread_local ThreadBuffer *current_buffer = nullptr;
+#endif
+thread_local String current_name; //!< kept till the buffer is created
+thread_local int current_job = -1;
+thread_local int current_frame = -1;
+thread_local int current_depth = 0;
+
+} // end of anonimous namespace
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+long long
+clock_microseconds()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+#ifndef SYNFIG_DISABLE_PROFILE
+ThreadBuffer&
+get_buffer()
+{
+	if (!current_buffer) {
+		std::shared_ptr<ThreadBuffer> buffer = std::make_shared<ThreadBuffer>();
+		std::lock_guard<std::mutex> lock(buffers_mutex);
+		buffer->name = !current_name.empty() ? current_name : strprintf("thread %d", (int)buffers.size());
+		buffers.push_back(buffer);
+		current_buffer = buffer.get();
+	}
+	return *current_buffer;
+}
+#endif
+
+ThreadEvents
+get_thread_events(ThreadBuffer &buffer)
+{
+	ThreadEvents thread;
+	{
+		std::lock_guard<std::mutex> lock(buffer.name_mutex);
+		thread.name = buffer.name;
+	}
+
+	const unsigned long long size = ThreadBuffer::SIZE;
+	unsigned long long end = buffer.written.load(std::memory_order_acquire);
+	unsigned long long begin = buffer.cleared.load(std::memory_order_relaxed);
+	if (end > size && begin < end - size) {
+		thread.dropped = end - size - begin;
+		begin = end - size;
+	}
+	for(unsigned long long i = begin; i < end; ++i)
+		thread.events.push_back(buffer.events[i % size]);
+
+	// the owner may overwrite the oldest events while they are copied,
+	// the slot of the next event may be half-written
+	unsigned long long written = buffer.written.load(std::memory_order_acquire);
+	if (written + 1 > begin + size) {
+		unsigned long long skip = std::min(written + 1 - size - begin, end - begin);
+		thread.events.erase(thread.events.begin(), thread.events.begin() + skip);
+		thread.dropped += skip;
+	}
+	return thread;
+}
+
+std::vector<ThreadEvents>
+get_events()
+{
+	std::vector< std::shared_ptr<ThreadBuffer> > list;
+	{
+		std::lock_guard<std::mutex> lock(buffers_mutex);
+		list = buffers;
+	}
+	std::vector<ThreadEvents> threads;
+	for(size_t i = 0; i < list.size(); ++i)
+		threads.push_back(get_thread_events(*list[i]));
+	return threads;
+}
+
+String
+quote(const char *str)
+{
+	String s = "\"";
+	for(const char *c = str; *c; ++c) {
+		switch(*c) {
+		case '"':  s += "\\\""; break;
+		case '\\': s += "\\\\"; break;
+		case '\n': s += "\\n";  break;
+		case '\t': s += "\\t";  break;
+		default:
+			if ((unsigned char)*c < 0x20)
+				s += strprintf("\\u%04x", (int)(unsigned char)*c);
+			else
+				s += *c;
+		}
+	}
+	return s + "\"";
+}
+
+String
+quote(const String &str)
+	{ return quote(str.c_str()); }
+
+double
+seconds(long long microseconds)
+	{ return (double)microseconds*0.000001; }
+
+//! Total time when the thread runs at least one event, nested events are not counted twice
+long long
+busy_time(const std::vector<Profile::Event> &events)
+{
+	long long time = 0;
+	for(std::vector<Profile::Event>::const_iterator i = events.begin(); i != events.end(); ++i)
+		if (i->depth == 0)
+			time += i->end - i->begin;
+	return time;
+}
+
+void
+write_stats(std::ostream &stream, const StatMap &stats, const char *indent)
+{
+	stream << "{";
+	for(StatMap::const_iterator i = stats.begin(); i != stats.end(); ++i)
+		stream << (i == stats.begin() ? "\n" : ",\n") << indent << "  "
+		       << quote(i->first)
+		       << ": { \"count\": " << i->second.count
+		       << ", \"time\": " << seconds(i->second.time) << " }";
+	stream << (stats.empty() ? "}" : String("\n") + indent + "}");
+}
+
+void
+write_histograms(std::ostream &stream, const Profile::HistogramMap &histograms, const char *indent)
+{
+	stream << "{";
+	for(Profile::HistogramMap::const_iterator i = histograms.begin(); i != histograms.end(); ++i) {
+		const Profile::Histogram &h = i->second;
+		int last = Profile::Histogram::BUCKETS_COUNT - 1;
+		while(last > 0 && !h.buckets[last]) --last;
+
+		stream << (i == histograms.begin() ? "\n" : ",\n") << indent << "  "
+		       << quote(i->first)
+		       << ": { \"count\": " << h.count
+		       << ", \"mean\": " << seconds((long long)h.get_mean())
+		       << ", \"min\": " << seconds(h.min)
+		       << ", \"max\": " << seconds(h.max)
+		       << ", \"p50\": " << seconds(h.get_percentile(0.5))
+		       << ", \"p90\": " << seconds(h.get_percentile(0.9))
+		       << ", \"p99\": " << seconds(h.get_percentile(0.99))
+		       << ", \"buckets\": [";
+		for(int j = 0; j <= last; ++j)
+			stream << (j ? ", " : "") << h.buckets[j];
+		stream << "] }";
+	}
+	stream << (histograms.empty() ? "}" : String("\n") + indent + "}");
+}
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+std::atomic<bool> Profile::enabled(false);
+
+Profile::Histogram::Histogram():
+	count(), total(), min(), max()
+{
+	for(int i = 0; i < BUCKETS_COUNT; ++i)
+		buckets[i] = 0;
+}
+
+int
+Profile::Histogram::get_bucket(long long duration)
+{
+	int bucket = 0;
+	while(duration > 0 && bucket < BUCKETS_COUNT - 1)
+		{ duration >>= 1; ++bucket; }
+	return bucket;
+}
+
+void
+Profile::Histogram::add(long long duration)
+{
+	if (duration < 0) duration = 0;
+	min = count ? std::min(min, duration) : duration;
+	max = count ? std::max(max, duration) : duration;
+	++count;
+	total += duration;
+	++buckets[get_bucket(duration)];
+}
+
+long long
+Profile::Histogram::get_percentile(double p) const
+{
+	if (!count) return 0;
+	long long limit = (long long)(p*count + 0.5);
+	if (limit < 1) limit = 1;
+	long long sum = 0;
+	for(int i = 0; i < BUCKETS_COUNT; ++i) {
+		sum += buckets[i];
+		if (sum >= limit)
+			return std::max(min, std::min(max, i ? 1ll << i : 0ll));
+	}
+	return max;
+}
+
+void
+Profile::enable()
+{
+	std::lock_guard<std::mutex> lock(buffers_mutex);
+	for(size_t i = 0; i < buffers.size(); ++i)
+		buffers[i]->cleared.store(buffers[i]->written.load(std::memory_order_acquire));
+	start_time.store(clock_microseconds());
+	enabled.store(true, std::memory_order_release);
+}
+
+void
+Profile::disable()
+	{ enabled.store(false, std::memory_order_release); }
+
+long long
+Profile::now()
+	{ return clock_microseconds() - start_time.load(std::memory_order_relaxed); }
+
+int
+Profile::get_frame()
+	{ return current_frame; }
+
+void
+Profile::set_frame(int frame)
+	{ current_frame = frame; }
+
+int
+Profile::get_job()
+	{ return current_job; }
+
+void
+Profile::set_job(int job)
+	{ current_job = job; }
+
+void
+Profile::set_job_name(int job, const String &name)
+{
+#ifndef SYNFIG_DISABLE_PROFILE
+	std::lock_guard<std::mutex> lock(job_names_mutex);
+	job_names[job] = name;
+#endif
+}
+
+long long
+Profile::begin_scope()
+{
+	++current_depth;
+	return now();
+}
+
+void
+Profile::end_scope(const char *name, const char *category, long long begin)
+{
+	long long end = now();
+	--current_depth;
+	add_event(name, category, begin, end);
+}
+
+void
+Profile::set_thread_name(const String &name)
+{
+#ifndef SYNFIG_DISABLE_PROFILE
+	current_name = name;
+	if (current_buffer) {
+		std::lock_guard<std::mutex> lock(current_buffer->name_mutex);
+		current_buffer->name = name;
+	}
+#endif
+}
+
+void
+Profile::add_event(const char *name, const char *category, long long begin, long long end)
+{
+#ifndef SYNFIG_DISABLE_PROFILE
+	if (!is_enabled()) return;
+
+	ThreadBuffer &buffer = get_buffer();
+	unsigned long long index = buffer.written.load(std::memory_order_relaxed);
+	Event &event = buffer.events[index % ThreadBuffer::SIZE];
+	event.name = name;
+	event.category = category;
+	event.job = current_job;
+	event.frame = current_frame;
+	event.depth = current_depth;
+	event.begin = begin;
+	event.end = end;
+	buffer.written.store(index + 1, std::memory_order_release);
+#endif
+}
+
+Profile::HistogramMap
+Profile::get_histograms(const char *category)
+{
+	HistogramMap histograms;
+	std::vector<ThreadEvents> threads = get_events();
+	for(std::vector<ThreadEvents>::const_iterator i = threads.begin(); i != threads.end(); ++i)
+		for(std::vector<Event>::const_iterator j = i->events.begin(); j != i->events.end(); ++j)
+			if (!category || !strcmp(j->category, category))
+				histograms[j->name].add(j->end - j->begin);
+	return histograms;
+}
+
+void
+Profile::write_chrome_trace(std::ostream &stream)
+{
+	std::vector<ThreadEvents> threads = get_events();
+
+	stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	bool first = true;
+	for(size_t i = 0; i < threads.size(); ++i) {
+		if (threads[i].events.empty()) continue;
+		stream << (first ? "\n" : ",\n")
+		       << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << i
+		       << ", \"args\": {\"name\": " << quote(threads[i].name) << "}}";
+		first = false;
+
+		const std::vector<Event> &events = threads[i].events;
+		for(std::vector<Event>::const_iterator j = events.begin(); j != events.end(); ++j) {
+			stream << ",\n{\"name\": " << quote(j->name)
+			       << ", \"cat\": " << quote(j->category)
+			       << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << i
+			       << ", \"ts\": " << j->begin
+			       << ", \"dur\": " << j->end - j->begin;
+			if (j->job >= 0 && j->frame >= 0)
+				stream << ", \"args\": {\"job\": " << j->job << ", \"frame\": " << j->frame << "}";
+			else
+			if (j->frame >= 0)
+				stream << ", \"args\": {\"frame\": " << j->frame << "}";
+			stream << "}";
+		}
+	}
+	stream << "\n]}\n";
+}
+
+void
+Profile::write_summary(std::ostream &stream)
+{
+	std::vector<ThreadEvents> threads = get_events();
+
+	long long duration = 0;
+	std::map<int, std::map<int, FrameStats> > jobs;
+	FrameStats total;
+	HistogramMap histograms;
+	for(std::vector<ThreadEvents>::const_iterator i = threads.begin(); i != threads.end(); ++i)
+		for(std::vector<Event>::const_iterator j = i->events.begin(); j != i->events.end(); ++j) {
+			duration = std::max(duration, j->end);
+			bool task = !strcmp(j->category, "task");
+			(task ? total.tasks : total.phases)[j->name].add(*j);
+			if (task)
+				histograms[j->name].add(j->end - j->begin);
+			if (j->frame >= 0) {
+				FrameStats &frame = jobs[j->job][j->frame];
+				(task ? frame.tasks : frame.phases)[j->name].add(*j);
+			}
+		}
+
+	stream << "{\n"
+	       << "  \"duration\": " << seconds(duration) << ",\n"
+	       << "  \"phases\": ";
+	write_stats(stream, total.phases, "  ");
+	stream << ",\n  \"tasks\": ";
+	write_stats(stream, total.tasks, "  ");
+	stream << ",\n  \"histograms\": ";
+	write_histograms(stream, histograms, "  ");
+
+	std::map<int, String> names;
+	{
+		std::lock_guard<std::mutex> lock(job_names_mutex);
+		names = job_names;
+	}
+
+	// events outside of jobs are in the job -1
+	stream << ",\n  \"jobs\": [";
+	for(std::map<int, std::map<int, FrameStats> >::const_iterator i = jobs.begin(); i != jobs.end(); ++i) {
+		stream << (i == jobs.begin() ? "\n" : ",\n")
+		       << "    { \"job\": " << i->first;
+		if (names.count(i->first))
+			stream << ", \"name\": " << quote(names[i->first]);
+		stream << ",\n      \"frames\": [";
+		const std::map<int, FrameStats> &frames = i->second;
+		for(std::map<int, FrameStats>::const_iterator j = frames.begin(); j != frames.end(); ++j) {
+			stream << (j == frames.begin() ? "\n" : ",\n")
+			       << "        { \"frame\": " << j->first << ",\n"
+			       << "          \"phases\": ";
+			write_stats(stream, j->second.phases, "          ");
+			stream << ",\n          \"tasks\": ";
+			write_stats(stream, j->second.tasks, "          ");
+			stream << " }";
+		}
+		stream << "\n      ] }";
+	}
+	stream << (jobs.empty() ? "]" : "\n  ]");
+
+	stream << ",\n  \"threads\": [";
+	bool first = true;
+	for(std::vector<ThreadEvents>::const_iterator i = threads.begin(); i != threads.end(); ++i) {
+		if (i->events.empty()) continue;
+		long long busy = busy_time(i->events);
+		stream << (first ? "\n" : ",\n")
+		       << "    { \"name\": " << quote(i->name)
+		       << ", \"events\": " << i->events.size()
+		       << ", \"dropped\": " << i->dropped
+		       << ", \"busy\": " << seconds(busy)
+		       << ", \"utilization\": " << (duration > 0 ? (double)busy/(double)duration : 0.0)
+		       << " }";
+		first = false;
+	}
+	stream << (first ? "]" : "\n  ]") << "\n}\n";
+}
@@ -0,0 +1,217 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file debug/profile.h
+**	\brief Recording of the rendering timings for the profiling output
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_DEBUG_PROFILE_H
+#define __SYNFIG_DEBUG_PROFILE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <atomic>
+#include <iosfwd>
+#include <map>
+
+#include <synfig/string.h>
+
+/* === M A C R O S ========================================================= */
+
+// Define SYNFIG_DISABLE_PROFILE (configure --disable-render-profiling)
+// to compile out the scopes, then they cost nothing even in the hot paths
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+namespace debug {
+
+//! Records the timings of rendering phases and tasks.
+//! Each thread appends events to its own ring buffer without locks,
+//! so the scopes may be placed in the hot paths of the render threads.
+//! Nothing is recorded while profiling is disabled, and the buffer
+//! of a thread is allocated only when it records its first event.
+//! When the buffer overflows the oldest events of the thread are dropped.
+//! Names and categories of events must be static strings
+//! (or names of rendering tokens), because only pointers are stored.
+class Profile
+{
+public:
+	struct Event
+	{
+		const char *name;
+		const char *category;
+		int job;         //!< rendered file, frames of several jobs have the same numbers
+		int frame;
+		int depth;       //!< count of the outer scopes of the same thread
+		long long begin; //!< microseconds from the enabling of profiling
+		long long end;
+
+		Event(): name(), category(), job(-1), frame(-1), depth(), begin(), end() { }
+	};
+
+	//! Distribution of durations of the events with the same name.
+	//! Bucket 0 counts zero durations, and bucket i counts
+	//! durations from 2^(i-1) to 2^i microseconds
+	struct Histogram
+	{
+		enum { BUCKETS_COUNT = 40 };
+
+		int count;
+		long long total;
+		long long min;
+		long long max;
+		int buckets[BUCKETS_COUNT];
+
+		Histogram();
+
+		void add(long long duration);
+		double get_mean() const
+			{ return count ? (double)total/(double)count : 0.0; }
+		//! Returns the upper bound of the bucket where the part \a p (0..1) of durations is reached
+		long long get_percentile(double p) const;
+
+		static int get_bucket(long long duration);
+	};
+
+	typedef std::map<String, Histogram> HistogramMap;
+
+	//! Records the time of the scope as the event of the current thread
+	class Scope
+	{
+	private:
+		Scope(const Scope&);
+		Scope& operator= (const Scope&);
+
+#ifdef SYNFIG_DISABLE_PROFILE
+	public:
+		Scope(const char*, const char*) { }
+#else
+		const char *name;
+		const char *category;
+		long long begin;
+
+	public:
+		Scope(const char *name, const char *category):
+			name(), category(), begin()
+		{
+			if (is_enabled())
+				{ this->name = name; this->category = category; begin = begin_scope(); }
+		}
+		~Scope()
+			{ if (name) end_scope(name, category, begin); }
+#endif
+	};
+
+	//! Sets the frame of the events recorded by the current thread inside the scope
+	class FrameScope
+	{
+	private:
+		FrameScope(const FrameScope&);
+		FrameScope& operator= (const FrameScope&);
+
+#ifdef SYNFIG_DISABLE_PROFILE
+	public:
+		explicit FrameScope(int) { }
+#else
+		int prev_frame;
+
+	public:
+		explicit FrameScope(int frame):
+			prev_frame(get_frame()) { set_frame(frame); }
+		~FrameScope()
+			{ set_frame(prev_frame); }
+#endif
+	};
+
+	//! Sets the job of the events recorded by the current thread inside the scope.
+	//! The \a name (usually the output file) is written into the profiling output
+	class JobScope
+	{
+	private:
+		JobScope(const JobScope&);
+		JobScope& operator= (const JobScope&);
+
+#ifdef SYNFIG_DISABLE_PROFILE
+	public:
+		explicit JobScope(int, const String& = String()) { }
+#else
+		int prev_job;
+
+	public:
+		explicit JobScope(int job, const String &name = String()):
+			prev_job(get_job())
+		{
+			if (!name.empty()) set_job_name(job, name);
+			set_job(job);
+		}
+		~JobScope()
+			{ set_job(prev_job); }
+#endif
+	};
+
+private:
+	static std::atomic<bool> enabled;
+
+	static void set_frame(int frame);
+	static void set_job(int job);
+	static long long begin_scope();
+	static void end_scope(const char *name, const char *category, long long begin);
+
+public:
+	//! Drops the recorded events and starts recording
+	static void enable();
+	static void disable();
+	static bool is_enabled()
+		{ return enabled.load(std::memory_order_acquire); }
+
+	//! Returns microseconds from the enabling of profiling
+	static long long now();
+
+	static int get_frame();
+	static int get_job();
+	//! Name of the job in the profiling output
+	static void set_job_name(int job, const String &name);
+	//! Name of the current thread in the profiling output, doesn't allocate the buffer
+	static void set_thread_name(const String &name);
+
+	//! Adds the event to the buffer of the current thread
+	static void add_event(const char *name, const char *category, long long begin, long long end);
+
+	//! Returns histograms of event durations by event name,
+	//! only events of the \a category are counted if it is set
+	static HistogramMap get_histograms(const char *category = nullptr);
+
+	//! Writes events in the Chrome trace format (chrome://tracing, Perfetto)
+	static void write_chrome_trace(std::ostream &stream);
+	//! Writes JSON with the time of each phase and task type per frame of each job,
+	//! histograms of durations of each task type, and the utilization of each thread
+	static void write_summary(std::ostream &stream);
+};
+
+}; // END of namespace debug
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
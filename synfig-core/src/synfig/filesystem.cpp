@@ -85,6 +85,21 @@ int FileSystem::ReadStream::underflow()
 	return std::streambuf::traits_type::to_int_type(*gptr());
 }
 
+std::streamsize
+FileSystem::ReadStream::xsgetn(char *s, std::streamsize n)
+{
+	// read whole blocks instead of char by char, but take the pending char first
+	if (n <= 0) return 0;
+	std::streamsize count = 0;
+	if (gptr() < egptr())
+	{
+		*s = *gptr();
+		setg(&buffer_ + 1, &buffer_ + 1, &buffer_ + 1);
+		++count;
+	}
+	return count + (std::streamsize)internal_read(s + count, (size_t)(n - count));
+}
+
 // WriteStream
 
 FileSystem::WriteStream::WriteStream(FileSystem::Handle file_system):
@@ -99,6 +114,13 @@ FileSystem::WriteStream::overflow(int character)
 	return character != EOF && sizeof(c) == internal_write(&c, sizeof(c)) ? character : EOF;
 }
 
+std::streamsize
+FileSystem::WriteStream::xsputn(const char *s, std::streamsize n)
+{
+	// stream has no buffer, so pass whole blocks instead of writing char by char
+	return n > 0 ? (std::streamsize)internal_write(s, (size_t)n) : 0;
+}
+
 // Identifier
 
 FileSystem::ReadStream::Handle FileSystem::Identifier::get_read_stream() const
@@ -80,6 +80,7 @@ namespace synfig
 
 			ReadStream(FileSystem::Handle file_system);
 			virtual int underflow();
+			virtual std::streamsize xsgetn(char *s, std::streamsize n);
 			virtual size_t internal_read(void *buffer, size_t size) = 0;
 
 		public:
@@ -102,6 +103,7 @@ namespace synfig
 		protected:
 			WriteStream(FileSystem::Handle file_system);
 	        virtual int overflow(int ch);
+			virtual std::streamsize xsputn(const char *s, std::streamsize n);
 			virtual size_t internal_write(const void *buffer, size_t size) = 0;
 
 		public:
@@ -0,0 +1,532 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file framecache.cpp
+**	\brief Persistent on-disk cache of rendered frames
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <ETL/stringf>
+
+#include "framecache.h"
+
+#include "blinepoint.h"
+#include "bone.h"
+#include "canvas.h"
+#include "canvasfilenaming.h"
+#include "context.h"
+#include "dashitem.h"
+#include "filesystemnative.h"
+#include "general.h"
+#include "gradient.h"
+#include "guid.h"
+#include "layer.h"
+#include "renddesc.h"
+#include "segment.h"
+#include "transformation.h"
+#include "value.h"
+#include "widthpoint.h"
+#include "zstreambuf.h"
+
+#include "rendering/software/surfacesw.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+namespace {
+
+struct Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	int32_t width;
+	int32_t height;
+	uint64_t packed_size;
+};
+
+const char magic[8] = { 'S', 'I', 'F', 'F', 'R', 'A', 'M', 'E' };
+const uint32_t byte_order = 0x01020304;
+
+//! Feeds the canvas state into SHA1 checksum
+class Hasher
+{
+public:
+	GChecksum *checksum;
+	const ContextParams &context_params;
+	std::set<const Canvas*> visited;
+
+	Hasher(const ContextParams &context_params):
+		checksum(g_checksum_new(G_CHECKSUM_SHA1)),
+		context_params(context_params) { }
+	~Hasher() { g_checksum_free(checksum); }
+
+	String get_string() const { return g_checksum_get_string(checksum); }
+
+	void add(const void *data, size_t size)
+		{ g_checksum_update(checksum, (const guchar*)data, size); }
+	void add(const String &x)
+		{ add_int((int)x.size()); add(x.c_str(), x.size()); }
+	void add_int(int x) { add(&x, sizeof(x)); }
+	void add_real(Real x) { add(&x, sizeof(x)); }
+	void add_vector(const Vector &x) { add_real(x[0]); add_real(x[1]); }
+	void add_color(const Color &x)
+		{ add_real(x.get_r()); add_real(x.get_g()); add_real(x.get_b()); add_real(x.get_a()); }
+	void add_matrix(const Matrix &x)
+	{
+		add_real(x.m00); add_real(x.m01); add_real(x.m02);
+		add_real(x.m10); add_real(x.m11); add_real(x.m12);
+		add_real(x.m20); add_real(x.m21); add_real(x.m22);
+	}
+
+	void add_file(const Canvas &canvas, const String &filename)
+	{
+		// content of the referenced file is not hashed, only its size and modification time
+		String full = CanvasFileNaming::make_full_filename(canvas.get_file_name(), filename);
+		GStatBuf buf;
+		if (g_stat(full.c_str(), &buf) == 0)
+		{
+			add_real((Real)buf.st_size);
+			add_real((Real)buf.st_mtime);
+		}
+	}
+
+	void add_value(const Canvas &canvas, const ValueBase &value)
+	{
+		Type &type = value.get_type();
+		add(type.description.name);
+
+		if (type == type_bool)
+			add_int(value.get(bool()) ? 1 : 0);
+		else
+		if (type == type_integer)
+			add_int(value.get(int()));
+		else
+		if (type == type_angle)
+			add_real(Angle::rad(value.get(Angle())).get());
+		else
+		if (type == type_time)
+			add_real((Real)value.get(Time()));
+		else
+		if (type == type_real)
+			add_real(value.get(Real()));
+		else
+		if (type == type_vector)
+			add_vector(value.get(Vector()));
+		else
+		if (type == type_color)
+			add_color(value.get(Color()));
+		else
+		if (type == type_string)
+			add(value.get(String()));
+		else
+		if (type == type_matrix)
+			add_matrix(value.get(Matrix()));
+		else
+		if (type == type_segment)
+		{
+			const Segment &x = value.get(Segment());
+			add_vector(x.p1); add_vector(x.t1); add_vector(x.p2); add_vector(x.t2);
+		}
+		else
+		if (type == type_bline_point)
+		{
+			const BLinePoint &x = value.get(BLinePoint());
+			add_vector(x.get_vertex());
+			add_vector(x.get_tangent1());
+			add_vector(x.get_tangent2());
+			add_real(x.get_width());
+			add_real(x.get_origin());
+			add_int( (x.get_split_tangent_radius() ? 1 : 0)
+			       | (x.get_split_tangent_angle() ? 2 : 0)
+			       | (x.get_boned_vertex_flag() ? 4 : 0) );
+		}
+		else
+		if (type == type_width_point)
+		{
+			const WidthPoint &x = value.get(WidthPoint());
+			add_real(x.get_position());
+			add_real(x.get_width());
+			add_int(x.get_side_type_before());
+			add_int(x.get_side_type_after());
+			add_real(x.get_lower_bound());
+			add_real(x.get_upper_bound());
+		}
+		else
+		if (type == type_dash_item)
+		{
+			const DashItem &x = value.get(DashItem());
+			add_real(x.get_offset());
+			add_real(x.get_length());
+			add_int(x.get_side_type_before());
+			add_int(x.get_side_type_after());
+		}
+		else
+		if (type == type_transformation)
+		{
+			const Transformation &x = value.get(Transformation());
+			add_vector(x.offset);
+			add_real(Angle::rad(x.angle).get());
+			add_real(Angle::rad(x.skew_angle).get());
+			add_vector(x.scale);
+		}
+		else
+		if (type == type_gradient)
+		{
+			const Gradient &x = value.get(Gradient());
+			for(Gradient::const_iterator i = x.begin(); i != x.end(); ++i)
+				{ add_real(i->pos); add_color(i->color); }
+		}
+		else
+		if (type == type_bone_object)
+		{
+			const Bone &x = value.get(Bone());
+			add_matrix(x.get_animated_matrix());
+			add_real(x.get_width());
+			add_real(x.get_tipwidth());
+			add_real(x.get_length());
+		}
+		else
+		if (type == type_list)
+		{
+			const ValueBase::List &list = value.get_list();
+			add_int((int)list.size());
+			for(ValueBase::List::const_iterator i = list.begin(); i != list.end(); ++i)
+				add_value(canvas, *i);
+		}
+		else
+		if (type == type_canvas)
+		{
+			Canvas::Handle sub_canvas = value.get(Canvas::Handle());
+			if (sub_canvas)
+				add_canvas(*sub_canvas);
+		}
+		else
+		{
+			add(value.get_string());
+		}
+	}
+
+	void add_canvas(const Canvas &canvas)
+	{
+		// canvas may be pasted several times, its state is the same every time
+		if (!visited.insert(&canvas).second)
+			{ add_int(-1); return; }
+
+		add_real((Real)canvas.get_time());
+		add_real(canvas.get_outline_grow());
+		for(Canvas::const_iterator i = canvas.begin(); i != canvas.end(); ++i)
+		{
+			const Layer &layer = **i;
+			if (!layer.active()) continue;
+			if (layer.get_exclude_from_rendering() && !context_params.render_excluded_contexts) continue;
+
+			add(layer.get_name());
+			add(layer.get_version());
+			Layer::ParamList params = layer.get_param_list();
+			for(Layer::ParamList::const_iterator j = params.begin(); j != params.end(); ++j)
+			{
+				add(j->first);
+				add_value(canvas, j->second);
+				if (j->first == "filename" && j->second.get_type() == type_string)
+					add_file(canvas, j->second.get(String()));
+			}
+		}
+		add_int(-2);
+	}
+};
+
+String
+get_cache_dir()
+{
+	const char *dir = getenv("SYNFIG_FRAME_CACHE_DIR");
+	return dir ? String(dir) : String();
+}
+
+String
+get_cache_filename(const String &key)
+	{ return get_cache_dir() + ETL_DIRECTORY_SEPARATOR + key + ".sifframe"; }
+
+//! Tracks the total size of cache files and removes least recently used ones
+class CacheSize
+{
+private:
+	struct Entry
+	{
+		String filename;
+		time_t mtime;
+		long long size;
+		bool operator<(const Entry &other) const
+			{ return mtime < other.mtime; }
+	};
+
+	std::mutex mutex;
+	long long size;  //!< total size of cache files, -1 if not counted yet
+	long long limit; //!< -1 if not read from environment yet
+
+	static long long scan(std::vector<Entry> *entries)
+	{
+		long long size = 0;
+		String dir = get_cache_dir();
+		GDir *gdir = g_dir_open(dir.c_str(), 0, nullptr);
+		if (!gdir) return 0;
+		while(const gchar *name = g_dir_read_name(gdir))
+		{
+			String filename = dir + ETL_DIRECTORY_SEPARATOR + name;
+			GStatBuf buf;
+			if (etl::filename_extension(filename) != ".sifframe" || g_stat(filename.c_str(), &buf))
+				continue;
+			size += buf.st_size;
+			if (entries)
+				entries->push_back(Entry{filename, buf.st_mtime, (long long)buf.st_size});
+		}
+		g_dir_close(gdir);
+		return size;
+	}
+
+	long long get_limit_unlocked()
+	{
+		if (limit < 0)
+		{
+			const char *megabytes = getenv("SYNFIG_FRAME_CACHE_SIZE");
+			limit = std::max(0LL, (megabytes ? atoll(megabytes) : 1024LL)*1024*1024);
+		}
+		return limit;
+	}
+
+public:
+	CacheSize(): size(-1), limit(-1) { }
+
+	long long get_limit()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return get_limit_unlocked();
+	}
+
+	void set_limit(long long x)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		limit = std::max(0LL, x);
+	}
+
+	//! Counts the new file, and removes old files if the limit is exceeded, except of \a filename
+	void add(const String &filename, long long file_size)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (size < 0)
+			size = scan(nullptr);
+		else
+			size += file_size;
+
+		long long max_size = get_limit_unlocked();
+		if (!max_size || size <= max_size)
+			return;
+
+		// other processes may share the directory, so count the files again,
+		// and free a quarter of the limit, to not scan on every save
+		std::vector<Entry> entries;
+		size = scan(&entries);
+		std::sort(entries.begin(), entries.end());
+		for(std::vector<Entry>::const_iterator i = entries.begin(); i != entries.end() && size > max_size - max_size/4; ++i)
+			if (i->filename != filename && !g_remove(i->filename.c_str()))
+				size -= i->size;
+	}
+};
+
+CacheSize cache_size;
+
+} // END of anonymous namespace
+
+bool
+FrameCache::is_enabled()
+{
+	static bool enabled = !get_cache_dir().empty()
+	                   && FileSystemNative::instance()->is_directory(get_cache_dir());
+	return enabled;
+}
+
+String
+FrameCache::get_canvas_hash(const Canvas &canvas, const ContextParams &context_params)
+{
+	Hasher hasher(context_params);
+	hasher.add_int(format_version);
+	hasher.add_int(context_params.z_range ? 1 : 0);
+	hasher.add_real(context_params.z_range_position);
+	hasher.add_real(context_params.z_range_depth);
+	hasher.add_real(context_params.z_range_blur);
+	hasher.add_canvas(canvas);
+	return hasher.get_string();
+}
+
+String
+FrameCache::get_frame_key(const String &canvas_hash, const RendDesc &desc, const String &engine)
+{
+	Hasher hasher((ContextParams()));
+	hasher.add(canvas_hash);
+	hasher.add_int(desc.get_w());
+	hasher.add_int(desc.get_h());
+	hasher.add_vector(desc.get_tl());
+	hasher.add_vector(desc.get_br());
+	hasher.add_real(desc.get_outline_grow());
+	hasher.add_int(desc.get_antialias());
+	hasher.add(engine);
+	return hasher.get_string();
+}
+
+long long
+FrameCache::get_size_limit()
+	{ return cache_size.get_limit(); }
+
+void
+FrameCache::set_size_limit(long long size)
+	{ cache_size.set_limit(size); }
+
+bool
+FrameCache::contains(const String &key)
+	{ return is_enabled() && g_file_test(get_cache_filename(key).c_str(), G_FILE_TEST_IS_REGULAR); }
+
+bool
+FrameCache::load(const String &key, const SurfaceResource::Handle &surface)
+{
+	if (!is_enabled() || !surface)
+		return false;
+
+	String filename = get_cache_filename(key);
+	gchar *data = nullptr;
+	gsize size = 0;
+	if (!g_file_get_contents(filename.c_str(), &data, &size, nullptr))
+		return false;
+
+	bool success = false;
+	bool broken = true;
+	const Header *header = (const Header*)data;
+	VectorInt surface_size = surface->get_size();
+	// size of the frame is a part of the key, so a file of other size is broken too
+	if ( size >= sizeof(Header)
+	  && !memcmp(header->magic, magic, sizeof(magic))
+	  && header->version == format_version
+	  && header->byte_order == byte_order
+	  && header->width == surface_size[0]
+	  && header->height == surface_size[1]
+	  && header->packed_size == size - sizeof(Header) )
+	{
+		SurfaceResource::LockWrite<SurfaceSW> lock(surface);
+		if (lock)
+		{
+			synfig::Surface &s = lock->get_surface();
+			size_t pixels_size = sizeof(Color)*s.get_w()*s.get_h();
+			if (s.get_w() == header->width && s.get_h() == header->height && s.get_pitch() == (int)sizeof(Color)*s.get_w())
+			{
+				success = pixels_size == zstreambuf::unpack(&s[0][0], pixels_size, data + sizeof(Header), header->packed_size);
+				broken = !success;
+			}
+			else broken = false;
+		}
+		else broken = false;
+	}
+	g_free(data);
+
+	if (success)
+		g_utime(filename.c_str(), nullptr); // mark as recently used
+	else
+	if (broken)
+		g_remove(filename.c_str());
+	return success;
+}
+
+bool
+FrameCache::save(const String &key, const SurfaceResource::Handle &surface)
+{
+	if (!is_enabled() || !surface)
+		return false;
+
+	SurfaceResource::LockRead<SurfaceSW> lock(surface);
+	if (!lock)
+		return false;
+
+	const synfig::Surface &s = lock->get_surface();
+	if (!s.is_valid() || s.get_pitch() != (int)sizeof(Color)*s.get_w())
+		return false;
+
+	size_t pixels_size = sizeof(Color)*s.get_w()*s.get_h();
+	std::vector<char> buffer(sizeof(Header) + pixels_size + pixels_size/100 + 1024);
+	size_t packed_size = zstreambuf::pack(&buffer[sizeof(Header)], buffer.size() - sizeof(Header), &s[0][0], pixels_size, true);
+	if (!packed_size)
+		return false;
+
+	Header &header = *(Header*)&buffer.front();
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = format_version;
+	header.byte_order = byte_order;
+	header.width = s.get_w();
+	header.height = s.get_h();
+	header.packed_size = packed_size;
+
+	// write into temporary file and rename it, concurrent renders may store the same frame
+	FileSystem::Handle file_system = FileSystemNative::instance();
+	String filename = get_cache_filename(key);
+	String tmp_filename = filename + "." + GUID().get_string() + ".tmp";
+	{
+		FileSystem::WriteStream::Handle stream = file_system->get_write_stream(tmp_filename);
+		if (!stream || !stream->write_whole_block(&buffer.front(), sizeof(Header) + packed_size))
+		{
+			stream.reset();
+			file_system->file_remove(tmp_filename);
+			synfig::warning("FrameCache: cannot write cache file: %s", filename.c_str());
+			return false;
+		}
+	}
+
+	if (!file_system->file_rename(tmp_filename, filename))
+	{
+		file_system->file_remove(tmp_filename);
+		return false;
+	}
+
+	cache_size.add(filename, sizeof(Header) + packed_size);
+	return true;
+}
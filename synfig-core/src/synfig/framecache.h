@@ -0,0 +1,92 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file framecache.h
+**	\brief Persistent on-disk cache of rendered frames
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_FRAMECACHE_H
+#define __SYNFIG_FRAMECACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include "string.h"
+#include "rendering/surface.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+
+class Canvas;
+class ContextParams;
+class RendDesc;
+
+//! Persistent on-disk cache of rendered frames
+/*! Frames are keyed by the content hash of the canvas state at the current
+ *  time (types and parameters of all the rendered layers, recursively into
+ *  inline and exported canvases, modification times of the referenced files),
+ *  plus the frame time, the rendering rectangle and the engine name.
+ *  So after an edit only frames whose content has changed are rendered again.
+ *
+ *  The cache is enabled when SYNFIG_FRAME_CACHE_DIR environment variable
+ *  points to an existing directory. Frames are stored gzipped. When the total
+ *  size of cache files exceeds the limit (SYNFIG_FRAME_CACHE_SIZE environment
+ *  variable, in megabytes, 1024 by default), the least recently used frames
+ *  are removed. */
+class FrameCache
+{
+public:
+	enum { format_version = 1 };
+
+	//! Returns true if SYNFIG_FRAME_CACHE_DIR is set
+	static bool is_enabled();
+
+	//! Returns the content hash of the canvas state at its current time
+	static String get_canvas_hash(const Canvas &canvas, const ContextParams &context_params);
+
+	//! Returns the key of the frame (or part of frame) described by \a desc
+	static String get_frame_key(const String &canvas_hash, const RendDesc &desc, const String &engine);
+
+	//! Returns the limit of the total size of cache files in bytes, zero means no limit
+	static long long get_size_limit();
+	//! Sets the limit of the total size of cache files in bytes, zero means no limit
+	static void set_size_limit(long long size);
+
+	//! Returns true if the frame is stored in the cache, the file isn't read
+	static bool contains(const String &key);
+
+	//! Fills already created \a surface from the cache
+	/*! \return false if frame is not cached or has another size */
+	static bool load(const String &key, const rendering::SurfaceResource::Handle &surface);
+
+	//! Stores rendered \a surface into the cache and removes old frames beyond the size limit
+	static bool save(const String &key, const rendering::SurfaceResource::Handle &surface);
+}; // END of class FrameCache
+
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
@@ -39,6 +39,7 @@
 #include <algorithm>
 #include <functional>
 #include <map>
+#include <mutex>
 
 #include <glibmm.h>
 
@@ -65,9 +66,22 @@ using namespace synfig;
 Importer::Book* synfig::Importer::book_;
 
 static std::map<FileSystem::Identifier,Importer::LooseHandle> *__open_importers;
+static std::mutex __open_importers_mutex;
 
 /* === P R O C E D U R E S ================================================= */
 
+//! Returns the open importer of the file, __open_importers_mutex must be locked
+static Importer*
+find_open_locked(const FileSystem::Identifier &identifier)
+{
+	std::map<FileSystem::Identifier,Importer::LooseHandle>::iterator i = __open_importers->find(identifier);
+	// importer is removed from the list under this lock when it loses the last reference (see unref()),
+	// so the reference may be safely added by the caller
+	if (i == __open_importers->end() || !i->second || !i->second->count())
+		return nullptr;
+	return i->second.get();
+}
+
 /* === M E T H O D S ======================================================= */
 
 bool
@@ -105,11 +119,9 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 
 	// If we already have an importer open under that filename,
 	// then use it instead.
-	if(__open_importers->count(identifier))
-	{
-		//synfig::info("Found importer already open, using it...");
-		return (*__open_importers)[identifier];
-	}
+	Importer::Handle importer = find_open(identifier);
+	if (importer)
+		return importer;
 
 	if(filename_extension(identifier.filename) == "")
 	{
@@ -128,21 +140,36 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 		return nullptr;
 	}
 
+	// importer is created without lock, constructors may be slow
 	try {
-		Importer::Handle importer;
 		importer=Importer::book()[ext].factory(identifier);
-		(*__open_importers)[identifier]=importer;
-		return importer;
 	}
 	catch (const String& str)
 	{
 		synfig::error(str);
+		return nullptr;
 	}
-	return nullptr;
+
+	// other thread may open the same file meanwhile, then use its importer,
+	// the check and the insertion are done under the same lock;
+	// our importer is destroyed after the lock is released (it's declared before the lock)
+	std::lock_guard<std::mutex> lock(__open_importers_mutex);
+	if (Importer *opened = find_open_locked(identifier))
+		return opened;
+	(*__open_importers)[identifier]=importer;
+	return importer;
+}
+
+Importer::Handle
+Importer::find_open(const FileSystem::Identifier &identifier)
+{
+	std::lock_guard<std::mutex> lock(__open_importers_mutex);
+	return find_open_locked(identifier);
 }
 
 void Importer::forget(const FileSystem::Identifier &identifier)
 {
+	std::lock_guard<std::mutex> lock(__open_importers_mutex);
 	__open_importers->erase(identifier);
 }
 
@@ -155,20 +182,40 @@ Importer::Importer(const FileSystem::Identifier &identifier):
 Importer::~Importer()
 {
 	// Remove ourselves from the open importer list
+	std::lock_guard<std::mutex> lock(__open_importers_mutex);
 	std::map<FileSystem::Identifier,Importer::LooseHandle>::iterator iter;
 	for(iter=__open_importers->begin();iter!=__open_importers->end();)
 		if(iter->second==this)
 			__open_importers->erase(iter++); else ++iter;
 }
 
+bool
+Importer::unref() const
+{
+	{
+		std::lock_guard<std::mutex> lock(__open_importers_mutex);
+		if (shared_object::unref_inactive())
+			return true;
+		std::map<FileSystem::Identifier,Importer::LooseHandle>::iterator i = __open_importers->find(identifier);
+		if (i != __open_importers->end() && i->second == this)
+			__open_importers->erase(i);
+	}
+	#ifdef ETL_SELF_DELETING_SHARED_OBJECT
+	delete this;
+	#endif
+	return false;
+}
+
 rendering::Surface::Handle
-Importer::get_frame(const RendDesc & /* renddesc */, const Time &time)
+Importer::get_frame(const RendDesc &renddesc, const Time &time)
 {
+	// still image is decoded once, and the other callers wait for it
+	std::lock_guard<std::mutex> lock(last_surface_mutex_);
 	if (last_surface_ && last_surface_->is_exists() && !is_animated())
 		return last_surface_;
 
 	Surface surface;
-	if(!get_frame(surface, RendDesc(), time))
+	if(!get_frame(surface, renddesc, time))
 		warning(strprintf("Unable to get frame from \"%s\"", identifier.filename.c_str()));
 
 	const char *s = getenv("SYNFIG_PACK_IMAGES");
@@ -31,6 +31,7 @@
 /* === H E A D E R S ======================================================= */
 
 #include <map>
+#include <mutex>
 
 #include <ETL/handle>
 
@@ -144,8 +145,13 @@ public:
 	typedef etl::handle<const Importer> ConstHandle;
 
 private:
+	//! Guards last_surface_, the importer is shared between all jobs
+	//! and render threads which import the same file
+	std::mutex last_surface_mutex_;
 	rendering::Surface::Handle last_surface_;
 
+	static Handle find_open(const FileSystem::Identifier &identifier);
+
 protected:
 
 	Importer(const FileSystem::Identifier &identifier);
@@ -155,6 +161,10 @@ public:
 
 	virtual ~Importer();
 
+	//! Drops the last reference under the lock of the list of open importers,
+	//! so open() never returns the importer which is being destroyed
+	virtual bool unref() const;
+
 	//! Gets a frame and puts it into \a surface
 	/*!	\param	surface Reference to surface to put frame into
 	**	\param	time	For animated importers, determines which frame to get.
@@ -170,7 +180,8 @@ public:
 	//! Returns \c true if the importer pays attention to the \a time parameter of get_frame()
 	virtual bool is_animated() { return false; }
 
-	//! Attempts to open \a filename, and returns a handle to the associated Importer
+	//! Attempts to open \a filename, and returns a handle to the associated Importer.
+	//! Thread-safe, the same Importer is shared between all callers.
 	static Handle open(const FileSystem::Identifier &identifier, bool force=false);
 	static void forget(const FileSystem::Identifier &identifier);
 };
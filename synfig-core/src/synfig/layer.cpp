@@ -94,6 +94,8 @@ static struct _LayerCounter
 	}
 } _layer_counter;
 
+static std::atomic<long long> _layer_rendering_snapshot_counter(0);
+
 //int _LayerCounter::counter(0);
 
 /* === P R O C E D U R E S ================================================= */
@@ -168,7 +170,8 @@ Layer::Layer():
 	exclude_from_rendering_(false),
 	param_z_depth(Real(0.0f)),
 	time_mark(Time::end()),
-	outline_grow_mark(0.0)
+	outline_grow_mark(0.0),
+	rendering_snapshot_amount_(1.0)
 {
 	_layer_counter.counter++;
 	SET_INTERPOLATION_DEFAULTS();
@@ -890,23 +893,69 @@ rendering::Task::Handle
 Layer::build_rendering_task_vfunc(Context context)const
 {
 	rendering::TaskLayer::Handle task = new rendering::TaskLayer();
-	// TODO: This is not thread-safe
-	//task->layer = const_cast<Layer*>(this);//clone(NULL);
-	task->layer = clone(NULL);
-	task->layer->set_canvas(get_canvas());
+	task->layer = get_rendering_snapshot(Context::z_depth_visibility(context.get_params(), *this));
+	task->sub_task() = context.build_rendering_task();
+	return task;
+}
+
+Layer::Handle
+Layer::get_rendering_snapshot(Real amount)const
+{
+	ParamList param_list(get_param_list());
 
-	Real amount = Context::z_depth_visibility(context.get_params(), *this);
-	if (approximate_not_equal(amount, 1.0) && task->layer.type_is<Layer_Composite>())
+	std::lock_guard<std::mutex> lock(rendering_snapshot_mutex_);
+	if ( rendering_snapshot_
+	  && rendering_snapshot_->get_canvas() == get_canvas()
+	  && rendering_snapshot_->active() == active()
+	  && rendering_snapshot_->optimized() == optimized()
+	  && rendering_snapshot_->get_exclude_from_rendering() == get_exclude_from_rendering()
+	  && rendering_snapshot_->get_time_mark() == get_time_mark()
+	  && rendering_snapshot_->get_outline_grow_mark() == get_outline_grow_mark()
+	  && approximate_equal(rendering_snapshot_amount_, amount)
+	  && rendering_snapshot_params_ == param_list )
+		return rendering_snapshot_;
+
+	// inline canvases should be duplicated, so do the full clone for such layers
+	bool has_canvas = false;
+	for(ParamList::const_iterator i = param_list.begin(); i != param_list.end(); ++i)
+		if (i->second.get_type() == type_canvas)
+			{ has_canvas = true; break; }
+
+	Handle snapshot;
+	if (has_canvas || !book().count(get_name()))
 	{
-		//task->layer = task->layer->clone(NULL);
-		etl::handle<Layer_Composite> composite = etl::handle<Layer_Composite>::cast_dynamic(task->layer);
+		snapshot = clone(NULL);
+		if (!snapshot) return Handle();
+	}
+	else
+	{
+		snapshot = create(get_name()).get();
+		snapshot->set_active(active());
+		snapshot->set_optimized(optimized());
+		snapshot->set_exclude_from_rendering(get_exclude_from_rendering());
+		snapshot->set_time_mark(get_time_mark());
+		snapshot->set_outline_grow_mark(get_outline_grow_mark());
+		snapshot->set_param_list(param_list);
+	}
+	snapshot->set_canvas(get_canvas());
+
+	if (approximate_not_equal(amount, 1.0) && snapshot.type_is<Layer_Composite>())
+	{
+		etl::handle<Layer_Composite> composite = etl::handle<Layer_Composite>::cast_dynamic(snapshot);
 		composite->set_amount( composite->get_amount()*amount );
 	}
 
-	task->sub_task() = context.build_rendering_task();
-	return task;
+	++_layer_rendering_snapshot_counter;
+	rendering_snapshot_ = snapshot;
+	rendering_snapshot_params_.swap(param_list);
+	rendering_snapshot_amount_ = amount;
+	return snapshot;
 }
 
+long long
+Layer::get_rendering_snapshot_count()
+	{ return _layer_rendering_snapshot_counter; }
+
 rendering::Task::Handle
 Layer::build_rendering_task(Context context)const
 {
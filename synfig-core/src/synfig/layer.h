@@ -33,6 +33,7 @@
 /* === H E A D E R S ======================================================= */
 
 #include <map>
+#include <mutex>
 
 #include <ETL/handle>
 
@@ -306,6 +307,13 @@ private:
 	mutable Time time_mark;
 	mutable Real outline_grow_mark;
 
+	//! Copy of the layer shared by rendering tasks, see get_rendering_snapshot()
+	mutable Handle rendering_snapshot_;
+	//! Parameters and amount which was used to build the rendering snapshot
+	mutable ParamList rendering_snapshot_params_;
+	mutable Real rendering_snapshot_amount_;
+	mutable std::mutex rendering_snapshot_mutex_;
+
 	//! Contains the name of the group that this layer belongs to
 	String group_;
 
@@ -646,6 +654,20 @@ public:
 	//! Duplicates the Layer without duplicating the value nodes
 	virtual Handle simple_clone()const;
 
+	//! Returns the immutable copy of the layer state to render it in other threads
+	/*! The copy holds only the current values of the parameters, without
+	**  animation nodes, and it is reused by rendering tasks of next frames
+	**  while parameters, flags and time marks of the layer stay unchanged.
+	**  So static layers are copied once.
+	**  Layers with canvas parameters are still fully cloned.
+	**	\param amount	multiplier of the amount parameter of Layer_Composite
+	**	\see get_rendering_snapshot_count()
+	*/
+	Handle get_rendering_snapshot(Real amount = 1.0)const;
+
+	//! Returns how many times layers was copied for rendering since the program start
+	static long long get_rendering_snapshot_count();
+
 	//! Connects the parameter to another Value Node
 	virtual bool connect_dynamic_param(const String& param, etl::loose_handle<ValueNode>);
 
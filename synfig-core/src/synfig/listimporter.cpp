@@ -33,12 +33,19 @@
 #	include <config.h>
 #endif
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+#include <sigc++/bind.h>
+
 #include "listimporter.h"
 
 #include "general.h"
 #include <synfig/localization.h>
 
 #include "filesystemnative.h"
+#include "threadpool.h"
 #include <synfig/rendering/software/surfacesw.h>
 
 
@@ -50,7 +57,10 @@ using namespace synfig;
 
 /* === M A C R O S ========================================================= */
 
-#define LIST_IMPORTER_CACHE_SIZE	20
+//! Memory limit for decoded images, in bytes
+#define LIST_IMPORTER_CACHE_SIZE	(512*1024*1024)
+//! Count of next images to decode in background
+#define LIST_IMPORTER_PREFETCH	8
 
 /* === G L O B A L S ======================================================= */
 
@@ -62,10 +72,158 @@ SYNFIG_IMPORTER_SET_SUPPORTS_FILE_SYSTEM_WRAPPER(ListImporter, false);
 
 /* === P R O C E D U R E S ================================================= */
 
+/* === C L A S S E S ======================================================= */
+
+//! Decoded images by filename, shared with background jobs,
+//! so it stays alive while jobs are queued.
+class ListImporter::Cache
+{
+private:
+	enum State {
+		STATE_QUEUED,  //!< background job is queued, but not started yet
+		STATE_LOADING, //!< decoding now
+		STATE_LOADED
+	};
+
+	struct Entry {
+		rendering::Surface::Handle surface;
+		State state;
+		long long last_access;
+		Entry(): state(STATE_LOADING), last_access() { }
+	};
+
+	typedef std::map<String, Entry> Map;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	Map entries;
+	size_t size;
+	long long access_counter;
+	int last_frame;
+	int direction;
+
+	static rendering::Surface::Handle load(const String &filename, ProgressCallback *cb)
+	{
+		Importer::Handle importer(Importer::open(FileSystem::Identifier(FileSystemNative::instance(), filename)));
+		if (!importer)
+		{
+			if(cb)cb->error(_("Unable to open ")+filename);
+			else synfig::error(_("Unable to open ")+filename);
+			return rendering::Surface::Handle();
+		}
+		return importer->get_frame(RendDesc(), 0);
+	}
+
+	//! Stores loaded surface and removes the least recently used ones
+	//! while memory limit is exceeded. Should be called under lock.
+	void store(const String &filename, const rendering::Surface::Handle &surface)
+	{
+		if (!surface)
+		{
+			entries.erase(filename);
+			return;
+		}
+
+		Entry &entry = entries[filename];
+		entry.surface = surface;
+		entry.state = STATE_LOADED;
+		size += surface->get_buffer_size();
+
+		while(size > LIST_IMPORTER_CACHE_SIZE)
+		{
+			Map::iterator oldest = entries.end();
+			for(Map::iterator i = entries.begin(); i != entries.end(); ++i)
+				if ( i->second.state == STATE_LOADED
+				  && i->first != filename
+				  && (oldest == entries.end() || i->second.last_access < oldest->second.last_access) )
+					oldest = i;
+			if (oldest == entries.end())
+				break;
+			size -= oldest->second.surface->get_buffer_size();
+			entries.erase(oldest);
+		}
+	}
+
+	static void load_job(const std::shared_ptr<Cache> &cache, const String &filename)
+	{
+		std::unique_lock<std::mutex> lock(cache->mutex);
+		Map::iterator i = cache->entries.find(filename);
+		// image is already claimed by the waiting caller
+		if (i == cache->entries.end() || i->second.state != STATE_QUEUED)
+			return;
+		i->second.state = STATE_LOADING;
+		lock.unlock();
+
+		rendering::Surface::Handle surface = load(filename, NULL);
+		lock.lock();
+		cache->store(filename, surface);
+		cache->cond.notify_all();
+	}
+
+public:
+	Cache(): size(), access_counter(), last_frame(-1), direction(1) { }
+
+	rendering::Surface::Handle get(const String &filename, ProgressCallback *cb)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true)
+		{
+			Map::iterator i = entries.find(filename);
+			// not requested yet, or the background job is not started,
+			// then decode it here instead of waiting for the free thread
+			if (i == entries.end() || i->second.state == STATE_QUEUED)
+				break;
+			if (i->second.state == STATE_LOADED)
+			{
+				i->second.last_access = ++access_counter;
+				return i->second.surface;
+			}
+			// already decoding in background,
+			// the caller may be the thread of pool, so let pool run other threads meanwhile
+			ThreadPool::instance().wait(cond, lock);
+		}
+
+		Entry &entry = entries[filename];
+		entry.state = STATE_LOADING;
+		entry.last_access = ++access_counter;
+		lock.unlock();
+		rendering::Surface::Handle surface = load(filename, cb);
+		lock.lock();
+		store(filename, surface);
+		cond.notify_all();
+		return surface;
+	}
+
+	//! Queues decoding of next images after \a frame in the direction of playback
+	void prefetch(const std::shared_ptr<Cache> &self, const std::vector<String> &filename_list, int frame)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (last_frame >= 0 && frame != last_frame)
+			direction = frame > last_frame ? 1 : -1;
+		last_frame = frame;
+
+		for(int i = 1; i <= LIST_IMPORTER_PREFETCH; ++i)
+		{
+			int f = frame + i*direction;
+			if (f < 0 || f >= (int)filename_list.size())
+				break;
+			const String &filename = filename_list[f];
+			if (entries.count(filename))
+				continue;
+			Entry &entry = entries[filename];
+			entry.state = STATE_QUEUED;
+			entry.last_access = ++access_counter;
+			ThreadPool::instance().enqueue( sigc::bind(
+				sigc::ptr_fun(&Cache::load_job), self, filename ));
+		}
+	}
+};
+
 /* === M E T H O D S ======================================================= */
 
 ListImporter::ListImporter(const FileSystem::Identifier &identifier):
-Importer(identifier)
+Importer(identifier),
+cache(new Cache())
 {
 	fps=15;
 
@@ -156,8 +314,8 @@ Importer(identifier)
 
 ListImporter::~ListImporter() = default;
 
-Importer::Handle
-ListImporter::get_sub_importer(const RendDesc &renddesc, Time time, ProgressCallback *cb)
+rendering::Surface::Handle
+ListImporter::get_sub_frame(const RendDesc &renddesc, Time time, ProgressCallback *cb)
 {
 	float document_fps=renddesc.get_frame_rate();
 	int document_frame=etl::round_to_int(time*document_fps);
@@ -167,43 +325,32 @@ ListImporter::get_sub_importer(const RendDesc &renddesc, Time time, ProgressCall
 	{
 		if (cb) cb->error(_("No images in list"));
 		else synfig::error(_("No images in list"));
-		return Importer::Handle();
+		return rendering::Surface::Handle();
 	}
 
 	if(frame<0)frame=0;
 	if(frame>=(signed)filename_list.size())frame=filename_list.size()-1;
 
-	const String &filename = filename_list[frame];
-	Importer::Handle importer(Importer::open(FileSystem::Identifier(FileSystemNative::instance(), filename)));
-	if(!importer)
-	{
-		if(cb)cb->error(_("Unable to open ")+filename);
-		else synfig::error(_("Unable to open ")+filename);
-		return Importer::Handle();
-	}
-
-	for(std::list<Importer::Handle>::iterator i = frame_cache.begin(); i != frame_cache.end();)
-		if (*i == importer) i = frame_cache.erase(i); else ++i;
-
-	while (frame_cache.size() >= LIST_IMPORTER_CACHE_SIZE)
-		frame_cache.pop_front();
-	frame_cache.push_back(importer);
-
-	return importer;
+	rendering::Surface::Handle surface = cache->get(filename_list[frame], cb);
+	cache->prefetch(cache, filename_list, frame);
+	return surface;
 }
 
 bool
 ListImporter::get_frame(Surface &surface, const RendDesc &renddesc, Time time, ProgressCallback *cb)
 {
-	Importer::Handle importer = get_sub_importer(renddesc, time, cb);
-	return importer && importer->get_frame(surface, renddesc, 0, cb);
+	rendering::Surface::Handle sub_surface = get_sub_frame(renddesc, time, cb);
+	if (!sub_surface || !sub_surface->is_exists())
+		return false;
+	surface.set_wh(sub_surface->get_width(), sub_surface->get_height());
+	return sub_surface->get_pixels(&surface[0][0]);
 }
 
 rendering::Surface::Handle
 ListImporter::get_frame(const RendDesc &renddesc, const Time &time)
 {
-	Importer::Handle importer = get_sub_importer(renddesc, time, NULL);
-	return importer ? importer->get_frame(renddesc, 0) : new rendering::SurfaceSW();
+	rendering::Surface::Handle surface = get_sub_frame(renddesc, time, NULL);
+	return surface ? surface : new rendering::SurfaceSW();
 }
 
 bool
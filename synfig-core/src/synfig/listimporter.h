@@ -33,8 +33,8 @@
 
 #include "importer.h"
 #include "surface.h"
+#include <memory>
 #include <vector>
-#include <list>
 
 /* === M A C R O S ========================================================= */
 
@@ -45,17 +45,23 @@
 namespace synfig {
 
 /*!	\class ListImporter
-**	\todo Write more detailed description
+**	\brief Imports image sequence listed in the text file.
+**
+**	Decoded images are kept in the cache with limited memory size,
+**	next images in the direction of playback are decoded in background
+**	by the ThreadPool.
 */
 class ListImporter : public Importer
 {
 	SYNFIG_IMPORTER_MODULE_EXT
 private:
+	class Cache;
+
 	float fps;
 	std::vector<String> filename_list;
-	std::list<Importer::Handle> frame_cache;
+	std::shared_ptr<Cache> cache;
 
-	Importer::Handle get_sub_importer(const RendDesc &renddesc, Time time, ProgressCallback *cb);
+	rendering::Surface::Handle get_sub_frame(const RendDesc &renddesc, Time time, ProgressCallback *cb);
 
 public:
 	ListImporter(const FileSystem::Identifier &identifier);
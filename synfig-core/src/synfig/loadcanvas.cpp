@@ -40,6 +40,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 
 #include <iostream>
 #include <map>
@@ -47,6 +48,7 @@
 #include <stdexcept>
 
 #include <libxml++/libxml++.h>
+#include <libxml/xmlreader.h>
 #include <sigc++/bind.h>
 
 #include "loadcanvas.h"
@@ -56,6 +58,7 @@
 
 #include "blur.h"
 #include "boneweightpair.h"
+#include "canvasfilenaming.h"
 #include "dashitem.h"
 #include "exception.h"
 #include "importer.h"
@@ -139,8 +142,8 @@ static void _canvas_file_name_changed(Canvas *x)
 	canvas_map[x] = etl::absolute_path(x->get_file_name());
 }
 
-Canvas::Handle
-synfig::open_canvas_as(const FileSystem::Identifier &identifier,const String &as,String &errors,String &warnings)
+static Canvas::Handle
+_open_canvas_as(const FileSystem::Identifier &identifier,const String &as,String &errors,String &warnings,bool use_cache)
 {
 	String filename = FileSystem::fix_slashes(as);
 	if (CanvasParser::loading_.count(identifier))
@@ -160,6 +163,7 @@ synfig::open_canvas_as(const FileSystem::Identifier &identifier,const String &as
 	Canvas::Handle canvas;
 	CanvasParser parser;
 	parser.set_allow_errors(true);
+	parser.set_use_cache(use_cache);
 
 	try
 	{
@@ -184,6 +188,14 @@ synfig::open_canvas_as(const FileSystem::Identifier &identifier,const String &as
 	return canvas;
 }
 
+Canvas::Handle
+synfig::open_canvas_as(const FileSystem::Identifier &identifier,const String &as,String &errors,String &warnings)
+	{ return _open_canvas_as(identifier, as, errors, warnings, false); }
+
+Canvas::Handle
+synfig::open_canvas_cached_as(const FileSystem::Identifier &identifier,const String &as,String &errors,String &warnings)
+	{ return _open_canvas_as(identifier, as, errors, warnings, true); }
+
 /* === M E T H O D S ======================================================= */
 
 void
@@ -3122,8 +3134,9 @@ CanvasParser::parse_layer(xmlpp::Element *element,Canvas::Handle canvas)
 }
 
 Canvas::Handle
-CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename)
+CanvasParser::parse_canvas_attributes(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,const String &filename,bool &existing)
 {
+	existing=false;
 
 	if(element->get_name()!="canvas")
 	{
@@ -3170,7 +3183,10 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	{
 		GUID guid(element->get_attribute("guid")->get_value());
 		if(guid_cast<Canvas>(guid))
+		{
+			existing=true;
 			return guid_cast<Canvas>(guid);
+		}
 		else
 			canvas->set_guid(guid);
 	}
@@ -3289,152 +3305,149 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	}
 
 	canvas->rend_desc().set_flags(RendDesc::PX_ASPECT|RendDesc::IM_SPAN);
+	return canvas;
+}
 
-	list<ValueNode::Handle> bone_list;
-	xmlpp::Element::NodeList list = element->get_children();
-	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+void
+CanvasParser::parse_canvas_child(xmlpp::Element *child,Canvas::Handle canvas,std::list<ValueNode::Handle> &bone_list)
+{
+	if(child->get_name()=="defs")
 	{
-		xmlpp::Element *child(dynamic_cast<xmlpp::Element*>(*iter));
-		if(child)
+		if(canvas->is_inline())
+			error(child,_("Group canvases cannot have a <defs> section"));
+		parse_canvas_defs(child, canvas);
+	}
+	else
+	if(child->get_name()=="bones")
+	{
+		if(canvas->is_inline())
+			error(child,_("Inline canvas cannot have a <bones> section"));
+		bone_list = parse_canvas_bones(child, canvas);
+	}
+	else
+	if(child->get_name()=="keyframe")
+	{
+		if(canvas->is_inline())
 		{
-			if(child->get_name()=="defs")
-			{
-				if(canvas->is_inline())
-					error(child,_("Group canvases cannot have a <defs> section"));
-				parse_canvas_defs(child, canvas);
-			}
-			else
-			if(child->get_name()=="bones")
-			{
-				if(canvas->is_inline())
-					error(child,_("Inline canvas cannot have a <bones> section"));
-				bone_list = parse_canvas_bones(child, canvas);
-			}
-			else
-			if(child->get_name()=="keyframe")
-			{
-				if(canvas->is_inline())
-				{
-					warning(child,_("Group canvases cannot have keyframes"));
-					continue;
-				}
+			warning(child,_("Group canvases cannot have keyframes"));
+			return;
+		}
 
-				canvas->keyframe_list().add(parse_keyframe(child,canvas));
-				canvas->keyframe_list().sync();
-			}
-			else
-			if(child->get_name()=="meta")
-			{
-				if(canvas->is_inline())
-				{
-					warning(child,_("Group canvases cannot have metadata"));
-					continue;
-				}
+		canvas->keyframe_list().add(parse_keyframe(child,canvas));
+		canvas->keyframe_list().sync();
+	}
+	else
+	if(child->get_name()=="meta")
+	{
+		if(canvas->is_inline())
+		{
+			warning(child,_("Group canvases cannot have metadata"));
+			return;
+		}
 
-				if(!child->get_attribute("name"))
-				{
-					warning(child,_("<meta> must have a name"));
-					continue;
-				}
+		if(!child->get_attribute("name"))
+		{
+			warning(child,_("<meta> must have a name"));
+			return;
+		}
 
-				if(!child->get_attribute("content"))
-				{
-					warning(child,_("<meta> must have content"));
-					continue;
-				}
-				
-				// In Synfig prior to version 1.0 we have messed decimal separator:
-				// some files use ".", but other ones use ","/
-				// Let's try to put a workaround for that.
-				std::vector<String> replacelist;
-				replacelist.push_back("background_first_color");
-				replacelist.push_back("background_second_color");
-				replacelist.push_back("background_size");
-				replacelist.push_back("grid_color");
-				replacelist.push_back("grid_size");
-				replacelist.push_back("jack_offset");
-				String content;
-				content=child->get_attribute("content")->get_value();
-				if(std::find(replacelist.begin(), replacelist.end(), child->get_attribute("name")->get_value()) != replacelist.end()) 
-				{
-					size_t index = 0;
-					while (true) {
-					     /* Locate the substring to replace. */
-					     index = content.find(",", index);
-					     if (index == string::npos) break;
+		if(!child->get_attribute("content"))
+		{
+			warning(child,_("<meta> must have content"));
+			return;
+		}
+		
+		// In Synfig prior to version 1.0 we have messed decimal separator:
+		// some files use ".", but other ones use ","/
+		// Let's try to put a workaround for that.
+		std::vector<String> replacelist;
+		replacelist.push_back("background_first_color");
+		replacelist.push_back("background_second_color");
+		replacelist.push_back("background_size");
+		replacelist.push_back("grid_color");
+		replacelist.push_back("grid_size");
+		replacelist.push_back("jack_offset");
+		String content;
+		content=child->get_attribute("content")->get_value();
+		if(std::find(replacelist.begin(), replacelist.end(), child->get_attribute("name")->get_value()) != replacelist.end()) 
+		{
+			size_t index = 0;
+			while (true) {
+			     /* Locate the substring to replace. */
+			     index = content.find(",", index);
+			     if (index == string::npos) break;
 
-					     /* Make the replacement. */
-					     content.replace(index, 1, ".");
+			     /* Make the replacement. */
+			     content.replace(index, 1, ".");
 
-					     /* Advance index forward so the next iteration doesn't pick it up as well. */
-					     index += 1;
-					}
-					
-				}
-				canvas->set_meta_data(child->get_attribute("name")->get_value(),content);
+			     /* Advance index forward so the next iteration doesn't pick it up as well. */
+			     index += 1;
 			}
-			else if(child->get_name()=="name")
-			{
-				xmlpp::Element::NodeList list = child->get_children();
+			
+		}
+		canvas->set_meta_data(child->get_attribute("name")->get_value(),content);
+	}
+	else if(child->get_name()=="name")
+	{
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any name, warn
-				if(list.empty())
-					warning(child,_("blank \"name\" entity"));
+		// If we don't have any name, warn
+		if(list.empty())
+			warning(child,_("blank \"name\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_name(tmp);
-			}
-			else
-			if(child->get_name()=="desc")
-			{
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_name(tmp);
+	}
+	else
+	if(child->get_name()=="desc")
+	{
 
-				xmlpp::Element::NodeList list = child->get_children();
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any description, warn
-				if(list.empty())
-					warning(child,_("blank \"desc\" entity"));
+		// If we don't have any description, warn
+		if(list.empty())
+			warning(child,_("blank \"desc\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_description(tmp);
-			}
-			else
-			if(child->get_name()=="author")
-			{
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_description(tmp);
+	}
+	else
+	if(child->get_name()=="author")
+	{
 
-				xmlpp::Element::NodeList list = child->get_children();
+		xmlpp::Element::NodeList list = child->get_children();
 
-				// If we don't have any description, warn
-				if(list.empty())
-					warning(child,_("blank \"author\" entity"));
+		// If we don't have any description, warn
+		if(list.empty())
+			warning(child,_("blank \"author\" entity"));
 
-				string tmp;
-				for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
-					if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
-				canvas->set_author(tmp);
-			}
-			else
-			if(child->get_name()=="layer")
-			{
-				//if(canvas->is_inline())
-				//	canvas->push_front(parse_layer(child,canvas->parent()));
-				//else
-					canvas->push_front(parse_layer(child,canvas));
-			}
-			else
-			{
-				printf("%s:%d\n", __FILE__, __LINE__);
-				error_unexpected_element(child,child->get_name());
-			}
-		}
-//		else
-//		if((child->get_name()=="text"||child->get_name()=="comment") && child->has_child_text())
-//			continue;
+		string tmp;
+		for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+			if(dynamic_cast<xmlpp::TextNode*>(*iter))tmp+=dynamic_cast<xmlpp::TextNode*>(*iter)->get_content();
+		canvas->set_author(tmp);
 	}
+	else
+	if(child->get_name()=="layer")
+	{
+		//if(canvas->is_inline())
+		//	canvas->push_front(parse_layer(child,canvas->parent()));
+		//else
+			canvas->push_front(parse_layer(child,canvas));
+	}
+	else
+	{
+		printf("%s:%d\n", __FILE__, __LINE__);
+		error_unexpected_element(child,child->get_name());
+	}
+}
 
+void
+CanvasParser::parse_canvas_finish(xmlpp::Element *element,Canvas::Handle canvas)
+{
 	if(canvas->value_node_list().placeholder_count())
 	{
 		String nodes;
@@ -3451,6 +3464,125 @@ CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool in
 	}
 
 	canvas->set_version(CURRENT_CANVAS_VERSION);
+}
+
+Canvas::Handle
+CanvasParser::parse_canvas(xmlpp::Element *element,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,String filename)
+{
+	bool existing;
+	Canvas::Handle canvas = parse_canvas_attributes(element, parent, inline_, identifier, filename, existing);
+	if (!canvas || existing)
+		return canvas;
+
+	std::list<ValueNode::Handle> bone_list;
+	xmlpp::Element::NodeList list = element->get_children();
+	for(xmlpp::Element::NodeList::iterator iter = list.begin(); iter != list.end(); ++iter)
+		if (xmlpp::Element *child = dynamic_cast<xmlpp::Element*>(*iter))
+			parse_canvas_child(child, canvas, bone_list);
+
+	parse_canvas_finish(element, canvas);
+	return canvas;
+}
+
+namespace {
+	int
+	xml_read_stream(void *context, char *buffer, int len)
+	{
+		std::istream &stream = *static_cast<std::istream*>(context);
+		stream.read(buffer, len);
+		return stream.bad() ? -1 : (int)stream.gcount();
+	}
+
+	//! Owns the xmlTextReader and the libxml++ wrappers attached to the streamed nodes
+	class StreamReaderGuard
+	{
+	public:
+		xmlTextReaderPtr reader;
+		xmlNodePtr root;
+
+		explicit StreamReaderGuard(xmlTextReaderPtr reader): reader(reader), root() { }
+		~StreamReaderGuard()
+		{
+			if (root) xmlpp::Node::free_wrappers(root);
+			if (reader) xmlFreeTextReader(reader);
+		}
+	};
+
+	xmlpp::Element*
+	wrap_element(xmlNodePtr node)
+	{
+		xmlpp::Node::create_wrapper(node);
+		return static_cast<xmlpp::Element*>(node->_private);
+	}
+
+	void
+	throw_reader_error(const String &filename)
+	{
+		const xmlError *e = xmlGetLastError();
+		if (e && e->message)
+			throw runtime_error(strprintf("%s:%d: %s", filename.c_str(), e->line, String(e->message).c_str()));
+		throw runtime_error(filename + ": " + _("XML parse error"));
+	}
+}
+
+Canvas::Handle
+CanvasParser::parse_canvas_stream(std::istream &stream,const FileSystem::Identifier &identifier,const String &filename,CanvasCache::Builder *cache)
+{
+	// Only the <canvas> root element with its attributes and one top-level child
+	// (a layer, the <defs> section, a keyframe...) are kept in memory at a time.
+	// Every child is expanded into a small DOM subtree, parsed by the regular
+	// element parsers, and then released by the reader when it moves past it.
+	StreamReaderGuard guard(xmlReaderForIO(xml_read_stream, NULL, &stream, filename.c_str(), NULL, 0));
+	if (!guard.reader)
+		throw runtime_error(String("  * ") + _("Can't open file") + " \"" + identifier.filename + "\"");
+
+	int ret;
+	while ((ret = xmlTextReaderRead(guard.reader)) == 1)
+		if (xmlTextReaderNodeType(guard.reader) == XML_READER_TYPE_ELEMENT)
+			break;
+	if (ret != 1)
+		throw_reader_error(filename);
+
+	guard.root = xmlTextReaderCurrentNode(guard.reader);
+	xmlpp::Element *element = wrap_element(guard.root);
+	if (cache)
+		cache->set_root(*element);
+
+	bool existing;
+	Canvas::Handle canvas = parse_canvas_attributes(element, 0, false, identifier, filename, existing);
+	if (!canvas || existing)
+		return canvas;
+
+	std::list<ValueNode::Handle> bone_list;
+	if (!xmlTextReaderIsEmptyElement(guard.reader))
+	{
+		ret = xmlTextReaderRead(guard.reader);
+		while (ret == 1 && xmlTextReaderDepth(guard.reader) > 0)
+		{
+			if (xmlTextReaderDepth(guard.reader) == 1 && xmlTextReaderNodeType(guard.reader) == XML_READER_TYPE_ELEMENT)
+			{
+				xmlNodePtr node = xmlTextReaderExpand(guard.reader);
+				if (!node)
+					throw_reader_error(filename);
+				xmlpp::Element *child = wrap_element(node);
+				if (cache)
+					cache->add_child(*child);
+				parse_canvas_child(child, canvas, bone_list);
+				xmlpp::Node::free_wrappers(node);
+				ret = xmlTextReaderNext(guard.reader);
+			}
+			else
+			{
+				ret = xmlTextReaderRead(guard.reader);
+			}
+		}
+		if (ret == -1)
+			throw_reader_error(filename);
+	}
+	if (cache)
+		cache->finish();
+
+	parse_canvas_finish(element, canvas);
 	return canvas;
 }
 
@@ -3477,6 +3609,60 @@ CanvasParser::show_canvas_map(String file, int line, String text)
 }
 #endif	// _DEBUG
 
+Canvas::Handle
+CanvasParser::parse_canvas_cached(FileSystem::ReadStream::Handle stream,const FileSystem::Identifier &identifier,const String &filename)
+{
+	const String cache_filename = CanvasCache::get_cache_filename(filename);
+
+	// the key is the raw file content, so the check doesn't need to unpack .sifz,
+	// and the file is read for it only if its size or modification time are changed
+	CanvasCache::Stamp stamp;
+	const bool has_stamp = CanvasCache::get_stamp(identifier, stamp);
+	String source_hash;
+	{
+		xmlpp::Document document;
+		bool stamp_changed;
+		std::function<String()> get_source_hash = [&]() {
+			if (source_hash.empty() && stream) {
+				source_hash = CanvasCache::get_source_hash(stream);
+				stream = identifier.get_read_stream();
+			}
+			return source_hash;
+		};
+		if (CanvasCache::load(cache_filename, stamp, get_source_hash, document, stamp_changed))
+		{
+			stream.reset();
+			xmlpp::Element *root = document.get_root_node();
+			if (stamp_changed && has_stamp)
+				CanvasCache::save(cache_filename, stamp, source_hash, *root);
+			return parse_canvas(root,0,false,identifier,filename);
+		}
+	}
+	if (!stream)
+		throw runtime_error(String("  * ") + _("Can't open file") + " \"" + identifier.filename + "\"");
+
+	// cache is stale, so stream the document through the parser,
+	// and collect the element tree and the key for the cache on the way
+	CanvasCache::HashReadStream::Handle hash_stream;
+	if (source_hash.empty())
+	{
+		hash_stream = new CanvasCache::HashReadStream(stream);
+		stream = FileSystem::ReadStream::Handle(hash_stream.get());
+	}
+	if (filename_extension(identifier.filename) == ".sifz")
+		stream = FileSystem::ReadStream::Handle(new ZReadStream(stream));
+
+	CanvasCache::Builder builder;
+	Canvas::Handle canvas = parse_canvas_stream(*stream,identifier,filename,&builder);
+	if (hash_stream)
+		source_hash = hash_stream->finish();
+	stream.reset();
+
+	if (canvas)
+		builder.save(cache_filename, stamp, source_hash);
+	return canvas;
+}
+
 Canvas::Handle
 CanvasParser::parse_from_file_as(const FileSystem::Identifier &identifier,const String &as,String &errors)
 {
@@ -3498,34 +3684,51 @@ CanvasParser::parse_from_file_as(const FileSystem::Identifier &identifier,const
 		FileSystem::ReadStream::Handle stream = identifier.get_read_stream();
 		if (stream)
 		{
-			if (filename_extension(identifier.filename) == ".sifz")
-				stream = FileSystem::ReadStream::Handle(new ZReadStream(stream));
-
-			xmlpp::DomParser parser;
-			parser.parse_stream(*stream);
-			stream.reset();
-			if(parser)
+			Canvas::Handle canvas;
+			// cache files are stored next to plain files only, not into containers
+			if (use_cache_ && !CanvasFileNaming::is_container_filename(as))
 			{
-				Canvas::Handle canvas(parse_canvas(parser.get_document()->get_root_node(),0,false,identifier,as));
-				if (!canvas) return canvas;
-				register_canvas_in_map(canvas, as);
-
-				const ValueNodeList& value_node_list(canvas->value_node_list());
+				canvas = parse_canvas_cached(stream,identifier,as);
+				stream.reset();
+			}
+			else
+			{
+				if (filename_extension(identifier.filename) == ".sifz")
+					stream = FileSystem::ReadStream::Handle(new ZReadStream(stream));
 
-				again:
-				ValueNodeList::const_iterator iter;
-				for(iter=value_node_list.begin();iter!=value_node_list.end();++iter)
+				if (getenv("SYNFIG_LOADER_USE_DOM"))
 				{
-					ValueNode::Handle value_node(*iter);
-					if(value_node->is_exported() && value_node->get_id().find("Unnamed")==0)
-					{
-						canvas->remove_value_node(value_node, true);
-						goto again;
-					}
+					xmlpp::DomParser parser;
+					parser.parse_stream(*stream);
+					stream.reset();
+					if(parser)
+						canvas = parse_canvas(parser.get_document()->get_root_node(),0,false,identifier,as);
+				}
+				else
+				{
+					canvas = parse_canvas_stream(*stream,identifier,as);
+					stream.reset();
 				}
+			}
+
+			if (!canvas) return canvas;
+			register_canvas_in_map(canvas, as);
+
+			const ValueNodeList& value_node_list(canvas->value_node_list());
 
-				return canvas;
+			again:
+			ValueNodeList::const_iterator iter;
+			for(iter=value_node_list.begin();iter!=value_node_list.end();++iter)
+			{
+				ValueNode::Handle value_node(*iter);
+				if(value_node->is_exported() && value_node->get_id().find("Unnamed")==0)
+				{
+					canvas->remove_value_node(value_node, true);
+					goto again;
+				}
 			}
+
+			return canvas;
 		} else {
 			throw runtime_error(String("  * ") + _("Can't find linked file") + " \"" + identifier.filename + "\"");
 		}
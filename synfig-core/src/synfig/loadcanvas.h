@@ -32,8 +32,11 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <iosfwd>
+
 #include "string.h"
 #include "canvas.h"
+#include "canvascache.h"
 #include "valuenode.h"
 #include "vector.h"
 #include "value.h"
@@ -77,6 +80,8 @@ private:
     int total_errors_;
 	//! True if errors doesn't stop canvas parsing
 	bool allow_errors_;
+	//! True if file is loaded through the binary cache
+	bool use_cache_;
 	//! File name to parse
 	String filename;
 	//! Path of the file name to parse
@@ -101,6 +106,7 @@ public:
 		total_warnings_	(0),
 		total_errors_	(0),
 		allow_errors_	(false),
+		use_cache_		(false),
 		in_bones_section(false)
 	{ }
 
@@ -113,6 +119,10 @@ public:
 	//! Sets allow errors variable
 	CanvasParser &set_allow_errors(bool x) { allow_errors_=x; return *this; }
 
+	//! Enables loading through the binary canvas cache
+	/*!	\see CanvasCache */
+	CanvasParser &set_use_cache(bool x) { use_cache_=x; return *this; }
+
 	//! Sets the maximum number of warnings before a fatal error is thrown
 	CanvasParser &set_max_warnings(int i) { max_warnings_=i; return *this; }
 
@@ -167,6 +177,22 @@ private:
 	//! Unexpected element error handling function
 	void error_unexpected_element(xmlpp::Node *node,const String &got);
 
+	//! Canvas attributes Parsing Function (creates the canvas and sets up its RendDesc)
+	/*! \param existing is set to true when the canvas was already loaded (found by guid) */
+	Canvas::Handle parse_canvas_attributes(xmlpp::Element *node,Canvas::Handle parent,bool inline_,const FileSystem::Identifier &identifier,const String &filename,bool &existing);
+	//! Canvas child element Parsing Function (defs, bones, keyframes, metadata, layers, ...)
+	/*! \param bone_list receives the parsed bones, the caller keeps them alive till the
+	 *  end of the canvas, because the bone map refers to them by loose handles only */
+	void parse_canvas_child(xmlpp::Element *node,Canvas::Handle canvas,std::list<ValueNode::Handle> &bone_list);
+	//! Checks performed after all children of the canvas are parsed
+	void parse_canvas_finish(xmlpp::Element *node,Canvas::Handle canvas);
+	//! Streaming root Canvas Parsing Function
+	/*! Reads the document with xmlTextReader, so only one top-level child
+	 *  of the root canvas is materialized as DOM at a time.
+	 *  The elements are also passed into \a cache, if it's given */
+	Canvas::Handle parse_canvas_stream(std::istream &stream,const FileSystem::Identifier &identifier,const String &filename,CanvasCache::Builder *cache = NULL);
+	//! Loads the document from the binary cache if it is up to date, or parses the file and updates the cache
+	Canvas::Handle parse_canvas_cached(FileSystem::ReadStream::Handle stream,const FileSystem::Identifier &identifier,const String &filename);
 	//! Canvas Parsing Function
 	Canvas::Handle parse_canvas(xmlpp::Element *node,Canvas::Handle parent=0,bool inline_=false,const FileSystem::Identifier &identifier = FileSystemNative::instance()->get_identifier(std::string()),String path=".");
 	//! Canvas definitions Parsing Function (exported value nodes and exported canvases)
@@ -248,6 +274,10 @@ extern Canvas::Handle open_canvas(xmlpp::Element* node,String &errors,String &wa
 //!	Loads a canvas from \a filename and its absolute path
 /*!	\return	The Canvas's handle on success, an empty handle on failure */
 extern Canvas::Handle open_canvas_as(const FileSystem::Identifier &identifier,const String &as,String &errors,String &warnings);
+//!	Loads a canvas like open_canvas_as(), but reads the parsed document from
+//!	the binary cache when it is up to date and updates the cache otherwise
+/*!	\return	The Canvas's handle on success, an empty handle on failure */
+extern Canvas::Handle open_canvas_cached_as(const FileSystem::Identifier &identifier,const String &as,String &errors,String &warnings);
 
 //! Returns the Open Canvases Map.
 //! \see open_canvas_map_
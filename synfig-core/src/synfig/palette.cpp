@@ -38,11 +38,17 @@
 #include "surface.h"
 #include "general.h"
 #include "filesystemnative.h"
+#include "threadpool.h"
 #include <synfig/localization.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
+#include <sigc++/bind.h>
+
 #endif
 
 /* === U S I N G =========================================================== */
@@ -57,6 +63,11 @@ using namespace synfig;
 #define PALETTE_GIMP_FILE_COOKIE "GIMP Palette"
 #define PALETTE_GIMP_EXT ".gpl"
 
+//! Bits per channel of colors in the histogram (and depth of octree)
+#define PALETTE_HISTOGRAM_BITS 5
+//! Count of k-means passes after octree reduction
+#define PALETTE_KMEANS_PASSES 3
+
 /* === G L O B A L S ======================================================= */
 
 bool weight_less_than(const PaletteItem& lhs,const PaletteItem& rhs)
@@ -76,6 +87,134 @@ bool luma_less_than(const PaletteItem& lhs,const float& rhs)
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+//! Sum of colors of the pixels
+struct Bin
+{
+	double r, g, b, a;
+	long long count;
+
+	Bin(): r(), g(), b(), a(), count() { }
+
+	void add(const Color &color)
+		{ r += color.get_r(); g += color.get_g(); b += color.get_b(); a += color.get_a(); ++count; }
+	void add(const Bin &x)
+		{ r += x.r; g += x.g; b += x.b; a += x.a; count += x.count; }
+	Color get_color() const
+		{ return count ? Color(r/count, g/count, b/count, a/count) : Color(); }
+};
+
+typedef std::vector<Bin> Histogram;
+
+//! Node of octree. Bits of channels are interleaved in key,
+//! so key of the parent node is key >> 3
+struct Leaf
+{
+	int key;
+	int depth;
+	Bin bin;
+	Leaf(): key(), depth() { }
+};
+
+bool leaf_less_than(const Leaf &lhs, const Leaf &rhs)
+	{ return lhs.key < rhs.key; }
+
+int
+get_key(const Color &color)
+{
+	const int max = (1 << PALETTE_HISTOGRAM_BITS) - 1;
+	int r = std::max(0, std::min(max, (int)round(color.get_r()*max)));
+	int g = std::max(0, std::min(max, (int)round(color.get_g()*max)));
+	int b = std::max(0, std::min(max, (int)round(color.get_b()*max)));
+	int key = 0;
+	for(int i = PALETTE_HISTOGRAM_BITS - 1; i >= 0; --i)
+		key = (key << 3) | (((r >> i)&1) << 2) | (((g >> i)&1) << 1) | ((b >> i)&1);
+	return key;
+}
+
+//! Collects histogram of the band of surface rows
+struct HistogramBuilder
+{
+	const Surface *surface;
+	int begin, end;
+	Histogram histogram;
+	long long transparent;
+
+	HistogramBuilder(): surface(), begin(), end(), transparent() { }
+
+	void run()
+	{
+		histogram.resize(1 << (3*PALETTE_HISTOGRAM_BITS));
+		for(int y = begin; y < end; ++y)
+			for(int x = 0; x < surface->get_w(); ++x)
+			{
+				const Color &color = (*surface)[y][x];
+				if (color.get_a() <= 0)
+					++transparent;
+				else
+					histogram[get_key(color)].add(color);
+			}
+	}
+};
+
+//! Merges the leaves from deepest level of octree,
+//! the rarest colors first, until count of leaves exceeds \a max_count
+void
+reduce(std::vector<Leaf> &leaves, int max_count)
+{
+	for(int level = PALETTE_HISTOGRAM_BITS - 1; level >= 0 && (int)leaves.size() > max_count; --level)
+	{
+		// keys of all leaves to the level below the current one
+		for(std::vector<Leaf>::iterator i = leaves.begin(); i != leaves.end(); ++i)
+			i->key >>= 3*(i->depth - level - 1);
+		std::sort(leaves.begin(), leaves.end(), &leaf_less_than);
+
+		// groups of leaves with the same parent, sorted by count of pixels
+		std::vector< std::pair<long long, std::pair<int, int> > > groups;
+		for(int i = 0; i < (int)leaves.size();)
+		{
+			int j = i;
+			long long count = 0;
+			for(; j < (int)leaves.size() && (leaves[j].key >> 3) == (leaves[i].key >> 3); ++j)
+				count += leaves[j].bin.count;
+			if (j - i > 1)
+				groups.push_back(std::make_pair(count, std::make_pair(i, j)));
+			i = j;
+		}
+		std::sort(groups.begin(), groups.end());
+
+		std::vector<bool> merge(leaves.size(), false);
+		int count = (int)leaves.size();
+		for(int i = 0; i < (int)groups.size() && count > max_count; ++i)
+		{
+			merge[groups[i].second.first] = true;
+			count -= groups[i].second.second - groups[i].second.first - 1;
+		}
+
+		std::vector<Leaf> merged;
+		merged.reserve(count);
+		for(int i = 0; i < (int)leaves.size();)
+		{
+			Leaf leaf = leaves[i];
+			leaf.depth = level + 1;
+			int j = i + 1;
+			if (merge[i])
+			{
+				leaf.key >>= 3;
+				leaf.depth = level;
+				for(; j < (int)leaves.size() && (leaves[j].key >> 3) == leaf.key; ++j)
+					leaf.bin.add(leaves[j].bin);
+			}
+			merged.push_back(leaf);
+			i = j;
+		}
+		leaves.swap(merged);
+	}
+}
+
+} // end of anonimous namespace
+
 /* === M E T H O D S ======================================================= */
 
 Palette::Palette():
@@ -98,98 +237,71 @@ PaletteItem::add(const Color& x,int xweight)
 Palette::Palette(const Surface& surface, int max_colors, const Gamma &gamma):
 	name_(_("Surface Palette"))
 {
-	max_colors-=2;
-	for(int i=0;(signed)size()<(max_colors-1) && i<max_colors*16;++i) {
-        int x=rand()%surface.get_w();
-        int y=rand()%surface.get_h();
-
-			float dist;
-			Color color(surface[y][x]);
-
-			if(empty())
-			{
-				push_back(color);
-				continue;
-			}
-
-			if(color.get_a()==0)
-			{
-				if(front().color.get_a()!=0)
-					insert(begin(),Color(1,0,1,0));
-				front().weight+=400;
-				continue;
-			}
-
-			iterator iter(find_closest(color, gamma, &dist));
-			if(sqrt(dist)<0.005)
-			{
-				iter->add(color);
-				continue;
-			}
+	// collect histogram in parallel by bands of rows
+	std::vector<HistogramBuilder> builders(
+		std::max(1, std::min(surface.get_h(), ThreadPool::instance().get_max_threads())) );
+	ThreadPool::Group group;
+	for(int i = 0; i < (int)builders.size(); ++i)
+	{
+		builders[i].surface = &surface;
+		builders[i].begin = surface.get_h()*i/(int)builders.size();
+		builders[i].end = surface.get_h()*(i + 1)/(int)builders.size();
+		group.enqueue( sigc::mem_fun(builders[i], &HistogramBuilder::run) );
+	}
+	group.run();
 
-			/*if(size()>=max_colors)
-			{
-				iterator iterlight(find_light());
-				PaletteItem light(*iterlight);
-				erase(iterlight);
-				find_closest(light.color, gamma)->add(light.color,light.weight);
-			}
-			*/
+	Histogram &histogram = builders.front().histogram;
+	long long transparent = builders.front().transparent;
+	for(int i = 1; i < (int)builders.size(); ++i)
+	{
+		for(int j = 0; j < (int)histogram.size(); ++j)
+			histogram[j].add(builders[i].histogram[j]);
+		transparent += builders[i].transparent;
+	}
 
-			push_back(color);
-			continue;
-    }
+	std::vector<Leaf> leaves;
+	for(int i = 0; i < (int)histogram.size(); ++i)
+		if (histogram[i].count)
+		{
+			leaves.push_back(Leaf());
+			leaves.back().key = i;
+			leaves.back().depth = PALETTE_HISTOGRAM_BITS;
+			leaves.back().bin = histogram[i];
+		}
 
-/*
+	// black and white are always present
+	int count = std::max(1, max_colors - 2 - (transparent ? 1 : 0));
+	reduce(leaves, count);
 
-	max_colors-=2;
-	for(int y=0;y<surface.get_h();y++)
-		for(int x=0;x<surface.get_w();x++)
-		{
-			float dist;
-			Color color(surface[y][x]);
+	if (transparent)
+		push_back(PaletteItem(Color(1,0,1,0), (int)std::min(transparent, (long long)INT_MAX)));
+	int first = (int)size();
+	for(std::vector<Leaf>::const_iterator i = leaves.begin(); i != leaves.end(); ++i)
+		push_back(PaletteItem(i->bin.get_color(), (int)std::min(i->bin.count, (long long)INT_MAX)));
 
-			if(empty())
-			{
-				push_back(color);
-				continue;
-			}
+	// move colors to the centers of pixels closest to them
+	for(int pass = 0; pass < PALETTE_KMEANS_PASSES && !leaves.empty(); ++pass)
+	{
+		Palette centers;
+		centers.insert(centers.end(), begin() + first, end());
+		PaletteIndex index(centers, gamma);
 
-			if(color.get_a()==0)
-			{
-				if(front().color.get_a()!=0)
-					insert(begin(),Color(1,0,1,0));
-				front().weight+=400;
-				continue;
-			}
+		std::vector<Bin> sums(centers.size());
+		for(Histogram::const_iterator i = histogram.begin(); i != histogram.end(); ++i)
+			if (i->count)
+				sums[index.find(i->get_color())].add(*i);
 
-			iterator iter(find_closest(color, gamma, &dist));
-			if(sqrt(dist)<0.005)
+		for(int i = 0; i < (int)sums.size(); ++i)
+			if (sums[i].count)
 			{
-				iter->add(color);
-				continue;
+				PaletteItem &item = (*this)[first + i];
+				item.color = sums[i].get_color();
+				item.weight = (int)std::min(sums[i].count, (long long)INT_MAX);
 			}
-
-
-			push_back(color);
-			continue;
-		}
-	sort(rbegin(),rend());
-
-	iterator iter;
-
-	iterator best_match(begin());
-	while((signed)size()>max_colors)
-	{
-		PaletteItem item(back());
-		pop_back();
-		find_closest(item.color, gamma)->add(item.color,item.weight);
 	}
-*/
+
 	push_back(Color::black());
 	push_back(Color::white());
-
-//	sort(begin(),end(),&luma_less_than);
 }
 
 Palette::const_iterator
@@ -282,6 +394,121 @@ Palette::find_light()
 	return best_match;
 }
 
+PaletteIndex::PaletteIndex(const Palette &palette, const Gamma &gamma):
+	gamma(gamma),
+	nodes(palette.size())
+{
+	for(int i = 0; i < (int)nodes.size(); ++i)
+	{
+		to_point(palette[i].color, gamma, nodes[i].point);
+		nodes[i].index = i;
+		nodes[i].axis = 0;
+	}
+	build(0, (int)nodes.size());
+}
+
+void
+PaletteIndex::to_point(const Color &color, const Gamma &gamma, float *point)
+{
+	// squared euclidean distance between points is the distance of Palette::find_closest()
+	const Color prep = gamma.apply(color);
+	point[0] = prep.get_y()*prep.get_a()*std::sqrt(1.5f);
+	point[1] = prep.get_u();
+	point[2] = prep.get_v();
+	point[3] = prep.get_a();
+}
+
+void
+PaletteIndex::build(int begin, int end)
+{
+	if (end - begin < 2)
+		return;
+
+	// split by axis with the largest spread
+	float min[4], max[4];
+	for(int j = 0; j < 4; ++j)
+		min[j] = max[j] = nodes[begin].point[j];
+	for(int i = begin + 1; i < end; ++i)
+		for(int j = 0; j < 4; ++j)
+		{
+			min[j] = std::min(min[j], nodes[i].point[j]);
+			max[j] = std::max(max[j], nodes[i].point[j]);
+		}
+	int axis = 0;
+	for(int j = 1; j < 4; ++j)
+		if (max[j] - min[j] > max[axis] - min[axis])
+			axis = j;
+
+	int mid = (begin + end)/2;
+	std::nth_element(
+		nodes.begin() + begin, nodes.begin() + mid, nodes.begin() + end,
+		[axis](const Node &a, const Node &b) { return a.point[axis] < b.point[axis]; } );
+	nodes[mid].axis = axis;
+
+	build(begin, mid);
+	build(mid + 1, end);
+}
+
+void
+PaletteIndex::search(int begin, int end, const float *point, int &best, float &best_dist) const
+{
+	if (begin >= end)
+		return;
+
+	int mid = (begin + end)/2;
+	const Node &node = nodes[mid];
+
+	float dist = 0;
+	for(int j = 0; j < 4; ++j)
+		dist += (point[j] - node.point[j])*(point[j] - node.point[j]);
+	// first of equal colors wins, as in Palette::find_closest()
+	if (dist < best_dist || (dist == best_dist && node.index < best))
+		{ best = node.index; best_dist = dist; }
+
+	float d = point[node.axis] - node.point[node.axis];
+	if (d < 0)
+	{
+		search(begin, mid, point, best, best_dist);
+		if (d*d <= best_dist) search(mid + 1, end, point, best, best_dist);
+	}
+	else
+	{
+		search(mid + 1, end, point, best, best_dist);
+		if (d*d <= best_dist) search(begin, mid, point, best, best_dist);
+	}
+}
+
+int
+PaletteIndex::find(const Color &color, float *dist) const
+{
+	float point[4];
+	to_point(color, gamma, point);
+	int best = -1;
+	float best_dist = INFINITY;
+	search(0, (int)nodes.size(), point, best, best_dist);
+	if (dist)
+		*dist = best_dist;
+	return best;
+}
+
+int
+PaletteIndex::find(const Color &color, Cache &cache) const
+{
+	const Color c = color.clamped();
+	unsigned int key = ((unsigned int)round(c.get_r()*255) << 24)
+	                 | ((unsigned int)round(c.get_g()*255) << 16)
+	                 | ((unsigned int)round(c.get_b()*255) << 8)
+	                 |  (unsigned int)round(c.get_a()*255);
+	unsigned int slot = (key*2654435761u) >> (32 - Cache::SIZE_BITS);
+	if (cache.values[slot] < 0 || cache.keys[slot] != key)
+	{
+		const ColorReal k = 1/255.0;
+		cache.keys[slot] = key;
+		cache.values[slot] = find(Color(k*(key >> 24), k*((key >> 16)&0xff), k*((key >> 8)&0xff), k*(key&0xff)));
+	}
+	return cache.values[slot];
+}
+
 Palette
 Palette::grayscale(int steps, ColorReal gamma)
 {
@@ -72,7 +72,8 @@ public:
 	Palette(const String& name_);
 
 	/*! Generates a palette for the given
-	**	surface
+	**	surface. Colors of all pixels are collected into the histogram,
+	**	reduced by the octree and refined by few k-means passes.
 	*/
 	Palette(const Surface& surface, int size, const Gamma &gamma);
 
@@ -90,6 +91,53 @@ public:
 	static Palette load_from_file(const synfig::String& filename);
 }; // END of class Palette
 
+/*!	\class PaletteIndex
+**	\brief Fast search of the closest palette color.
+**
+**	Colors are converted to the space where distance of Palette::find_closest()
+**	is euclidean and stored in the k-d tree, so search gives the same results.
+**	Palette should not be changed while index exists.
+*/
+class PaletteIndex
+{
+public:
+	//! Cached search results for colors rounded to 8 bits per channel.
+	//! Cache should be used by the one thread only.
+	class Cache
+	{
+	private:
+		friend class PaletteIndex;
+		enum { SIZE_BITS = 16 };
+		std::vector<unsigned int> keys;
+		std::vector<int> values;
+	public:
+		Cache(): keys(1 << SIZE_BITS), values(1 << SIZE_BITS, -1) { }
+	};
+
+private:
+	struct Node {
+		float point[4];
+		int index;
+		int axis;
+	};
+
+	Gamma gamma;
+	std::vector<Node> nodes;
+
+	void build(int begin, int end);
+	void search(int begin, int end, const float *point, int &best, float &best_dist) const;
+
+public:
+	PaletteIndex(const Palette &palette, const Gamma &gamma);
+
+	static void to_point(const Color &color, const Gamma &gamma, float *point);
+
+	//! Returns index of the closest color in palette, or -1 if palette is empty
+	int find(const Color &color, float *dist = 0) const;
+	//! Same as find(), but for color rounded to 8 bits, and uses cache
+	int find(const Color &color, Cache &cache) const;
+}; // END of class PaletteIndex
+
 }; // END of namespace synfig
 
 /* === E N D =============================================================== */
@@ -36,6 +36,7 @@
 
 #include "../task/taskcontour.h"
 #include "../task/taskblur.h"
+#include "../task/taskdistort.h"
 #include "../task/tasklayer.h"
 #include "../task/tasktransformation.h"
 
@@ -114,6 +115,16 @@ OptimizerDraftTransformation::run(const RunParams &params) const
 			apply(params, transformation);
 		}
 	}
+	else
+	if (TaskDistort::Handle distort = TaskDistort::Handle::cast_dynamic(params.ref_task))
+	{
+		if (distort->interpolation != Color::INTERPOLATION_NEAREST)
+		{
+			distort = TaskDistort::Handle::cast_dynamic( distort->clone() );
+			distort->interpolation = Color::INTERPOLATION_NEAREST;
+			apply(params, distort);
+		}
+	}
 }
 
 
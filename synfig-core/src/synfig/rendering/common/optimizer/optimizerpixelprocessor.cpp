@@ -0,0 +1,118 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizerpixelprocessor.cpp
+**	\brief OptimizerPixelProcessor
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "optimizerpixelprocessor.h"
+
+#include "../task/taskpixelprocessor.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+OptimizerPixelProcessor::OptimizerPixelProcessor()
+{
+	category_id = CATEGORY_ID_BEGIN;
+	mode = MODE_REPEAT_LAST | MODE_RECURSIVE;
+	for_task = true;
+}
+
+
+void
+OptimizerPixelProcessor::run(const RunParams& params) const
+{
+	// colors are transformed by rows: out = in * matrix,
+	// so the matrix of the chain "inner, then outer" is inner * outer
+
+	TaskPixelProcessor::Handle outer = TaskPixelProcessor::Handle::cast_dynamic(params.ref_task);
+	if (!outer) return;
+
+	TaskPixelProcessor::Handle inner = TaskPixelProcessor::Handle::cast_dynamic(outer->sub_task());
+	if (!inner || inner->target_surface) // exclude tasks with prerendered source
+		return;
+
+	TaskPixelColorMatrix::Handle outer_matrix = TaskPixelColorMatrix::Handle::cast_dynamic(outer);
+	TaskPixelColorMatrix::Handle inner_matrix = TaskPixelColorMatrix::Handle::cast_dynamic(inner);
+	TaskPixelGamma::Handle outer_gamma = TaskPixelGamma::Handle::cast_dynamic(outer);
+	TaskPixelGamma::Handle inner_gamma = TaskPixelGamma::Handle::cast_dynamic(inner);
+
+	if (outer_matrix && inner_matrix)
+	{
+		TaskPixelColorMatrix::Handle task = TaskPixelColorMatrix::Handle::cast_dynamic(outer->clone());
+		task->matrix = inner_matrix->matrix * outer_matrix->matrix;
+		task->sub_task() = inner->sub_task();
+		apply(params, task);
+		return;
+	}
+
+	if (outer_gamma && inner_matrix)
+	{
+		TaskPixelGamma::Handle task = TaskPixelGamma::Handle::cast_dynamic(outer->clone());
+		task->matrix_before = inner_matrix->matrix * outer_gamma->matrix_before;
+		task->sub_task() = inner->sub_task();
+		apply(params, task);
+		return;
+	}
+
+	if (outer_matrix && inner_gamma)
+	{
+		TaskPixelGamma::Handle task = TaskPixelGamma::Handle::cast_dynamic(inner->clone());
+		task->assign_target(*outer);
+		task->matrix_after = inner_gamma->matrix_after * outer_matrix->matrix;
+		apply(params, task);
+		return;
+	}
+
+	// powers may be multiplied only if there is nothing between them
+	if ( outer_gamma && inner_gamma
+	  && outer_gamma->matrix_before.is_copy()
+	  && inner_gamma->matrix_after.is_copy() )
+	{
+		TaskPixelGamma::Handle task = TaskPixelGamma::Handle::cast_dynamic(outer->clone());
+		task->matrix_before = inner_gamma->matrix_before;
+		task->gamma = inner_gamma->gamma * outer_gamma->gamma;
+		task->sub_task() = inner->sub_task();
+		apply(params, task);
+		return;
+	}
+}
+
+/* === E N T R Y P O I N T ================================================= */
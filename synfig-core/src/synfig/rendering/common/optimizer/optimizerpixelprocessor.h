@@ -1,10 +1,8 @@
 /* === S Y N F I G ========================================================= */
-/*!	\file measure.h
-**	\brief Template Header
+/*!	\file synfig/rendering/common/optimizer/optimizerpixelprocessor.h
+**	\brief OptimizerPixelProcessor Header
 **
 **	\legal
-**	......... ... 2015 Ivan Mahonin
-**
 **	This file is part of Synfig.
 **
 **	Synfig is free software: you can redistribute it and/or modify
@@ -25,60 +23,36 @@
 
 /* === S T A R T =========================================================== */
 
-#ifndef __SYNFIG_DEBUG_MEASURE_H
-#define __SYNFIG_DEBUG_MEASURE_H
+#ifndef __SYNFIG_RENDERING_OPTIMIZERPIXELPROCESSOR_H
+#define __SYNFIG_RENDERING_OPTIMIZERPIXELPROCESSOR_H
 
 /* === H E A D E R S ======================================================= */
 
-#include <vector>
-
-#include <mutex>
-
-#include <synfig/string.h>
+#include "../../optimizer.h"
 
 /* === M A C R O S ========================================================= */
 
-#define SYNFIG_DEBUG_MEASURE
-
 /* === T Y P E D E F S ===================================================== */
 
 /* === C L A S S E S & S T R U C T S ======================================= */
 
-namespace synfig {
-namespace debug {
-
-class Measure {
-private:
-	static std::mutex mutex;
-	static std::vector<Measure*> stack;
-	static String text;
-
-	String name;
-	bool hide;
-	bool hide_subs;
-	long long subs;
-	long long t;
-	long long cpu_subs;
-	long long cpu_t;
-
-	Measure(const Measure&):
-		name(), hide(), hide_subs(),
-		subs(), t(), cpu_subs(), cpu_t() { }
-	Measure& operator= (const Measure&) { return *this; }
-	void init();
+namespace synfig
+{
+namespace rendering
+{
 
+//! Merges chains of color matrix and gamma tasks into a single task,
+//! so each pixel is read and written once for the whole chain
+class OptimizerPixelProcessor: public Optimizer
+{
 public:
-	Measure(const String &name, bool hide_subs = false):
-		name(name), hide(), hide_subs(hide_subs),
-		subs(), t(), cpu_subs(), cpu_t()
-	{ init(); }
-
-	~Measure();
+	OptimizerPixelProcessor();
+	virtual void run(const RunParams &params) const;
 };
 
-}; // END of namespace debug
-}; // END of namespace synfig
+} /* end namespace rendering */
+} /* end namespace synfig */
 
-/* === E N D =============================================================== */
+/* -- E N D ----------------------------------------------------------------- */
 
 #endif
@@ -0,0 +1,144 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/task/taskdistort.cpp
+**	\brief TaskDistort
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "taskdistort.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+SYNFIG_EXPORT Task::Token TaskDistort::token(
+	DescAbstract<TaskDistort>("Distort") );
+
+
+Rect
+TaskDistort::Distortion::calc_source_rect(const Rect &rect, const Vector &units_per_pixel) const
+{
+	// transform a grid of points (at most one point per pixel),
+	// points between grid nodes may go a bit farther than nodes,
+	// so expand the result by half of the distance between neighbour nodes
+	const int max_count = 64;
+	const int cx = std::max(2, std::min(max_count, (int)approximate_ceil(rect.get_width()/std::fabs(units_per_pixel[0])) + 1));
+	const int cy = std::max(2, std::min(max_count, (int)approximate_ceil(rect.get_height()/std::fabs(units_per_pixel[1])) + 1));
+	const Vector step(rect.get_width()/(cx - 1), rect.get_height()/(cy - 1));
+
+	std::vector<Vector> points(cx*cy);
+	for(int j = 0; j < cy; ++j)
+		for(int i = 0; i < cx; ++i)
+			points[j*cx + i] = Vector(rect.minx + i*step[0], rect.miny + j*step[1]);
+	transform(&points.front(), (int)points.size());
+
+	bool found = false;
+	Rect result;
+	Real margin = 0.0;
+	for(int j = 0; j < cy; ++j) {
+		for(int i = 0; i < cx; ++i) {
+			const Vector &p = points[j*cx + i];
+			if (!p.is_valid())
+				continue;
+			if (found) result.expand(p); else result = Rect(p);
+			found = true;
+			if (i > 0 && points[j*cx + i - 1].is_valid())
+				margin = std::max(margin, (p - points[j*cx + i - 1]).mag());
+			if (j > 0 && points[(j - 1)*cx + i].is_valid())
+				margin = std::max(margin, (p - points[(j - 1)*cx + i]).mag());
+		}
+	}
+
+	if (!found)
+		return Rect::zero();
+	return result.expand(0.5*margin);
+}
+
+Rect
+TaskDistort::Distortion::calc_bounds(const Rect&) const
+	{ return Rect::infinite(); }
+
+
+Rect
+TaskDistort::calc_bounds() const
+{
+	if (!sub_task() || !distortion) return Rect::zero();
+	return distortion->calc_bounds(sub_task()->get_bounds());
+}
+
+void
+TaskDistort::set_coords_sub_tasks()
+{
+	if (!sub_task() || !distortion)
+		{ trunc_to_zero(); return; }
+	if (!is_valid_coords())
+		{ sub_task()->set_coords_zero(); return; }
+
+	Vector upp = get_units_per_pixel();
+	Rect rect = distortion->calc_source_rect(source_rect, upp);
+	rect &= sub_task()->get_bounds();
+	if (!rect.is_valid() || rect.is_nan_or_inf())
+		{ sub_task()->set_coords_zero(); return; }
+
+	// align the source to the pixels of this task,
+	// so undistorted areas are copied without blurring,
+	// and add two pixels for cubic interpolation
+	const int margin = 2;
+	const int max_size = 10000;
+	RectInt pixels(
+		(int)approximate_floor((rect.minx - source_rect.minx)/upp[0]) - margin,
+		(int)approximate_floor((rect.miny - source_rect.miny)/upp[1]) - margin,
+		(int)approximate_ceil ((rect.maxx - source_rect.minx)/upp[0]) + margin,
+		(int)approximate_ceil ((rect.maxy - source_rect.miny)/upp[1]) + margin );
+	Rect sub_source_rect(
+		source_rect.minx + pixels.minx*upp[0],
+		source_rect.miny + pixels.miny*upp[1],
+		source_rect.minx + pixels.maxx*upp[0],
+		source_rect.miny + pixels.maxy*upp[1] );
+	VectorInt sub_target_size(
+		std::min(pixels.get_width(), max_size),
+		std::min(pixels.get_height(), max_size) );
+
+	sub_task()->set_coords(sub_source_rect, sub_target_size);
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,98 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/task/taskdistort.h
+**	\brief TaskDistort Header
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_TASKDISTORT_H
+#define __SYNFIG_RENDERING_TASKDISTORT_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <ETL/handle>
+
+#include <synfig/color.h>
+
+#include "../../task.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Renders sub task and moves its pixels by arbitrary (non-affine) back-transformation
+class TaskDistort: public Task, public TaskInterfaceSplit
+{
+public:
+	typedef etl::handle<TaskDistort> Handle;
+	SYNFIG_EXPORT static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	//! Back-transformation of the distortion.
+	//! It must be immutable, because it shared between clones of the task.
+	class Distortion: public etl::shared_object
+	{
+	public:
+		typedef etl::handle<Distortion> Handle;
+
+		virtual ~Distortion() { }
+
+		//! Replaces each of \a count points of the result by the point of the source
+		//! where the color comes from. Use NaN to get the transparent color.
+		virtual void transform(Vector *points, int count) const = 0;
+
+		//! Returns area of the source required to render the \a rect of the result,
+		//! where \a units_per_pixel is the resolution of the result.
+		//! Default implementation transforms a grid of points.
+		virtual Rect calc_source_rect(const Rect &rect, const Vector &units_per_pixel) const;
+
+		//! Returns bounds of the result for the \a source_bounds
+		virtual Rect calc_bounds(const Rect &source_bounds) const;
+	};
+
+	Distortion::Handle distortion;
+	Color::Interpolation interpolation;
+
+	TaskDistort(): interpolation(Color::INTERPOLATION_CUBIC) { }
+
+	virtual int get_pass_subtask_index() const
+		{ return sub_task() && distortion ? PASSTO_THIS_TASK : PASSTO_NO_TASK; }
+
+	const Task::Handle& sub_task() const { return Task::sub_task(0); }
+	Task::Handle& sub_task() { return Task::sub_task(0); }
+
+	virtual Rect calc_bounds() const;
+	virtual void set_coords_sub_tasks();
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -52,6 +52,7 @@ public:
 	static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
 
+	//! Immutable copy of the layer, may be shared by tasks, see Layer::get_rendering_snapshot()
 	Layer::Handle layer;
 
 	const Task::Handle& sub_task() const { return Task::sub_task(0); }
@@ -88,6 +88,9 @@ public:
 };
 
 
+//! Applies matrix_before, gamma and matrix_after to each pixel in a single pass.
+//! Layers set only the gamma, matrices are filled by OptimizerPixelProcessor
+//! when it fuses chains of pixel processors.
 class TaskPixelGamma: public TaskPixelProcessor
 {
 public:
@@ -96,14 +99,21 @@ public:
 	virtual Token::Handle get_token() const { return token.handle(); }
 
 	Gamma gamma;
+	ColorMatrix matrix_before;
+	ColorMatrix matrix_after;
 	TaskPixelGamma() { }
 
-	virtual bool is_transparent() const
+	bool is_gamma_identity() const
 	{
 		return approximate_equal_lp(gamma.get_r(), ColorReal(1.0))
 			&& approximate_equal_lp(gamma.get_g(), ColorReal(1.0))
 			&& approximate_equal_lp(gamma.get_b(), ColorReal(1.0));
 	}
+
+	virtual bool is_transparent() const
+		{ return is_gamma_identity() && matrix_before.is_identity() && matrix_after.is_identity(); }
+	virtual bool is_affects_transparent() const
+		{ return matrix_before.is_affects_transparent() || matrix_after.is_affects_transparent(); }
 };
 
 
@@ -0,0 +1,269 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/dependencies.cpp
+**	\brief Dependencies
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+
+#include "dependencies.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+//! Writes to the one surface
+struct Target {
+	RectIndex writes;
+	Surface::Token::Handle token;
+	bool simultaneous;
+	Target(): simultaneous(true) { }
+};
+
+typedef std::unordered_map<const SurfaceResource*, Target> TargetMap;
+
+class Builder {
+public:
+	const Task::List &list;
+	TargetMap targets;
+	std::vector<int> found;
+	long long edges;
+
+	explicit Builder(const Task::List &list): list(list), edges() { }
+
+	void add_dep(const Task::Handle &task, const Task::Handle &dep) {
+		if (task != dep && task->renderer_data.deps.insert(dep).second) {
+			dep->renderer_data.back_deps.insert(task);
+			++edges;
+		}
+	}
+
+	void add_deps(const Task::Handle &task, const RectIndex &index) {
+		for(std::vector<int>::const_iterator i = found.begin(); i != found.end(); ++i)
+			add_dep(task, list[index.get_value(*i)]);
+	}
+
+	void read(const Task::Handle &task, const Task &sub_task) {
+		TargetMap::iterator i = targets.find(sub_task.target_surface.get());
+		if (i == targets.end())
+			return;
+		found.clear();
+		i->second.writes.find(sub_task.target_rect, found);
+		add_deps(task, i->second.writes);
+	}
+
+	void write(const Task::Handle &task, int index) {
+		Target &target = targets[task->target_surface.get()];
+		Surface::Token::Handle token = task->get_target_token();
+		bool simultaneous = task->get_mode_allow_simultaneous_write();
+
+		found.clear();
+		if (!target.writes.empty() && (!simultaneous || !target.simultaneous || token != target.token)) {
+			// task conflicts with all of previous writes,
+			// so it replaces them by the single write with the common bounds,
+			// and the next tasks will depend on the all of previous writes through this task
+			target.writes.find_all(found);
+			add_deps(task, target.writes);
+			RectInt rect = task->target_rect;
+			for(std::vector<int>::const_iterator i = found.begin(); i != found.end(); ++i)
+				rect |= target.writes.get_rect(*i);
+			target.writes.clear();
+			target.writes.insert(rect, index);
+		} else {
+			// previous writes covered by the task are not needed anymore,
+			// the next tasks will depend on them through this task
+			target.writes.find(task->target_rect, found);
+			add_deps(task, target.writes);
+			for(std::vector<int>::const_iterator i = found.begin(); i != found.end(); ++i)
+				if (rect_contains(task->target_rect, target.writes.get_rect(*i)))
+					target.writes.remove(*i);
+			target.writes.insert(task->target_rect, index);
+		}
+
+		target.token = token;
+		target.simultaneous = simultaneous;
+	}
+};
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+int
+RectIndex::get_level(const RectInt &rect)
+{
+	int size = std::max(rect.get_width(), rect.get_height());
+	int level = 0;
+	while(level < MAX_LEVEL && (1 << level) < size)
+		++level;
+	return level;
+}
+
+void
+RectIndex::find_in_cell(std::vector<int> &cell, const RectInt &rect, std::vector<int> &out)
+{
+	// removed entries are erased from cells lazily
+	std::vector<int>::iterator j = cell.begin();
+	for(std::vector<int>::iterator i = cell.begin(); i != cell.end(); ++i) {
+		const Entry &entry = entries[*i];
+		if (!entry.alive)
+			continue;
+		if (rect_intersect(entry.rect, rect))
+			out.push_back(*i);
+		*j++ = *i;
+	}
+	cell.erase(j, cell.end());
+}
+
+void
+RectIndex::clear()
+{
+	entries.clear();
+	levels.clear();
+	count = 0;
+}
+
+int
+RectIndex::insert(const RectInt &rect, int value)
+{
+	int level = get_level(rect);
+	if ((int)levels.size() <= level)
+		levels.resize(level + 1);
+
+	int id = (int)entries.size();
+	entries.push_back(Entry(rect, value));
+	levels[level].cells[get_key(get_cell(rect.minx, level), get_cell(rect.miny, level))].push_back(id);
+	++levels[level].count;
+	++count;
+	return id;
+}
+
+void
+RectIndex::remove(int id)
+{
+	Entry &entry = entries[id];
+	if (!entry.alive)
+		return;
+	entry.alive = false;
+	--levels[get_level(entry.rect)].count;
+	--count;
+}
+
+void
+RectIndex::find(const RectInt &rect, std::vector<int> &out)
+{
+	if (!rect.is_valid())
+		return;
+	for(int level = 0; level < (int)levels.size(); ++level) {
+		Level &l = levels[level];
+		if (!l.count)
+			continue;
+
+		// entries of level are not larger than the cell,
+		// so entry which intersects the rect begins in the cell
+		// that intersects the rect or in the previous one
+		int x0 = get_cell(rect.minx, level) - 1;
+		int y0 = get_cell(rect.miny, level) - 1;
+		int x1 = get_cell(rect.maxx - 1, level);
+		int y1 = get_cell(rect.maxy - 1, level);
+
+		if ((long long)(x1 - x0 + 1)*(y1 - y0 + 1) > (long long)l.cells.size()) {
+			for(Level::Map::iterator i = l.cells.begin(); i != l.cells.end();) {
+				find_in_cell(i->second, rect, out);
+				if (i->second.empty()) i = l.cells.erase(i); else ++i;
+			}
+		} else {
+			for(int y = y0; y <= y1; ++y)
+				for(int x = x0; x <= x1; ++x) {
+					Level::Map::iterator i = l.cells.find(get_key(x, y));
+					if (i != l.cells.end())
+						find_in_cell(i->second, rect, out);
+				}
+		}
+	}
+}
+
+void
+RectIndex::find_all(std::vector<int> &out)
+{
+	for(int id = 0; id < (int)entries.size(); ++id)
+		if (entries[id].alive)
+			out.push_back(id);
+}
+
+
+long long
+Dependencies::build(const Task::List &list, long long batch_index)
+{
+	Builder builder(list);
+	Task::Handle last_single_thread;
+
+	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i) {
+		const Task::Handle &task = *i;
+		Task::RendererData &task_rd = task->renderer_data;
+
+		assert(task_rd.index == 0);
+		assert(task_rd.batch_index == 0);
+		task_rd.batch_index = batch_index;
+		task_rd.index = i - list.begin() + 1;
+
+		task_rd.deps.clear();
+		task_rd.back_deps.clear();
+
+		if (!task->is_valid())
+			continue;
+
+		// tasks without multithreading are never reordered
+		if (!task->get_allow_multithreading()) {
+			if (last_single_thread)
+				builder.add_dep(task, last_single_thread);
+			last_single_thread = task;
+		}
+
+		for(Task::List::const_iterator j = task->sub_tasks.begin(); j != task->sub_tasks.end(); ++j)
+			if (*j && (*j)->is_valid())
+				builder.read(task, **j);
+
+		builder.write(task, i - list.begin());
+	}
+
+	return builder.edges;
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,124 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/dependencies.h
+**	\brief Dependencies Header
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_DEPENDENCIES_H
+#define __SYNFIG_RENDERING_DEPENDENCIES_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <unordered_map>
+#include <vector>
+
+#include <synfig/rect.h>
+
+#include "task.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Spatial index of integer rectangles.
+//! Each rectangle is stored in the single cell of the grid with the cell size
+//! not less than the size of rectangle (grids of all power-of-two sizes are used),
+//! so insertion and removal take constant time, and search visits only
+//! the cells near the requested area.
+class RectIndex
+{
+private:
+	struct Entry {
+		RectInt rect;
+		int value;
+		bool alive;
+		Entry(): value(), alive() { }
+		Entry(const RectInt &rect, int value): rect(rect), value(value), alive(true) { }
+	};
+
+	struct Level {
+		typedef std::unordered_map<long long, std::vector<int> > Map;
+		Map cells;
+		int count;
+		Level(): count() { }
+	};
+
+	enum { MAX_LEVEL = 30 };
+
+	std::vector<Entry> entries;
+	std::vector<Level> levels;
+	int count;
+
+	static int get_cell(int x, int level)
+		{ return x >= 0 ? x >> level : -((-x - 1) >> level) - 1; }
+	static long long get_key(int x, int y)
+		{ return ((long long)x << 32) | (unsigned int)y; }
+	static int get_level(const RectInt &rect);
+
+	void find_in_cell(std::vector<int> &cell, const RectInt &rect, std::vector<int> &out);
+
+public:
+	RectIndex(): count() { }
+
+	void clear();
+	bool empty() const { return count == 0; }
+	int size() const { return count; }
+
+	//! Adds the rectangle, returns id of entry
+	int insert(const RectInt &rect, int value);
+	void remove(int id);
+
+	const RectInt& get_rect(int id) const { return entries[id].rect; }
+	int get_value(int id) const { return entries[id].value; }
+
+	//! Appends to \a out ids of entries which intersects the \a rect
+	void find(const RectInt &rect, std::vector<int> &out);
+	//! Appends to \a out ids of all entries
+	void find_all(std::vector<int> &out);
+};
+
+
+//! Builds dependencies between tasks of linearized task list.
+//! Task depends on the previous tasks which writes to the areas of surfaces
+//! that it reads or writes. Writes to the non-intersected areas of the same surface
+//! are independent when both tasks allows simultaneous write.
+class Dependencies
+{
+public:
+	//! Fills renderer_data (index, batch_index, deps and back_deps) of the tasks,
+	//! returns count of dependencies
+	static long long build(const Task::List &list, long long batch_index);
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
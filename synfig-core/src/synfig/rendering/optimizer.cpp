@@ -48,10 +48,10 @@ using namespace rendering;
 /* === M E T H O D S ======================================================= */
 
 const Optimizer::CategoryInfo Optimizer::categories_info[CATEGORIES_COUNT] = {
-	CategoryInfo(false),   // CATEGORY_ID_BEGIN
-	CategoryInfo(false),   // CATEGORY_ID_COORDS
-	CategoryInfo(true),    // CATEGORY_ID_SPECIALIZED
-	CategoryInfo(false) }; // CATEGORY_ID_LIST
+	CategoryInfo(false, "optimize_begin"),       // CATEGORY_ID_BEGIN
+	CategoryInfo(false, "optimize_coords"),      // CATEGORY_ID_COORDS
+	CategoryInfo(true,  "optimize_specialized"), // CATEGORY_ID_SPECIALIZED
+	CategoryInfo(false, "optimize_list") };      // CATEGORY_ID_LIST
 
 Optimizer::~Optimizer() { }
 
@@ -93,7 +93,10 @@ public:
 		//! true:  optimizer1(taskA), optimizer2(taskA), optimizer1(taskB), optimizer2(taskB)
 		//! false: optimizer1(taskA), optimizer1(taskB), optimizer2(taskA), optimizer2(taskB)
 		bool simultaneous_run;
-		CategoryInfo(bool simultaneous_run): simultaneous_run(simultaneous_run) { }
+		//! name of the category in the profiling output, see debug::Profile
+		const char *name;
+		CategoryInfo(bool simultaneous_run, const char *name):
+			simultaneous_run(simultaneous_run), name(name) { }
 	};
 
 	struct RunParams
@@ -45,9 +45,10 @@
 #include <synfig/threadpool.h>
 #include <synfig/debug/debugsurface.h>
 #include <synfig/debug/log.h>
-#include <synfig/debug/measure.h>
+#include <synfig/debug/profile.h>
 
 #include "renderer.h"
+#include "dependencies.h"
 #include "renderqueue.h"
 
 #include "software/renderersw.h"
@@ -67,7 +68,6 @@ using namespace rendering;
 
 
 //#define DEBUG_TASK_MEASURE
-//#define DEBUG_OPTIMIZATION_MEASURE
 //#define DEBUG_OPTIMIZATION_COUNTERS
 
 #ifndef NDEBUG
@@ -198,18 +198,13 @@ Renderer::count_tasks_recursive(Task::List &list) const {
 int
 Renderer::count_tasks(Task::List &list) const
 {
-	#ifdef DEBUG_OPTIMIZATION_MEASURE
-	debug::Measure t("count tasks");
-	#endif
 	return count_tasks_recursive(list);
 }
 
 void
 Renderer::calc_coords(const Task::List &list) const
 {
-	#ifdef DEBUG_OPTIMIZATION_MEASURE
-	debug::Measure t("calc coords");
-	#endif
+	debug::Profile::Scope profile("calc_coords", "optimizer");
 	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i)
 		if (*i) (*i)->touch_coords();
 }
@@ -234,9 +229,7 @@ Renderer::specialize_recursive(Task::List &list) const
 void
 Renderer::specialize(Task::List &list) const
 {
-	#ifdef DEBUG_OPTIMIZATION_MEASURE
-	debug::Measure t("specialize");
-	#endif
+	debug::Profile::Scope profile("specialize", "optimizer");
 	specialize_recursive(list);
 }
 
@@ -254,9 +247,7 @@ Renderer::remove_dummy(Task::List &list) const
 void
 Renderer::linearize(Task::List &list) const
 {
-	#ifdef DEBUG_OPTIMIZATION_MEASURE
-	debug::Measure t("linearize");
-	#endif
+	debug::Profile::Scope profile("linearize", "optimizer");
 
 	// convert task-tree to linear list
 	for(Task::List::iterator i = list.begin(); i != list.end();)
@@ -490,9 +481,7 @@ Renderer::optimize_recursive(
 void
 Renderer::optimize(Task::List &list) const
 {
-	#ifdef DEBUG_TASK_MEASURE
-	debug::Measure t("Renderer::optimize");
-	#endif
+	debug::Profile::Scope profile("optimize", "renderer");
 
 	#ifdef DEBUG_OPTIMIZATION_COUNTERS
 	debug::Log::info("", "optimize %d tasks", count_tasks(list));
@@ -580,9 +569,7 @@ Renderer::optimize(Task::List &list) const
 		log("", list, etl::strprintf("before optimize category %d index %d", current_category_id, current_optimizer_index));
 		#endif
 
-		#ifdef DEBUG_OPTIMIZATION_MEASURE
-		debug::Measure t(etl::strprintf("optimize category %d index %d", current_category_id, current_optimizer_index));
-		#endif
+		debug::Profile::Scope profile(Optimizer::categories_info[current_category_id].name, "optimizer");
 
 		#ifdef DEBUG_OPTIMIZATION_COUNTERS
 		std::atomic<int> calls_count(0), *calls_count_ptr = &calls_count;
@@ -677,115 +664,15 @@ Renderer::optimize(Task::List &list) const
 void
 Renderer::find_deps(const Task::List &list, long long batch_index) const
 {
-	#ifdef DEBUG_TASK_MEASURE
-	debug::Measure t("Renderer::find_deps");
-	#endif
-
-	typedef std::map<SurfaceResource::Handle, Task::Handle> DepTargetPrevMap;
-	DepTargetPrevMap target_prev_map;
-	Task::Set tasks_to_process;
-	const int max_iterations = 50000;
-
-	// find dependencies by target surface
-	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i)
-	{
-		Task::Handle task = *i;
-		Task::RendererData &task_rd = task->renderer_data;
-
-		assert(task_rd.index == 0);
-		assert(task_rd.batch_index == 0);
-		task_rd.batch_index = batch_index;
-		task_rd.index = i - list.begin() + 1;
-
-		task_rd.deps.clear();
-		task_rd.back_deps.clear();
-
-		if ((*i)->is_valid()) {
-			for(Task::List::const_iterator j = (*i)->sub_tasks.begin(); j != (*i)->sub_tasks.end(); ++j)
-				if (*j && (*j)->is_valid())
-					if (Task::Handle dep = target_prev_map[(*j)->target_surface]) {
-						if (task_rd.tmp_deps.empty()) tasks_to_process.insert(*i);
-						task_rd.tmp_deps.insert(dep);
-						dep->renderer_data.tmp_back_deps.insert(*i);
-					}
-			Task::Handle &dep = target_prev_map[(*i)->target_surface];
-			if (dep) {
-				if (task_rd.tmp_deps.empty()) tasks_to_process.insert(*i);
-				task_rd.tmp_deps.insert(dep);
-				dep->renderer_data.tmp_back_deps.insert(*i);
-			}
-			dep = *i;
-		}
-	}
-
-	// fix dependencies for tasks with non-intersected areas
-	int iterations = 0;
-	while(iterations < max_iterations && !tasks_to_process.empty())
-	{
-		for(Task::Set::iterator i = tasks_to_process.begin(); i != tasks_to_process.end();)
-		{
-			Task::Handle task = *i;
-			Task::RendererData &task_rd = task->renderer_data;
-			assert(!task_rd.tmp_deps.empty());
-
-			Task::Handle dep = *task_rd.tmp_deps.begin();
-			Task::RendererData &dep_rd = dep->renderer_data;
-			task_rd.tmp_deps.erase( task_rd.tmp_deps.begin() );
-			dep_rd.tmp_back_deps.erase(task);
-
-			if (!task->allow_run_before(*dep)) {
-				task_rd.deps.insert(dep);
-				dep_rd.back_deps.insert(task);
-				++iterations;
-			} else {
-				iterations += dep_rd.deps.size() + dep_rd.tmp_deps.size() + task_rd.back_deps.size() + task_rd.tmp_back_deps.size();
-				for(Task::Set::iterator j = dep_rd.deps.begin(); j != dep_rd.deps.end(); ++j)
-					if (task_rd.deps.count(*j) == 0) {
-						task_rd.tmp_deps.insert(*j);
-						(*j)->renderer_data.tmp_back_deps.insert(task);
-					}
-				for(Task::Set::iterator j = dep_rd.tmp_deps.begin(); j != dep_rd.tmp_deps.end(); ++j)
-					if (task_rd.deps.count(*j) == 0) {
-						task_rd.tmp_deps.insert(*j);
-						(*j)->renderer_data.tmp_back_deps.insert(task);
-					}
-				for(Task::Set::iterator j = task_rd.back_deps.begin(); j != task_rd.back_deps.end(); ++j)
-					if ((*j)->renderer_data.deps.count(dep) == 0) {
-						if ((*j)->renderer_data.tmp_deps.empty()) tasks_to_process.insert(*j);
-						(*j)->renderer_data.tmp_deps.insert(dep);
-						dep_rd.tmp_back_deps.insert(*j);
-					}
-				for(Task::Set::iterator j = task_rd.tmp_back_deps.begin(); j != task_rd.tmp_back_deps.end(); ++j)
-					if ((*j)->renderer_data.deps.count(dep) == 0) {
-						(*j)->renderer_data.tmp_deps.insert(dep);
-						dep_rd.tmp_back_deps.insert(*j);
-					}
-			}
+	debug::Profile::Scope profile("find_deps", "renderer");
 
-			Task::Set::iterator j = i;
-			++i;
-			++iterations;
-
-			if (task_rd.tmp_deps.empty())
-				tasks_to_process.erase(j);
-		}
-	}
+	long long edges = Dependencies::build(list, batch_index);
 
 	#ifdef DEBUG_TASK_MEASURE
-	info("find deps iterations: %d (%d from %d tasks not optimized)", iterations, (int)tasks_to_process.size(), (int)list.size());
+	info("find deps: %lld dependencies for %d tasks", edges, (int)list.size());
+	#else
+	(void)edges;
 	#endif
-
-	// copy tmp_deps to deps
-	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i) {
-		Task::Handle task = *i;
-		Task::RendererData &task_rd = task->renderer_data;
-
-		task_rd.deps     .insert(task_rd.tmp_deps     .begin(), task_rd.tmp_deps     .end());
-		task_rd.back_deps.insert(task_rd.tmp_back_deps.begin(), task_rd.tmp_back_deps.end());
-
-		task_rd.tmp_deps.clear();
-		task_rd.tmp_back_deps.clear();
-	}
 }
 
 bool
@@ -793,17 +680,11 @@ Renderer::run(const Task::List &list, bool quiet) const
 {
 	//if (!quiet) info("renderer.debug.result_image: %s", get_debug_options().result_image.c_str());
 
-	#ifdef DEBUG_TASK_MEASURE
-	if (!quiet) debug::Measure t("Renderer::run");
-	#endif
-
 	TaskEvent::Handle task_event = new TaskEvent();
 	enqueue(list, task_event, quiet);
 
 	{
-		#ifdef DEBUG_TASK_MEASURE
-		if (!quiet) debug::Measure t("run tasks");
-		#endif
+		debug::Profile::Scope profile("run_tasks", "renderer");
 
 		task_event->wait();
 	}
@@ -829,9 +710,7 @@ Renderer::enqueue(const Task::List &list, const TaskEvent::Handle &finish_event_
 	//if (!quiet) info("renderer.debug.task_list_log: %s", get_debug_options().task_list_log.c_str());
 	//if (!quiet) info("renderer.debug.task_list_optimized_log: %s", get_debug_options().task_list_optimized_log.c_str());
 
-	#ifdef DEBUG_TASK_MEASURE
-	if (!quiet) debug::Measure t("Renderer::enqueue");
-	#endif
+	debug::Profile::Scope profile("enqueue", "renderer");
 
 	#ifdef DEBUG_TASK_LIST
 	if (!quiet) log("", list, "input list");
@@ -862,7 +741,10 @@ Renderer::enqueue(const Task::List &list, const TaskEvent::Handle &finish_event_
 	// try to find existing handle to this renderer instead,
 	// because creation and destruction of handle may cause destruction of renderer
 	// if it never stored in handles before
-	queue->enqueue(optimized_list, Task::RunParams( get_renderer(get_name()) ));
+	Task::RunParams params( get_renderer(get_name()) );
+	params.job = debug::Profile::get_job();
+	params.frame = debug::Profile::get_frame();
+	queue->enqueue(optimized_list, params);
 }
 
 void Renderer::cancel(const Task::Handle &task)
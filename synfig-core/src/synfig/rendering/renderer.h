@@ -134,11 +134,6 @@ private:
 	static void initialize_renderers();
 	static void deinitialize_renderers();
 
-	typedef std::pair<Surface::Handle, int>             DepTargetKey;
-	typedef std::pair<Task::Handle, Task::Set>          DepTargetValue;
-	typedef std::multimap<DepTargetKey, DepTargetValue> DepTargetMap;
-	typedef DepTargetMap::value_type                    DepTargetPair;
-
 	void find_deps(const Task::List &list, long long batch_index) const;
 
 public:
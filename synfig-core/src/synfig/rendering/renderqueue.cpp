@@ -39,7 +39,7 @@
 #include <synfig/localization.h>
 #include <synfig/debug/debugsurface.h>
 #include <synfig/debug/log.h>
-#include <synfig/debug/measure.h>
+#include <synfig/debug/profile.h>
 
 #include "renderqueue.h"
 #include "renderer.h"
@@ -134,8 +134,16 @@ RenderQueue::stop()
 void
 RenderQueue::process(int thread_index)
 {
+	#ifndef SYNFIG_DISABLE_PROFILE
+	debug::Profile::set_thread_name(etl::strprintf("render %d", thread_index));
+	#endif
+
 	while(Task::Handle task = get(thread_index))
 	{
+		// sub-queues enqueued by the task belong to the same job and frame
+		debug::Profile::JobScope job_scope(task->renderer_data.params.job);
+		debug::Profile::FrameScope frame_scope(task->renderer_data.params.frame);
+
 		#ifdef DEBUG_THREAD_TASK
 		info( "thread %d: begin task #%05d-%04d '%s'",
 			  thread_index,
@@ -153,6 +161,7 @@ RenderQueue::process(int thread_index)
 
 		bool success = false;
 		try {
+			debug::Profile::Scope profile(task->get_token()->name.c_str(), "task");
 			success = task->run(task->renderer_data.params);
 		} catch(...) { }
 		if (!success)
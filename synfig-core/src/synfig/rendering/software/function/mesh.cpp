@@ -32,6 +32,9 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <vector>
+
 #include "mesh.h"
 
 #endif
@@ -86,6 +89,81 @@ namespace {
 			if (coords[1] < 0.0 || coords[1] > size[1])
 				coords[1] -= floor(coords[1]/size[1])*size[1];
 		}
+
+		//! Draws pixels [x0, x1] of row y of textured triangle.
+		//! Texture coordinates are interpolated and texels are fetched by batches,
+		//! so each of the loops is short and simple.
+		static void render_span(
+			synfig::Surface::alpha_pen &apen,
+			int y,
+			int x0,
+			int x1,
+			const Matrix &matrix,
+			const Vector &tdx,
+			const synfig::Surface &texture,
+			const Rect &tex_bounds,
+			Color::value_type opacity )
+		{
+			const int n = 64;
+			Real tx[n], ty[n];
+			bool inside[n];
+			Color colors[n];
+
+			const Vector tex_point = matrix.get_transformed(Vector(Real(x0), Real(y)));
+			apen.move_to(x0, y);
+			for(int x = x0; x <= x1; x += n)
+			{
+				const int count = std::min(n, x1 - x + 1);
+				const Real offset = Real(x - x0);
+
+				// interpolate texture coordinates
+				for(int i = 0; i < count; ++i)
+				{
+					tx[i] = tex_point[0] + (offset + i)*tdx[0];
+					ty[i] = tex_point[1] + (offset + i)*tdx[1];
+				}
+				for(int i = 0; i < count; ++i)
+					inside[i] = tx[i] >= tex_bounds.minx && tx[i] <= tex_bounds.maxx
+							 && ty[i] >= tex_bounds.miny && ty[i] <= tex_bounds.maxy;
+
+				// fetch texels
+				for(int i = 0; i < count; ++i)
+					colors[i] = inside[i] ? texture.cubic_sample(tx[i], ty[i]) : Color();
+
+				// blend
+				for(int i = 0; i < count; ++i)
+				{
+					apen.set_alpha(inside[i] ? opacity : Color::value_type(0.0));
+					apen.put_value(colors[i]);
+					apen.inc_x();
+				}
+			}
+		}
+
+		//! Returns count of vertices referenced by triangles
+		static int get_vertices_count(const int *triangles, int triangles_strip, int triangles_count)
+		{
+			int count = 0;
+			for(int i = 0; i < triangles_count; ++i)
+			{
+				const int *triangle = (const int*)((const char*)triangles + i*triangles_strip);
+				count = std::max(count, std::max(triangle[0], std::max(triangle[1], triangle[2])) + 1);
+			}
+			return count;
+		}
+
+		//! Transforms each vertex once, instead of once per each triangle which uses it
+		static void transform_vertices(
+			std::vector<Vector> &out,
+			const Vector *vertices,
+			int vertices_strip,
+			int vertices_count,
+			const Matrix &matrix )
+		{
+			out.resize(vertices_count);
+			for(int i = 0; i < vertices_count; ++i)
+				out[i] = matrix.get_transformed(*(const Vector*)((const char*)vertices + i*vertices_strip));
+		}
 	};
 }
 
@@ -297,26 +375,9 @@ software::Mesh::render_triangle(
 			if (x1 >= bounds.maxx) x1 = bounds.maxx-1;
 			if (x1 >= x0)
 			{
-				apen.move_to(x0, y);
-				Vector tex_point = matrix.get_transformed(Vector(Real(x0), Real(y)));
-				for(int x = x0; x <= x1; ++x)
-				{
-					if (tex_point[0] < tex_bounds.minx || tex_point[0] > tex_bounds.maxx
-					 || tex_point[1] < tex_bounds.miny || tex_point[1] > tex_bounds.maxy)
-					{
-						apen.set_alpha(0.0);
-						apen.put_value(Color());
-					}
-					else
-					{
-						apen.set_alpha(opacity);
-						apen.put_value(texture.cubic_sample(tex_point[0], tex_point[1]));
-					}
-					// uncomment following line to debug
-					//apen.put_value(Color(0,0,1,0.5));
-					apen.inc_x();
-					tex_point += tdx;
-				}
+				Internal::render_span(
+					apen, y, x0, x1, matrix, tdx,
+					texture, tex_bounds, opacity );
 			}
     	}
 
@@ -346,26 +407,9 @@ software::Mesh::render_triangle(
 			if (x1 >= bounds.maxx) x1 = bounds.maxx-1;
 			if (x1 >= x0)
 			{
-				apen.move_to(x0, y);
-				Vector tex_point = matrix.get_transformed(Vector(Real(x0), Real(y)));
-				for(int x = x0; x <= x1; ++x)
-				{
-					if (tex_point[0] < tex_bounds.minx || tex_point[0] > tex_bounds.maxx
-					 || tex_point[1] < tex_bounds.miny || tex_point[1] > tex_bounds.maxy)
-					{
-						apen.set_alpha(0.0);
-						apen.put_value(Color());
-					}
-					else
-					{
-						apen.set_alpha(opacity);
-						apen.put_value(texture.cubic_sample(tex_point[0], tex_point[1]));
-					}
-					// uncomment following line to debug
-					//apen.put_value(Color(1,0,0,0.5));
-					apen.inc_x();
-					tex_point += tdx;
-				}
+				Internal::render_span(
+					apen, y, x0, x1, matrix, tdx,
+					texture, tex_bounds, opacity );
 			}
     	}
 
@@ -396,15 +440,21 @@ software::Mesh::render_polygon(
 	if (vertices_strip <= 0) vertices_strip = sizeof(Vector);
 	if (triangles_strip <= 0) triangles_strip = sizeof(int[3]);
 
+	std::vector<Vector> points;
+	Internal::transform_vertices(
+		points, vertices, vertices_strip,
+		Internal::get_vertices_count(triangles, triangles_strip, triangles_count),
+		transform_matrix );
+
 	for(int i = 0; i < triangles_count; ++i)
 	{
 		int *triangle = (int*)((char*)triangles + i*triangles_strip);
 		render_triangle(
 			target_surface,
 			target_rect,
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[0]*vertices_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[1]*vertices_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[2]*vertices_strip)),
+			points[triangle[0]],
+			points[triangle[1]],
+			points[triangle[2]],
 			color,
 			opacity,
 			blend_method );
@@ -474,18 +524,32 @@ software::Mesh::render_mesh(
 	if (tex_coords_strip <= 0) tex_coords_strip = sizeof(Vector);
 	if (triangles_strip <= 0) triangles_strip = sizeof(int[3]);
 
+	const int vertices_count = Internal::get_vertices_count(triangles, triangles_strip, triangles_count);
+	std::vector<Vector> points, tex_points;
+	Internal::transform_vertices(points, vertices, vertices_strip, vertices_count, transform_matrix);
+	Internal::transform_vertices(tex_points, tex_coords, tex_coords_strip, vertices_count, texture_matrix);
+
+	// when target is a part of the whole image (see TaskMeshSW)
+	// most of triangles are outside, so skip them before any other work
+	const Rect boundsf(bounds.minx - 1, bounds.miny - 1, bounds.maxx + 1, bounds.maxy + 1);
 	for(int i = 0; i < triangles_count; ++i)
 	{
 		int *triangle = (int*)((char*)triangles + i*triangles_strip);
+		const Vector &p0 = points[triangle[0]];
+		const Vector &p1 = points[triangle[1]];
+		const Vector &p2 = points[triangle[2]];
+		if ( (p0[0] < boundsf.minx && p1[0] < boundsf.minx && p2[0] < boundsf.minx)
+		  || (p0[1] < boundsf.miny && p1[1] < boundsf.miny && p2[1] < boundsf.miny)
+		  || (p0[0] > boundsf.maxx && p1[0] > boundsf.maxx && p2[0] > boundsf.maxx)
+		  || (p0[1] > boundsf.maxy && p1[1] > boundsf.maxy && p2[1] > boundsf.maxy) )
+			continue;
+
 		render_triangle(
 			target_surface,
 			target_rect,
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[0]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[0]*tex_coords_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[1]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[1]*tex_coords_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[2]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[2]*tex_coords_strip)),
+			p0, tex_points[triangle[0]],
+			p1, tex_points[triangle[1]],
+			p2, tex_points[triangle[2]],
 			texture,
 			texture_rect,
 			opacity,
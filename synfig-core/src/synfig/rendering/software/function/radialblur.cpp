@@ -0,0 +1,239 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/radialblur.cpp
+**	\brief RadialBlur
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "radialblur.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+const int max_passes = 16;
+
+//! Premultiplied colors of the part of the source
+class Buffer
+{
+public:
+	RectInt rect;
+	int width;
+	std::vector<Color> pixels;
+
+	explicit Buffer(const RectInt &rect):
+		rect(rect),
+		width(rect.get_width()),
+		pixels(rect.get_width()*rect.get_height(), Color(0.0, 0.0, 0.0, 0.0)) { }
+
+	Color* row(int y)
+		{ return &pixels[(y - rect.miny)*width] - rect.minx; }
+	const Color* row(int y) const
+		{ return &pixels[(y - rect.miny)*width] - rect.minx; }
+
+	//! Bilinear sample at point \a x, \a y (in pixels, centers of pixels are at x.5),
+	//! pixels outside of the buffer are transparent
+	Color sample(Real x, Real y) const {
+		x -= 0.5; y -= 0.5;
+		const int ix = (int)std::floor(x);
+		const int iy = (int)std::floor(y);
+		const ColorReal fx = (ColorReal)(x - ix);
+		const ColorReal fy = (ColorReal)(y - iy);
+
+		if ( ix >= rect.minx && iy >= rect.miny
+		  && ix + 1 < rect.maxx && iy + 1 < rect.maxy )
+		{
+			const Color *r0 = row(iy) + ix;
+			const Color *r1 = r0 + width;
+			return (r0[0]*(1 - fx) + r0[1]*fx)*(1 - fy)
+			     + (r1[0]*(1 - fx) + r1[1]*fx)*fy;
+		}
+
+		Color c(0.0, 0.0, 0.0, 0.0);
+		const ColorReal wx[2] = { 1 - fx, fx };
+		const ColorReal wy[2] = { 1 - fy, fy };
+		for(int j = 0; j < 2; ++j)
+			for(int i = 0; i < 2; ++i)
+				if ( ix + i >= rect.minx && iy + j >= rect.miny
+				  && ix + i < rect.maxx && iy + j < rect.maxy )
+					c += row(iy + j)[ix + i]*(wx[i]*wy[j]);
+		return c;
+	}
+};
+
+//! One blending pass: dst(p) = a*src(p) + (1 - a)*src(origin + (p - origin)*scale)
+void
+blend_scaled(Buffer &dst, const Buffer &src, const Vector &origin, Real scale, ColorReal a)
+{
+	const ColorReal b = 1 - a;
+	for(int y = dst.rect.miny; y < dst.rect.maxy; ++y) {
+		const Real sy = origin[1] + (y + 0.5 - origin[1])*scale;
+		const Color *s = src.row(y);
+		Color *d = dst.row(y);
+		for(int x = dst.rect.minx; x < dst.rect.maxx; ++x) {
+			const Real sx = origin[0] + (x + 0.5 - origin[0])*scale;
+			d[x] = s[x]*a + src.sample(sx, sy)*b;
+		}
+	}
+}
+
+//! Makes passes with scales f, f^2, f^4, ... and weights of scaled copies proportional to scale^power,
+//! so the result is the sum of src(origin + (p - origin)*f^j)*f^(j*power) for j = 0..2^passes-1
+//! divided by the sum of the weights
+void
+blur_passes(Buffer &buffer, Buffer &tmp, const Vector &origin, Real f, int passes, int power)
+{
+	Real scale = f;
+	for(int i = 0; i < passes; ++i, scale *= scale) {
+		const Real w = std::pow(scale, (Real)power);
+		blend_scaled(tmp, buffer, origin, scale, (ColorReal)(1/(1 + w)));
+		std::swap(buffer.pixels, tmp.pixels);
+	}
+}
+
+} // end of anonimous namespace
+
+/* === M E T H O D S ======================================================= */
+
+int
+RadialBlur::calc_passes(Real length, Real size)
+{
+	if (!(length > 0) || !(size > 0))
+		return 0;
+	const Real min_scale = std::max(1 - size, std::min(0.5, 1/length));
+	// samples near the farthest pixel must be closer than a half of pixel
+	const Real samples = 2*length*std::log(1/min_scale);
+	int passes = 0;
+	while(passes < max_passes && (Real)((1 << passes) - 1) < samples)
+		++passes;
+	return passes;
+}
+
+void
+RadialBlur::blur(
+	synfig::Surface &dest,
+	const RectInt &dest_rect,
+	const synfig::Surface &src,
+	const VectorInt &src_offset,
+	const Vector &origin,
+	Real size,
+	bool fade_out )
+{
+	if (!dest_rect.is_valid())
+		return;
+
+	const RectInt src_bounds(0, 0, src.get_w(), src.get_h());
+	const RectInt rect = dest_rect + src_offset;
+
+	// find the farthest pixel and count of passes
+	Real length = 0;
+	for(int i = 0; i < 4; ++i) {
+		const Vector corner((i & 1) ? rect.maxx : rect.minx, (i & 2) ? rect.maxy : rect.miny);
+		length = std::max(length, (corner - origin).mag());
+	}
+	const int passes = calc_passes(length, size);
+	const Real min_scale = std::max(1 - size, std::min(0.5, length > 0 ? 1/length : 0.5));
+
+	// all samples are taken between pixels of the rect and its scaled copy,
+	// add margin for interpolation
+	Rect bounds(rect.minx, rect.miny, rect.maxx, rect.maxy);
+	bounds.expand( Vector(rect.minx, rect.miny)*min_scale + origin*(1 - min_scale) );
+	bounds.expand( Vector(rect.maxx, rect.maxy)*min_scale + origin*(1 - min_scale) );
+	const int margin = 2;
+	RectInt buffer_rect(
+		(int)std::floor(bounds.minx) - margin,
+		(int)std::floor(bounds.miny) - margin,
+		(int)std::ceil (bounds.maxx) + margin,
+		(int)std::ceil (bounds.maxy) + margin );
+	rect_set_intersect(buffer_rect, buffer_rect, src_bounds);
+	if (!buffer_rect.is_valid()) {
+		for(int y = dest_rect.miny; y < dest_rect.maxy; ++y)
+			for(int x = dest_rect.minx; x < dest_rect.maxx; ++x)
+				dest[y][x] = Color(0.0, 0.0, 0.0, 0.0);
+		return;
+	}
+
+	Buffer buffer(buffer_rect);
+	for(int y = buffer_rect.miny; y < buffer_rect.maxy; ++y) {
+		const Color *s = src[y];
+		Color *d = buffer.row(y);
+		for(int x = buffer_rect.minx; x < buffer_rect.maxx; ++x)
+			d[x] = s[x].premult_alpha();
+	}
+
+	Buffer tmp(buffer_rect);
+	const Real f = passes ? std::pow(min_scale, 1/(Real)((1 << passes) - 1)) : 1;
+
+	// linear distribution along the ray means the weight of sample
+	// with scale s is proportional to s,
+	// fade out multiplies it by (s - min_scale)
+	ColorReal k_squared = 0, k_linear = 1;
+	Buffer squared(fade_out && passes ? buffer_rect : RectInt(0, 0, 0, 0));
+	if (fade_out && passes) {
+		squared.pixels = buffer.pixels;
+		blur_passes(squared, tmp, origin, f, passes, 2);
+		Real sum_linear = 0, sum_squared = 0;
+		for(int j = (1 << passes) - 1; j >= 0; --j) {
+			sum_linear += std::pow(f, (Real)j);
+			sum_squared += std::pow(f, (Real)(2*j));
+		}
+		const Real sum = sum_squared - min_scale*sum_linear;
+		k_squared = (ColorReal)(sum_squared/sum);
+		k_linear = (ColorReal)(-min_scale*sum_linear/sum);
+	}
+	blur_passes(buffer, tmp, origin, f, passes, 1);
+
+	for(int y = dest_rect.miny; y < dest_rect.maxy; ++y) {
+		Color *d = dest[y];
+		for(int x = dest_rect.minx; x < dest_rect.maxx; ++x) {
+			const int sx = x + src_offset[0], sy = y + src_offset[1];
+			if (!buffer_rect.is_inside(VectorInt(sx, sy)))
+				{ d[x] = Color(0.0, 0.0, 0.0, 0.0); continue; }
+			Color c = buffer.row(sy)[sx]*k_linear;
+			if (k_squared)
+				c += squared.row(sy)[sx]*k_squared;
+			d[x] = c.get_a() > ColorReal(1e-6) ? c.demult_alpha() : Color(0.0, 0.0, 0.0, 0.0);
+		}
+	}
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,81 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/radialblur.h
+**	\brief RadialBlur Header
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_RADIALBLUR_H
+#define __SYNFIG_RENDERING_SOFTWARE_RADIALBLUR_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/rect.h>
+#include <synfig/surface.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+//! Averages colors along the rays from each pixel to the origin (radial or zoom blur).
+//!
+//! Color of pixel p is the average of src(origin + (p - origin)*s) for s in [1 - size, 1].
+//! Instead of sampling each ray, the image is blended with its scaled copy
+//! log2(n) times with scales f, f^2, f^4, ..., so after all passes each pixel
+//! contains n samples with scales f^j, j = 0..n-1, and weights are chosen so
+//! the result is equal to n samples uniformly distributed along the ray.
+class RadialBlur
+{
+public:
+	//! Returns count of blending passes required to blur the ray of \a length pixels
+	//! (from the farthest pixel to the origin) by the part \a size of the ray
+	static int calc_passes(Real length, Real size);
+
+	//! Blurs \a src and writes \a dest_rect of \a dest.
+	//! Pixel (x, y) of \a dest corresponds to pixel (x, y) + \a src_offset of \a src,
+	//! \a origin is given in pixels of \a src, pixels outside of \a src are transparent.
+	//! If \a fade_out is set, the colors near each pixel have more weight than far ones.
+	static void blur(
+		synfig::Surface &dest,
+		const RectInt &dest_rect,
+		const synfig::Surface &src,
+		const VectorInt &src_offset,
+		const Vector &origin,
+		Real size,
+		bool fade_out );
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -169,6 +169,37 @@ namespace {
 						fill_cut<pen, sampler_func>(p, i);
 			}
 
+			template<SamplerFunc sampler_func>
+			static inline void fill_points(Color *dest, const void *surface, const RectInt &bounds, const Vector *points, int count)
+			{
+				const Rect boundsf(bounds.minx, bounds.miny, bounds.maxx, bounds.maxy);
+				for(const Vector *p = points, *end = points + count; p < end; ++p, ++dest)
+					*dest = boundsf.is_inside(*p)
+						  ? sampler_func(surface, (*p)[0] - 0.5, (*p)[1] - 0.5)
+						  : Color(0.0, 0.0, 0.0, 0.0);
+			}
+
+			static void resample_points(
+				Color *dest,
+				const void *src,
+				const RectInt &src_bounds,
+				const Vector *points,
+				int count,
+				Color::Interpolation interpolation )
+			{
+				switch(interpolation)
+				{
+				case Color::INTERPOLATION_LINEAR:
+					fill_points< uncook<SamplerCook::linear_sample> >(dest, src, src_bounds, points, count); break;
+				case Color::INTERPOLATION_COSINE:
+					fill_points< uncook<SamplerCook::cosine_sample> >(dest, src, src_bounds, points, count); break;
+				case Color::INTERPOLATION_CUBIC:
+					fill_points< uncook<SamplerCook::cubic_sample> >(dest, src, src_bounds, points, count); break;
+				default:
+					fill_points< Sampler::nearest_sample >(dest, src, src_bounds, points, count); break;
+				}
+			}
+
 			template<typename pen>
 			static inline void fill(Color::Interpolation interpolation, bool cut, pen &p, Iterator &i)
 			{
@@ -573,5 +604,23 @@ software::Resample::resample(
 		blend_method );
 }
 
+void
+software::Resample::resample_points(
+	Color *dest,
+	const synfig::Surface &src,
+	const Vector *points,
+	int count,
+	Color::Interpolation interpolation )
+{
+	typedef synfig::Surface Surface;
+	Helper::Generic<Surface::reader, Surface::reader_cook>::resample_points(
+		dest,
+		&src,
+		RectInt(0, 0, src.get_w(), src.get_h()),
+		points,
+		count,
+		interpolation );
+}
+
 
 /* === E N T R Y P O I N T ================================================= */
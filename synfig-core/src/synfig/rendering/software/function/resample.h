@@ -86,6 +86,15 @@ public:
 		bool blend,
 		ColorReal blend_amount,
 		Color::BlendMethod blend_method );
+
+	//! Samples \a src at \a count points given in pixels of \a src
+	//! and writes the colors into \a dest, points outside of \a src are transparent
+	static void resample_points(
+		Color *dest,
+		const synfig::Surface &src,
+		const Vector *points,
+		int count,
+		Color::Interpolation interpolation );
 };
 
 } /* end namespace software */
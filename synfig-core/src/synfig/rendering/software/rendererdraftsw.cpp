@@ -43,6 +43,7 @@
 #include "../common/optimizer/optimizerblendtotarget.h"
 #include "../common/optimizer/optimizerdraft.h"
 #include "../common/optimizer/optimizerlist.h"
+#include "../common/optimizer/optimizerpixelprocessor.h"
 #include "../common/optimizer/optimizersplit.h"
 #include "../common/optimizer/optimizertransformation.h"
 #include "../common/optimizer/optimizerpass.h"
@@ -93,6 +94,7 @@ RendererDraftSW::RendererDraftSW()
 	register_optimizer(new OptimizerDraftLayerSkip("xor_pattern"));
 
 	register_optimizer(new OptimizerTransformation());
+	register_optimizer(new OptimizerPixelProcessor());
 	register_optimizer(new OptimizerDraftTransformation());
 
 	register_optimizer(new OptimizerPass(false));
@@ -42,6 +42,7 @@
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
 #include "../common/optimizer/optimizerlist.h"
+#include "../common/optimizer/optimizerpixelprocessor.h"
 #include "../common/optimizer/optimizersplit.h"
 #include "../common/optimizer/optimizertransformation.h"
 #include "../common/optimizer/optimizerpass.h"
@@ -68,6 +69,7 @@ RendererPreviewSW::RendererPreviewSW()
 
 	// register optimizers
 	register_optimizer(new OptimizerTransformation());
+	register_optimizer(new OptimizerPixelProcessor());
 	register_optimizer(new OptimizerDraftTransformation());
 	register_optimizer(new OptimizerPass(false));
 	register_optimizer(new OptimizerPass(true));
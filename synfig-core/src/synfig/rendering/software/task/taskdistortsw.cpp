@@ -0,0 +1,120 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/task/taskdistortsw.cpp
+**	\brief TaskDistortSW
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+
+#include "../../common/task/taskdistort.h"
+#include "tasksw.h"
+#include "../function/resample.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+namespace {
+
+class TaskDistortSW: public TaskDistort, public TaskSW
+{
+public:
+	typedef etl::handle<TaskDistortSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid() || !distortion || !sub_task() || !sub_task()->is_valid())
+			return true;
+
+		LockWrite la(this);
+		LockRead lb(sub_task());
+		if (!la || !lb)
+			return false;
+
+		const synfig::Surface &src = lb->get_surface();
+		synfig::Surface &dst = la->get_surface();
+
+		// units to pixels of source surface
+		RectInt src_target_rect = sub_task()->target_rect;
+		Vector src_lt = sub_task()->source_rect.get_min();
+		Vector src_rb = sub_task()->source_rect.get_max();
+		Vector src_k(
+			(src_target_rect.maxx - src_target_rect.minx)/(src_rb[0] - src_lt[0]),
+			(src_target_rect.maxy - src_target_rect.miny)/(src_rb[1] - src_lt[1]) );
+		Vector src_offset(
+			src_target_rect.minx - src_lt[0]*src_k[0],
+			src_target_rect.miny - src_lt[1]*src_k[1] );
+
+		const Vector upp = get_units_per_pixel();
+		const Vector lt = source_rect.get_min();
+
+		// transform and sample points by batches,
+		// so distortions may process several points at once
+		const int n = 64;
+		Vector points[n];
+		for(int iy = target_rect.miny; iy < target_rect.maxy; ++iy) {
+			// centers of pixels
+			Real y = lt[1] + (iy - target_rect.miny + 0.5)*upp[1];
+			for(int ix = target_rect.minx; ix < target_rect.maxx; ix += n) {
+				int count = std::min(n, target_rect.maxx - ix);
+				for(int i = 0; i < count; ++i)
+					points[i] = Vector(lt[0] + (ix - target_rect.minx + i + 0.5)*upp[0], y);
+
+				distortion->transform(points, count);
+
+				for(int i = 0; i < count; ++i)
+					points[i] = Vector(
+						points[i][0]*src_k[0] + src_offset[0],
+						points[i][1]*src_k[1] + src_offset[1] );
+				software::Resample::resample_points(
+					&dst[iy][ix], src, points, count, interpolation );
+			}
+		}
+
+		return true;
+	}
+};
+
+
+Task::Token TaskDistortSW::token(
+	DescReal<TaskDistortSW, TaskDistort>("DistortSW") );
+
+} // end of anonimous namespace
+
+/* === E N T R Y P O I N T ================================================= */
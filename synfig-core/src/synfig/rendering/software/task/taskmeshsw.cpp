@@ -51,7 +51,7 @@ using namespace rendering;
 
 namespace {
 
-class TaskMeshSW: public TaskMesh, public TaskSW
+class TaskMeshSW: public TaskMesh, public TaskSW, public TaskInterfaceSplit
 {
 	typedef etl::handle<TaskMeshSW> Handle;
 	static Token token;
@@ -32,6 +32,10 @@
 #	include <config.h>
 #endif
 
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
 #include <synfig/debug/debugsurface.h>
 #include <synfig/general.h>
 
@@ -61,7 +65,55 @@ public:
 	virtual Token::Handle get_token() const { return token.handle(); }
 
 private:
-	typedef void Func(ColorReal &dst, const ColorReal &src, const ColorReal &gamma);
+	//! Evaluates x^gamma by tables, 4 times faster than powf() with the same precision.
+	//! x^gamma = (2^e * (1 + m))^gamma = (2^e)^gamma * (1 + m)^gamma,
+	//! so one table contains powers of all exponents,
+	//! and another contains powers of mantissas which are linearly interpolated.
+	class PowTable
+	{
+	private:
+		enum {
+			MANTISSA_BITS = 10,
+			FRACTION_BITS = 23 - MANTISSA_BITS
+		};
+
+		ColorReal gamma;
+		bool tabulated;
+		float exponents[256];
+		float mantissas[(1 << MANTISSA_BITS) + 1];
+
+	public:
+		//! Filling of tables costs about 1300 calls of pow(),
+		//! so set \a tabulate only for large surfaces
+		PowTable(ColorReal gamma, bool tabulate): gamma(gamma), tabulated(tabulate)
+		{
+			if (!tabulated) return;
+			for(int i = 0; i < 256; ++i)
+				exponents[i] = (float)std::pow(2.0, (i - 127)*(double)gamma);
+			for(int i = 0; i <= (1 << MANTISSA_BITS); ++i)
+				mantissas[i] = (float)std::pow(1.0 + i/(double)(1 << MANTISSA_BITS), (double)gamma);
+		}
+
+		//! \a x must be non-negative
+		ColorReal pow(ColorReal x) const
+		{
+			if (!tabulated)
+				return powf(x, gamma);
+
+			uint32_t bits;
+			memcpy(&bits, &x, sizeof(bits));
+			const uint32_t e = bits >> 23;
+			if (e == 0 || e == 255) // zero, denormal, infinity or NaN
+				return powf(x, gamma);
+
+			const uint32_t index = (bits >> FRACTION_BITS) & ((1 << MANTISSA_BITS) - 1);
+			const float f = (float)(bits & ((1 << FRACTION_BITS) - 1)) * (1.f/(1 << FRACTION_BITS));
+			const float m = mantissas[index];
+			return (m + (mantissas[index + 1] - m)*f)*exponents[e];
+		}
+	};
+
+	typedef void Func(ColorReal &dst, const ColorReal &src, const PowTable &table);
 
 	struct Params
 	{
@@ -79,12 +131,7 @@ private:
 			};
 		};
 
-		Params():
-			dst(), dst_stride(),
-			src(), src_stride(),
-			width(), height(),
-			gamma_r(1.0), gamma_g(1.0), gamma_b(1.0)
-		{ }
+		const PowTable *table_r, *table_g, *table_b;
 
 		Params(
 			Color *dst,
@@ -95,12 +142,16 @@ private:
 			int height,
 			ColorReal gamma_r,
 			ColorReal gamma_g,
-			ColorReal gamma_b
+			ColorReal gamma_b,
+			const PowTable &table_r,
+			const PowTable &table_g,
+			const PowTable &table_b
 		):
 			dst((ColorReal*)dst), dst_stride(dst_stride),
 			src((const ColorReal*)src), src_stride(src_stride),
 			width(width), height(height),
-			gamma_r(gamma_r), gamma_g(gamma_g), gamma_b(gamma_b)
+			gamma_r(gamma_r), gamma_g(gamma_g), gamma_b(gamma_b),
+			table_r(&table_r), table_g(&table_g), table_b(&table_b)
 		{ }
 	};
 
@@ -116,16 +167,17 @@ private:
 		return std::max(real_low_precision<ColorReal>(), std::min(max, x));
 	}
 
-	static inline void func_none(ColorReal&, const ColorReal&, const ColorReal&) { }
-	static inline void func_copy(ColorReal &dst, const ColorReal &src, const ColorReal&)
+	static inline void func_none(ColorReal&, const ColorReal&, const PowTable&) { }
+	static inline void func_copy(ColorReal &dst, const ColorReal &src, const PowTable&)
 		{ dst = src; }
-	static inline void func_one(ColorReal &dst, const ColorReal &, const ColorReal &)
+	static inline void func_one(ColorReal &dst, const ColorReal &, const PowTable&)
 		{ dst = ColorReal(1.0); }
-	static inline void func_pow(ColorReal &dst, const ColorReal &src, const ColorReal &gamma)
-		{ dst = clamp(src < 0 ? -pow(-src, gamma) : pow(src, gamma)); }
+	static inline void func_pow(ColorReal &dst, const ColorReal &src, const PowTable &table)
+		{ dst = clamp(src < 0 ? -table.pow(-src) : table.pow(src)); }
 
 	template<Func fr, Func fg, Func fb>
 	static void process_rgb(const Params &p) {
+		const PowTable &tr = *p.table_r, &tg = *p.table_g, &tb = *p.table_b;
 		if (p.src == p.dst)
 		{
 			assert(p.src_stride == p.dst_stride);
@@ -137,9 +189,9 @@ private:
 			{
 				for(ColorReal *dst_row_end = dst + row_size; dst != dst_row_end; dst += 4)
 				{
-					fr(dst[0], dst[0], p.gamma_r);
-					fg(dst[1], dst[1], p.gamma_g);
-					fb(dst[2], dst[2], p.gamma_b);
+					fr(dst[0], dst[0], tr);
+					fg(dst[1], dst[1], tg);
+					fb(dst[2], dst[2], tb);
 				}
 			}
 		}
@@ -156,9 +208,9 @@ private:
 			{
 				for(ColorReal *dst_row_end = dst + row_size; dst != dst_row_end; dst += 4, src += 4)
 				{
-					fr(dst[0], src[0], p.gamma_r);
-					fg(dst[1], src[1], p.gamma_g);
-					fb(dst[2], src[2], p.gamma_b);
+					fr(dst[0], src[0], tr);
+					fg(dst[1], src[1], tg);
+					fb(dst[2], src[2], tb);
 					dst[3] = src[3];
 				}
 			}
@@ -188,35 +240,96 @@ private:
 				                                              process_r<func_copy>(p);
 	}
 
+	//! Applies matrix_before, gamma and matrix_after.
+	//! When matrices are used the surface is processed row by row,
+	//! so each row is still in cache for the next step.
+	void process_fused(
+		Color *dst,
+		int dst_stride,
+		const Color *src,
+		int src_stride,
+		int width,
+		int height ) const
+	{
+		const ColorReal gamma_r = clamp_positive(gamma.get_r());
+		const ColorReal gamma_g = clamp_positive(gamma.get_g());
+		const ColorReal gamma_b = clamp_positive(gamma.get_b());
+
+		const int min_tabulated_area = 64*64;
+		const bool tabulate = width*height >= min_tabulated_area;
+		const PowTable table_r(gamma_r, tabulate);
+		const PowTable table_g(gamma_g, tabulate);
+		const PowTable table_b(gamma_b, tabulate);
+
+		ColorMatrix::BatchProcessor before(matrix_before);
+		ColorMatrix::BatchProcessor after(matrix_after);
+
+		if (before.is_copy() && after.is_copy())
+		{
+			process(Params(
+				dst, dst_stride, src, src_stride, width, height,
+				gamma_r, gamma_g, gamma_b, table_r, table_g, table_b ));
+			return;
+		}
+
+		for(int i = 0; i < height; ++i, dst += dst_stride, src += src_stride)
+		{
+			const Color *row = src;
+			if (!before.is_copy())
+				{ before.process(dst, width, row, width, width, 1); row = dst; }
+			process(Params(
+				dst, width, row, width, width, 1,
+				gamma_r, gamma_g, gamma_b, table_r, table_g, table_b ));
+			if (!after.is_copy())
+				after.process(dst, width, dst, width, width, 1);
+		}
+	}
+
 public:
 	virtual bool run(RunParams&) const {
-		if (!is_valid() || !sub_task() || !sub_task()->is_valid())
+		if (!is_valid())
+			return true;
+
+		const bool affects_transparent = is_affects_transparent();
+		const bool has_source = sub_task() && sub_task()->is_valid();
+		if (!has_source && !affects_transparent)
 			return true;
 
 		RectInt rd = target_rect;
-		VectorInt offset = get_offset();
-		RectInt rs = sub_task()->target_rect + rd.get_min() + offset;
-		rect_set_intersect(rs, rs, rd);
-		if (rs.is_valid())
-		{
-			LockWrite ldst(this);
-			if (!ldst) return false;
-			LockRead lsrc(sub_task());
-			if (!lsrc) return false;
+		std::vector<RectInt> transparent_rects(1, rd);
 
-			synfig::Surface &dst = ldst->get_surface();
-			const synfig::Surface &src = lsrc->get_surface();
+		LockWrite ldst(this);
+		if (!ldst) return false;
+		synfig::Surface &dst = ldst->get_surface();
 
-			process(Params(
-				&dst[rs.miny][rs.minx],
-				dst.get_pitch()/sizeof(Color),
-				&src[rs.miny - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]],
-				src.get_pitch()/sizeof(Color),
-				rs.get_width(),
-				rs.get_height(),
-				clamp_positive(gamma.get_r()),
-				clamp_positive(gamma.get_g()),
-				clamp_positive(gamma.get_b()) ));
+		if (has_source)
+		{
+			VectorInt offset = get_offset();
+			RectInt rs = sub_task()->target_rect + rd.get_min() + offset;
+			rect_set_intersect(rs, rs, rd);
+			if (rs.is_valid())
+			{
+				LockRead lsrc(sub_task());
+				if (!lsrc) return false;
+				const synfig::Surface &src = lsrc->get_surface();
+
+				process_fused(
+					&dst[rs.miny][rs.minx],
+					dst.get_pitch()/sizeof(Color),
+					&src[rs.miny - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]],
+					src.get_pitch()/sizeof(Color),
+					rs.get_width(),
+					rs.get_height() );
+				rs.list_subtract(transparent_rects);
+			}
+		}
+
+		if (affects_transparent)
+		{
+			Color color = Color(0.0, 0.0, 0.0, 0.0);
+			process_fused(&color, 1, &color, 1, 1, 1);
+			for(std::vector<RectInt>::const_iterator i = transparent_rects.begin(); i != transparent_rects.end(); ++i)
+				dst.fill(color, i->minx, i->miny, i->get_width(), i->get_height());
 		}
 
 		return true;
@@ -85,7 +85,7 @@ Task::Token::prepare_vfunc()
 
 
 Task::RunParams::RunParams(const Renderer::Handle &renderer):
-	rendererHolder(renderer), renderer(renderer.get()) { }
+	rendererHolder(renderer), renderer(renderer.get()), job(-1), frame(-1) { }
 
 
 Task::Task():
@@ -271,7 +271,9 @@ public:
 		etl::handle<etl::shared_object> rendererHolder;
 		Renderer *renderer;
 		mutable Task::List sub_queue;
-		RunParams(): renderer() { }
+		int job;   //!< job for the profiling output, see debug::Profile
+		int frame; //!< frame for the profiling output, see debug::Profile
+		RunParams(): renderer(), job(-1), frame(-1) { }
 		explicit RunParams(const etl::handle<Renderer> &renderer);
 	};
 
@@ -282,9 +284,6 @@ public:
 		Set deps;
 		Set back_deps;
 
-		Set tmp_deps;
-		Set tmp_back_deps;
-
 		RunParams params;
 		bool success;
 
@@ -34,6 +34,9 @@
 #	include <config.h>
 #endif
 
+#include <cstdio>
+#include <sstream>
+
 #include "savecanvas.h"
 #include "general.h"
 #include <synfig/localization.h>
@@ -64,8 +67,8 @@
 #include "zstreambuf.h"
 #include "importer.h"
 
-#include <libxml++/libxml++.h>
 #include "gradient.h"
+#include "xmlwriter.h"
 
 
 #endif
@@ -84,6 +87,20 @@ using namespace synfig;
 
 /* === G L O B A L S ======================================================= */
 
+namespace {
+
+//! Formats a number into a buffer on the stack, avoiding the heap allocations of strprintf()
+class NumberString
+{
+	char buffer[64];
+public:
+	NumberString(const char *format, double x) { snprintf(buffer, sizeof(buffer), format, x); }
+	NumberString(const char *format, int x) { snprintf(buffer, sizeof(buffer), format, x); }
+	operator const char*() const { return buffer; }
+};
+
+}
+
 ReleaseVersion save_canvas_version = ReleaseVersion(RELEASE_VERSION_END-1);
 int valuenode_too_new_count;
 save_canvas_external_file_callback_t save_canvas_external_file_callback = nullptr;
@@ -91,12 +108,12 @@ void *save_canvas_external_file_user_data = nullptr;
 
 /* === P R O C E D U R E S ================================================= */
 
-xmlpp::Element* encode_canvas(xmlpp::Element* root,Canvas::ConstHandle canvas);
-xmlpp::Element* encode_value_node(xmlpp::Element* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas);
-xmlpp::Element* encode_value_node_bone(xmlpp::Element* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas);
-xmlpp::Element* encode_value_node_bone_id(xmlpp::Element* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas);
+XmlElement* encode_canvas(XmlElement* root,Canvas::ConstHandle canvas);
+XmlElement* encode_value_node(XmlElement* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas);
+XmlElement* encode_value_node_bone(XmlElement* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas);
+XmlElement* encode_value_node_bone_id(XmlElement* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas);
 
-xmlpp::Element* encode_keyframe(xmlpp::Element* root,const Keyframe &kf, float fps)
+XmlElement* encode_keyframe(XmlElement* root,const Keyframe &kf, float fps)
 {
 	root->set_name("keyframe");
  	root->set_attribute("time",kf.get_time().get_string(fps));
@@ -106,7 +123,7 @@ xmlpp::Element* encode_keyframe(xmlpp::Element* root,const Keyframe &kf, float f
 	return root;
 }
 
-xmlpp::Element* encode_interpolation(xmlpp::Element* root,Interpolation value,String attribute)
+XmlElement* encode_interpolation(XmlElement* root,Interpolation value,String attribute)
 {
 	if (value!=INTERPOLATION_UNDEFINED)
 	{
@@ -137,7 +154,7 @@ xmlpp::Element* encode_interpolation(xmlpp::Element* root,Interpolation value,St
 	return root;
 }
 
-xmlpp::Element* encode_static(xmlpp::Element* root,bool s)
+XmlElement* encode_static(XmlElement* root,bool s)
 {
 	if(s)
 		root->set_attribute("static", s?"true":"false");
@@ -145,67 +162,67 @@ xmlpp::Element* encode_static(xmlpp::Element* root,bool s)
 }
 
 
-xmlpp::Element* encode_real(xmlpp::Element* root,Real v)
+XmlElement* encode_real(XmlElement* root,Real v)
 {
 	root->set_name("real");
-	root->set_attribute("value",strprintf(VECTOR_VALUE_TYPE_FORMAT,v));
+	root->set_attribute("value",NumberString(VECTOR_VALUE_TYPE_FORMAT,v));
 	return root;
 }
 
-xmlpp::Element* encode_time(xmlpp::Element* root,Time t)
+XmlElement* encode_time(XmlElement* root,Time t)
 {
 	root->set_name("time");
 	root->set_attribute("value",t.get_string());
 	return root;
 }
 
-xmlpp::Element* encode_integer(xmlpp::Element* root,int i)
+XmlElement* encode_integer(XmlElement* root,int i)
 {
 	root->set_name("integer");
-	root->set_attribute("value",strprintf("%i",i));
+	root->set_attribute("value",NumberString("%i",i));
 	return root;
 }
 
-xmlpp::Element* encode_bool(xmlpp::Element* root, bool b)
+XmlElement* encode_bool(XmlElement* root, bool b)
 {
 	root->set_name("bool");
 	root->set_attribute("value",b?"true":"false");
 	return root;
 }
 
-xmlpp::Element* encode_string(xmlpp::Element* root,const String &str)
+XmlElement* encode_string(XmlElement* root,const String &str)
 {
 	root->set_name("string");
 	root->set_child_text(str);
 	return root;
 }
 
-xmlpp::Element* encode_vector(xmlpp::Element* root,Vector vect)
+XmlElement* encode_vector(XmlElement* root,Vector vect)
 {
 	root->set_name("vector");
-	root->add_child("x")->set_child_text(strprintf(VECTOR_VALUE_TYPE_FORMAT,(float)vect[0]));
-	root->add_child("y")->set_child_text(strprintf(VECTOR_VALUE_TYPE_FORMAT,(float)vect[1]));
+	root->add_child("x")->set_child_text(NumberString(VECTOR_VALUE_TYPE_FORMAT,(float)vect[0]));
+	root->add_child("y")->set_child_text(NumberString(VECTOR_VALUE_TYPE_FORMAT,(float)vect[1]));
 	return root;
 }
 
-xmlpp::Element* encode_color(xmlpp::Element* root,Color color)
+XmlElement* encode_color(XmlElement* root,Color color)
 {
 	root->set_name("color");
-	root->add_child("r")->set_child_text(strprintf(COLOR_VALUE_TYPE_FORMAT,(float)color.get_r()));
-	root->add_child("g")->set_child_text(strprintf(COLOR_VALUE_TYPE_FORMAT,(float)color.get_g()));
-	root->add_child("b")->set_child_text(strprintf(COLOR_VALUE_TYPE_FORMAT,(float)color.get_b()));
-	root->add_child("a")->set_child_text(strprintf(COLOR_VALUE_TYPE_FORMAT,(float)color.get_a()));
+	root->add_child("r")->set_child_text(NumberString(COLOR_VALUE_TYPE_FORMAT,(float)color.get_r()));
+	root->add_child("g")->set_child_text(NumberString(COLOR_VALUE_TYPE_FORMAT,(float)color.get_g()));
+	root->add_child("b")->set_child_text(NumberString(COLOR_VALUE_TYPE_FORMAT,(float)color.get_b()));
+	root->add_child("a")->set_child_text(NumberString(COLOR_VALUE_TYPE_FORMAT,(float)color.get_a()));
 	return root;
 }
 
-xmlpp::Element* encode_angle(xmlpp::Element* root,Angle theta)
+XmlElement* encode_angle(XmlElement* root,Angle theta)
 {
 	root->set_name("angle");
-	root->set_attribute("value",strprintf("%f",(float)Angle::deg(theta).get()));
+	root->set_attribute("value",NumberString("%f",(float)Angle::deg(theta).get()));
 	return root;
 }
 
-xmlpp::Element* encode_segment(xmlpp::Element* root,Segment seg)
+XmlElement* encode_segment(XmlElement* root,Segment seg)
 {
 	root->set_name("segment");
 	encode_vector(root->add_child("p1")->add_child("vector"),seg.p1);
@@ -215,7 +232,7 @@ xmlpp::Element* encode_segment(xmlpp::Element* root,Segment seg)
 	return root;
 }
 
-xmlpp::Element* encode_bline_point(xmlpp::Element* root,BLinePoint bline_point)
+XmlElement* encode_bline_point(XmlElement* root,BLinePoint bline_point)
 {
 	root->set_name(type_bline_point.description.name);
 
@@ -230,7 +247,7 @@ xmlpp::Element* encode_bline_point(xmlpp::Element* root,BLinePoint bline_point)
 	return root;
 }
 
-xmlpp::Element* encode_width_point(xmlpp::Element* root,WidthPoint width_point)
+XmlElement* encode_width_point(XmlElement* root,WidthPoint width_point)
 {
 	root->set_name(type_width_point.description.name);
 	encode_real(root->add_child("position")->add_child("real"),width_point.get_position());
@@ -240,7 +257,7 @@ xmlpp::Element* encode_width_point(xmlpp::Element* root,WidthPoint width_point)
 	return root;
 }
 
-xmlpp::Element* encode_dash_item(xmlpp::Element* root, DashItem dash_item)
+XmlElement* encode_dash_item(XmlElement* root, DashItem dash_item)
 {
 	root->set_name(type_dash_item.description.name);
 	encode_real(root->add_child("offset")->add_child("real"),dash_item.get_offset());
@@ -250,23 +267,23 @@ xmlpp::Element* encode_dash_item(xmlpp::Element* root, DashItem dash_item)
 	return root;
 }
 
-xmlpp::Element* encode_gradient(xmlpp::Element* root,Gradient x)
+XmlElement* encode_gradient(XmlElement* root,Gradient x)
 {
 	root->set_name("gradient");
 	Gradient::const_iterator iter;
 	x.sort();
 	for(iter=x.begin();iter!=x.end();iter++)
 	{
-		xmlpp::Element *cpoint(encode_color(root->add_child("color"),iter->color));
-		cpoint->set_attribute("pos",strprintf("%f",iter->pos));
+		XmlElement *cpoint(encode_color(root->add_child("color"),iter->color));
+		cpoint->set_attribute("pos",NumberString("%f",iter->pos));
 	}
 	return root;
 }
 
 
-xmlpp::Element* encode_value(xmlpp::Element* root,const ValueBase &data,Canvas::ConstHandle canvas=nullptr);
+XmlElement* encode_value(XmlElement* root,const ValueBase &data,Canvas::ConstHandle canvas=nullptr);
 
-xmlpp::Element* encode_list(xmlpp::Element* root,std::vector<ValueBase> list, Canvas::ConstHandle canvas=nullptr)
+XmlElement* encode_list(XmlElement* root,std::vector<ValueBase> list, Canvas::ConstHandle canvas=nullptr)
 {
 	root->set_name("list");
 
@@ -279,7 +296,7 @@ xmlpp::Element* encode_list(xmlpp::Element* root,std::vector<ValueBase> list, Ca
 	return root;
 }
 
-xmlpp::Element* encode_transformation(xmlpp::Element* root,const Transformation &transformation)
+XmlElement* encode_transformation(XmlElement* root,const Transformation &transformation)
 {
 	root->set_name("transformation");
 	encode_vector(root->add_child("offset")->add_child("vector"),transformation.offset);
@@ -289,7 +306,7 @@ xmlpp::Element* encode_transformation(xmlpp::Element* root,const Transformation
 	return root;
 }
 
-xmlpp::Element* encode_weighted_value(xmlpp::Element* root,types_namespace::TypeWeightedValueBase &type, const ValueBase &data,Canvas::ConstHandle canvas)
+XmlElement* encode_weighted_value(XmlElement* root,types_namespace::TypeWeightedValueBase &type, const ValueBase &data,Canvas::ConstHandle canvas)
 {
 	root->set_name(type.description.name);
 	encode_real(root->add_child("weight")->add_child("real"), type.extract_weight(data));
@@ -297,7 +314,7 @@ xmlpp::Element* encode_weighted_value(xmlpp::Element* root,types_namespace::Type
 	return root;
 }
 
-xmlpp::Element* encode_pair(xmlpp::Element* root,types_namespace::TypePairBase &type, const ValueBase &data,Canvas::ConstHandle canvas)
+XmlElement* encode_pair(XmlElement* root,types_namespace::TypePairBase &type, const ValueBase &data,Canvas::ConstHandle canvas)
 {
 	root->set_name(type.description.name);
 	encode_value(root->add_child("first")->add_child("value"), type.extract_first(data), canvas);
@@ -305,7 +322,7 @@ xmlpp::Element* encode_pair(xmlpp::Element* root,types_namespace::TypePairBase &
 	return root;
 }
 
-xmlpp::Element* encode_value(xmlpp::Element* root,const ValueBase &data,Canvas::ConstHandle canvas)
+XmlElement* encode_value(XmlElement* root,const ValueBase &data,Canvas::ConstHandle canvas)
 {
 	if (getenv("SYNFIG_DEBUG_SAVE_CANVAS")) printf("%s:%d encode_value (type %s)\n", __FILE__, __LINE__, data.get_type().description.name.c_str());
 	Type &type(data.get_type());
@@ -437,7 +454,7 @@ xmlpp::Element* encode_value(xmlpp::Element* root,const ValueBase &data,Canvas::
 	return root;
 }
 
-xmlpp::Element* encode_animated(xmlpp::Element* root,ValueNode_Animated::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
+XmlElement* encode_animated(XmlElement* root,ValueNode_Animated::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
 {
 	assert(value_node);
 	root->set_name("animated");
@@ -451,7 +468,7 @@ xmlpp::Element* encode_animated(xmlpp::Element* root,ValueNode_Animated::ConstHa
 	
 	for(iter=waypoint_list.begin();iter!=waypoint_list.end();++iter)
 	{
-		xmlpp::Element *waypoint_node=root->add_child("waypoint");
+		XmlElement *waypoint_node=root->add_child("waypoint");
 		waypoint_node->set_attribute("time",iter->get_time().get_string());
 
 		if(iter->get_value_node()->is_exported())
@@ -481,13 +498,13 @@ xmlpp::Element* encode_animated(xmlpp::Element* root,ValueNode_Animated::ConstHa
 			error("Unknown waypoint type for \"after\" attribute");
 
 		if(iter->get_tension()!=0.0)
-			waypoint_node->set_attribute("tension",strprintf("%f",iter->get_tension()));
+			waypoint_node->set_attribute("tension",NumberString("%f",iter->get_tension()));
 		if(iter->get_temporal_tension()!=0.0)
-			waypoint_node->set_attribute("temporal-tension",strprintf("%f",iter->get_temporal_tension()));
+			waypoint_node->set_attribute("temporal-tension",NumberString("%f",iter->get_temporal_tension()));
 		if(iter->get_continuity()!=0.0)
-			waypoint_node->set_attribute("continuity",strprintf("%f",iter->get_continuity()));
+			waypoint_node->set_attribute("continuity",NumberString("%f",iter->get_continuity()));
 		if(iter->get_bias()!=0.0)
-			waypoint_node->set_attribute("bias",strprintf("%f",iter->get_bias()));
+			waypoint_node->set_attribute("bias",NumberString("%f",iter->get_bias()));
 
 	}
 
@@ -495,7 +512,7 @@ xmlpp::Element* encode_animated(xmlpp::Element* root,ValueNode_Animated::ConstHa
 }
 
 
-xmlpp::Element* encode_subtract(xmlpp::Element* root,ValueNode_Subtract::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
+XmlElement* encode_subtract(XmlElement* root,ValueNode_Subtract::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
 {
 	assert(value_node);
 	root->set_name("subtract");
@@ -533,7 +550,7 @@ xmlpp::Element* encode_subtract(xmlpp::Element* root,ValueNode_Subtract::ConstHa
 	return root;
 }
 
-xmlpp::Element* encode_static_list(xmlpp::Element* root,ValueNode_StaticList::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
+XmlElement* encode_static_list(XmlElement* root,ValueNode_StaticList::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
 {
 	if (getenv("SYNFIG_DEBUG_SAVE_CANVAS")) printf("%s:%d encode_static_list %s\n", __FILE__, __LINE__, value_node->get_string().c_str());
 	assert(value_node);
@@ -546,7 +563,7 @@ xmlpp::Element* encode_static_list(xmlpp::Element* root,ValueNode_StaticList::Co
 
 	for(iter=value_node->list.begin();iter!=value_node->list.end();++iter)
 	{
-		xmlpp::Element	*entry_node=root->add_child("entry");
+		XmlElement	*entry_node=root->add_child("entry");
 		assert(*iter);
 		if(!(*iter)->get_id().empty())
 			entry_node->set_attribute("use",(*iter)->get_relative_id(canvas));
@@ -561,7 +578,7 @@ xmlpp::Element* encode_static_list(xmlpp::Element* root,ValueNode_StaticList::Co
 	return root;
 }
 
-xmlpp::Element* encode_dynamic_list(xmlpp::Element* root,ValueNode_DynamicList::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
+XmlElement* encode_dynamic_list(XmlElement* root,ValueNode_DynamicList::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
 {
 	assert(value_node);
 	const float fps(canvas?canvas->rend_desc().get_frame_rate():0);
@@ -600,7 +617,7 @@ xmlpp::Element* encode_dynamic_list(xmlpp::Element* root,ValueNode_DynamicList::
 
 	for(iter=corrected_valuenode_list.begin();iter!=corrected_valuenode_list.end();++iter)
 	{
-		xmlpp::Element	*entry_node=root->add_child("entry");
+		XmlElement	*entry_node=root->add_child("entry");
 		assert(iter->value_node);
 		if(!iter->value_node->get_id().empty())
 			entry_node->set_attribute("use",iter->value_node->get_relative_id(canvas));
@@ -657,7 +674,7 @@ xmlpp::Element* encode_dynamic_list(xmlpp::Element* root,ValueNode_DynamicList::
 }
 
 // Generic linkable data node entry
-xmlpp::Element* encode_linkable_value_node(xmlpp::Element* root,LinkableValueNode::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
+XmlElement* encode_linkable_value_node(XmlElement* root,LinkableValueNode::ConstHandle value_node,Canvas::ConstHandle canvas=nullptr)
 {
 	if (getenv("SYNFIG_DEBUG_SAVE_CANVAS")) printf("%s:%d encode_linkable_value_node %s\n", __FILE__, __LINE__, value_node->get_string().c_str());
 	assert(value_node);
@@ -706,7 +723,7 @@ xmlpp::Element* encode_linkable_value_node(xmlpp::Element* root,LinkableValueNod
 	return root;
 }
 
-xmlpp::Element* encode_value_node(xmlpp::Element* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas)
+XmlElement* encode_value_node(XmlElement* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas)
 {
 	assert(value_node);
 	if (getenv("SYNFIG_DEBUG_SAVE_CANVAS")) printf("%s:%d encode_value_node %s %s\n", __FILE__, __LINE__, value_node->get_string().c_str(), value_node->get_guid().get_string().c_str());
@@ -761,7 +778,7 @@ xmlpp::Element* encode_value_node(xmlpp::Element* root,ValueNode::ConstHandle va
 	return root;
 }
 
-xmlpp::Element* encode_value_node_bone(xmlpp::Element* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas)
+XmlElement* encode_value_node_bone(XmlElement* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas)
 {
 	assert(value_node);
 	if (getenv("SYNFIG_DEBUG_SAVE_CANVAS")) printf("%s:%d encode_value_node_bone %s %s\n", __FILE__, __LINE__, value_node->get_string().c_str(), value_node->get_guid().get_string().c_str());
@@ -794,7 +811,7 @@ xmlpp::Element* encode_value_node_bone(xmlpp::Element* root,ValueNode::ConstHand
 	return root;
 }
 
-xmlpp::Element* encode_value_node_bone_id(xmlpp::Element* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas)
+XmlElement* encode_value_node_bone_id(XmlElement* root,ValueNode::ConstHandle value_node,Canvas::ConstHandle canvas)
 {
 	root->set_name("bone");
 	root->set_attribute("type",type_bone_object.description.name);
@@ -817,7 +834,7 @@ xmlpp::Element* encode_value_node_bone_id(xmlpp::Element* root,ValueNode::ConstH
 	return root;
 }
 
-xmlpp::Element* encode_layer(xmlpp::Element* root,Layer::ConstHandle layer)
+XmlElement* encode_layer(XmlElement* root,Layer::ConstHandle layer)
 {
 	root->set_name("layer");
 
@@ -842,7 +859,7 @@ xmlpp::Element* encode_layer(xmlpp::Element* root,Layer::ConstHandle layer)
 		// Handle dynamic parameters
 		if(dynamic_param_list.count(iter->get_name()))
 		{
-			xmlpp::Element *node=root->add_child("param");
+			XmlElement *node=root->add_child("param");
 			node->set_attribute("name",iter->get_name());
 
 			handle<const ValueNode> value_node=dynamic_param_list.find(iter->get_name())->second;
@@ -881,7 +898,7 @@ xmlpp::Element* encode_layer(xmlpp::Element* root,Layer::ConstHandle layer)
 
 					if(!value.get(Canvas::Handle()))
 						continue;
-					xmlpp::Element *node=root->add_child("param");
+					XmlElement *node=root->add_child("param");
 					node->set_attribute("name",iter->get_name());
 					node->set_attribute("use",child->get_relative_id(layer->get_canvas()));
 					if(value.get_static())
@@ -889,7 +906,7 @@ xmlpp::Element* encode_layer(xmlpp::Element* root,Layer::ConstHandle layer)
 					continue;
 				}
 			}
-			xmlpp::Element *node=root->add_child("param");
+			XmlElement *node=root->add_child("param");
 			node->set_attribute("name",iter->get_name());
 
 			// remember filename param if need
@@ -917,7 +934,7 @@ xmlpp::Element* encode_layer(xmlpp::Element* root,Layer::ConstHandle layer)
 	return root;
 }
 
-xmlpp::Element* encode_canvas(xmlpp::Element* root,Canvas::ConstHandle canvas)
+XmlElement* encode_canvas(XmlElement* root,Canvas::ConstHandle canvas)
 {
 	assert(canvas);
 	const RendDesc &rend_desc=canvas->rend_desc();
@@ -994,7 +1011,7 @@ xmlpp::Element* encode_canvas(xmlpp::Element* root,Canvas::ConstHandle canvas)
 		std::list<String> meta_keys(canvas->get_meta_data_keys());
 		while(!meta_keys.empty())
 		{
-			xmlpp::Element* meta_element(root->add_child("meta"));
+			XmlElement* meta_element(root->add_child("meta"));
 			meta_element->set_attribute("name",meta_keys.front());
 			meta_element->set_attribute("content",canvas->get_meta_data(meta_keys.front()));
 			meta_keys.pop_front();
@@ -1006,7 +1023,7 @@ xmlpp::Element* encode_canvas(xmlpp::Element* root,Canvas::ConstHandle canvas)
 	// Output the <bones> section
 	if((!canvas->is_inline() && !ValueNode_Bone::get_bone_map(canvas).empty()))
 	{
-		xmlpp::Element *node=root->add_child("bones");
+		XmlElement *node=root->add_child("bones");
 
 		encode_value_node_bone(node->add_child("value_node"),ValueNode_Bone::get_root_bone(),canvas);
 
@@ -1031,7 +1048,7 @@ xmlpp::Element* encode_canvas(xmlpp::Element* root,Canvas::ConstHandle canvas)
 
 	if((!canvas->is_inline() && !canvas->value_node_list().empty()) || !canvas->children().empty())
 	{
-		xmlpp::Element *node=root->add_child("defs");
+		XmlElement *node=root->add_child("defs");
 		const ValueNodeList &value_node_list(canvas->value_node_list());
 
 		for(ValueNodeList::const_iterator iter=value_node_list.begin();iter!=value_node_list.end();++iter)
@@ -1039,7 +1056,7 @@ xmlpp::Element* encode_canvas(xmlpp::Element* root,Canvas::ConstHandle canvas)
 			// If the value_node is a constant, then use the shorthand
 			if (ValueNode_Const::Handle value_node = ValueNode_Const::Handle::cast_dynamic(*iter))
 			{
-				reinterpret_cast<xmlpp::Element*>(encode_value(node->add_child("value"),value_node->get_value(),canvas))->set_attribute("id",value_node->get_id());
+				encode_value(node->add_child("value"),value_node->get_value(),canvas)->set_attribute("id",value_node->get_id());
 				continue;
 			}
 			encode_value_node(node->add_child("value_node"),*iter,canvas);
@@ -1060,11 +1077,11 @@ xmlpp::Element* encode_canvas(xmlpp::Element* root,Canvas::ConstHandle canvas)
 	return root;
 }
 
-xmlpp::Element* encode_canvas_toplevel(xmlpp::Element* root,Canvas::ConstHandle canvas)
+XmlElement* encode_canvas_toplevel(XmlElement* root,Canvas::ConstHandle canvas)
 {
 	valuenode_too_new_count = 0;
 
-	xmlpp::Element* ret = encode_canvas(root, canvas);
+	XmlElement* ret = encode_canvas(root, canvas);
 
 	if (valuenode_too_new_count)
 		warning("saved %d valuenodes as constant values in old file format\n", valuenode_too_new_count);
@@ -1082,9 +1099,6 @@ synfig::save_canvas(const FileSystem::Identifier &identifier, Canvas::ConstHandl
 	try
 	{
 		assert(canvas);
-		xmlpp::Document document;
-
-		encode_canvas_toplevel(document.create_root_node("canvas"),canvas);
 
 		FileSystem::WriteStream::Handle stream = identifier.file_system->get_write_stream(tmp_filename);
 		if (!stream)
@@ -1096,7 +1110,14 @@ synfig::save_canvas(const FileSystem::Identifier &identifier, Canvas::ConstHandl
 		if (filename_extension(identifier.filename) == ".sifz")
 			stream = FileSystem::WriteStream::Handle(new ZWriteStream(stream));
 
-		document.write_to_stream_formatted(*stream, "UTF-8");
+		// elements are written into the stream while the canvas is encoded
+		XmlWriter writer(*stream);
+		encode_canvas_toplevel(writer.create_root_node("canvas"),canvas);
+		if (!writer.finish())
+		{
+			synfig::error("synfig::save_canvas(): Unable to write file");
+			return false;
+		}
 
 		// close stream
 		stream.reset();
@@ -1121,11 +1142,13 @@ synfig::canvas_to_string(Canvas::ConstHandle canvas)
     ChangeLocale change_locale(LC_NUMERIC, "C");
 	assert(canvas);
 
-	xmlpp::Document document;
+	std::ostringstream stream;
+	XmlWriter writer(stream);
 
-	encode_canvas_toplevel(document.create_root_node("canvas"),canvas);
+	encode_canvas_toplevel(writer.create_root_node("canvas"),canvas);
+	writer.finish();
 
-	return document.write_to_string_formatted();
+	return stream.str();
 }
 
 void
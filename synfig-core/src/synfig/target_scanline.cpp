@@ -41,6 +41,7 @@
 
 #include "canvas.h"
 #include "context.h"
+#include "framecache.h"
 #include "render.h"
 #include "string.h"
 #include "surface.h"
@@ -48,6 +49,7 @@
 #include "rendering/surface.h"
 #include "rendering/software/surfacesw.h"
 #include "rendering/common/task/tasktransformation.h"
+#include "debug/profile.h"
 
 #endif
 
@@ -91,7 +93,20 @@ synfig::Target_Scanline::call_renderer(
 	const RendDesc &renddesc )
 {
 	surface->create(renddesc.get_w(), renddesc.get_h());
-	rendering::Task::Handle task = canvas.build_rendering_task(context_params);
+
+	String cache_key;
+	if (FrameCache::is_enabled())
+	{
+		cache_key = FrameCache::get_frame_key(FrameCache::get_canvas_hash(canvas, context_params), renddesc, get_engine());
+		if (FrameCache::load(cache_key, surface))
+			return true;
+	}
+
+	rendering::Task::Handle task;
+	{
+		debug::Profile::Scope profile("build_rendering_task", "target");
+		task = canvas.build_rendering_task(context_params);
+	}
 
 	if (task)
 	{
@@ -118,6 +133,9 @@ synfig::Target_Scanline::call_renderer(
 		rendering::Task::List list;
 		list.push_back(task);
 		renderer->run(list);
+
+		if (!cache_key.empty())
+			FrameCache::save(cache_key, surface);
 	}
 	return true;
 }
@@ -161,6 +179,9 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 			// Grab the time
 			frames=next_frame(t);
 
+			debug::Profile::FrameScope profile_frame(frame_start + total_frames - frames - 1);
+			debug::Profile::Scope profile_frame_time("frame", "target");
+
 			// If we have a callback, and it returns
 			// false, go ahead and bail. (it may be a user cancel)
 			if(cb && !cb->amount_complete(total_frames-frames,total_frames))
@@ -168,8 +189,14 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 
 			// Set the time that we wish to render
 			if(!get_avoid_time_sync() || canvas->get_time()!=t) {
-				canvas->set_time(t);
-				canvas->load_resources(t);
+				{
+					debug::Profile::Scope profile("set_time", "target");
+					canvas->set_time(t);
+				}
+				{
+					debug::Profile::Scope profile("load_resources", "target");
+					canvas->load_resources(t);
+				}
 			}
 			canvas->set_outline_grow(desc.get_outline_grow());
 
@@ -229,6 +256,7 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 								return false;
 							}
 
+							debug::Profile::Scope profile_write("write", "target");
 							const synfig::Surface &s = lock->get_surface();
 
 							int y;
@@ -303,6 +331,7 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 						return false;
 					}
 
+					debug::Profile::Scope profile_write("write", "target");
 					// Put the surface we renderer
 					// onto the target.
 					if(!add_frame(&lock->get_surface(), cb))
@@ -318,10 +347,19 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 	}
     else
     {
+		debug::Profile::FrameScope profile_frame(frame_start);
+		debug::Profile::Scope profile_frame_time("frame", "target");
+
 		// Set the time that we wish to render
 		if(!get_avoid_time_sync() || canvas->get_time()!=t) {
-			canvas->set_time(t);
-			canvas->load_resources(t);
+			{
+				debug::Profile::Scope profile("set_time", "target");
+				canvas->set_time(t);
+			}
+			{
+				debug::Profile::Scope profile("load_resources", "target");
+				canvas->load_resources(t);
+			}
 		}
 		canvas->set_outline_grow(desc.get_outline_grow());
 
@@ -385,6 +423,7 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 						return false;
 					}
 
+					debug::Profile::Scope profile_write("write", "target");
 					const synfig::Surface &s = lock->get_surface();
 
 					int y;
@@ -461,6 +500,7 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 					return false;
 				}
 
+				debug::Profile::Scope profile_write("write", "target");
 				// Put the surface we renderer
 				// onto the target.
 				if(!add_frame(&lock->get_surface(), cb))
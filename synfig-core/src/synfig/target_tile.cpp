@@ -50,7 +50,7 @@
 #include "string.h"
 #include "surface.h"
 
-#include "debug/measure.h"
+#include "debug/profile.h"
 
 #include "rendering/renderer.h"
 #include "rendering/surface.h"
@@ -70,10 +70,6 @@ using namespace rendering;
 const unsigned int	DEF_TILE_WIDTH = TILE_SIZE / 2;
 const unsigned int	DEF_TILE_HEIGHT = TILE_SIZE / 2;
 
-#ifdef _DEBUG
-//#define DEBUG_MEASURE
-#endif
-
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
@@ -125,16 +121,10 @@ synfig::Target_Tile::call_renderer(
 	const ContextParams &context_params,
 	const RendDesc &renddesc )
 {
-	#ifdef DEBUG_MEASURE
-	debug::Measure t("Target_Tile::call_renderer");
-	#endif
-
 	surface->create(renddesc.get_w(), renddesc.get_h());
 	rendering::Task::Handle task;
 	{
-		#ifdef DEBUG_MEASURE
-		debug::Measure t("build rendering task");
-		#endif
+		debug::Profile::Scope profile("build_rendering_task", "target");
 		task = canvas.build_rendering_task(context_params);
 	}
 
@@ -163,12 +153,7 @@ synfig::Target_Tile::call_renderer(
 		rendering::Task::List list;
 		list.push_back(task);
 
-		{
-			#ifdef DEBUG_MEASURE
-			debug::Measure t("run renderer");
-			#endif
-			renderer->run(list);
-		}
+		renderer->run(list);
 	}
 	return true;
 }
@@ -331,6 +316,9 @@ synfig::Target_Tile::render(ProgressCallback *cb)
 				// Grab the time
 				frames=next_frame(t);
 
+				debug::Profile::FrameScope profile_frame(frame_start + total_frames - frames - 1);
+				debug::Profile::Scope profile_frame_time("frame", "target");
+
 				curr_tile_=0;
 
 				// If we have a callback, and it returns
@@ -342,8 +330,14 @@ synfig::Target_Tile::render(ProgressCallback *cb)
 					return false;
 
 				// Set the time that we wish to render
-				canvas->set_time(t);
-				canvas->load_resources(t);
+				{
+					debug::Profile::Scope profile("set_time", "target");
+					canvas->set_time(t);
+				}
+				{
+					debug::Profile::Scope profile("load_resources", "target");
+					canvas->load_resources(t);
+				}
 				canvas->set_outline_grow(desc.get_outline_grow());
 				if(!render_frame_(canvas, context_params, 0))
 					return false;
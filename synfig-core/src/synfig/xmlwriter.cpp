@@ -0,0 +1,253 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file xmlwriter.cpp
+**	\brief Streaming XML writer used to save canvases
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cassert>
+
+#include "xmlwriter.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+XmlElement::XmlElement(XmlWriter *writer):
+	writer(writer),
+	attributes_count(),
+	has_text()
+{ }
+
+void
+XmlElement::reset(const String &x)
+{
+	name = x;
+	attributes_count = 0;
+	text.clear();
+	has_text = false;
+	children.clear();
+}
+
+void
+XmlElement::set_attribute(const String &name, const char *value)
+{
+	assert(this != &writer->root || !writer->root_opened);
+	for(size_t i = 0; i < attributes_count; ++i)
+		if (attributes[i].first == name)
+			{ attributes[i].second = value; return; }
+	// strings of unused entries are reused to keep their capacity
+	if (attributes_count == attributes.size())
+		attributes.push_back(std::pair<String, String>());
+	std::pair<String, String> &attribute = attributes[attributes_count++];
+	attribute.first = name;
+	attribute.second = value;
+}
+
+void
+XmlElement::set_attribute(const String &name, const String &value)
+	{ set_attribute(name, value.c_str()); }
+
+XmlElement*
+XmlElement::add_child(const String &name)
+{
+	if (this == &writer->root)
+		writer->on_root_child_added();
+	XmlElement *child = writer->new_element(name);
+	children.push_back(child);
+	return child;
+}
+
+
+XmlWriter::XmlWriter(std::ostream &stream):
+	stream(stream),
+	root(this),
+	root_opened(false),
+	finished(false),
+	pool_used()
+{
+	buffer.reserve(buffer_size + buffer_size/4);
+}
+
+XmlWriter::~XmlWriter()
+{
+	for(std::vector<XmlElement*>::iterator i = pool.begin(); i != pool.end(); ++i)
+		delete *i;
+}
+
+XmlElement*
+XmlWriter::new_element(const String &name)
+{
+	if (pool_used == pool.size())
+		pool.push_back(new XmlElement(this));
+	XmlElement *element = pool[pool_used++];
+	element->reset(name);
+	return element;
+}
+
+XmlElement*
+XmlWriter::create_root_node(const String &name)
+{
+	assert(!root_opened);
+	root.reset(name);
+	return &root;
+}
+
+void
+XmlWriter::on_root_child_added()
+{
+	if (!root_opened)
+	{
+		buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+		write_start_tag(root, 0);
+		buffer += ">\n";
+		root_opened = true;
+		return;
+	}
+
+	// previous child is complete, so write it and release all the pooled elements
+	assert(!root.children.empty());
+	write_element(*root.children.back(), 1, true);
+	root.children.clear();
+	pool_used = 0;
+	write_buffer(false);
+}
+
+void
+XmlWriter::write_escaped(const String &x, bool attribute)
+{
+	const char *begin = x.c_str();
+	const char *end = begin + x.size();
+	const char *plain = begin;
+	for(const char *c = begin; c < end; ++c)
+	{
+		const char *entity;
+		switch(*c)
+		{
+		case '<':  entity = "&lt;"; break;
+		case '>':  entity = "&gt;"; break;
+		case '&':  entity = "&amp;"; break;
+		case '\r': entity = "&#13;"; break;
+		case '"':  if (!attribute) continue; entity = "&quot;"; break;
+		case '\n': if (!attribute) continue; entity = "&#10;"; break;
+		case '\t': if (!attribute) continue; entity = "&#9;"; break;
+		default: continue;
+		}
+		buffer.append(plain, c);
+		buffer += entity;
+		plain = c + 1;
+	}
+	buffer.append(plain, end);
+}
+
+void
+XmlWriter::write_start_tag(const XmlElement &element, int depth)
+{
+	buffer.append(2*depth, ' ');
+	buffer += '<';
+	buffer += element.name;
+	for(size_t i = 0; i < element.attributes_count; ++i)
+	{
+		buffer += ' ';
+		buffer += element.attributes[i].first;
+		buffer += "=\"";
+		write_escaped(element.attributes[i].second, true);
+		buffer += '"';
+	}
+}
+
+void
+XmlWriter::write_element(const XmlElement &element, int depth, bool format)
+{
+	// libxml2 disables formatting inside of elements with text content
+	write_start_tag(element, format ? depth : 0);
+	if (!element.has_text && element.children.empty())
+	{
+		buffer += "/>";
+	}
+	else
+	{
+		buffer += '>';
+		if (element.has_text)
+			write_escaped(element.text, false);
+		bool format_children = format && !element.has_text;
+		if (format_children)
+			buffer += '\n';
+		for(std::vector<XmlElement*>::const_iterator i = element.children.begin(); i != element.children.end(); ++i)
+			write_element(**i, depth + 1, format_children);
+		if (format_children)
+			buffer.append(2*depth, ' ');
+		buffer += "</";
+		buffer += element.name;
+		buffer += '>';
+	}
+	if (format)
+		buffer += '\n';
+}
+
+void
+XmlWriter::write_buffer(bool force)
+{
+	if (buffer.empty() || (!force && buffer.size() < buffer_size))
+		return;
+	stream.write(buffer.data(), buffer.size());
+	buffer.clear();
+}
+
+bool
+XmlWriter::finish()
+{
+	if (finished)
+		return stream.good();
+	finished = true;
+
+	if (root_opened)
+	{
+		write_element(*root.children.back(), 1, true);
+		buffer += "</";
+		buffer += root.name;
+		buffer += ">\n";
+	}
+	else
+	{
+		buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+		write_element(root, 0, true);
+	}
+	root.children.clear();
+	pool_used = 0;
+
+	write_buffer(true);
+	stream.flush();
+	return stream.good();
+}
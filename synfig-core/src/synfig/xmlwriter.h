@@ -0,0 +1,131 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file xmlwriter.h
+**	\brief Streaming XML writer used to save canvases
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_XMLWRITER_H
+#define __SYNFIG_XMLWRITER_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "string.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+
+class XmlWriter;
+
+//! Element of the document written by XmlWriter
+/*! Has the same interface as the subset of xmlpp::Element used by
+ *  the canvas saver, but elements are pooled and reused by the writer,
+ *  so building them costs almost no allocations. */
+class XmlElement
+{
+	friend class XmlWriter;
+
+private:
+	XmlWriter *writer;
+	String name;
+	std::vector< std::pair<String, String> > attributes;
+	size_t attributes_count;
+	String text;
+	bool has_text;
+	std::vector<XmlElement*> children;
+
+	explicit XmlElement(XmlWriter *writer);
+	void reset(const String &name);
+
+public:
+	const String& get_name() const { return name; }
+	void set_name(const String &x) { name = x; }
+
+	void set_attribute(const String &name, const String &value);
+	void set_attribute(const String &name, const char *value);
+
+	//! Adds child element, the previous children must be already complete
+	XmlElement* add_child(const String &name);
+
+	void set_child_text(const String &x) { text = x; has_text = true; }
+	void set_child_text(const char *x) { text = x; has_text = true; }
+}; // END of class XmlElement
+
+//! Writes formatted XML document into stream
+/*! The output is the same as xmlpp::Document::write_to_stream_formatted()
+ *  with "UTF-8" encoding.
+ *  Children of the root node are written and released as soon as the next
+ *  child is added, so only one top-level element is kept in memory.
+ *  Attributes of the root node must be set before its first child is added. */
+class XmlWriter
+{
+	friend class XmlElement;
+
+public:
+	enum { buffer_size = 65536 };
+
+private:
+	std::ostream &stream;
+	String buffer;
+	XmlElement root;
+	bool root_opened;
+	bool finished;
+
+	std::vector<XmlElement*> pool;
+	size_t pool_used;
+
+	XmlElement* new_element(const String &name);
+	void on_root_child_added();
+
+	void write_escaped(const String &x, bool attribute);
+	void write_start_tag(const XmlElement &element, int depth);
+	void write_element(const XmlElement &element, int depth, bool format);
+	void write_buffer(bool force);
+
+	//! Noncopyable
+	XmlWriter(const XmlWriter&);
+	XmlWriter& operator=(const XmlWriter&);
+
+public:
+	explicit XmlWriter(std::ostream &stream);
+	~XmlWriter();
+
+	XmlElement* create_root_node(const String &name);
+
+	//! Writes the rest of document and flushes the buffer
+	/*! \return false if stream failed */
+	bool finish();
+}; // END of class XmlWriter
+
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
@@ -127,12 +127,7 @@ namespace synfig {
 
 	protected:
 		virtual size_t internal_write(const void *buffer, size_t size)
-		{
-			for(size_t i = 0; i < size; i++)
-				if (!ostream_.put(((const char*)buffer)[i]).good())
-					return i;
-			return size;
-		}
+			{ return ostream_.write((const char*)buffer, size).good() ? size : 0; }
 
 	public:
 		ZWriteStream(FileSystem::WriteStream::Handle stream):
@@ -38,6 +38,8 @@ SynfigToolGeneralOptions::SynfigToolGeneralOptions()
 	_should_be_quiet = false;
 	_should_print_benchmarks = false;
 	_threads = 1;
+	_jobs = 1;
+	_profile_format = "chrome";
 }
 
 std::string SynfigToolGeneralOptions::get_binary_path() const
@@ -59,6 +61,16 @@ void SynfigToolGeneralOptions::set_threads(size_t threads)
 	_threads = threads;
 }
 
+size_t SynfigToolGeneralOptions::get_jobs() const
+{
+	return _jobs;
+}
+
+void SynfigToolGeneralOptions::set_jobs(size_t jobs)
+{
+	_jobs = jobs;
+}
+
 int SynfigToolGeneralOptions::get_verbosity() const
 {
 	return _verbosity;
@@ -89,3 +101,23 @@ void SynfigToolGeneralOptions::set_should_print_benchmarks(bool print_benchmarks
 {
 	_should_print_benchmarks = print_benchmarks;
 }
+
+std::string SynfigToolGeneralOptions::get_profile_filename() const
+{
+	return _profile_filename;
+}
+
+void SynfigToolGeneralOptions::set_profile_filename(const std::string& filename)
+{
+	_profile_filename = filename;
+}
+
+std::string SynfigToolGeneralOptions::get_profile_format() const
+{
+	return _profile_format;
+}
+
+void SynfigToolGeneralOptions::set_profile_format(const std::string& format)
+{
+	_profile_format = format;
+}
@@ -91,6 +91,10 @@ public:
 
 	void set_threads(size_t threads);
 
+	size_t get_jobs() const;
+
+	void set_jobs(size_t jobs);
+
 	int get_verbosity() const;
 
 	void set_verbosity(int verbosity);
@@ -103,13 +107,24 @@ public:
 
 	void set_should_print_benchmarks(bool print_benchmarks);
 
+	std::string get_profile_filename() const;
+
+	void set_profile_filename(const std::string& filename);
+
+	std::string get_profile_format() const;
+
+	void set_profile_format(const std::string& format);
+
 private:
 	SynfigToolGeneralOptions();
 	std::string _binary_path;
 	int _verbosity;
 	size_t _threads;
+	size_t _jobs;
 	bool _should_be_quiet,
 		 _should_print_benchmarks;
+	std::string _profile_filename;
+	std::string _profile_format;
 };
 
 #endif
@@ -31,6 +31,7 @@
 
 struct Job
 {
+	int index; //!< number of the job in the profiling output
 	std::string filename;
 	std::string outfilename;
 	std::string target_name;
@@ -77,6 +78,7 @@ struct Job
 		canvas_info_metadata;
 
     Job():
+		index(-1),
 		alpha_mode(synfig::TARGET_ALPHA_MODE_KEEP),
 		quality(DEFAULT_QUALITY),
 		sifout(false),
@@ -38,14 +38,25 @@
 #include <cstring>
 
 #include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #include <autorevision.h>
 #include <synfig/general.h>
+#include <synfig/layer.h>
 #include <synfig/localization.h>
 #include <synfig/target.h>
 #include <synfig/target_scanline.h>
 #include <synfig/savecanvas.h>
 #include <synfig/filesystemnative.h>
+#include <synfig/debug/profile.h>
 
 #include "definitions.h"
 #include "synfigtoolexception.h"
@@ -64,18 +75,156 @@
 
 using namespace synfig;
 
+namespace {
+
+//! Serializes the benchmark output of the simultaneously processed jobs
+std::mutex benchmarks_mutex;
+
+void print_benchmarks(const std::string& text)
+{
+	std::lock_guard<std::mutex> lock(benchmarks_mutex);
+	std::cout << text << std::flush;
+}
+
+//! Processes the jobs in several threads.
+//! Frames of all jobs are rendered by the common rendering queue.
+//! Jobs of the same canvas are never processed simultaneously,
+//! because targets change the time of the canvas while rendering.
+class JobRunner
+{
+private:
+	std::list<Job> &jobs;
+	RenderProgress &progress;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::set<const Canvas*> busy_canvases;
+	std::exception_ptr exception;
+
+	std::list<Job>::iterator find_job()
+	{
+		for(std::list<Job>::iterator i = jobs.begin(); i != jobs.end(); ++i)
+			if (!busy_canvases.count(i->root.get()))
+				return i;
+		return jobs.end();
+	}
+
+	void worker(int index)
+	{
+		debug::Profile::set_thread_name(etl::strprintf("job %d", index));
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while(!exception && !jobs.empty())
+		{
+			std::list<Job>::iterator i = find_job();
+			if (i == jobs.end())
+			{
+				cond.wait(lock);
+				continue;
+			}
+
+			Job job = *i;
+			jobs.erase(i);
+			busy_canvases.insert(job.root.get());
+			lock.unlock();
+
+			std::exception_ptr job_exception;
+			try
+			{
+				process_job(job, &progress);
+			}
+			catch(...)
+			{
+				job_exception = std::current_exception();
+			}
+
+			lock.lock();
+			busy_canvases.erase(job.root.get());
+			if (job_exception && !exception)
+				exception = job_exception;
+			cond.notify_all();
+		}
+	}
+
+public:
+	JobRunner(std::list<Job> &jobs, RenderProgress &progress):
+		jobs(jobs), progress(progress) { }
+
+	void run(size_t threads_count)
+	{
+		std::vector<std::thread> threads;
+		for(size_t i = 0; i < threads_count; ++i)
+			threads.push_back(std::thread(&JobRunner::worker, this, (int)i));
+		for(std::vector<std::thread>::iterator i = threads.begin(); i != threads.end(); ++i)
+			i->join();
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+};
+
+} // end of anonimous namespace
+
 void process_job_list(std::list<Job>& job_list, const TargetParam& target_params)
 {
 	if (job_list.empty())
 		throw (SynfigToolException(SYNFIGTOOL_BORED, _("Nothing to do!")));
 
-	for(; !job_list.empty(); job_list.pop_front())
+	const size_t jobs_count = SynfigToolGeneralOptions::instance()->get_jobs();
+	if (jobs_count <= 1 || job_list.size() <= 1)
+	{
+		for(; !job_list.empty(); job_list.pop_front())
+		{
+			if (setup_job(job_list.front(), target_params))
+				process_job(job_list.front());
+		}
+		return;
+	}
+
+	// targets are created before rendering, in the main thread
+	for(std::list<Job>::iterator i = job_list.begin(); i != job_list.end(); )
+		if (setup_job(*i, target_params)) ++i; else i = job_list.erase(i);
+	if (job_list.empty())
+		return;
+
+	RenderProgress progress;
+	progress.task(_("All jobs"));
+	progress.set_jobs_count((int)job_list.size());
+
+	std::chrono::system_clock::time_point start_timepoint =
+		std::chrono::system_clock::now();
+	const size_t total_jobs = job_list.size();
+
+	JobRunner(job_list, progress).run(std::min(jobs_count, job_list.size()));
+
+	if(SynfigToolGeneralOptions::instance()->should_print_benchmarks())
 	{
-		if (setup_job(job_list.front(), target_params))
-			process_job(job_list.front());
+		std::chrono::duration<double> duration =
+			std::chrono::system_clock::now() - start_timepoint;
+
+		std::ostringstream out;
+		out << etl::strprintf(_("%d jobs processed in "), (int)total_jobs)
+			<< duration.count()
+			<< _(" seconds.") << std::endl;
+		print_benchmarks(out.str());
 	}
 }
 
+void write_profile(const std::string& filename)
+{
+	std::ofstream file(filename.c_str());
+	if (!file)
+	{
+		synfig::error(_("Unable to write profile to \"%s\""), filename.c_str());
+		return;
+	}
+
+	if (SynfigToolGeneralOptions::instance()->get_profile_format() == "json")
+		debug::Profile::write_summary(file);
+	else
+		debug::Profile::write_chrome_trace(file);
+
+	VERBOSE_OUT(1) << _("Profile written to ") << filename << std::endl;
+}
+
 std::string get_extension(const std::string &filename)
 {
 	std::size_t found = filename.rfind(".");
@@ -220,8 +369,10 @@ bool setup_job(Job& job, const TargetParam& target_parameters)
 	return true;
 }
 
-void process_job (Job& job)
+void process_job (Job& job, RenderProgress* parent_progress)
 {
+	debug::Profile::JobScope profile_job(job.index, job.outfilename);
+
 	VERBOSE_OUT(3) << job.filename.c_str() << " -- " << std::endl;
 	synfig::info("\tw: %d, h: %d, a: %d, pxaspect: %f, imaspect: %f, span: %f", 
 		job.desc.get_w(), job.desc.get_h(), job.desc.get_antialias(),
@@ -252,18 +403,37 @@ void process_job (Job& job)
                                     % job.desc.get_focus()[1]
                     << std::endl;*/
 
-	RenderProgress p;
+	std::unique_ptr<RenderProgress> progress(
+		parent_progress ? new RenderProgress(*parent_progress) : new RenderProgress());
+	RenderProgress& p = *progress;
 	p.task(job.filename + " ==> " + job.outfilename);
 
 	if(job.sifout)
 	{
+		std::chrono::system_clock::time_point start_timepoint =
+			std::chrono::system_clock::now();
+
 		// todo: support containers
 		if(!save_canvas(FileSystemNative::instance()->get_identifier(job.outfilename), job.canvas))
 			throw (SynfigToolException(SYNFIGTOOL_RENDERFAILURE, _("Render Failure.")));
+
+		if(SynfigToolGeneralOptions::instance()->should_print_benchmarks())
+		{
+			std::chrono::duration<double> duration =
+				std::chrono::system_clock::now() - start_timepoint;
+
+			std::ostringstream out;
+			out << job.filename.c_str()
+				<< _(": Saved in ")
+				<< duration.count()
+				<< _(" seconds.") << std::endl;
+			print_benchmarks(out.str());
+		}
 	}
 	else
 	{
 		VERBOSE_OUT(1) << _("Rendering...") << std::endl;
+		long long start_snapshot_count = Layer::get_rendering_snapshot_count();
 		std::chrono::system_clock::time_point start_timepoint =
             std::chrono::system_clock::now();
 
@@ -276,10 +446,24 @@ void process_job (Job& job)
             std::chrono::duration<double> duration =
                 std::chrono::system_clock::now() - start_timepoint;
 
-            std::cout << job.filename.c_str()
-                      << _(": Rendered in ")
-                      << duration.count()
-                      << _(" seconds.") << std::endl;
+            std::ostringstream out;
+            out << job.filename.c_str()
+                << _(": Rendered in ")
+                << duration.count()
+                << _(" seconds.") << std::endl;
+
+            // count of layer copies made for rendering, see Layer::get_rendering_snapshot(),
+            // the counter is global, so it is not reported for the simultaneous jobs
+            if (!parent_progress)
+            {
+                long long snapshots = Layer::get_rendering_snapshot_count() - start_snapshot_count;
+                int frames = std::max(1, job.desc.get_frame_end() - job.desc.get_frame_start() + 1);
+                out << job.filename.c_str()
+                    << _(": Layers copied for rendering: ")
+                    << snapshots
+                    << " (" << (double)snapshots/frames << _(" per frame).") << std::endl;
+            }
+            print_benchmarks(out.str());
         }
 	}
 
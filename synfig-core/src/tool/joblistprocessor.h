@@ -32,6 +32,8 @@
 #include <synfig/targetparam.h>
 #include "job.h"
 
+class RenderProgress;
+
 /// Process a Job list setting up and processing each job
 void process_job_list(std::list<Job>& job_list,
 						const synfig::TargetParam& target_parameters);
@@ -41,7 +43,12 @@ void process_job_list(std::list<Job>& job_list,
 bool setup_job(Job& job, const synfig::TargetParam& target_parameters);
 
 /// Process an individual job
-void process_job(Job& job);
+/// \param parent_progress progress which sums the simultaneously processed jobs,
+/// the job prints its own progress when it is null
+void process_job(Job& job, RenderProgress* parent_progress = nullptr);
+
+/// Write the recorded timings of rendering in the format set by --profile-format
+void write_profile(const std::string& filename);
 
 std::string get_absolute_path(std::string relative_path);
 
@@ -49,6 +49,7 @@
 #include <synfig/target.h>
 #include <synfig/paramdesc.h>
 #include <synfig/main.h>
+#include <synfig/debug/profile.h>
 #include <autorevision.h>
 #include "definitions.h"
 #include "progress.h"
@@ -281,22 +282,49 @@ int main(int argc, char* argv[])
 		std::list<Job> job_list;
 
 		// Processing --------------------------------------------------
-		Job job;
-		job = parser.extract_job();
-		job.desc = job.canvas->rend_desc() = parser.extract_renddesc(job.canvas->rend_desc());
-
-		if (job.extract_alpha) {
-			job.alpha_mode = synfig::TARGET_ALPHA_MODE_REDUCE;
-			job_list.push_front(job);
-			job.alpha_mode = synfig::TARGET_ALPHA_MODE_EXTRACT;
-			job.outfilename = _appendAlphaToFilename(job.outfilename);
-			job_list.push_front(job);
-		} else {
-			job_list.push_front(job);
+		std::vector<std::string> input_files = parser.extract_input_files();
+		if (input_files.empty())
+			input_files.push_back(std::string()); // reports the missing input file
+
+		for (const std::string& input_file : input_files) {
+			std::list<Job> file_jobs;
+			Job job;
+			job = parser.extract_job(input_file);
+			job.desc = job.canvas->rend_desc() = parser.extract_renddesc(job.canvas->rend_desc());
+
+			if (job.extract_alpha) {
+				job.alpha_mode = synfig::TARGET_ALPHA_MODE_REDUCE;
+				file_jobs.push_front(job);
+				job.alpha_mode = synfig::TARGET_ALPHA_MODE_EXTRACT;
+				job.outfilename = _appendAlphaToFilename(job.outfilename);
+				file_jobs.push_front(job);
+			} else {
+				file_jobs.push_front(job);
+			}
+			job_list.splice(job_list.end(), file_jobs);
+		}
+
+		// several files and the alpha jobs have the same frame numbers,
+		// so jobs are told apart by the index in the profiling output
+		int job_index = 0;
+		for (Job& job : job_list)
+			job.index = job_index++;
+
+		const std::string profile_filename = SynfigToolGeneralOptions::instance()->get_profile_filename();
+		if (!profile_filename.empty())
+		{
+			synfig::debug::Profile::set_thread_name("main");
+			synfig::debug::Profile::enable();
 		}
 
 		process_job_list(job_list, parser.extract_targetparam());
 
+		if (!profile_filename.empty())
+		{
+			synfig::debug::Profile::disable();
+			write_profile(profile_filename);
+		}
+
 		return SYNFIGTOOL_OK;
 
     }
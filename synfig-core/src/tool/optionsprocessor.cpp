@@ -95,6 +95,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	set_antialias(),
 	set_quality(),
 	set_num_threads(),
+	set_num_jobs(),
 	set_input_file(),
 	set_output_file(),
 	set_sequence_separator(),
@@ -113,11 +114,14 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	sw_quiet(),
 	sw_print_benchmarks(),
 	sw_extract_alpha(),
+	sw_canvas_cache(),
 
 	// Misc group
 	misc_append_filename(),
 	misc_canvas_info(),
 	misc_canvases(),
+	misc_profile_filename(),
+	misc_profile_format(),
 
 	//FFMPEG group
 	video_codec(),
@@ -153,6 +157,7 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option(og_set, "antialias",   'a', set_antialias,	_("Set antialias amount for parametric renderer."), "1..30");
 	//og_set.add_option("quality",     'Q', quality_arg_desc, etl::strprintf(_("Specify image quality for accelerated renderer (Default: %d)"), DEFAULT_QUALITY).c_str(), "NUM");
 	add_option(og_set, "threads",     'T', set_num_threads, _("Enable multithreaded renderer using the specified number of threads"), "NUM");
+	add_option(og_set, "jobs",        'j', set_num_jobs,    _("Render the specified number of input files simultaneously"), "NUM");
 	add_option(og_set, "input-file",  'i', set_input_file, 	_("Specify input filename"), "filename");
 	add_option(og_set, "output-file", 'o', set_output_file, _("Specify output filename"), "filename");
 	add_option(og_set, "sequence-separator", ' ', set_sequence_separator, _("Output file sequence separator string (Use double quotes if you want to use spaces)"), "string");
@@ -172,11 +177,14 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option(og_switch, "quiet",         'q', sw_quiet, 				_("Quiet mode (No progress/time-remaining display)"), "");
 	add_option(og_switch, "benchmarks",    'b', sw_print_benchmarks,	_("Print benchmarks"), "");
 	add_option(og_switch, "extract-alpha", 'x', sw_extract_alpha, 		_("Extract alpha"), "");
+	add_option(og_switch, "canvas-cache",  ' ', sw_canvas_cache, 		_("Load the document tree of the file from the binary cache, and update the cache if it is stale"), "");
 
 	//SynfigOptionGroup og_misc("misc", _("Misc options"), "Show Misc options help");
 	add_option_filename(og_misc, "append", ' ', misc_append_filename, 	_("Append layers in <filename> to composition"), _("filename"));
 	add_option(og_misc, "canvas-info",     ' ', misc_canvas_info, 			_("Print out specified details of the root canvas"), _("fields"));
 	add_option(og_misc, "canvases",		   ' ', misc_canvases,				_("Print out the list of exported canvases in the composition"), "");
+	add_option_filename(og_misc, "profile", ' ', misc_profile_filename,	_("Write timings of rendering phases and tasks for each frame to <filename>"), _("filename"));
+	add_option(og_misc, "profile-format",  ' ', misc_profile_format,		_("Format of the profile: chrome (trace for chrome://tracing, default) or json (summary)"), _("format"));
 
 	//SynfigOptionGroup og_ffmpeg("ffmpeg", _("FFMPEG target options"), "Show FFMPEG target options help");
 	add_option(og_ffmpeg, "video-codec",   ' ', video_codec, 	_("Set the codec for the video. See --target-video-codecs"), _("codec"));
@@ -357,6 +365,29 @@ void SynfigCommandLineParser::process_settings_options() const
 
 	VERBOSE_OUT(1) << _("Threads set to ")
 				   << SynfigToolGeneralOptions::instance()->get_threads() << std::endl;
+
+	if (!misc_profile_format.empty())
+	{
+		if (misc_profile_format != "chrome" && misc_profile_format != "json")
+			throw SynfigToolException(SYNFIGTOOL_UNKNOWNARGUMENT,
+				etl::strprintf(_("Unknown profile format \"%s\"."), misc_profile_format.c_str()));
+		SynfigToolGeneralOptions::instance()->set_profile_format(misc_profile_format);
+	}
+
+	if (!misc_profile_filename.empty())
+	{
+		#ifdef SYNFIG_DISABLE_PROFILE
+		synfig::warning(_("Render profiling is disabled at compile time, the profile will be empty."));
+		#endif
+		SynfigToolGeneralOptions::instance()->set_profile_filename(misc_profile_filename);
+	}
+
+	if (set_num_jobs > 0)
+	{
+		SynfigToolGeneralOptions::instance()->set_jobs(size_t(set_num_jobs));
+		VERBOSE_OUT(1) << _("Jobs set to ")
+					   << SynfigToolGeneralOptions::instance()->get_jobs() << std::endl;
+	}
 }
 
 void SynfigCommandLineParser::process_trivial_info_options()
@@ -635,14 +666,30 @@ TargetParam SynfigCommandLineParser::extract_targetparam()
 	return params;
 }
 
-Job SynfigCommandLineParser::extract_job()
+std::vector<std::string> SynfigCommandLineParser::extract_input_files() const
+{
+	std::vector<std::string> files;
+	if (!set_input_file.empty())
+		files.push_back(set_input_file);
+	for (const Glib::ustring& file : remaining_options_list)
+		if (file != set_input_file)
+			files.push_back(file);
+
+	if (files.size() > 1 && !set_output_file.empty())
+		throw SynfigToolException(SYNFIGTOOL_INVALIDOUTPUT,
+								  _("Output filename cannot be set when several input files are given."));
+
+	return files;
+}
+
+Job SynfigCommandLineParser::extract_job(const std::string& filename)
 {
 	Job job;
 
 	// Common input file loading
-	if (!set_input_file.empty())
+	if (!filename.empty())
 	{
-		job.filename = set_input_file;
+		job.filename = filename;
 
 		// Open the composition
 		std::string errors, warnings;
@@ -651,7 +698,9 @@ Job SynfigCommandLineParser::extract_job()
 			if (FileSystem::Handle file_system = CanvasFileNaming::make_filesystem(job.filename))
 			{
 				FileSystem::Identifier identifier = file_system->get_identifier(CanvasFileNaming::project_file(job.filename));
-				job.root = open_canvas_as(identifier, job.filename, errors, warnings);
+				job.root = sw_canvas_cache
+				         ? open_canvas_cached_as(identifier, job.filename, errors, warnings)
+				         : open_canvas_as(identifier, job.filename, errors, warnings);
 			}
 			else
 			{
@@ -43,7 +43,7 @@ public:
 	bool parse(int argc, char* argv[]);
 
 	/// Settings options
-	/// verbose, quiet, threads, benchmarks
+	/// verbose, quiet, threads, jobs, benchmarks, profile
 	void process_settings_options() const;
 
 	/// Trivial information options
@@ -55,10 +55,13 @@ public:
 	/// Options that will only display information
 	void process_info_options();
 
-	/// Extract the necessary options to create a job
+	/// Input files given by --input-file and the remaining arguments
+	std::vector<std::string> extract_input_files() const;
+
+	/// Extract the necessary options to create a job for the input file
 	/// After this, it is necessary to overwrite the necessary RendDesc options
 	/// and set the target parameters, if provided. Then can be processed
-	Job extract_job();
+	Job extract_job(const std::string& filename);
 
 	/// Overwrite the input RendDesc object with the options given in the command line
 	synfig::RendDesc extract_renddesc(const synfig::RendDesc& renddesc);
@@ -104,6 +107,7 @@ private:
 	int				set_antialias;
 	int				set_quality;
 	int				set_num_threads;
+	int				set_num_jobs;
 	Glib::ustring	set_input_file;
 	Glib::ustring	set_output_file;
 	Glib::ustring	set_sequence_separator;
@@ -122,11 +126,14 @@ private:
 	bool			sw_quiet;
 	bool			sw_print_benchmarks;
 	bool			sw_extract_alpha;
+	bool			sw_canvas_cache;
 
 	// Misc group
 	std::string		misc_append_filename;
 	Glib::ustring	misc_canvas_info;
 	bool			misc_canvases;
+	std::string		misc_profile_filename;
+	Glib::ustring	misc_profile_format;
 
 	//FFMPEG group
 	Glib::ustring	video_codec;
@@ -28,10 +28,27 @@
 #include <sstream>
 
 RenderProgress::RenderProgress()
-    : last_frame_(0), last_printed_line_length_(0),
+    : parent_(nullptr), job_index_(0), jobs_count_(0), finished_jobs_count_(0),
+      last_frame_(0), last_printed_line_length_(0),
       start_timepoint_(Clock::now()), last_timepoint_(Clock::now())
 { }
 
+RenderProgress::RenderProgress(RenderProgress& parent)
+    : parent_(&parent), job_index_(0), jobs_count_(0), finished_jobs_count_(0),
+      last_frame_(0), last_printed_line_length_(0),
+      start_timepoint_(Clock::now()), last_timepoint_(Clock::now())
+{
+    std::lock_guard<std::mutex> lock(parent.mutex_);
+    job_index_ = (int)parent.jobs_.size();
+    parent.jobs_.push_back(JobState());
+}
+
+void RenderProgress::set_jobs_count(int jobs_count)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_count_ = jobs_count;
+}
+
 bool RenderProgress::task(const std::string& taskname)
 {
     taskname_ = taskname;
@@ -40,12 +57,14 @@ bool RenderProgress::task(const std::string& taskname)
 
 bool RenderProgress::error(const std::string& task)
 {
+    std::lock_guard<std::mutex> lock(parent_ ? parent_->mutex_ : mutex_);
     std::cout << _("error") << ": " << task << std::endl;
     return true;
 }
 
 bool RenderProgress::warning(const std::string& task)
 {
+    std::lock_guard<std::mutex> lock(parent_ ? parent_->mutex_ : mutex_);
     std::cout << _("warning") << ": " << task << std::endl;
     return true;
 }
@@ -57,16 +76,63 @@ bool RenderProgress::amount_complete(int current_frame, int frames_count)
         return true;
     }
 
+    if (parent_)
+    {
+        parent_->jobProgress(*this, current_frame, frames_count);
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    printProgress(taskname_, current_frame, frames_count,
+                  current_frame == frames_count);
+    return true;
+}
+
+void RenderProgress::jobProgress(const RenderProgress& job,
+                                 int current_frame, int frames_count)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    JobState& state = jobs_[job.job_index_];
+    state.current_frame = current_frame;
+    state.frames_count = frames_count;
+    if (current_frame == frames_count && !state.finished)
+    {
+        state.finished = true;
+        ++finished_jobs_count_;
+        printLine("\r" + job.taskname_ + ": " + _("DONE"), true);
+    }
+
+    // frames of all jobs are summed, so the remaining time is estimated
+    // for the jobs started so far
+    int total_current_frame = 0;
+    int total_frames_count = 0;
+    for (const JobState& job_state : jobs_)
+    {
+        total_current_frame += job_state.current_frame;
+        total_frames_count += job_state.frames_count;
+    }
+
+    const std::string taskname =
+        etl::strprintf(_("%s (%d of %d jobs done)"),
+                       taskname_.c_str(), finished_jobs_count_, jobs_count_);
+    printProgress(taskname, total_current_frame, total_frames_count,
+                  finished_jobs_count_ >= jobs_count_);
+}
+
+void RenderProgress::printProgress(const std::string& taskname,
+                                   int current_frame, int frames_count,
+                                   bool isFinished)
+{
     std::ostringstream outputStream;
 
-    const bool isFinished = (current_frame == frames_count);
     if (!isFinished)
     {
         // avoid reporting the progress too often
         Duration time_since_last_call(Clock::now() - last_timepoint_);
         if (time_since_last_call.count() < 0.2)
         {
-            return true;
+            return;
         }
         last_timepoint_ = Clock::now();
 
@@ -78,7 +144,7 @@ bool RenderProgress::amount_complete(int current_frame, int frames_count)
 
         outputStream << "\r"
                      << etl::strprintf(_("%s: Frame %d of %d (%d%%). Remaining time: "), 
-                        taskname_.c_str(), current_frame, frames_count, percentage_completed);
+                        taskname.c_str(), current_frame, frames_count, percentage_completed);
 
         if (current_frame != last_frame_)
         {
@@ -93,10 +159,14 @@ bool RenderProgress::amount_complete(int current_frame, int frames_count)
     }
     else
     {
-        outputStream << "\r" << taskname_ << ": " << _("DONE");
+        outputStream << "\r" << taskname << ": " << _("DONE");
     }
 
-    const std::string line = outputStream.str();
+    printLine(outputStream.str(), isFinished);
+}
+
+void RenderProgress::printLine(const std::string& line, bool isFinished)
+{
     const std::string extendedLine =
         extendLineToClearRest(line, last_printed_line_length_);
     last_printed_line_length_ = line.size();
@@ -106,8 +176,6 @@ bool RenderProgress::amount_complete(int current_frame, int frames_count)
     {
         std::cerr << std::endl;
     }
-
-    return true;
 }
 
 void RenderProgress::printRemainingTime(std::ostream& os,
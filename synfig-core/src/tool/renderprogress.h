@@ -31,6 +31,8 @@
 #include <string>
 #include <iosfwd>
 #include <chrono>
+#include <vector>
+#include <mutex>
 #include <synfig/progresscallback.h>
 #include "definitions.h"
 
@@ -42,6 +44,13 @@ public:
 
     RenderProgress();
 
+    //! Creates the progress of one of the simultaneously rendered jobs,
+    //! it is reported to the \a parent which prints the summary of all jobs
+    explicit RenderProgress(RenderProgress& parent);
+
+    //! Sets the count of jobs which are reported to this progress
+    void set_jobs_count(int jobs_count);
+
     virtual bool task(const std::string& taskname);
 
     virtual bool error(const std::string& task);
@@ -50,6 +59,21 @@ public:
 
     virtual bool amount_complete(int scanline, int height);
 private:
+    struct JobState
+    {
+        int current_frame;
+        int frames_count;
+        bool finished;
+        JobState(): current_frame(), frames_count(), finished() { }
+    };
+
+    RenderProgress* parent_;
+    int job_index_;
+    std::mutex mutex_;
+    std::vector<JobState> jobs_;
+    int jobs_count_;
+    int finished_jobs_count_;
+
     std::string taskname_;
     int last_frame_;
     size_t last_printed_line_length_;
@@ -60,6 +84,13 @@ private:
     Clock::time_point last_timepoint_;
     double remaining_rendered_proportion_;
 
+    void jobProgress(const RenderProgress& job, int current_frame, int frames_count);
+
+    void printProgress(const std::string& taskname, int current_frame,
+                       int frames_count, bool isFinished);
+
+    void printLine(const std::string& line, bool isFinished);
+
     void printRemainingTime(std::ostream& os, double remaining_seconds) const;
 
     void printRemainingTime(std::ostream& os,
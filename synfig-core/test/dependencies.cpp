@@ -0,0 +1,190 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file dependencies.cpp
+**	\brief Test dependencies between rendering tasks
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <synfig/rendering/dependencies.h>
+
+using namespace synfig;
+using namespace rendering;
+
+class TaskTest: public Task
+{
+public:
+	typedef etl::handle<TaskTest> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+};
+
+Task::Token TaskTest::token(
+	DescAbstract<TaskTest>("Test") );
+
+const int width = 4096;
+const int height = 4096;
+
+std::vector<SurfaceResource::Handle> surfaces;
+
+Task::Handle create_task(int surface, const RectInt &rect)
+{
+	Task::Handle task = new TaskTest();
+	task->target_surface = surfaces[surface];
+	task->target_rect = rect;
+	task->source_rect = Rect(rect.minx, rect.miny, rect.maxx, rect.maxy);
+	return task;
+}
+
+RectInt random_rect(int size)
+{
+	int w = 1 + rand()%size, h = 1 + rand()%size;
+	int x = rand()%(width - w), y = rand()%(height - h);
+	return RectInt(x, y, x + w, y + h);
+}
+
+void create_surfaces(int count)
+{
+	surfaces.clear();
+	for(int i = 0; i < count; ++i) {
+		surfaces.push_back(new SurfaceResource());
+		surfaces.back()->create(width, height);
+	}
+}
+
+// random tasks which writes to the few surfaces and reads previous tasks
+Task::List create_random_list(int count, int surfaces_count, int size)
+{
+	Task::List list;
+	for(int i = 0; i < count; ++i) {
+		Task::Handle task = create_task(rand()%surfaces_count, random_rect(size));
+		for(int j = rand()%3; j > 0 && !list.empty(); --j)
+			task->sub_tasks.push_back(list[rand()%list.size()]);
+		list.push_back(task);
+	}
+	return list;
+}
+
+// each task is checked against all of previous tasks,
+// so it must depend on every conflicting task directly or through other tasks
+bool check_order(const Task::List &list)
+{
+	const int count = (int)list.size();
+	std::vector< std::vector<bool> > after(count, std::vector<bool>(count, false));
+	for(int i = 0; i < count; ++i) {
+		const Task::Set &deps = list[i]->renderer_data.deps;
+		for(Task::Set::const_iterator j = deps.begin(); j != deps.end(); ++j) {
+			int k = (*j)->renderer_data.index - 1;
+			if (k >= i) {
+				std::cerr << "task " << i << " depends on the next task " << k << std::endl;
+				return false;
+			}
+			if ((*j)->renderer_data.back_deps.count(list[i]) == 0) {
+				std::cerr << "task " << i << " is not in back dependencies of task " << k << std::endl;
+				return false;
+			}
+			after[i][k] = true;
+			for(int l = 0; l < k; ++l)
+				if (after[k][l]) after[i][l] = true;
+		}
+		for(int k = 0; k < i; ++k)
+			if (!after[i][k] && !list[i]->allow_run_before(*list[k])) {
+				std::cerr << "task " << i << " may run before conflicting task " << k << std::endl;
+				return false;
+			}
+	}
+	return true;
+}
+
+bool test_random()
+{
+	for(int pass = 0; pass < 8; ++pass) {
+		create_surfaces(1 + pass%3);
+		Task::List list = create_random_list(1500, (int)surfaces.size(), pass < 4 ? 256 : 2048);
+		Dependencies::build(list, pass + 1);
+		if (!check_order(list)) {
+			std::cerr << "random test failed at pass " << pass << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// 100k tasks: tiles of the frame are rendered and blended onto the few surfaces,
+// then surfaces are blended together by the large tasks
+bool test_stress()
+{
+	const int count = 100000;
+	const int tile = 32;
+	const int columns = width/tile;
+
+	create_surfaces(4);
+	Task::List list;
+	while((int)list.size() < count) {
+		int index = (int)list.size();
+		int surface = index % 4;
+		int t = (index/4) % (columns*columns);
+		RectInt rect(
+			(t%columns)*tile, (t/columns)*tile,
+			(t%columns + 1)*tile, (t/columns + 1)*tile );
+		Task::Handle task;
+		if (index % 10000 == 9999) {
+			task = create_task(surface, RectInt(0, 0, width, height));
+			for(int i = 1; i <= 4; ++i)
+				task->sub_tasks.push_back(list[index - i]);
+		} else {
+			task = create_task(surface, rect);
+			if (index >= 4)
+				task->sub_tasks.push_back(list[index - 4]);
+		}
+		list.push_back(task);
+	}
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	long long edges = Dependencies::build(list, 1);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	std::cout << "stress: " << count << " tasks, "
+	          << edges << " dependencies, "
+	          << seconds << " seconds" << std::endl;
+
+	if (edges > 4ll*count) {
+		std::cerr << "too many dependencies" << std::endl;
+		return false;
+	}
+	if (seconds > 10.0) {
+		std::cerr << "dependencies build too slow" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	srand(0);
+	if (!test_random())
+		return 1;
+	if (!test_stress())
+		return 1;
+	return 0;
+}
@@ -0,0 +1,222 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file framecache.cpp
+**	\brief Test the keys and the files of the on-disk frame cache
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <cstdlib>
+#include <iostream>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <synfig/canvas.h>
+#include <synfig/color.h>
+#include <synfig/context.h>
+#include <synfig/framecache.h>
+#include <synfig/general.h>
+#include <synfig/renddesc.h>
+#include <synfig/type.h>
+#include <synfig/layers/layer_solidcolor.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/surface.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+using namespace synfig;
+
+#define ASSERT(condition) {\
+	if (!(condition)) { \
+		std::cerr << __FUNCTION__ << ":" << __LINE__ << " - assertion failed: " << #condition << std::endl; \
+		return true; \
+	} \
+}
+
+const int width = 37;
+const int height = 23;
+
+rendering::SurfaceResource::Handle create_surface(int w, int h, Real seed)
+{
+	rendering::SurfaceResource::Handle surface = new rendering::SurfaceResource();
+	surface->create(w, h);
+	rendering::SurfaceResource::LockWrite<rendering::SurfaceSW> lock(surface);
+	Surface &s = lock->get_surface();
+	for(int y = 0; y < h; ++y)
+		for(int x = 0; x < w; ++x)
+			s[y][x] = Color(x/Real(w), y/Real(h), seed, 0.5 + 0.5*((x*7 + y*13)%5)/4.0);
+	return surface;
+}
+
+bool test_frame_key()
+{
+	RendDesc desc;
+	desc.set_wh(width, height);
+	desc.set_tl(Point(-2.0, 1.0));
+	desc.set_br(Point(2.0, -1.0));
+	const String key = FrameCache::get_frame_key("hash", desc, "software");
+
+	ASSERT(key == FrameCache::get_frame_key("hash", desc, "software"));
+	ASSERT(key != FrameCache::get_frame_key("other hash", desc, "software"));
+	ASSERT(key != FrameCache::get_frame_key("hash", desc, "draft"));
+
+	RendDesc other = desc;
+	other.set_wh(width + 1, height);
+	ASSERT(key != FrameCache::get_frame_key("hash", other, "software"));
+
+	other = desc;
+	other.set_subwindow(0, 0, width/2, height);
+	ASSERT(key != FrameCache::get_frame_key("hash", other, "software"));
+	return false;
+}
+
+bool test_canvas_hash()
+{
+	Canvas::Handle canvas = Canvas::create();
+	Layer::Handle layer = new Layer_SolidColor();
+	layer->set_param("color", Color(1.0, 0.5, 0.25, 1.0));
+	canvas->push_back(layer);
+
+	const ContextParams params;
+	const String hash = FrameCache::get_canvas_hash(*canvas, params);
+	ASSERT(hash == FrameCache::get_canvas_hash(*canvas, params));
+
+	layer->set_param("color", Color(0.0, 0.5, 0.25, 1.0));
+	ASSERT(hash != FrameCache::get_canvas_hash(*canvas, params));
+	layer->set_param("color", Color(1.0, 0.5, 0.25, 1.0));
+	ASSERT(hash == FrameCache::get_canvas_hash(*canvas, params));
+
+	// disabled layers are not rendered, so they don't change the frame
+	Layer::Handle disabled = new Layer_SolidColor();
+	disabled->set_active(false);
+	canvas->push_back(disabled);
+	ASSERT(hash == FrameCache::get_canvas_hash(*canvas, params));
+
+	canvas->set_time(Time(1.0));
+	ASSERT(hash != FrameCache::get_canvas_hash(*canvas, params));
+	return false;
+}
+
+bool test_load_store_round_trip()
+{
+	ASSERT(FrameCache::is_enabled());
+
+	rendering::SurfaceResource::Handle stored = create_surface(width, height, 0.75);
+	ASSERT(!FrameCache::contains("round_trip"));
+	ASSERT(FrameCache::save("round_trip", stored));
+	ASSERT(FrameCache::contains("round_trip"));
+
+	rendering::SurfaceResource::Handle loaded = new rendering::SurfaceResource();
+	loaded->create(width, height);
+	ASSERT(FrameCache::load("round_trip", loaded));
+
+	{
+		rendering::SurfaceResource::LockRead<rendering::SurfaceSW> stored_lock(stored);
+		rendering::SurfaceResource::LockRead<rendering::SurfaceSW> loaded_lock(loaded);
+		const Surface &a = stored_lock->get_surface();
+		const Surface &b = loaded_lock->get_surface();
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				ASSERT(a[y][x] == b[y][x]);
+	}
+
+	// the size is a part of the key, so the file of other size is removed as broken
+	rendering::SurfaceResource::Handle other = new rendering::SurfaceResource();
+	other->create(width + 1, height);
+	ASSERT(!FrameCache::load("round_trip", other));
+	ASSERT(!FrameCache::contains("round_trip"));
+
+	ASSERT(!FrameCache::load("missing", loaded));
+	return false;
+}
+
+bool test_size_limit()
+{
+	long long limit = FrameCache::get_size_limit();
+
+	// every file is over the limit, only the last stored one is kept
+	FrameCache::set_size_limit(1);
+	ASSERT(FrameCache::save("first", create_surface(width, height, 0.1)));
+	ASSERT(FrameCache::save("second", create_surface(width, height, 0.2)));
+	ASSERT(!FrameCache::contains("first"));
+	ASSERT(FrameCache::contains("second"));
+
+	FrameCache::set_size_limit(0);
+	ASSERT(FrameCache::save("third", create_surface(width, height, 0.3)));
+	ASSERT(FrameCache::contains("second"));
+	ASSERT(FrameCache::contains("third"));
+
+	FrameCache::set_size_limit(limit);
+	return false;
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+int main() {
+	// must be set before the first use of the cache
+	gchar *cache_dir = g_build_filename(g_get_tmp_dir(), "synfig-framecache-XXXXXX", nullptr);
+	if (!g_mkdtemp(cache_dir)) {
+		error("Cannot create temporary directory");
+		return 1;
+	}
+	g_setenv("SYNFIG_FRAME_CACHE_DIR", cache_dir, TRUE);
+
+	Type::subsys_init();
+	rendering::Renderer::subsys_init();
+
+	int failures = 0;
+	bool fail;
+	bool exception_thrown = false;
+
+	try {
+		TEST_FUNCTION(test_frame_key)
+		TEST_FUNCTION(test_canvas_hash)
+		TEST_FUNCTION(test_load_store_round_trip)
+		TEST_FUNCTION(test_size_limit)
+	} catch (...) {
+		error("Some exception has been thrown.");
+		exception_thrown = true;
+	}
+
+	if (failures || exception_thrown)
+		error("Test finished with %i errors and %i exception", failures, exception_thrown);
+	else
+		info("Success");
+
+	rendering::Renderer::subsys_stop();
+	Type::subsys_stop();
+
+	if (GDir *dir = g_dir_open(cache_dir, 0, nullptr)) {
+		while(const gchar *name = g_dir_read_name(dir)) {
+			gchar *filename = g_build_filename(cache_dir, name, nullptr);
+			g_remove(filename);
+			g_free(filename);
+		}
+		g_dir_close(dir);
+	}
+	g_rmdir(cache_dir);
+	g_free(cache_dir);
+
+	return (failures || exception_thrown)? 1 : 0;
+}
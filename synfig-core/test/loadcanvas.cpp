@@ -0,0 +1,143 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file loadcanvas.cpp
+**	\brief Test that the DOM and the streaming canvas loaders agree
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <synfig/bone.h>
+#include <synfig/canvas.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/general.h>
+#include <synfig/loadcanvas.h>
+#include <synfig/savecanvas.h>
+#include <synfig/type.h>
+#include <synfig/valuenodes/valuenode_bone.h>
+#include <synfig/valuenodes/valuenode_const.h>
+
+using namespace etl;
+using namespace synfig;
+
+#define ASSERT_EQUAL(expected, value) {\
+	if ((expected) != (value)) { \
+		std::cerr << __FUNCTION__ << ":" << __LINE__ << " - expected:" << std::endl << (expected) \
+		          << std::endl << "but got:" << std::endl << (value) << std::endl; \
+		return true; \
+	} \
+}
+
+// document with two bones, only one of them is referenced by the canvas,
+// the other one is kept alive by the <bones> section alone
+String build_rigged_document()
+{
+	Canvas::Handle canvas = Canvas::create();
+	canvas->set_name("Rig");
+
+	Bone arm_bone;
+	arm_bone.set_name("arm");
+	arm_bone.set_length(2.0);
+	ValueNode_Bone::Handle arm = ValueNode_Bone::create(arm_bone, canvas);
+
+	Bone spare_bone;
+	spare_bone.set_name("spare");
+	spare_bone.set_origin(Point(0.5, -0.5));
+	ValueNode_Bone::Handle spare = ValueNode_Bone::create(spare_bone, canvas);
+
+	canvas->add_value_node(ValueNode_Const::create(ValueBase(arm)), "arm");
+
+	return canvas_to_string(canvas);
+}
+
+Canvas::Handle load_file(const String &filename, bool use_dom, String &errors)
+{
+	if (use_dom)
+		setenv("SYNFIG_LOADER_USE_DOM", "1", 1);
+	else
+		unsetenv("SYNFIG_LOADER_USE_DOM");
+
+	String warnings;
+	Canvas::Handle canvas = open_canvas_as(FileSystemNative::instance()->get_identifier(filename), filename, errors, warnings);
+	unsetenv("SYNFIG_LOADER_USE_DOM");
+	return canvas;
+}
+
+bool test_rigged_canvas_loaders_agree()
+{
+	// separate files, loaders return already open canvases by their path
+	const String dom_filename = "loadcanvas_rig_dom.sif";
+	const String stream_filename = "loadcanvas_rig_stream.sif";
+
+	String document = build_rigged_document();
+	std::ofstream(dom_filename.c_str()) << document;
+	std::ofstream(stream_filename.c_str()) << document;
+
+	String dom_errors, stream_errors;
+	Canvas::Handle dom_canvas = load_file(dom_filename, true, dom_errors);
+	Canvas::Handle stream_canvas = load_file(stream_filename, false, stream_errors);
+	std::remove(dom_filename.c_str());
+	std::remove(stream_filename.c_str());
+
+	ASSERT_EQUAL(String(), dom_errors);
+	ASSERT_EQUAL(String(), stream_errors);
+	if (!dom_canvas || !stream_canvas) return true;
+
+	// the unreferenced bone must survive the loading too
+	ASSERT_EQUAL(2u, ValueNode_Bone::get_bone_map(dom_canvas).size());
+	ASSERT_EQUAL(2u, ValueNode_Bone::get_bone_map(stream_canvas).size());
+
+	ASSERT_EQUAL(canvas_to_string(dom_canvas), canvas_to_string(stream_canvas));
+	return false;
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+int main() {
+	Type::subsys_init();
+
+	int failures = 0;
+	bool fail;
+	bool exception_thrown = false;
+
+	try {
+		TEST_FUNCTION(test_rigged_canvas_loaders_agree)
+	} catch (...) {
+		error("Some exception has been thrown.");
+		exception_thrown = true;
+	}
+
+	if (failures || exception_thrown)
+		error("Test finished with %i errors and %i exception", failures, exception_thrown);
+	else
+		info("Success");
+
+	Type::subsys_stop();
+
+	return (failures || exception_thrown)? 1 : 0;
+}
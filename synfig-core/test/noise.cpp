@@ -0,0 +1,259 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file noise.cpp
+**	\brief Test batch evaluation of RandomNoise and rendering tasks of noise layers
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/general.h>
+#include <synfig/gradient.h>
+#include <synfig/threadpool.h>
+#include <synfig/type.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/surface.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#include <modules/mod_noise/distort.h>
+#include <modules/mod_noise/noise.h>
+#include <modules/mod_noise/random_noise.h>
+
+using namespace synfig;
+
+// tasks must render exactly the same image as the old per-pixel code,
+// so batch values are compared bit by bit
+bool test_batch(RandomNoise::SmoothType smooth, float time)
+{
+	const int n = RandomNoise::BATCH_SIZE;
+	RandomNoise random;
+	random.set_seed(12345);
+
+	for(int row = 0; row < 64; ++row)
+	{
+		float x[n], y[n], values[n];
+		for(int i = 0; i < n; ++i)
+		{
+			x[i] = (row*n + i)*0.137f - 30.f;
+			y[i] = row*0.731f - 20.f + i*0.01f;
+		}
+
+		random(smooth, 5, x, y, time, values);
+
+		for(int i = 0; i < n; ++i)
+		{
+			float expected = random(smooth, 5, x[i], y[i], time);
+			if (memcmp(&expected, &values[i], sizeof(float)))
+			{
+				std::cerr.precision(8);
+				std::cerr << __FUNCTION__ << ": smooth " << (int)smooth << ", time " << time
+				          << ", point (" << x[i] << ", " << y[i] << ")"
+				          << " - expected " << expected << ", but got " << values[i] << std::endl;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool test_batch_static()
+{
+	for(int smooth = RandomNoise::SMOOTH_DEFAULT; smooth <= RandomNoise::SMOOTH_FAST_SPLINE; ++smooth)
+		if (test_batch(RandomNoise::SmoothType(smooth), 0.f) || test_batch(RandomNoise::SmoothType(smooth), -3.f))
+			return true;
+	return false;
+}
+
+bool test_batch_animated()
+{
+	for(int smooth = RandomNoise::SMOOTH_DEFAULT; smooth <= RandomNoise::SMOOTH_CUBIC; ++smooth)
+		if (test_batch(RandomNoise::SmoothType(smooth), 1.25f) || test_batch(RandomNoise::SmoothType(smooth), -0.6f))
+			return true;
+	return false;
+}
+
+const int width = 64;
+const int height = 48;
+
+// layers of the canvas are given from top to bottom
+Canvas::Handle create_canvas(const std::vector<Layer::Handle> &layers)
+{
+	Canvas::Handle canvas = Canvas::create();
+	for(std::vector<Layer::Handle>::const_iterator i = layers.begin(); i != layers.end(); ++i)
+		canvas->push_back(*i);
+	return canvas;
+}
+
+Layer::Handle create_noise(int seed, const Vector &size, int detail, bool turbulent, bool do_alpha, bool super_sample)
+{
+	Layer::Handle layer = new Noise();
+	layer->set_param("gradient", ValueBase(Gradient(Color(1.f, 0.f, 0.f, 1.f), Color(0.f, 0.5f, 1.f, 1.f))));
+	layer->set_param("seed", ValueBase(seed));
+	layer->set_param("size", ValueBase(size));
+	layer->set_param("detail", ValueBase(detail));
+	layer->set_param("turbulent", ValueBase(turbulent));
+	layer->set_param("do_alpha", ValueBase(do_alpha));
+	layer->set_param("super_sample", ValueBase(super_sample));
+	return layer;
+}
+
+Layer::Handle create_distort(int seed, const Vector &displacement)
+{
+	Layer::Handle layer = new NoiseDistort();
+	layer->set_param("seed", ValueBase(seed));
+	layer->set_param("displacement", ValueBase(displacement));
+	layer->set_param("size", ValueBase(Vector(0.5, 0.5)));
+	layer->set_param("detail", ValueBase(3));
+	return layer;
+}
+
+// renders the canvas through the rendering tasks, like Target_Scanline does,
+// and compares pixels with Context::get_color() taken at their centers
+bool test_render(const String &name, const Canvas::Handle &canvas, Real max_mean_error, Real max_error)
+{
+	const Rect rect(-1.0, -0.75, 1.0, 0.75);
+	const Vector upp(rect.get_width()/width, rect.get_height()/height);
+
+	rendering::SurfaceResource::Handle surface = new rendering::SurfaceResource();
+	surface->create(width, height);
+
+	rendering::Task::Handle task = canvas->build_rendering_task(ContextParams());
+	if (!task) {
+		std::cerr << __FUNCTION__ << ": " << name << " - no task" << std::endl;
+		return true;
+	}
+	task->target_surface = surface;
+	task->target_rect = RectInt(0, 0, width, height);
+	task->source_rect = rect;
+	rendering::Renderer::get_renderer("software")->run(task);
+
+	rendering::SurfaceResource::LockRead<rendering::SurfaceSW> lock(surface);
+	if (!lock) {
+		std::cerr << __FUNCTION__ << ": " << name << " - no surface" << std::endl;
+		return true;
+	}
+	const Surface &s = lock->get_surface();
+
+	Context context = canvas->get_context(ContextParams());
+	Real sum_error = 0, worst_error = 0;
+	int count = 0;
+	for(int y = 0; y < height; ++y)
+	{
+		for(int x = 0; x < width; ++x)
+		{
+			Point point(rect.minx + (x + 0.5)*upp[0], rect.miny + (y + 0.5)*upp[1]);
+			Color expected = context.get_color(point).premult_alpha();
+			Color actual = s[y][x].premult_alpha();
+			const ColorReal errors[] = {
+				actual.get_r() - expected.get_r(),
+				actual.get_g() - expected.get_g(),
+				actual.get_b() - expected.get_b(),
+				actual.get_a() - expected.get_a() };
+			for(int i = 0; i < 4; ++i)
+			{
+				worst_error = std::max(worst_error, (Real)std::fabs(errors[i]));
+				sum_error += std::fabs(errors[i]);
+				++count;
+			}
+		}
+	}
+
+	Real mean_error = sum_error/count;
+	if (mean_error > max_mean_error || worst_error > max_error)
+	{
+		std::cerr << __FUNCTION__ << ": " << name
+		          << " - mean error " << mean_error << ", max error " << worst_error << std::endl;
+		return true;
+	}
+	return false;
+}
+
+// TaskNoiseSW::color_batch() evaluates the same octaves as Noise::color_func(),
+// only the coordinates are accumulated in another way
+bool test_noise_task()
+{
+	return test_render("plain", create_canvas({ create_noise(12345, Vector(1, 1), 4, false, false, false) }), 1e-4, 1e-3)
+	    || test_render("turbulent alpha", create_canvas({ create_noise(54321, Vector(0.7, 1.3), 5, true, true, false) }), 1e-4, 1e-3);
+}
+
+// Noise::get_color() has no pixel size to supersample with,
+// so the averaged gradient only may differ where the noise is steep
+bool test_noise_task_super_sample()
+{
+	return test_render("super sample", create_canvas({ create_noise(777, Vector(1, 1), 4, false, false, true) }), 0.02, 0.25);
+}
+
+// the distortion samples the rendered context with linear interpolation,
+// so the context is a smooth noise and errors are compared with tolerance
+bool test_noise_distort_task()
+{
+	return test_render("distort", create_canvas({
+			create_distort(4242, Vector(0.25, 0.25)),
+			create_noise(999, Vector(2, 2), 3, false, false, false) }), 0.005, 0.05)
+	    || test_render("distort alpha", create_canvas({
+			create_distort(2424, Vector(-0.4, 0.1)),
+			create_noise(111, Vector(1.5, 2), 2, false, true, false) }), 0.005, 0.05);
+}
+
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+int main() {
+	int failures = 0;
+	bool fail;
+	bool exception_thrown = false;
+
+	Type::subsys_init();
+	rendering::Renderer::subsys_init();
+	ThreadPool::subsys_init();
+
+	try {
+		TEST_FUNCTION(test_batch_static)
+		TEST_FUNCTION(test_batch_animated)
+		TEST_FUNCTION(test_noise_task)
+		TEST_FUNCTION(test_noise_task_super_sample)
+		TEST_FUNCTION(test_noise_distort_task)
+	} catch (...) {
+		error("Some exception has been thrown.");
+		exception_thrown = true;
+	}
+
+	if (failures || exception_thrown)
+		error("Test finished with %i errors and %i exception", failures, exception_thrown);
+	else
+		info("Success");
+
+	ThreadPool::subsys_stop();
+	rendering::Renderer::subsys_stop();
+	Type::subsys_stop();
+
+	return (failures || exception_thrown)? 1 : 0;
+}
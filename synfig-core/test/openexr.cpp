@@ -0,0 +1,175 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file openexr.cpp
+**	\brief Test the float to half conversion of the OpenEXR target
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <synfig/general.h>
+
+#include <modules/mod_openexr/trgt_openexr.h>
+
+using namespace synfig;
+
+float float_from_bits(unsigned int bits)
+{
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+unsigned int bits_from_float(float f)
+{
+	unsigned int bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+// converts values by exr_trgt, and compares them bit by bit with half(float)
+bool check_values(std::vector<float> values)
+{
+	// the target converts whole colors
+	while(values.size() % 4)
+		values.push_back(0.f);
+
+	std::vector<Imf::Rgba> colors(values.size()/4);
+	exr_trgt::convert_to_half(values.data(), colors.data(), (int)colors.size());
+
+	for(size_t i = 0; i < values.size(); ++i) {
+		const Imf::Rgba &color = colors[i/4];
+		const half &converted = i%4 == 0 ? color.r : i%4 == 1 ? color.g : i%4 == 2 ? color.b : color.a;
+		const half expected(values[i]);
+
+		// half(float) keeps the payload of NaN, the target writes the quiet NaN
+		const bool equal = expected.isNan()
+		                 ? converted.isNan() && converted.isNegative() == expected.isNegative()
+		                 : converted.bits() == expected.bits();
+		if (!equal) {
+			std::cerr << __FUNCTION__ << " - " << values[i] << " (0x" << std::hex
+			          << bits_from_float(values[i]) << ") converted to 0x"
+			          << converted.bits() << " instead of 0x" << expected.bits() << std::dec << std::endl;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<float> with_negatives(std::vector<float> values)
+{
+	const size_t count = values.size();
+	for(size_t i = 0; i < count; ++i)
+		values.push_back(-values[i]);
+	return values;
+}
+
+bool test_normals()
+{
+	return check_values(with_negatives({
+		0.f, 1.f, 0.1f, 1.f/3.f, 0.5f, 2.f, 1000.f, 12345.678f,
+		1.f + 1.f/2048.f,       // halfway, rounds down to even
+		1.f + 3.f/2048.f,       // halfway, rounds up to even
+		1.f + 1.f/2048.f + 1.f/65536.f,
+		6.103515625e-5f,        // the smallest normal half
+		6.1035156e-5f }));
+}
+
+bool test_denormals()
+{
+	return check_values(with_negatives({
+		5.9604645e-8f,          // the smallest denormal half
+		2.9802322e-8f,          // halfway to the smallest denormal, rounds to zero
+		2.9802326e-8f,
+		8.940697e-8f,           // halfway between 1 and 2 of the smallest denormals
+		1.4901161e-7f,          // halfway between 2 and 3 of the smallest denormals
+		1e-6f, 3.3e-5f, 6.09e-5f,
+		6.1029e-5f,             // rounds up to the smallest normal half
+		1e-10f,
+		std::numeric_limits<float>::denorm_min(),
+		std::numeric_limits<float>::min() }));
+}
+
+bool test_overflow()
+{
+	return check_values(with_negatives({
+		65504.f,                // the largest half
+		65519.f,                // rounds down to the largest half
+		65520.f,                // halfway to the infinity, rounds up
+		65535.f, 65536.f, 70000.f, 1e10f,
+		std::numeric_limits<float>::max() }));
+}
+
+bool test_special()
+{
+	return check_values(with_negatives({
+		std::numeric_limits<float>::infinity(),
+		std::numeric_limits<float>::quiet_NaN(),
+		std::numeric_limits<float>::signaling_NaN(),
+		float_from_bits(0x7f800001u),   // NaN with the lowest payload
+		float_from_bits(0x7fffffffu) }));
+}
+
+// every exponent and every mantissa of a normal half, with the dropped bits
+// around the rounding boundary of normals
+bool test_all_exponents()
+{
+	const unsigned int dropped[] = { 0x0000u, 0x0001u, 0x0fffu, 0x1000u, 0x1001u, 0x1fffu, 0x0a5au };
+	std::vector<float> values;
+	for(unsigned int exponent = 0; exponent < 256; ++exponent)
+		for(unsigned int mantissa = 0; mantissa < 1024; ++mantissa)
+			for(unsigned int low : dropped)
+				values.push_back(float_from_bits((exponent << 23) | (mantissa << 13) | low));
+	return check_values(with_negatives(values));
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+int main() {
+	int failures = 0;
+	bool fail;
+	bool exception_thrown = false;
+
+	try {
+		TEST_FUNCTION(test_normals)
+		TEST_FUNCTION(test_denormals)
+		TEST_FUNCTION(test_overflow)
+		TEST_FUNCTION(test_special)
+		TEST_FUNCTION(test_all_exponents)
+	} catch (...) {
+		error("Some exception has been thrown.");
+		exception_thrown = true;
+	}
+
+	if (failures || exception_thrown)
+		error("Test finished with %i errors and %i exception", failures, exception_thrown);
+	else
+		info("Success");
+
+	return (failures || exception_thrown)? 1 : 0;
+}
@@ -0,0 +1,154 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file palette.cpp
+**	\brief Test palette generation and search of closest colors
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <synfig/palette.h>
+#include <synfig/surface.h>
+#include <synfig/threadpool.h>
+
+using namespace synfig;
+
+const int width = 320;
+const int height = 180;
+
+ColorReal random_real()
+	{ return rand()/(ColorReal)RAND_MAX; }
+
+Color random_color()
+	{ return Color(random_real(), random_real(), random_real(), random_real() < 0.2 ? random_real() : 1.f); }
+
+// gradients with the few flat areas and transparent border
+void fill_surface(Surface &surface)
+{
+	surface.set_wh(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+		{
+			ColorReal fx = x/(ColorReal)width, fy = y/(ColorReal)height;
+			Color color(fx, fy, 0.5f + 0.5f*std::sin(fx*10.f), 1.f);
+			if ((x/40 + y/30) % 5 == 0)
+				color = Color(0.9f, 0.1f, 0.2f, 1.f);
+			if (x < 4 || y < 4)
+				color = Color::alpha();
+			surface[y][x] = color;
+		}
+}
+
+// error of opaque pixels, transparent ones should be mapped to transparent color
+Real mean_error(const Surface &surface, const Palette &palette)
+{
+	Real sum = 0;
+	int count = 0;
+	for(int y = 0; y < surface.get_h(); ++y)
+		for(int x = 0; x < surface.get_w(); ++x) {
+			float dist;
+			Palette::const_iterator i = palette.find_closest(surface[y][x], Gamma(), &dist);
+			if (surface[y][x].get_a() > 0) {
+				sum += dist;
+				++count;
+			} else
+			if (i->color.get_a() > 0.00001) {
+				return INFINITY;
+			}
+		}
+	return sum/count;
+}
+
+bool test_index()
+{
+	for(int pass = 0; pass < 20; ++pass) {
+		Palette palette;
+		for(int i = 1 + pass*13; i > 0; --i)
+			palette.push_back(random_color());
+		if (pass % 4 == 0)
+			palette.push_back(palette.front().color); // duplicated color
+		Gamma gamma(pass % 2 ? 2.2f : 1.f);
+
+		PaletteIndex index(palette, gamma);
+		PaletteIndex::Cache cache;
+		for(int i = 0; i < 2000; ++i) {
+			Color color = random_color();
+			float expected_dist, dist;
+			int expected = palette.find_closest(color, gamma, &expected_dist) - palette.begin();
+			int found = index.find(color, &dist);
+			if (std::fabs(dist - expected_dist) > 1e-5f) {
+				std::cerr << "index search differs from find_closest at pass " << pass
+				          << ": " << found << " (" << dist << ") instead of "
+				          << expected << " (" << expected_dist << ")" << std::endl;
+				return false;
+			}
+			int cached = index.find(color, cache);
+			if (cached < 0 || cached >= (int)palette.size() || cached != index.find(color, cache)) {
+				std::cerr << "cached search failed at pass " << pass << std::endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool test_quantize()
+{
+	Surface surface;
+	fill_surface(surface);
+
+	Palette palette(surface, 256, Gamma());
+	if (palette.size() > 256) {
+		std::cerr << "too many colors in palette: " << palette.size() << std::endl;
+		return false;
+	}
+	if (palette.find_closest(Color(1, 0, 1, 0), Gamma())->color.get_a() > 0.00001) {
+		std::cerr << "no transparent color in palette" << std::endl;
+		return false;
+	}
+
+	// uniform 6x6x6 color cube is the lower bound for quality
+	Palette uniform;
+	for(int r = 0; r < 6; ++r)
+		for(int g = 0; g < 6; ++g)
+			for(int b = 0; b < 6; ++b)
+				uniform.push_back(Color(r/5.f, g/5.f, b/5.f, 1.f));
+	uniform.push_back(Color::alpha());
+
+	Real error = mean_error(surface, palette);
+	Real uniform_error = mean_error(surface, uniform);
+	std::cout << "quantize: " << palette.size() << " colors, mean error " << error
+	          << ", uniform palette error " << uniform_error << std::endl;
+	if (!(error < uniform_error)) {
+		std::cerr << "palette is worse than uniform one" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	srand(0);
+	ThreadPool::subsys_init();
+	bool success = test_index() && test_quantize();
+	ThreadPool::subsys_stop();
+	return success ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file profile.cpp
+**	\brief Test recording of the rendering timings
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <synfig/debug/profile.h>
+
+using namespace synfig;
+using namespace debug;
+
+const int threads_count = 4;
+const int frames_count = 10;
+const int tasks_count = 100;
+
+void work(int index)
+{
+	Profile::set_thread_name("worker");
+	// every job has the same frame numbers
+	Profile::JobScope job_scope(index, "job");
+	for(int frame = 0; frame < frames_count; ++frame) {
+		Profile::FrameScope frame_scope(frame);
+		Profile::Scope scope("frame", "target");
+		for(int i = 0; i < tasks_count; ++i) {
+			Profile::Scope task_scope("TaskTest", "task");
+			Profile::Scope inner_scope("inner", "test");
+		}
+		{
+			Profile::Scope task_scope("TaskSleep", "task");
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+}
+
+bool test_histogram()
+{
+	Profile::Histogram h;
+	for(int i = 1; i <= 100; ++i)
+		h.add(i <= 90 ? 10 : 1000);
+
+	if (h.count != 100 || h.min != 10 || h.max != 1000) {
+		std::cerr << "wrong histogram count or bounds" << std::endl;
+		return false;
+	}
+	if (h.buckets[Profile::Histogram::get_bucket(10)] != 90) {
+		std::cerr << "wrong histogram bucket" << std::endl;
+		return false;
+	}
+	if (h.get_percentile(0.5) != 16 || h.get_percentile(0.99) != 1000) {
+		std::cerr << "wrong histogram percentiles" << std::endl;
+		return false;
+	}
+	if (Profile::Histogram::get_bucket(0) != 0 || Profile::Histogram::get_bucket(1) != 1
+	 || Profile::Histogram::get_bucket(2) != 2 || Profile::Histogram::get_bucket(3) != 2) {
+		std::cerr << "wrong histogram bucket bounds" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool test_threads()
+{
+	Profile::enable();
+	std::vector<std::thread> threads;
+	for(int i = 0; i < threads_count; ++i)
+		threads.push_back(std::thread(work, i));
+	for(int i = 0; i < threads_count; ++i)
+		threads[i].join();
+	Profile::disable();
+
+#ifdef SYNFIG_DISABLE_PROFILE
+	// scopes are compiled out (configure --disable-render-profiling)
+	if (!Profile::get_histograms().empty()) {
+		std::cerr << "events are recorded while profiling is compiled out" << std::endl;
+		return false;
+	}
+	return true;
+#endif
+
+	// events are not recorded while profiling is disabled
+	{ Profile::Scope scope("TaskTest", "task"); }
+
+	Profile::HistogramMap tasks = Profile::get_histograms("task");
+	if ( tasks.size() != 2
+	  || tasks["TaskTest"].count != threads_count*frames_count*tasks_count
+	  || tasks["TaskSleep"].count != threads_count*frames_count )
+	{
+		std::cerr << "wrong count of task events" << std::endl;
+		return false;
+	}
+	if (tasks["TaskSleep"].min < 2000) {
+		std::cerr << "wrong duration of task events" << std::endl;
+		return false;
+	}
+
+	Profile::HistogramMap all = Profile::get_histograms();
+	if (all.size() != 4 || all["frame"].count != threads_count*frames_count) {
+		std::cerr << "wrong count of events" << std::endl;
+		return false;
+	}
+
+	std::ostringstream summary;
+	Profile::write_summary(summary);
+	if ( summary.str().find("\"histograms\"") == std::string::npos
+	  || summary.str().find("\"dropped\": 0") == std::string::npos )
+	{
+		std::cerr << "wrong summary" << std::endl;
+		return false;
+	}
+
+	// frames with the same number are counted apart for each job
+	int first_frames = 0;
+	for(size_t pos = summary.str().find("\"frame\": 0,"); pos != std::string::npos; pos = summary.str().find("\"frame\": 0,", pos + 1))
+		++first_frames;
+	if (first_frames != threads_count || summary.str().find("\"job\": 3, \"name\": \"job\"") == std::string::npos) {
+		std::cerr << "frames are not grouped by jobs" << std::endl;
+		return false;
+	}
+
+	// enabling drops the previous events
+	Profile::enable();
+	Profile::disable();
+	if (!Profile::get_histograms().empty()) {
+		std::cerr << "events are not dropped" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	if (!test_histogram())
+		return 1;
+	if (!test_threads())
+		return 1;
+	return 0;
+}
@@ -0,0 +1,200 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file radialblur.cpp
+**	\brief Test multi-pass radial blur against direct sampling along the rays
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <synfig/general.h>
+#include <synfig/surface.h>
+#include <synfig/rendering/software/function/radialblur.h>
+
+using namespace synfig;
+using namespace rendering::software;
+
+const int width = 160;
+const int height = 120;
+
+// checkers with colored gradients inside of the opaque rectangle,
+// so the blur has hard edges both in color and in alpha
+void fill_source(Surface &surface)
+{
+	surface.set_wh(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+		{
+			bool inside = x > 16 && x < width - 16 && y > 8 && y < height - 8;
+			bool checker = ((x/11) + (y/7)) % 2;
+			surface[y][x] = inside
+			              ? Color(checker ? 1.f : 0.f, x/(float)width, y/(float)height, 1.f)
+			              : Color(0.f, 0.f, 0.f, 0.f);
+		}
+}
+
+// bilinear sample of premultiplied color, centers of pixels are at x.5
+Color sample(const Surface &surface, Real x, Real y)
+{
+	x -= 0.5; y -= 0.5;
+	int ix = (int)std::floor(x), iy = (int)std::floor(y);
+	ColorReal fx = (ColorReal)(x - ix), fy = (ColorReal)(y - iy);
+	Color c(0.f, 0.f, 0.f, 0.f);
+	for(int j = 0; j < 2; ++j)
+		for(int i = 0; i < 2; ++i)
+			if (ix + i >= 0 && iy + j >= 0 && ix + i < surface.get_w() && iy + j < surface.get_h())
+				c += surface[iy + j][ix + i].premult_alpha()*((i ? fx : 1 - fx)*(j ? fy : 1 - fy));
+	return c;
+}
+
+// direct integration along the ray with many samples
+Color reference(const Surface &surface, const Vector &point, const Vector &origin, Real size, bool fade_out)
+{
+	const int samples = 2000;
+	Color sum(0.f, 0.f, 0.f, 0.f);
+	Real sum_weight = 0;
+	for(int i = 0; i < samples; ++i)
+	{
+		Real t = (i + 0.5)/samples;
+		Real weight = fade_out ? 1 - t : 1;
+		Vector p = origin + (point - origin)*(1 - size*t);
+		sum += sample(surface, p[0], p[1])*(ColorReal)weight;
+		sum_weight += weight;
+	}
+	return sum/(ColorReal)sum_weight;
+}
+
+bool test_blur(const Vector &origin, Real size, bool fade_out)
+{
+	Surface src, dest;
+	fill_source(src);
+	dest.set_wh(width, height);
+	RadialBlur::blur(dest, RectInt(0, 0, width, height), src, VectorInt(0, 0), origin, size, fade_out);
+
+	// the blur resamples the image several times, so small details are a bit softer,
+	// compare average error and maximal error at hard edges
+	Real max_error = 0, sum_error = 0;
+	int count = 0;
+	for(int y = 0; y < height; y += 3)
+	{
+		for(int x = 0; x < width; x += 3)
+		{
+			Color expected = reference(src, Vector(x + 0.5, y + 0.5), origin, size, fade_out);
+			Color actual = dest[y][x].premult_alpha();
+			const ColorReal errors[] = {
+				actual.get_r() - expected.get_r(),
+				actual.get_g() - expected.get_g(),
+				actual.get_b() - expected.get_b(),
+				actual.get_a() - expected.get_a() };
+			for(int i = 0; i < 4; ++i)
+			{
+				max_error = std::max(max_error, (Real)std::fabs(errors[i]));
+				sum_error += std::fabs(errors[i]);
+				++count;
+			}
+		}
+	}
+
+	Real mean_error = sum_error/count;
+	if (mean_error > 0.01 || max_error > 0.2)
+	{
+		std::cerr << __FUNCTION__ << ": origin (" << origin[0] << ", " << origin[1] << ")"
+		          << ", size " << size << ", fade_out " << fade_out
+		          << " - mean error " << mean_error << ", max error " << max_error << std::endl;
+		return true;
+	}
+	return false;
+}
+
+bool test_blur_center()
+{
+	return test_blur(Vector(width*0.5, height*0.5), 0.2, false)
+	    || test_blur(Vector(width*0.5, height*0.5), 0.2, true)
+	    || test_blur(Vector(width*0.3, height*0.6), 0.05, false);
+}
+
+bool test_blur_corner()
+{
+	return test_blur(Vector(0.0, 0.0), 0.5, false)
+	    || test_blur(Vector(0.0, 0.0), 0.5, true);
+}
+
+bool test_blur_outside()
+{
+	return test_blur(Vector(width*2.0, -height*0.5), 0.9, true)
+	    || test_blur(Vector(-width*0.5, height*0.5), 0.3, false);
+}
+
+bool test_blur_to_origin()
+{
+	return test_blur(Vector(width*0.5, height*0.5), 1.0, false)
+	    || test_blur(Vector(width*0.5, height*0.5), 1.0, true);
+}
+
+bool test_blur_zero()
+{
+	Surface src, dest;
+	fill_source(src);
+	dest.set_wh(width, height);
+	RadialBlur::blur(dest, RectInt(0, 0, width, height), src, VectorInt(0, 0), Vector(10.0, 10.0), 0.0, false);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			if ( std::fabs(dest[y][x].get_a() - src[y][x].get_a()) > 1e-6
+			  || (src[y][x].get_a() && std::fabs(dest[y][x].get_r() - src[y][x].get_r()) > 1e-6) )
+			{
+				std::cerr << __FUNCTION__ << ": pixel (" << x << ", " << y << ") is changed" << std::endl;
+				return true;
+			}
+	return false;
+}
+
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+int main() {
+	int failures = 0;
+	bool fail;
+	bool exception_thrown = false;
+
+	try {
+		TEST_FUNCTION(test_blur_zero)
+		TEST_FUNCTION(test_blur_center)
+		TEST_FUNCTION(test_blur_corner)
+		TEST_FUNCTION(test_blur_outside)
+		TEST_FUNCTION(test_blur_to_origin)
+	} catch (...) {
+		error("Some exception has been thrown.");
+		exception_thrown = true;
+	}
+
+	if (failures || exception_thrown)
+		error("Test finished with %i errors and %i exception", failures, exception_thrown);
+	else
+		info("Success");
+
+	return (failures || exception_thrown)? 1 : 0;
+}
@@ -0,0 +1,167 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file savecanvas.cpp
+**	\brief Test canvas saving and the XML writer
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#include <sstream>
+#include <iostream>
+
+#include <libxml++/libxml++.h>
+
+#include <synfig/canvas.h>
+#include <synfig/color.h>
+#include <synfig/general.h>
+#include <synfig/loadcanvas.h>
+#include <synfig/savecanvas.h>
+#include <synfig/type.h>
+#include <synfig/valuenodes/valuenode_animated.h>
+#include <synfig/valuenodes/valuenode_const.h>
+#include <synfig/xmlwriter.h>
+
+using namespace etl;
+using namespace synfig;
+
+#define ASSERT_EQUAL(expected, value) {\
+	if ((expected) != (value)) { \
+		std::cerr << __FUNCTION__ << ":" << __LINE__ << " - expected:" << std::endl << (expected) \
+		          << std::endl << "but got:" << std::endl << (value) << std::endl; \
+		return true; \
+	} \
+}
+
+// builds the same document with xmlpp::Element and with XmlElement
+template<typename T>
+void build_document(T *root)
+{
+	root->set_attribute("version", "1.2");
+	root->set_attribute("desc", "quotes \" amp & lt < gt > \n\t\r");
+	root->set_attribute("version", "1.3");
+	root->add_child("name")->set_child_text("text & <text>\r\n\ttext \"text\" \xc3\xa9");
+	T *layer = root->add_child("layer");
+	layer->set_attribute("type", "circle");
+	T *param = layer->add_child("param");
+	param->set_attribute("name", "origin");
+	T *value = param->add_child("value");
+	value->set_name("vector");
+	value->add_child("x")->set_child_text("0.0000000000");
+	value->add_child("y")->set_child_text("-1.5000000000");
+	value->set_attribute("static", "true");
+	layer->add_child("param")->add_child("string")->set_child_text("");
+	layer->add_child("param")->add_child("real")->set_attribute("value", "1.0000000000");
+	root->add_child("layer")->set_attribute("type", "rectangle");
+}
+
+bool test_xml_writer_format()
+{
+	xmlpp::Document document;
+	build_document(document.create_root_node("canvas"));
+	String expected = document.write_to_string_formatted();
+
+	std::ostringstream stream;
+	XmlWriter writer(stream);
+	build_document(writer.create_root_node("canvas"));
+	writer.finish();
+
+	ASSERT_EQUAL(expected, stream.str());
+	return false;
+}
+
+bool test_xml_writer_empty_root()
+{
+	xmlpp::Document document;
+	document.create_root_node("canvas")->set_attribute("width", "480");
+	String expected = document.write_to_string_formatted();
+
+	std::ostringstream stream;
+	XmlWriter writer(stream);
+	writer.create_root_node("canvas")->set_attribute("width", "480");
+	writer.finish();
+
+	ASSERT_EQUAL(expected, stream.str());
+	return false;
+}
+
+bool test_canvas_round_trip()
+{
+	Canvas::Handle canvas = Canvas::create();
+	canvas->set_name("Round trip");
+	canvas->set_description("<description> & \"quotes\"");
+	canvas->rend_desc().set_w(640);
+	canvas->rend_desc().set_h(360);
+	canvas->set_meta_data("grid_size", "0.250000 0.250000");
+
+	canvas->add_value_node(ValueNode_Const::create(Real(0.125)), "real");
+	canvas->add_value_node(ValueNode_Const::create(Vector(1.5, -2.25)), "vector");
+	canvas->add_value_node(ValueNode_Const::create(Color(1.0, 0.5, 0.25, 1.0)), "color");
+	canvas->add_value_node(ValueNode_Const::create(String("text & <text>")), "string");
+	canvas->add_value_node(ValueNode_Const::create(String()), "empty_string");
+
+	ValueNode_Animated::Handle animated = ValueNode_Animated::create(type_real);
+	animated->new_waypoint(Time(0), ValueBase(Real(0.0)));
+	animated->new_waypoint(Time(1), ValueBase(Real(2.5)));
+	canvas->add_value_node(animated, "animated");
+
+	String saved = canvas_to_string(canvas);
+
+	xmlpp::DomParser parser;
+	parser.parse_memory(saved);
+	String errors, warnings;
+	Canvas::Handle loaded = open_canvas(parser.get_document()->get_root_node(), errors, warnings);
+	ASSERT_EQUAL(String(), errors);
+	if (!loaded) return true;
+
+	ASSERT_EQUAL(saved, canvas_to_string(loaded));
+	return false;
+}
+
+#define TEST_FUNCTION(function_name) {\
+	fail = function_name(); \
+	if (fail) { \
+		error("%s FAILED", #function_name); \
+		failures++; \
+	} \
+}
+
+int main() {
+	Type::subsys_init();
+
+	int failures = 0;
+	bool fail;
+	bool exception_thrown = false;
+
+	try {
+		TEST_FUNCTION(test_xml_writer_format)
+		TEST_FUNCTION(test_xml_writer_empty_root)
+		TEST_FUNCTION(test_canvas_round_trip)
+	} catch (...) {
+		error("Some exception has been thrown.");
+		exception_thrown = true;
+	}
+
+	if (failures || exception_thrown)
+		error("Test finished with %i errors and %i exception", failures, exception_thrown);
+	else
+		info("Success");
+
+	Type::subsys_stop();
+
+	return (failures || exception_thrown)? 1 : 0;
+}
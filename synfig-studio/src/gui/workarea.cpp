@@ -182,6 +182,10 @@ WorkArea::WorkArea(etl::loose_handle<synfigapp::CanvasInterface> canvas_interfac
 	insert_renderer(new Renderer_BoneSetup,  501);
 	insert_renderer(new Renderer_FrameError, 502);
 
+	// track which layers are changed to keep the tiles outside of the changed region
+	get_canvas()->signal_child_changed().connect(sigc::mem_fun(*renderer_canvas, &Renderer_Canvas::on_canvas_child_changed));
+	get_canvas()->signal_changed().connect(sigc::mem_fun(*renderer_canvas, &Renderer_Canvas::on_canvas_changed));
+
 	signal_duck_selection_changed().connect(sigc::mem_fun(*this,&studio::WorkArea::queue_draw));
 	signal_duck_selection_single().connect(sigc::mem_fun(*this, &studio::WorkArea::on_duck_selection_single));
 	signal_strokes_changed().connect(sigc::mem_fun(*this,&studio::WorkArea::queue_draw));
@@ -2134,7 +2138,7 @@ void
 WorkArea::sync_render(bool refresh)
 {
 	dirty_trap_queued = 0;
-	if (refresh) renderer_canvas->clear_render();
+	if (refresh) renderer_canvas->clear_changed_render();
 	renderer_canvas->enqueue_render();
 	renderer_canvas->wait_render();
 
@@ -2163,7 +2167,7 @@ studio::WorkArea::queue_render(bool refresh)
 	// avoiding dead-lock : github#1071
 	Glib::signal_idle().connect_once(sigc::track_obj([=] () {
 		if (refresh) {
-			renderer_canvas->clear_render();
+			renderer_canvas->clear_changed_render();
 			Glib::signal_idle().connect_once(
 						sigc::mem_fun(*renderer_canvas, &Renderer_Canvas::enqueue_render),
 						Glib::PRIORITY_DEFAULT );
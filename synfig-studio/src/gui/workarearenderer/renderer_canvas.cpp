@@ -35,12 +35,18 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
 #include <cstring>
 #include <valarray>
 
 #include <synfig/general.h>
 #include <synfig/context.h>
+#include <synfig/framecache.h>
 #include <synfig/threadpool.h>
+#include <synfig/layers/layer_composite_fork.h>
+#include <synfig/layers/layer_filtergroup.h>
+#include <synfig/layers/layer_pastecanvas.h>
+#include <synfig/valuenodes/valuenode_const.h>
 #include <synfig/rendering/renderer.h>
 #include <synfig/rendering/common/task/tasktransformation.h>
 
@@ -80,6 +86,40 @@ static long long
 image_rect_size(const RectInt &rect)
 	{ return 4ll*rect.get_width()*rect.get_height(); }
 
+//! output pixel of the layer depends only on the same pixel of its context
+static bool
+is_layer_pixel_local(const Layer &layer)
+{
+	return dynamic_cast<const Layer_Composite*>(&layer)
+	    && !dynamic_cast<const Layer_CompositeFork*>(&layer)
+	    && !dynamic_cast<const Layer_FilterGroup*>(&layer);
+}
+
+//! bounds of the layer doesn't depend on time
+static bool
+is_layer_time_static(const Layer &layer)
+{
+	const Layer::DynamicParamList &params = layer.dynamic_param_list();
+	for(Layer::DynamicParamList::const_iterator i = params.begin(); i != params.end(); ++i)
+		if (!ValueNode_Const::Handle::cast_dynamic(i->second))
+			return false;
+	if (const Layer_PasteCanvas *paste = dynamic_cast<const Layer_PasteCanvas*>(&layer))
+		if (Canvas::Handle sub_canvas = paste->get_sub_canvas())
+			for(Canvas::const_iterator i = sub_canvas->begin(); i != sub_canvas->end(); ++i)
+				if (!is_layer_time_static(**i))
+					return false;
+	return true;
+}
+
+//! reads the tile from the disk cache, called from the other threads
+static void
+load_cached_tile(String key, rendering::SurfaceResource::Handle surface, rendering::TaskEvent::Handle event)
+{
+	// event is already finished if tile was removed before the loading
+	if (!event->is_finished())
+		event->finish(FrameCache::load(key, surface));
+}
+
 /* === M E T H O D S ======================================================= */
 
 Renderer_Canvas::Renderer_Canvas():
@@ -94,7 +134,10 @@ Renderer_Canvas::Renderer_Canvas():
 	max_enqueued_tasks (6),
 	enqueued_tasks(),
 	tiles_size(),
-	pixel_format()
+	pixel_format(),
+	layer_regions_valid(),
+	child_change_pending(),
+	unknown_change()
 {
 	// check endianness
     union { int i; char c[4]; } checker = {0x01020304};
@@ -230,8 +273,12 @@ Renderer_Canvas::on_tile_finished(bool success, const Tile::Handle &tile)
 	// 'tiles', 'onion_frames', 'refresh_id', and 'tiles_size' are controlled by mutex
 
 	Cairo::RefPtr<Cairo::ImageSurface> cairo_surface;
-	if (success && tile->surface)
+	if (success && tile->surface) {
+		// key depends on the content only, so store the tile even if it is already outdated
+		if (!tile->cache_key.empty() && !tile->from_cache)
+			FrameCache::save(tile->cache_key, tile->surface);
 		cairo_surface = convert(tile->surface, tile->rect.get_width(), tile->rect.get_height());
+	}
 
 	std::lock_guard<std::mutex> lock(mutex);
 
@@ -240,6 +287,17 @@ Renderer_Canvas::on_tile_finished(bool success, const Tile::Handle &tile)
 	if (!tile->event && !tile->surface && !tile->cairo_surface)
 		return; // tile is already removed
 
+	if (!success && tile->from_cache) {
+		// cache file is lost or broken, remove the tile to render it on the next pass
+		TileMap::iterator i = tiles.find(tile->frame_id);
+		if (i != tiles.end()) {
+			TileList::iterator j = std::find(i->second.begin(), i->second.end(), tile);
+			rendering::Task::List events; // event is already finished
+			if (j != i->second.end())
+				erase_tile(i->second, j, events);
+		}
+	}
+
 	tile->event.reset();
 	tile->cairo_surface = cairo_surface;
 	tile->surface.reset();
@@ -522,21 +580,17 @@ Renderer_Canvas::enqueue_render_frame(
 	}
 
 	canvas->set_outline_grow(rend_desc.get_outline_grow());
-	rendering::Task::Handle task = canvas->build_rendering_task(context_params);
-
-	// add transformation task to flip result if needed
-	if (task && transform) {
-		rendering::TaskTransformationAffine::Handle t = new rendering::TaskTransformationAffine();
-		t->transformation->matrix = matrix;
-		t->sub_task() = task;
-		task = t;
-	}
 
-	// TaskSurface assumed as valid non-trivial task by renderer
-	// and TaskTransformationAffine of TaskSurface will not be optimized.
-	// To avoid this construction place creation of dummy TaskSurface here.
-	if (!task) task = new rendering::TaskSurface();
+	// tiles rendered before (in this or in previous sessions) are taken from the disk cache,
+	// so look them up before the rendering task is built, it may be not needed at all
+	String cache_hash;
+	if (FrameCache::is_enabled()) {
+		cache_hash = FrameCache::get_canvas_hash(*canvas, context_params);
+		if (transform)
+			cache_hash += etl::strprintf(":%f:%f", matrix.m00, matrix.m11);
+	}
 
+	rendering::Task::Handle task;
 	for(std::vector<RectInt>::iterator j = rects.begin(); j != rects.end(); ++j) {
 		// snap rect corners to tile grid
 		RectInt &rect = *j;
@@ -549,6 +603,49 @@ Renderer_Canvas::enqueue_render_frame(
 		RendDesc tile_desc=rend_desc;
 		tile_desc.set_subwindow(rect.minx, rect.miny, rect.get_width(), rect.get_height());
 
+		String cache_key;
+		if (!cache_hash.empty())
+			cache_key = FrameCache::get_frame_key(cache_hash, tile_desc, renderer->get_name());
+
+		if (!cache_key.empty() && FrameCache::contains(cache_key)) {
+			// reading and unpacking of the file are done by the other thread
+			Tile::Handle tile = new Tile(id, *j);
+			tile->surface = new rendering::SurfaceResource();
+			tile->surface->create(tile_desc.get_w(), tile_desc.get_h());
+			tile->cache_key = cache_key;
+			tile->from_cache = true;
+
+			tile->event = new rendering::TaskEvent();
+			tile->event->signal_finished.connect( sigc::bind(
+				sigc::ptr_fun(&on_tile_finished_callback), this, tile ));
+
+			insert_tile(frame_tiles, tile);
+
+			++enqueued_tasks;
+
+			ThreadPool::instance().enqueue( sigc::bind(
+				sigc::ptr_fun(&load_cached_tile),
+				cache_key, tile->surface, tile->event ));
+			continue;
+		}
+
+		if (!task) {
+			task = canvas->build_rendering_task(context_params);
+
+			// add transformation task to flip result if needed
+			if (task && transform) {
+				rendering::TaskTransformationAffine::Handle t = new rendering::TaskTransformationAffine();
+				t->transformation->matrix = matrix;
+				t->sub_task() = task;
+				task = t;
+			}
+
+			// TaskSurface assumed as valid non-trivial task by renderer
+			// and TaskTransformationAffine of TaskSurface will not be optimized.
+			// To avoid this construction place creation of dummy TaskSurface here.
+			if (!task) task = new rendering::TaskSurface();
+		}
+
 		rendering::Task::Handle tile_task = task->clone_recursive();
 		tile_task->target_surface = new rendering::SurfaceResource();
 		tile_task->target_surface->create(tile_desc.get_w(), tile_desc.get_h());
@@ -557,6 +654,7 @@ Renderer_Canvas::enqueue_render_frame(
 
 		Tile::Handle tile = new Tile(id, *j);
 		tile->surface = tile_task->target_surface;
+		tile->cache_key = cache_key;
 
 		tile->event = new rendering::TaskEvent();
 		tile->event->signal_finished.connect( sigc::bind(
@@ -607,6 +705,13 @@ Renderer_Canvas::enqueue_render()
 				Time orig_time = canvas->get_time();
 				int enqueued = 0;
 
+				// remember regions of layers before they will be changed
+				if (!layer_regions_valid || layer_regions_time != orig_time) {
+					build_layer_regions(*canvas, layer_regions);
+					layer_regions_time = orig_time;
+					layer_regions_valid = true;
+				}
+
 				// generate rendering task for thumbnail
 				// do it first to be sure that thumbnails will always fully covered by the single tile
 				if (enqueue_render_frame(renderer, canvas, current_thumb.rect(), current_thumb))
@@ -737,6 +842,134 @@ Renderer_Canvas::clear_render()
 		get_work_area()->signal_rendering()();
 }
 
+void
+Renderer_Canvas::build_layer_regions(const Canvas &canvas, LayerRegionMap &out_regions)
+{
+	out_regions.clear();
+	// the change spreads through the layers above without growing only if all of them are pixel-local
+	bool above_local = true;
+	for(Canvas::const_iterator i = canvas.begin(); i != canvas.end(); ++i) {
+		const Layer &layer = **i;
+		LayerRegion &region = out_regions[&layer];
+		region.rect = layer.get_bounding_rect();
+		region.local = above_local
+		            && is_layer_pixel_local(layer)
+		            && !Color::is_straight(static_cast<const Layer_Composite&>(layer).get_blend_method())
+		            && !region.rect.is_nan_or_inf();
+		region.time_static = is_layer_time_static(layer);
+		if (layer.active() && !is_layer_pixel_local(layer))
+			above_local = false;
+	}
+}
+
+void
+Renderer_Canvas::clear_render_region(const Rect &rect, const Time &time, bool all_times, rendering::Task::List &events)
+{
+	// mutex must be already locked
+	RendDesc rend_desc = get_work_area()->get_canvas()->rend_desc();
+	rend_desc.clear_flags();
+
+	for(TileMap::iterator i = tiles.begin(); i != tiles.end(); ++i) {
+		TileList &frame_tiles = i->second;
+		if (!all_times && i->first.time != time) {
+			while(!frame_tiles.empty())
+				erase_tile(frame_tiles, frame_tiles.begin(), events);
+			continue;
+		}
+
+		// convert region to pixels of the frame, add one pixel for antialiasing
+		rend_desc.set_wh(i->first.width, i->first.height);
+		Vector tl = rend_desc.get_tl();
+		Vector br = rend_desc.get_br();
+		Vector k( i->first.width/(br[0] - tl[0]), i->first.height/(br[1] - tl[1]) );
+		Real x0 = (rect.minx - tl[0])*k[0], x1 = (rect.maxx - tl[0])*k[0];
+		Real y0 = (rect.miny - tl[1])*k[1], y1 = (rect.maxy - tl[1])*k[1];
+		RectInt pixel_rect(
+			(int)std::floor(std::min(x0, x1)) - 1, (int)std::floor(std::min(y0, y1)) - 1,
+			(int)std::ceil (std::max(x0, x1)) + 1, (int)std::ceil (std::max(y0, y1)) + 1 );
+
+		for(TileList::iterator j = frame_tiles.begin(); j != frame_tiles.end(); )
+			if (*j && ((*j)->rect && pixel_rect))
+				j = erase_tile(frame_tiles, j, events);
+			else
+				++j;
+	}
+
+	// remove empty entries from tiles map
+	for(TileMap::iterator i = tiles.begin(); i != tiles.end(); )
+		if (i->second.empty()) tiles.erase(i++); else ++i;
+}
+
+void
+Renderer_Canvas::clear_changed_render()
+{
+	bool known = layer_regions_valid && !unknown_change && !changed_nodes.empty();
+	std::set<const Node*> nodes;
+	nodes.swap(changed_nodes);
+	unknown_change = false;
+	child_change_pending = false;
+
+	Canvas::Handle canvas = get_work_area() ? get_work_area()->get_canvas() : Canvas::Handle();
+	if (!known || !canvas) {
+		layer_regions_valid = false;
+		clear_render();
+		return;
+	}
+
+	Time time = canvas->get_time();
+	LayerRegionMap new_regions;
+	build_layer_regions(*canvas, new_regions);
+
+	Rect rect = Rect::zero();
+	bool all_times = true;
+	for(std::set<const Node*>::const_iterator i = nodes.begin(); i != nodes.end() && known; ++i) {
+		LayerRegionMap::const_iterator old_region = layer_regions.find(*i);
+		LayerRegionMap::const_iterator new_region = new_regions.find(*i);
+		if ( old_region == layer_regions.end() || new_region == new_regions.end()
+		  || !old_region->second.local || !new_region->second.local
+		  || (layer_regions_time != time && !old_region->second.time_static) )
+			{ known = false; break; }
+		rect |= old_region->second.rect;
+		rect |= new_region->second.rect;
+		all_times = all_times && old_region->second.time_static && new_region->second.time_static;
+	}
+
+	layer_regions.swap(new_regions);
+	layer_regions_time = time;
+	layer_regions_valid = true;
+
+	if (!known) {
+		clear_render();
+		return;
+	}
+
+	rendering::Task::List events;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (rect.is_valid())
+			clear_render_region(rect, time, all_times, events);
+	}
+	rendering::Renderer::cancel(events);
+	if (get_work_area())
+		get_work_area()->signal_rendering()();
+}
+
+void
+Renderer_Canvas::on_canvas_child_changed(const Node *node)
+{
+	child_change_pending = true;
+	changed_nodes.insert(node);
+}
+
+void
+Renderer_Canvas::on_canvas_changed()
+{
+	// canvas emits 'changed' after each 'child_changed', other changes are unknown
+	if (!child_change_pending)
+		unknown_change = true;
+	child_change_pending = false;
+}
+
 Renderer_Canvas::FrameStatus
 Renderer_Canvas::merge_status(FrameStatus a, FrameStatus b) {
 	static const FrameStatus map[FS_Count][FS_Count] = {
@@ -33,6 +33,7 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include <synfig/canvas.h>
 #include <synfig/rendering/task.h>
@@ -123,10 +124,21 @@ public:
 		synfig::rendering::TaskEvent::Handle event;
 		synfig::rendering::SurfaceResource::Handle surface;
 		Cairo::RefPtr<Cairo::ImageSurface> cairo_surface;
+		synfig::String cache_key; //!< key in synfig::FrameCache, empty if cache is disabled
+		bool from_cache;          //!< tile is read from synfig::FrameCache instead of rendering
 
-		Tile() { }
+		Tile(): from_cache() { }
 		Tile(const FrameId &frame_id, synfig::RectInt &rect):
-			frame_id(frame_id), rect(rect) { }
+			frame_id(frame_id), rect(rect), from_cache() { }
+	};
+
+	//! region of the top-level layer taken before the change of canvas
+	class LayerRegion {
+	public:
+		synfig::Rect rect;
+		bool local;       //!< changes of layer affect only pixels inside of rect
+		bool time_static; //!< rect is the same at any time
+		LayerRegion(): local(), time_static() { }
 	};
 
 	typedef std::map<synfig::Time, FrameStatus> StatusMap;
@@ -134,6 +146,7 @@ public:
 	typedef std::vector<FrameDesc> FrameList;
 	typedef std::vector<Tile::Handle> TileList;
 	typedef std::map<FrameId, TileList> TileMap;
+	typedef std::map<const synfig::Node*, LayerRegion> LayerRegionMap;
 
 private:
 	// cache options
@@ -172,6 +185,14 @@ private:
 	Cairo::RefPtr<Cairo::ImageSurface> alpha_dst_surface;
 	Cairo::RefPtr<Cairo::Context> alpha_context;
 
+	//! change tracking, all these fields are accessed from the main thread only
+	LayerRegionMap layer_regions;
+	synfig::Time layer_regions_time;
+	bool layer_regions_valid;
+	std::set<const synfig::Node*> changed_nodes;
+	bool child_change_pending;
+	bool unknown_change;
+
 	synfig::Vector previous_tl;
 	synfig::Vector previous_br;
 	Cairo::RefPtr<Cairo::ImageSurface> previous_surface;
@@ -218,6 +239,12 @@ private:
 
 	std::map<synfig::Time, std::set<std::string>> rendering_error_msg_map;
 
+	//! collects regions of top-level layers of canvas at its current time
+	static void build_layer_regions(const synfig::Canvas &canvas, LayerRegionMap &out_regions);
+
+	//! mutex must be locked before call
+	void clear_render_region(const synfig::Rect &rect, const synfig::Time &time, bool all_times, synfig::rendering::Task::List &events);
+
 public:
 	Renderer_Canvas();
 	~Renderer_Canvas();
@@ -227,6 +254,13 @@ public:
 	void enqueue_render();
 	void wait_render();
 	void clear_render();
+	//! removes only tiles affected by the canvas changes since the previous call
+	//! falls back to clear_render() when affected region is unknown
+	void clear_changed_render();
+
+	// change tracking, connected to signals of the canvas
+	void on_canvas_child_changed(const synfig::Node *node);
+	void on_canvas_changed();
 
 	void get_render_status(StatusMap &out_map);
 